@@ -0,0 +1,562 @@
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include "CollisionProbe.hpp"
+
+//does the segment go through the box anywhere
+static bool segmentMeetsBox(const Eigen::Vector3f& from, const Eigen::Vector3f& to, const Eigen::AlignedBox3f& box) {
+	Eigen::Vector3f dir = to - from;
+	float t_min = 0;
+	float t_max = 1;
+	for (int axis = 0; axis < 3; axis++) {
+		if (dir(axis) == 0) {
+			if (from(axis) < box.min()(axis) || from(axis) > box.max()(axis)) {
+				return false;
+			}
+			continue;
+		}
+		float t0 = (box.min()(axis) - from(axis)) / dir(axis);
+		float t1 = (box.max()(axis) - from(axis)) / dir(axis);
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		t_min = std::max(t_min, t0);
+		t_max = std::min(t_max, t1);
+		if (t_min > t_max) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//squared distance between the segments p1 q1 and p2 q2
+static float segmentsDistanceSq(const Eigen::Vector3f& p1, const Eigen::Vector3f& q1, const Eigen::Vector3f& p2, const Eigen::Vector3f& q2) {
+	Eigen::Vector3f d1 = q1 - p1;
+	Eigen::Vector3f d2 = q2 - p2;
+	Eigen::Vector3f r = p1 - p2;
+	float a = d1.dot(d1);
+	float e = d2.dot(d2);
+	float f = d2.dot(r);
+	float s = 0;
+	float t = 0;
+	if (a == 0 && e == 0) {
+		return r.squaredNorm();
+	}
+	if (a == 0) {
+		t = std::clamp(f / e, 0.f, 1.f);
+	} else {
+		float c = d1.dot(r);
+		if (e == 0) {
+			s = std::clamp(-c / a, 0.f, 1.f);
+		} else {
+			float b = d1.dot(d2);
+			float denom = a * e - b * b;
+			s = denom > 0 ? std::clamp((b * f - c * e) / denom, 0.f, 1.f) : 0;
+			t = (b * s + f) / e;
+			if (t < 0) {
+				t = 0;
+				s = std::clamp(-c / a, 0.f, 1.f);
+			} else if (t > 1) {
+				t = 1;
+				s = std::clamp((b - c) / a, 0.f, 1.f);
+			}
+		}
+	}
+	return (p1 + s * d1 - p2 - t * d2).squaredNorm();
+}
+
+//the point of triangle a b c closest to p, by which of its verts, edges or inside p is over
+static Eigen::Vector3f closestOnTriangle(const Eigen::Vector3f& p, const Eigen::Vector3f& a, const Eigen::Vector3f& b, const Eigen::Vector3f& c) {
+	Eigen::Vector3f ab = b - a;
+	Eigen::Vector3f ac = c - a;
+	float d1 = ab.dot(p - a);
+	float d2 = ac.dot(p - a);
+	if (d1 <= 0 && d2 <= 0) {
+		return a;
+	}
+	float d3 = ab.dot(p - b);
+	float d4 = ac.dot(p - b);
+	if (d3 >= 0 && d4 <= d3) {
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		return a + d1 / (d1 - d3) * ab;
+	}
+	float d5 = ab.dot(p - c);
+	float d6 = ac.dot(p - c);
+	if (d6 >= 0 && d5 <= d6) {
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		return a + d2 / (d2 - d6) * ac;
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+		return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+	}
+	float sum = va + vb + vc;
+	if (sum <= 0) {
+		//no area, its edges are checked on their own
+		return a;
+	}
+	return a + ab * (vb / sum) + ac * (vc / sum);
+}
+
+//squared distance between the segment p q and triangle a b c, 0 if it goes through
+static float segmentTriangleDistanceSq(const Eigen::Vector3f& p, const Eigen::Vector3f& q, const Eigen::Vector3f& a, const Eigen::Vector3f& b, const Eigen::Vector3f& c) {
+	Eigen::Vector3f n = (b - a).cross(c - a);
+	float dp = n.dot(p - a);
+	float dq = n.dot(q - a);
+	if (dp * dq <= 0 && dp != dq) {
+		Eigen::Vector3f x = p + dp / (dp - dq) * (q - p);
+		if (n.dot((b - a).cross(x - a)) >= 0 && n.dot((c - b).cross(x - b)) >= 0 && n.dot((a - c).cross(x - c)) >= 0) {
+			return 0;
+		}
+	}
+	float best = std::min((p - closestOnTriangle(p, a, b, c)).squaredNorm(), (q - closestOnTriangle(q, a, b, c)).squaredNorm());
+	best = std::min(best, segmentsDistanceSq(p, q, a, b));
+	best = std::min(best, segmentsDistanceSq(p, q, b, c));
+	best = std::min(best, segmentsDistanceSq(p, q, c, a));
+	return best;
+}
+
+//where o + t * dir goes into the sphere, only from outside it
+static bool raySphere(const Eigen::Vector3f& o, const Eigen::Vector3f& dir, const Eigen::Vector3f& center, float radius, float* t) {
+	Eigen::Vector3f oc = o - center;
+	float a = dir.dot(dir);
+	float b = dir.dot(oc);
+	float c = oc.dot(oc) - radius * radius;
+	float disc = b * b - a * c;
+	if (a == 0 || disc < 0) {
+		return false;
+	}
+	*t = (-b - std::sqrt(disc)) / a;
+	return *t >= 0;
+}
+
+//where o + t * dir first goes into the capsule p q for t before *t, the normal is out of the capsule
+//where it went in. the capsule is its body and its two end spheres, whichever is gone into first
+static bool rayCapsule(const Eigen::Vector3f& o, const Eigen::Vector3f& dir, const Eigen::Vector3f& p, const Eigen::Vector3f& q, float radius, float* t, Eigen::Vector3f* normal) {
+	bool found = false;
+	Eigen::Vector3f axis = q - p;
+	Eigen::Vector3f op = o - p;
+	float axis_sq = axis.dot(axis);
+	float a = axis_sq * dir.dot(dir) - axis.dot(dir) * axis.dot(dir);
+	if (a > 1e-12f * axis_sq * dir.dot(dir)) {
+		float b = axis_sq * dir.dot(op) - axis.dot(op) * axis.dot(dir);
+		float c = axis_sq * op.dot(op) - axis.dot(op) * axis.dot(op) - radius * radius * axis_sq;
+		float disc = b * b - a * c;
+		if (disc < 0) {
+			//misses the whole infinite cylinder
+			return false;
+		}
+		float body_t = (-b - std::sqrt(disc)) / a;
+		float along = axis.dot(op) + body_t * axis.dot(dir);
+		if (body_t >= 0 && body_t <= *t && along > 0 && along < axis_sq) {
+			*t = body_t;
+			*normal = (o + body_t * dir - p - along / axis_sq * axis).normalized();
+			found = true;
+		}
+	}
+	for (const Eigen::Vector3f* end : { &p, &q }) {
+		float end_t;
+		if (raySphere(o, dir, *end, radius, &end_t) && end_t <= *t) {
+			*t = end_t;
+			*normal = (o + end_t * dir - *end).normalized();
+			found = true;
+		}
+	}
+	return found;
+}
+
+//where o + t * dir first goes through either side of the convex polygon moved radius out along its
+//normal, over the polygon, for t before *t. the normal is the side it came from
+static bool raySlab(const Eigen::Vector3f& o, const Eigen::Vector3f& dir, const Eigen::Vector3f* polygon, int n_verts, float radius, float* t, Eigen::Vector3f* normal) {
+	Eigen::Vector3f n = (polygon[1] - polygon[0]).cross(polygon[2] - polygon[0]);
+	float area_sq = n.squaredNorm();
+	if (area_sq == 0 || area_sq < 1e-12f * (polygon[1] - polygon[0]).squaredNorm() * (polygon[2] - polygon[0]).squaredNorm()) {
+		return false;
+	}
+	n /= std::sqrt(area_sq);
+	float along = n.dot(dir);
+	if (along == 0) {
+		return false;
+	}
+	//only the side facing the ray can be gone into first
+	float side = along < 0 ? 1.f : -1.f;
+	float plane_t = (n.dot(polygon[0]) + side * radius - n.dot(o)) / along;
+	if (plane_t < 0 || plane_t > *t) {
+		return false;
+	}
+	Eigen::Vector3f x = o + plane_t * dir - side * radius * n;
+	for (int i = 0; i < n_verts; i++) {
+		const Eigen::Vector3f& v = polygon[i];
+		const Eigen::Vector3f& next = polygon[(i + 1) % n_verts];
+		if (n.dot((next - v).cross(x - v)) < 0) {
+			return false;
+		}
+	}
+	*t = plane_t;
+	*normal = side * n;
+	return true;
+}
+
+//a capsule from c - h to c + h with radius r moving by d touching triangle tri, at t along d before
+//*t. the same as the point c moving into the prism the triangle makes swept from -h to h, grown by r,
+//which is its faces moved out by r and capsules along its edges. a capsule already touching it is
+//t 0 with the normal straight back along d
+static bool sweepTriangle(const Eigen::Vector3f& c, const Eigen::Vector3f& h, float r, const Eigen::Vector3f& d, const Eigen::Vector3f tri[3], float* t, Eigen::Vector3f* normal) {
+	if (segmentTriangleDistanceSq(c - h, c + h, tri[0], tri[1], tri[2]) <= r * r) {
+		*t = 0;
+		*normal = -d.normalized();
+		return true;
+	}
+	Eigen::Vector3f low[3] = { tri[0] - h, tri[1] - h, tri[2] - h };
+	Eigen::Vector3f high[3] = { tri[0] + h, tri[1] + h, tri[2] + h };
+	bool swept = !h.isZero();
+	bool found = false;
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		found |= rayCapsule(c, d, low[i], low[j], r, t, normal);
+		if (swept) {
+			found |= rayCapsule(c, d, high[i], high[j], r, t, normal);
+			found |= rayCapsule(c, d, low[i], high[i], r, t, normal);
+			Eigen::Vector3f side[4] = { low[i], low[j], high[j], high[i] };
+			found |= raySlab(c, d, side, 4, r, t, normal);
+		}
+	}
+	found |= raySlab(c, d, low, 3, r, t, normal);
+	if (swept) {
+		found |= raySlab(c, d, high, 3, r, t, normal);
+	}
+	return found;
+}
+
+static bool nearer(const ProbeHit& first, const ProbeHit& second) {
+	if (first.distance != second.distance) {
+		return first.distance < second.distance;
+	}
+	return first.body < second.body || (first.body == second.body && first.face < second.face);
+}
+
+static ProbeHit miss() {
+	return ProbeHit{ nullptr, -1, -1, 0, Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero() };
+}
+
+bool CollisionProbe::canHit(int id, Eigen::AlignedBox3f* box) const {
+	const CollisionWorld::Body& body = world_.bodies_[id];
+	if (body.owner == nullptr || body.owner == ignored_ || !body.owner->isHitboxActive() || (world_.broad_phase_.getLayer(id) & mask_) == 0) {
+		return false;
+	}
+	//a pose the world hasnt stepped yet still gets its own box
+	const Eigen::AlignedBox3f& local_box = body.skinned != nullptr ? body.skinned->getBounds() : body.local_box;
+	*box = CollisionWorld::transformBox(local_box, body.owner->getPosition());
+	return true;
+}
+
+void CollisionProbe::bodiesInReach(std::vector<std::pair<int, Eigen::AlignedBox3f>>* bodies) const {
+	bodies->clear();
+	Eigen::AlignedBox3f box;
+	for (int id = 0; id < world_.bodies_.size(); id++) {
+		if (canHit(id, &box)) {
+			bodies->emplace_back(id, box);
+		}
+	}
+}
+
+bool CollisionProbe::firstOn(int id, const Eigen::Vector3f& from, const Eigen::Vector3f& to, float* k, int* face, Eigen::Vector3f* normal) const {
+	const CollisionWorld::Body& body = world_.bodies_[id];
+	float hit_k;
+	if (body.mesh == nullptr) {
+		if (!body.surface->firstCrossing(from, to, &hit_k, normal) || hit_k >= *k) {
+			return false;
+		}
+		*k = hit_k;
+		*face = -1;
+		return true;
+	}
+	int hit_face = -1;
+	if (body.mesh->getBVH().isBuilt()) {
+		hit_face = body.mesh->getBVH().nearestHit(from, to, &hit_k);
+	} else {
+		std::vector<std::pair<int, float>> crossings;
+		body.mesh->allCrossings(from, to, &crossings);
+		if (!crossings.empty()) {
+			std::tie(hit_face, hit_k) = crossings[0];
+		}
+	}
+	if (hit_face < 0 || hit_k >= *k) {
+		return false;
+	}
+	const Eigen::Vector3f& n = body.mesh->getFaceNorms()[hit_face];
+	*normal = n.dot(to - from) > 0 ? -n : n;
+	*k = hit_k;
+	*face = hit_face;
+	return true;
+}
+
+void CollisionProbe::setHit(int id, const Eigen::Matrix4f& to_local, const Eigen::Vector3f& from, const Eigen::Vector3f& to, float k, int face, const Eigen::Vector3f& normal, ProbeHit* hit) const {
+	hit->owner = world_.bodies_[id].owner;
+	hit->body = id;
+	hit->face = face;
+	hit->distance = k * (to - from).norm();
+	hit->point = from + k * (to - from);
+	//normals go back by the inverse transpose, which is to_local's rotation part transposed
+	hit->normal = (to_local.block<3, 3>(0, 0).transpose() * normal).normalized();
+}
+
+bool CollisionProbe::segment(const Eigen::Vector3f& from, const Eigen::Vector3f& to, ProbeHit* hit) const {
+	*hit = miss();
+	float best_k = 1;
+	Eigen::AlignedBox3f box;
+	for (int id = 0; id < world_.bodies_.size(); id++) {
+		if (!canHit(id, &box) || !segmentMeetsBox(from, to, box)) {
+			continue;
+		}
+		Eigen::Matrix4f to_local = world_.bodies_[id].owner->getPosition().inverse();
+		Eigen::Vector3f local_from = to_local.block<3, 3>(0, 0) * from + to_local.block<3, 1>(0, 3);
+		Eigen::Vector3f local_to = to_local.block<3, 3>(0, 0) * to + to_local.block<3, 1>(0, 3);
+		int face;
+		Eigen::Vector3f normal;
+		if (firstOn(id, local_from, local_to, &best_k, &face, &normal)) {
+			setHit(id, to_local, from, to, best_k, face, normal, hit);
+		}
+	}
+	return hit->owner != nullptr;
+}
+
+void CollisionProbe::segmentAll(const Eigen::Vector3f& from, const Eigen::Vector3f& to, std::vector<ProbeHit>* hits) const {
+	hits->clear();
+	std::vector<std::pair<int, float>> crossings;
+	Eigen::AlignedBox3f box;
+	for (int id = 0; id < world_.bodies_.size(); id++) {
+		if (!canHit(id, &box) || !segmentMeetsBox(from, to, box)) {
+			continue;
+		}
+		const CollisionWorld::Body& body = world_.bodies_[id];
+		Eigen::Matrix4f to_local = body.owner->getPosition().inverse();
+		Eigen::Vector3f local_from = to_local.block<3, 3>(0, 0) * from + to_local.block<3, 1>(0, 3);
+		Eigen::Vector3f local_to = to_local.block<3, 3>(0, 0) * to + to_local.block<3, 1>(0, 3);
+		if (body.mesh == nullptr) {
+			//a surface that isnt a mesh can only say where it is first crossed
+			float k = 1;
+			int face;
+			Eigen::Vector3f normal;
+			if (firstOn(id, local_from, local_to, &k, &face, &normal)) {
+				hits->emplace_back();
+				setHit(id, to_local, from, to, k, face, normal, &hits->back());
+			}
+			continue;
+		}
+		body.mesh->allCrossings(local_from, local_to, &crossings);
+		for (auto [face, k] : crossings) {
+			const Eigen::Vector3f& n = body.mesh->getFaceNorms()[face];
+			hits->emplace_back();
+			setHit(id, to_local, from, to, k, face, n.dot(local_to - local_from) > 0 ? -n : n, &hits->back());
+		}
+	}
+	std::sort(hits->begin(), hits->end(), nearer);
+}
+
+void CollisionProbe::segmentRange(const std::vector<Segment>& segments, const std::vector<int>& order, size_t begin, size_t end, const std::vector<std::pair<int, Eigen::AlignedBox3f>>& bodies, std::vector<ProbeHit>* hits) const {
+	//by place in order, less begin
+	std::vector<float> best_k(end - begin, 1);
+	std::vector<int> places;
+	std::vector<Segment> local_segments;
+	std::vector<int> faces;
+	std::vector<float> ks;
+	for (const auto& [id, box] : bodies) {
+		places.clear();
+		for (size_t j = begin; j < end; j++) {
+			const Segment& segment = segments[order[j]];
+			if (segmentMeetsBox(segment.first, segment.second, box)) {
+				places.push_back(static_cast<int>(j - begin));
+			}
+		}
+		if (places.empty()) {
+			continue;
+		}
+		const CollisionWorld::Body& body = world_.bodies_[id];
+		Eigen::Matrix4f to_local = body.owner->getPosition().inverse();
+		local_segments.clear();
+		for (int place : places) {
+			const Segment& segment = segments[order[begin + place]];
+			local_segments.emplace_back(to_local.block<3, 3>(0, 0) * segment.first + to_local.block<3, 1>(0, 3), to_local.block<3, 3>(0, 0) * segment.second + to_local.block<3, 1>(0, 3));
+		}
+		if (body.mesh != nullptr && body.mesh->getBVH().isBuilt()) {
+			//k is the same fraction of the segment in any frame, so the best so far carries over
+			ks.clear();
+			for (int place : places) {
+				ks.push_back(best_k[place]);
+			}
+			body.mesh->getBVH().nearestEach(local_segments, &faces, &ks);
+			for (int j = 0; j < places.size(); j++) {
+				if (faces[j] < 0) {
+					continue;
+				}
+				int i = order[begin + places[j]];
+				const Eigen::Vector3f& n = body.mesh->getFaceNorms()[faces[j]];
+				Eigen::Vector3f local_dir = local_segments[j].second - local_segments[j].first;
+				best_k[places[j]] = ks[j];
+				setHit(id, to_local, segments[i].first, segments[i].second, ks[j], faces[j], n.dot(local_dir) > 0 ? -n : n, &(*hits)[i]);
+			}
+			continue;
+		}
+		for (int j = 0; j < places.size(); j++) {
+			int i = order[begin + places[j]];
+			int face;
+			Eigen::Vector3f normal;
+			if (firstOn(id, local_segments[j].first, local_segments[j].second, &best_k[places[j]], &face, &normal)) {
+				setHit(id, to_local, segments[i].first, segments[i].second, best_k[places[j]], face, normal, &(*hits)[i]);
+			}
+		}
+	}
+}
+
+void CollisionProbe::segments(const std::vector<Segment>& segments, std::vector<ProbeHit>* hits) const {
+	hits->assign(segments.size(), miss());
+	std::vector<std::pair<int, Eigen::AlignedBox3f>> bodies;
+	bodiesInReach(&bodies);
+	if (bodies.empty() || segments.empty()) {
+		return;
+	}
+
+	//segments that start near each other and go the same way stay together further down a bvh, so
+	//they go in order of which way they point and then of where they start along a z curve
+	Eigen::AlignedBox3f starts;
+	for (const Segment& segment : segments) {
+		starts.extend(segment.first);
+	}
+	Eigen::Vector3f scale = Eigen::Vector3f::Constant(511).cwiseQuotient(starts.sizes().cwiseMax(Eigen::Vector3f::Constant(1e-6f)));
+	std::vector<uint64_t> keys(segments.size());
+	for (int i = 0; i < segments.size(); i++) {
+		Eigen::Vector3f dir = segments[i].second - segments[i].first;
+		Eigen::Vector3f cell = (segments[i].first - starts.min()).cwiseProduct(scale);
+		uint64_t octant = (dir(0) < 0) | (dir(1) < 0) << 1 | (dir(2) < 0) << 2;
+		uint64_t curve = 0;
+		for (int bit = 8; bit >= 0; bit--) {
+			for (int axis = 0; axis < 3; axis++) {
+				curve = curve << 1 | ((static_cast<uint32_t>(cell(axis)) >> bit) & 1);
+			}
+		}
+		keys[i] = octant << 59 | curve << 32 | static_cast<uint32_t>(i);
+	}
+	std::sort(keys.begin(), keys.end());
+	std::vector<int> order(segments.size());
+	for (int i = 0; i < segments.size(); i++) {
+		order[i] = static_cast<int>(keys[i] & 0xffffffff);
+	}
+
+	//a few chunks a thread so a thread that gets the empty ones can take more
+	size_t n_threads = world_.workers_ != nullptr ? world_.workers_->size() : 1;
+	size_t chunk = std::max(batch_chunk_, (segments.size() + 4 * n_threads - 1) / (4 * n_threads));
+	size_t n_chunks = (segments.size() + chunk - 1) / chunk;
+	auto job = [&](size_t i) {
+		segmentRange(segments, order, i * chunk, std::min(segments.size(), (i + 1) * chunk), bodies, hits);
+	};
+	if (world_.workers_ != nullptr) {
+		world_.workers_->parallelFor(n_chunks, job);
+	} else {
+		for (size_t i = 0; i < n_chunks; i++) {
+			job(i);
+		}
+	}
+}
+
+void CollisionProbe::sweep(const Eigen::Vector3f& center, const Eigen::Vector3f& half, float radius, const Eigen::Vector3f& motion, bool all, std::vector<ProbeHit>* hits) const {
+	hits->clear();
+	Eigen::Vector3f grow = half.cwiseAbs() + Eigen::Vector3f::Constant(radius);
+	Eigen::AlignedBox3f box;
+	for (int id = 0; id < world_.bodies_.size(); id++) {
+		if (!canHit(id, &box)) {
+			continue;
+		}
+		box.min() -= grow;
+		box.max() += grow;
+		if (!segmentMeetsBox(center, center + motion, box)) {
+			continue;
+		}
+		const CollisionWorld::Body& body = world_.bodies_[id];
+		Eigen::Matrix4f to_local = body.owner->getPosition().inverse();
+		Eigen::Vector3f c = to_local.block<3, 3>(0, 0) * center + to_local.block<3, 1>(0, 3);
+		Eigen::Vector3f h = to_local.block<3, 3>(0, 0) * half;
+		Eigen::Vector3f d = to_local.block<3, 3>(0, 0) * motion;
+		//a hit is kept if it is wanted, all of them or only the nearest
+		auto keep = [&](float t, int face, const Eigen::Vector3f& normal) {
+			ProbeHit hit;
+			setHit(id, to_local, center, center + motion, t, face, normal, &hit);
+			if (all) {
+				hits->push_back(hit);
+			} else if (hits->empty()) {
+				hits->push_back(hit);
+			} else if (nearer(hit, hits->front())) {
+				hits->front() = hit;
+			}
+		};
+
+		if (body.mesh == nullptr) {
+			//nothing to sweep against, the point of each end that leads the way goes instead
+			Eigen::Vector3f lead = d.normalized() * radius;
+			float best_t = 1;
+			int face;
+			Eigen::Vector3f normal;
+			bool found = false;
+			for (const Eigen::Vector3f& end : { Eigen::Vector3f(c - h), Eigen::Vector3f(c + h) }) {
+				found |= firstOn(id, end + lead, end + lead + d, &best_t, &face, &normal);
+			}
+			if (found) {
+				keep(best_t, -1, normal);
+			}
+			continue;
+		}
+
+		const MeshSurface& mesh = *body.mesh;
+		auto visit = [&](int face, float max_t) {
+			const auto& [a, b, cc] = mesh.getFaces()[face];
+			Eigen::Vector3f tri[3] = { mesh.getVerts()[a], mesh.getVerts()[b], mesh.getVerts()[cc] };
+			float t = all ? 1 : max_t;
+			Eigen::Vector3f normal;
+			if (!sweepTriangle(c, h, radius, d, tri, &t, &normal)) {
+				return max_t;
+			}
+			keep(t, face, normal);
+			return all ? max_t : t;
+		};
+		if (mesh.getBVH().isBuilt()) {
+			mesh.getBVH().sweptFaces(c, c + d, Eigen::Vector3f(h.cwiseAbs() + Eigen::Vector3f::Constant(radius)), visit);
+		} else {
+			float max_t = 1;
+			for (int face = 0; face < mesh.getFaces().size(); face++) {
+				max_t = visit(face, max_t);
+			}
+		}
+	}
+	if (all) {
+		std::sort(hits->begin(), hits->end(), nearer);
+	}
+}
+
+bool CollisionProbe::sphereCast(const Eigen::Vector3f& from, const Eigen::Vector3f& to, float radius, ProbeHit* hit) const {
+	std::vector<ProbeHit> hits;
+	sweep(from, Eigen::Vector3f::Zero(), radius, to - from, false, &hits);
+	*hit = hits.empty() ? miss() : hits[0];
+	return !hits.empty();
+}
+
+void CollisionProbe::sphereCastAll(const Eigen::Vector3f& from, const Eigen::Vector3f& to, float radius, std::vector<ProbeHit>* hits) const {
+	sweep(from, Eigen::Vector3f::Zero(), radius, to - from, true, hits);
+}
+
+bool CollisionProbe::capsuleCast(const Eigen::Vector3f& a, const Eigen::Vector3f& b, float radius, const Eigen::Vector3f& motion, ProbeHit* hit) const {
+	std::vector<ProbeHit> hits;
+	sweep((a + b) / 2, (b - a) / 2, radius, motion, false, &hits);
+	*hit = hits.empty() ? miss() : hits[0];
+	return !hits.empty();
+}
+
+void CollisionProbe::capsuleCastAll(const Eigen::Vector3f& a, const Eigen::Vector3f& b, float radius, const Eigen::Vector3f& motion, std::vector<ProbeHit>* hits) const {
+	sweep((a + b) / 2, (b - a) / 2, radius, motion, true, hits);
+}
@@ -4,47 +4,129 @@
 #ifndef PUPPET_COLLISIONPROBE
 #define PUPPET_COLLISIONPROBE
 
-#include "collision.hpp"
+#include <Eigen/Dense>
+#include <vector>
+#include <cstdint>
+
+#include "collision_world.hpp"
 #include "GameObject.h"
 
-class CollisionProbe_Base {
-	/*
-	* ________________________
-	* |_	hitbox 2	 ____|
-	*   \		 _______/
-	*    \______/
-	*		  /\
-	*		   \ dir
-	*			\__
-	*		   /   \_
-	*		   |  O	 \ hitbox 1
-	*			\__\_/
-	*			    \
-	*			     \	   /
-	*				 \X\  /\
-	*				  \\\/ dist
-	*				   \ \	 \/
-	*					\ \  /
-	*					 \ \/
-	*					  \/-----> pos
-	*
-	*
-	*
-	*/
-
-	virtual Eigen::Vector3f getDist(Eigen::Vector3f pos, Eigen::Vector3f dir) {
+//what a probe ran into
+struct ProbeHit {
+	GameObject* owner; //nullptr for a miss
+	int body; //the id CollisionWorld::add gave the hitbox
+	int face; //of the mesh, -1 if the hitbox isnt a mesh
+	float distance; //how far the probe got from where it started
+	Eigen::Vector3f point; //where a ray crossed, or where a shape's center was when it touched
+	Eigen::Vector3f normal; //of what was hit, facing back against the probe
+};
+
+//asks a CollisionWorld what is along a line or in the way of a shape moving along one, without making
+//a hitbox and a CollisionPair for it. everything is in world space and only bodies in a layer of the
+//probe's mask with their hitbox on are looked at. meshes are searched through their bvh, a hitbox that
+//isnt a mesh, like a level's Zmap, through its firstCrossing.
+//it only reads the world, so it can be used from onStep or from several threads at once, just not
+//while the world is in step, and a batch of segments only from one thread since it runs on the world's
+//workers. hitboxes are taken where their owners are now, not where step last saw them, and a shape
+//cast takes their transforms to be rigid
+/*
+* ________________________
+* |_	hitbox 2	 ____|
+*   \		 _______/
+*    \______/
+*		  /\
+*		   \ dir
+*			\__
+*		   /   \_
+*		   |  O	 \ hitbox 1
+*			\__\_/
+*			    \
+*			     \	   /
+*				 \X\  /\
+*				  \\\/ dist
+*				   \ \	 \/
+*					\ \  /
+*					 \ \/
+*					  \/-----> pos
+*
+*
+*
+*/
+class CollisionProbe {
+public:
+	typedef MeshBVH::Segment Segment;
+
+private:
+	//below this many segments a batch isnt worth splitting up between the workers
+	static constexpr size_t batch_chunk_ = 2048;
+
+	const CollisionWorld& world_;
+	uint32_t mask_;
+	const GameObject* ignored_;
+
+	//is body id in the mask with its hitbox on, and where its box is in the world if it is
+	bool canHit(int id, Eigen::AlignedBox3f* box) const;
+
+	//bodies a probe can hit, with their world boxes
+	void bodiesInReach(std::vector<std::pair<int, Eigen::AlignedBox3f>>* bodies) const;
+
+	//the face of body id the segment crosses first, if it is before *k. all in the body's frame, face is
+	//-1 if the hitbox isnt a mesh
+	bool firstOn(int id, const Eigen::Vector3f& from, const Eigen::Vector3f& to, float* k, int* face, Eigen::Vector3f* normal) const;
+
+	//a hit on body id at k along the world segment from to, normal in the body's frame
+	void setHit(int id, const Eigen::Matrix4f& to_local, const Eigen::Vector3f& from, const Eigen::Vector3f& to, float k, int face, const Eigen::Vector3f& normal, ProbeHit* hit) const;
+
+	//the nearest hit of every segment in order[begin, end) on any body
+	void segmentRange(const std::vector<Segment>& segments, const std::vector<int>& order, size_t begin, size_t end, const std::vector<std::pair<int, Eigen::AlignedBox3f>>& bodies, std::vector<ProbeHit>* hits) const;
 
+	//a capsule from center - half to center + half with radius moving by motion, a sphere when half is 0
+	void sweep(const Eigen::Vector3f& center, const Eigen::Vector3f& half, float radius, const Eigen::Vector3f& motion, bool all, std::vector<ProbeHit>* hits) const;
+
+public:
+	explicit CollisionProbe(const CollisionWorld& world, uint32_t mask = ~0u) : world_(world), mask_(mask), ignored_(nullptr) {}
+
+	void setMask(uint32_t mask) {
+		mask_ = mask;
 	}
 
-	virtual Eigen::Vector3f getNormal(Eigen::Vector3f pos, Eigen::Vector3f dir) {
+	//hitboxes of owner are passed through, for a probe starting inside whoever is asking
+	void ignore(const GameObject* owner) {
+		ignored_ = owner;
+	}
+
+	//the first thing the segment from to crosses
+	bool segment(const Eigen::Vector3f& from, const Eigen::Vector3f& to, ProbeHit* hit) const;
+
+	//everything it crosses, nearest first
+	void segmentAll(const Eigen::Vector3f& from, const Eigen::Vector3f& to, std::vector<ProbeHit>* hits) const;
 
+	//a segment from origin max_distance along dir, dir doesnt have to be unit length
+	bool ray(const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float max_distance, ProbeHit* hit) const {
+		return segment(origin, origin + dir.normalized() * max_distance, hit);
 	}
-};
 
+	void rayAll(const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float max_distance, std::vector<ProbeHit>* hits) const {
+		segmentAll(origin, origin + dir.normalized() * max_distance, hits);
+	}
+
+	//the first hit of each segment, hits[i].owner is nullptr where segments[i] hits nothing. the batch
+	//goes down each mesh's bvh together, sorted so segments near each other stay together, and is split
+	//between the world's workers when it is big
+	void segments(const std::vector<Segment>& segments, std::vector<ProbeHit>* hits) const;
+
+	//the first thing a sphere moving from from to to touches. starting out touching something is a hit
+	//at distance 0 with the normal straight back along the move. a hitbox that isnt a mesh has nothing
+	//to sweep against, only the point of the sphere leading the way is checked against it
+	bool sphereCast(const Eigen::Vector3f& from, const Eigen::Vector3f& to, float radius, ProbeHit* hit) const;
+
+	//everything it touches on the way, each face of a mesh where it first touches it, nearest first
+	void sphereCastAll(const Eigen::Vector3f& from, const Eigen::Vector3f& to, float radius, std::vector<ProbeHit>* hits) const;
 
-template<PrimaryHitbox PrimaryHitbox_T, SecondaryHitbox<PrimaryHitbox_T> SecondaryHitbox_T>
-class CollisionProbe : public CollisionProbe_Base {
+	//a capsule from a to b with radius moving by motion. point is where the middle of a and b was
+	bool capsuleCast(const Eigen::Vector3f& a, const Eigen::Vector3f& b, float radius, const Eigen::Vector3f& motion, ProbeHit* hit) const;
 
+	void capsuleCastAll(const Eigen::Vector3f& a, const Eigen::Vector3f& b, float radius, const Eigen::Vector3f& motion, std::vector<ProbeHit>* hits) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,24 +3,26 @@
 const char* CollisionVisualizer::vertex_code = "\n"
 "#version 330 core\n"
 "layout (location = 0) in vec3 pos;\n"
+"layout (location = 1) in vec4 color;\n"
 
 "uniform mat4 perspective;\n"
 "uniform mat4 camera;\n"
-"uniform mat4 model;\n"
 
+"out vec4 vert_color;\n"
 
+//debug draw vertices are already in world space
 "void main()\n"
 "{\n"
-"   gl_Position = perspective * camera *model*vec4(pos.x, pos.y, pos.z, 1.0);\n"
+"	vert_color = color;\n"
+"   gl_Position = perspective * camera * vec4(pos.x, pos.y, pos.z, 1.0);\n"
 "}\0";
 
 const char* CollisionVisualizer::fragment_code = "#version 330 core\n"
-"uniform vec3 color;\n"
+"in vec4 vert_color;\n"
 
 "out vec4 FragColor;\n"
 
 "void main()\n"
 "{\n"
-"	FragColor.xyz = color;\n"
-"	FragColor.w = 1.0;\n"
+"	FragColor = vert_color;\n"
 " } ";
\ No newline at end of file
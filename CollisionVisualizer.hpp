@@ -6,151 +6,51 @@
 #include "Graphics.hpp"
 #include "GameObject.h"
 #include "scene.hpp"
+#include "debug_draw.hpp"
 
-class CollisionVisualizer : public Graphics<CollisionPair<MeshSurface,MeshSurface>,int,int,int,int,int> {
+//draws the debug target's collision pairs: the primary mesh where it is and the surface the
+//secondary sweeps over the last step, wireframe normally and filled when they collide. everything
+//goes through one DebugDraw, so any number of pairs costs two draws and no gpu objects per pair.
+//other debug code can add its own lines to the same frame through getDebugDraw
+class CollisionVisualizer : public Graphics<CollisionPair<MeshSurface,MeshSurface>> {
 
 	const unsigned int perspective_location_;
 	const unsigned int camera_location_;
-	const unsigned int model_location_;
-	const unsigned int color_location_;
 
 	Scene* scene_;
-
-	static Model mesh2Model(const MeshSurface& mesh) {
-		Model output;
-		for (auto& face : mesh.getFaces()) {
-			output.addVert(mesh.getVerts()[std::get<0>(face)]);
-			output.addVert(mesh.getVerts()[std::get<1>(face)]);
-			output.addVert(mesh.getVerts()[std::get<2>(face)]);
-			output.addFace(std::get<0>(face), std::get<1>(face), std::get<2>(face));// i think this should be 1,2,3...4,5,6
-		}
-		if (output.flen() == 0) { //no faces
-			for (auto& edge : mesh.getEdges()) {
-				output.addVert(mesh.getVerts()[std::get<0>(edge)]);
-				output.addVert(mesh.getVerts()[std::get<1>(edge)]);
-				output.addVert(mesh.getVerts()[std::get<0>(edge)]);
-				output.addFace(0, 0, 0);
-			}
-		}
-		output.finalize();
-		return output;
-	}
-
-	static Model mesh4d2Model(const MeshSurface& mesh, const Eigen::Matrix4f& dG) {
-		Model output;
-		
-		for (auto& edge : mesh.getEdges()) {
-			Eigen::Matrix4f dG_inv = dG.inverse();
-			output.addVert(mesh.getVerts()[std::get<0>(edge)]);
-			output.addVert(mesh.getVerts()[std::get<1>(edge)]);
-			output.addVert(dG_inv(seq(0, 2), seq(0, 2)) * mesh.getVerts()[std::get<1>(edge)] + dG_inv(seq(0, 2), 3));
-			output.addFace(0, 0, 0);
-			output.addVert(mesh.getVerts()[std::get<0>(edge)]);
-			output.addVert(dG_inv(seq(0, 2), seq(0, 2)) * mesh.getVerts()[std::get<0>(edge)] + dG_inv(seq(0, 2), 3));
-			output.addVert(dG_inv(seq(0, 2), seq(0, 2)) * mesh.getVerts()[std::get<1>(edge)] + dG_inv(seq(0, 2), 3));
-			output.addFace(0, 0, 0);
-		}
-
-		output.finalize();
-		return output;
-	}
+	mutable DebugDraw debug_draw_;
 
 	Cache makeDataCache(const CollisionPair<MeshSurface, MeshSurface>& obj) const override {
-		Model primary_model = mesh2Model(obj.first);
-		Model secondary_model = mesh4d2Model(obj.second,obj.getSecondarydG());
-
-		unsigned int VAO[2];
-		glGenVertexArrays(2, VAO);
-		unsigned int VBO[2];
-		glGenBuffers(2, VBO);
-		//unsigned int EBO;
-		//glGenBuffers(1, &EBO);
-
-		glBindVertexArray(VAO[0]);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * primary_model.flen() * 9, primary_model.getVerts().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glBindVertexArray(VAO[1]);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * secondary_model.flen() * 9, secondary_model.getVerts().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-
-		return Cache{VAO[0], primary_model.flen(),VAO[1],secondary_model.flen(),VBO[1]};
+		return Cache{};
 	};
 
 	void drawObj(const CollisionPair<MeshSurface, MeshSurface>& obj, Cache cache) const {
-		Eigen::Vector3f primary_model_color = Eigen::Vector3f(0.0, 1.0, 0.0);
-		Eigen::Vector3f primary_model_collision_color = Eigen::Vector3f(1.0, 0.0, 0.0);
-		Eigen::Vector3f secondary_model_color = Eigen::Vector3f(0.0, 1.0, 1.0);
-		Eigen::Vector3f secondary_model_collision_color = Eigen::Vector3f(1.0, 0.0, 1.0);
-
-		//draw primary
-		glBindVertexArray(std::get<0>(cache));
-
-		glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getPrimaryPosition().data());
-		//if (obj.getCollisionInfo().is_colliding) {
-		if (obj.isCollision()) {
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-			glUniform3fv(color_location_, 1, primary_model_collision_color.data());
-		}
-		else {
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			glUniform3fv(color_location_, 1, primary_model_color.data());
-		}
-		glDrawArrays(GL_TRIANGLES, 0, 3 * std::get<1>(cache));
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-
-		//draw secondary
-		glBindVertexArray(std::get<2>(cache));
-		Model secondary_model = mesh4d2Model(obj.second, obj.getSecondarydG());
-
-		//should remove inverse here
-		glBindBuffer(GL_ARRAY_BUFFER, std::get<4>(cache));
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * secondary_model.flen() * 9, secondary_model.getVerts().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getSecondaryPosition().data());
-		//if (obj.getCollisionInfo().is_colliding) {
-		if (obj.isCollision()) {
-			glUniform3fv(color_location_, 1, secondary_model_collision_color.data());
-			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		}
-		else {
-			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-			glUniform3fv(color_location_, 1, secondary_model_color.data());
-
-		}
-
-		glDrawArrays(GL_TRIANGLES, 0, 3 * std::get<3>(cache));
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
+		const Eigen::Vector4f primary_model_color(0.0, 1.0, 0.0, 1.0);
+		const Eigen::Vector4f primary_model_collision_color(1.0, 0.0, 0.0, 1.0);
+		const Eigen::Vector4f secondary_model_color(0.0, 1.0, 1.0, 1.0);
+		const Eigen::Vector4f secondary_model_collision_color(1.0, 0.0, 1.0, 1.0);
+
+		//whatever the step found, drawing shouldnt run the narrow phase again
+		bool collision = obj.lastCollision();
+		debug_draw_.wireMesh(obj.first, obj.getPrimaryPosition(), collision ? primary_model_collision_color : primary_model_color, collision);
+		debug_draw_.sweptMesh(obj.second, obj.getSecondaryPosition(), obj.getSecondarydG(), collision ? secondary_model_collision_color : secondary_model_color, collision);
 	}
 
 	void beginDraw() const {
 	
-		glDisable(GL_DEPTH_TEST);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		GLState::disable(GL_DEPTH_TEST);
+		GLState::polygonMode(GL_FILL);
 
 		glUniformMatrix4fv(perspective_location_, 1, GL_FALSE, scene_->camera->getPerspective().data());
 		glUniformMatrix4fv(camera_location_, 1, GL_FALSE, scene_->camera->getCameraMatrix().data());
 		
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::enable(GL_BLEND);
+		GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	}
 	void endDraw() const {
-		glEnable(GL_DEPTH_TEST);
+		debug_draw_.flush();
+		GLState::enable(GL_DEPTH_TEST);
 	}
 	
 	virtual void deleteDataCache(Cache cache) const override {
@@ -158,19 +58,33 @@ class CollisionVisualizer : public Graphics<CollisionPair<MeshSurface,MeshSurfac
 	}
 
 public:
-	CollisionVisualizer():model_location_(glGetUniformLocation(gl_id, "model")),
+	CollisionVisualizer():
 		camera_location_(glGetUniformLocation(gl_id, "camera")),
 		perspective_location_(glGetUniformLocation(gl_id, "perspective")),
-		color_location_(glGetUniformLocation(gl_id, "color")),
 		scene_(nullptr) {
 
 		//perspective_ << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1;
 	}
 
+	void setCamera(Camera* camera) {
+		if (scene_ == nullptr) {
+			scene_ = new Scene();
+		}
+		scene_->camera = camera;
+	}
+
 	void setScene(Scene* scene) {
 		scene_ = scene;
 	}
 
+	//lines and triangles added here before drawAll are drawn along with the collision pairs
+	DebugDraw& getDebugDraw() {
+		return debug_draw_;
+	}
+
+	const DebugDraw::Stats& getStats() const {
+		return debug_draw_.getStats();
+	}
 
 };
 
@@ -5,15 +5,13 @@ const char* Default2d::vertex_code = "\n"
 "#version 330 core\n"
 "layout (location = 0) in vec3 pos;\n"
 "layout (location = 1) in vec2 vt;\n"
-
-
-"uniform mat4 position_matrix;\n"
+//quads are positioned on the cpu when they are written into the batch
 
 "out vec2 texCoord;\n"
 
 "void main()\n"
 "{\n"
-"   gl_Position = position_matrix * vec4(pos.x, pos.y, 0., 1.0);\n"
+"   gl_Position = vec4(pos, 1.0);\n"
 "	texCoord = vt;\n"
 "}\0";
 const char* Default2d::fragment_code = "#version 330 core\n"
@@ -1,96 +1,226 @@
 #pragma once
 
+#include <chrono>
+#include <algorithm>
+
 #include "Graphics.hpp"
 #include "GameObject.h"
+#include "texture_atlas.hpp"
 
-class Default2d : public Graphics<GameObject, int, int> {
-											//vao, tex_id
-	const unsigned int position_location_;
-
-	constexpr int& getVAO(Cache cache) const {
-		return std::get<0>(cache);
-	}
-
-	constexpr int& getTexID(Cache cache) const {
-		return std::get<1>(cache);
-	}
+struct Default2dCache {
+	int tex_id;
+	Eigen::Vector4f uv_rect; //(left, bottom, width, height) of this objects texture inside tex_id
+	const Texture* texture; //so deleteDataCache knows what to let go of
 
-	Cache makeDataCache(const GameObject& obj) const override {
-		const Model& model = *(obj.getModel());
-		// = model.flen();
-		unsigned int VAO;
-		glGenVertexArrays(1, &(VAO));
-		//this->VAO = static_cast<int>(VAO);
-		unsigned int VBO[2];
-		glGenBuffers(2, VBO);
-
-		glBindVertexArray(VAO);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);//getverts must be xy only!//only pulls first 4
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * 3, model.getVerts().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 4 * 2, model.getTexCoords().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
+	Default2dCache() : tex_id(0), uv_rect(0, 0, 1, 1), texture(nullptr) {}
+	Default2dCache(int tex_id, Eigen::Vector4f uv_rect, const Texture* texture) : tex_id(tex_id), uv_rect(uv_rect), texture(texture) {}
+};
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+struct Default2dStats {
+	size_t n_quads;
+	size_t n_draw_calls; //before batching this was always n_quads
+	double cpu_ms; //time spent in drawAll on the cpu side, including the upload
+	size_t n_atlas_textures;
+	size_t n_loose_textures;
+};
 
-		//texture code:
+//all visible quads are written into one streaming vertex buffer every frame, sorted by layer (z of
+//the position, back to front) and then texture. textures go in a shared atlas so the whole ui is
+//usually a single draw. textures that have to repeat (uvs outside 0..1) or dont fit get their own gl
+//texture instead. a texture's atlas slot or own texture is freed once no object uses it
+class Default2d : public Graphics<GameObject, Default2dCache> {
+
+	static constexpr size_t floats_per_vert_ = 5; //x,y,z,u,v
+	static constexpr size_t verts_per_quad_ = 6;
+
+	struct QuadRef {
+		const GameObject* obj;
+		Default2dCache cache;
+		float layer;
+	};
+
+	mutable TextureAtlas atlas_;
+	mutable std::unordered_map<const Texture*, int> loose_textures_; //textures that repeat or are too big for the atlas
+	mutable std::unordered_map<const Texture*, size_t> n_users_; //objects with a cache using each texture
+
+	unsigned int VAO_;
+	unsigned int VBO_;
+	mutable size_t vbo_capacity_; //in floats
+	mutable std::vector<QuadRef> quads_;
+	mutable std::vector<float> verts_;
+
+	mutable std::chrono::steady_clock::time_point draw_start_;
+	mutable Default2dStats stats_;
+
+	int makeLooseTexture(const Texture& tex) const {
+		if (loose_textures_.contains(&tex)) {
+			return loose_textures_.at(&tex);
+		}
 		unsigned int tex_id;
-		if (obj.getTexture() != nullptr) {
-			const Texture& tex = *(obj.getTexture());
+		glGenTextures(1, &(tex_id));
+		GLState::bindTexture(tex_id);
 
-			glGenTextures(1, &(tex_id));
-			glBindTexture(GL_TEXTURE_2D, tex_id);
-			//this->tex_id = static_cast<int>(tex_id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		if (tex.n_channels == 3) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex.width, tex.height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex.getData().data());
+		}
+		else if (tex.n_channels == 4) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width, tex.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex.getData().data());
 
-			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-			if (tex.n_channels == 3) {
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex.width, tex.height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex.getData().data());
-			}
-			else if (tex.n_channels == 4) {
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width, tex.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex.getData().data());
+		}
+		glGenerateMipmap(GL_TEXTURE_2D);
+		loose_textures_[&tex] = static_cast<int>(tex_id);
+		return static_cast<int>(tex_id);
+	}
 
+	static bool repeats(const Model& model) {
+		for (float uv : model.getTexCoords()) {
+			if (uv < 0 || uv > 1) {
+				return true;
 			}
-			glGenerateMipmap(GL_TEXTURE_2D);
 		}
-		else {
-			tex_id = 0;
+		return false;
+	}
+
+	Cache makeDataCache(const GameObject& obj) const override {
+		//only the texture is looked up here, the quad itself is rebuilt every frame so there is nothing
+		//to upload per object
+		if (obj.getTexture() == nullptr) {
+			return Cache{ Default2dCache() };
+		}
+		const Texture& tex = *(obj.getTexture());
+		n_users_[&tex]++;
+		if (!loose_textures_.contains(&tex) && !repeats(*(obj.getModel()))) {
+			TextureAtlas::Region region = atlas_.insert(tex);
+			if (region.isValid()) {
+				return Cache{ Default2dCache(atlas_.getTexID(), atlas_.getUVRect(region), &tex) };
+			}
 		}
-		return Cache{VAO, tex_id};
+		//a texture already in the atlas that a later object repeats stays in the atlas for the others
+		return Cache{ Default2dCache(makeLooseTexture(tex), Eigen::Vector4f(0, 0, 1, 1), &tex) };
 	}
 
 	void deleteDataCache(Cache cache) const override {
+		const Texture* tex = std::get<0>(cache).texture;
+		if (tex == nullptr || --n_users_.at(tex) > 0) {
+			return;
+		}
+		//nothing uses it, it might already be deleted so only the pointer is used from here
+		n_users_.erase(tex);
+		atlas_.remove(tex);
+		if (loose_textures_.contains(tex)) {
+			unsigned int tex_id = static_cast<unsigned int>(loose_textures_.at(tex));
+			GLState::deleteTextures(1, &tex_id);
+			loose_textures_.erase(tex);
+		}
+	}
 
+	void writeQuad(const QuadRef& quad) const {
+		const Model& model = *(quad.obj->getModel());
+		const std::vector<float>& verts = model.getVerts(); //getverts must be xy only!//only pulls first 4
+		const std::vector<float>& tex_coords = model.getTexCoords();
+		const Eigen::Matrix4f position = quad.obj->getPosition();
+		const Eigen::Vector4f& uv_rect = quad.cache.uv_rect;
+
+		//strip order 0,1,2,3 as two triangles
+		for (int i : {0, 1, 2, 2, 1, 3}) {
+			Eigen::Vector4f p = position * Eigen::Vector4f(verts[3 * i], verts[3 * i + 1], 0, 1);
+			verts_.push_back(p(0));
+			verts_.push_back(p(1));
+			verts_.push_back(p(2));
+			verts_.push_back(uv_rect(0) + tex_coords[2 * i] * uv_rect(2));
+			verts_.push_back(uv_rect(1) + tex_coords[2 * i + 1] * uv_rect(3));
+		}
 	}
 
 public:
-	Default2d() : position_location_(glGetUniformLocation(gl_id, "position_matrix")) {}
+	Default2d(size_t initial_quad_capacity = 256) :
+		vbo_capacity_(initial_quad_capacity * verts_per_quad_ * floats_per_vert_),
+		stats_{ 0, 0, 0., 0, 0 } {
+		glGenVertexArrays(1, &VAO_);
+		glGenBuffers(1, &VBO_);
+
+		GLState::bindVertexArray(VAO_);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vbo_capacity_, NULL, GL_DYNAMIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, floats_per_vert_ * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, floats_per_vert_ * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+	}
 
-	void beginDraw() const override {
-		glEnable(GL_DEPTH_TEST);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	~Default2d() {
+		for (auto& [tex, tex_id] : loose_textures_) {
+			unsigned int id = static_cast<unsigned int>(tex_id);
+			GLState::deleteTextures(1, &id);
+		}
+		GLState::deleteBuffers(1, &VBO_);
+		GLState::deleteVertexArrays(1, &VAO_);
+	}
 
+	void beginDraw() const override {
+		draw_start_ = std::chrono::steady_clock::now();
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::polygonMode(GL_FILL);
+		quads_.clear();
+		verts_.clear();
 		//default3d specific code
 	}
 
 	void drawObj(const GameObject& obj, Cache cache) const override {
-		glBindTexture(GL_TEXTURE_2D, getTexID(cache));
-
-		glUniformMatrix4fv(position_location_, 1, GL_FALSE, obj.getPosition().data());
-		glBindVertexArray(getVAO(cache));
-		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-		//for (auto const& o : obj.getChildren()) {
-		//	draw(*o);
-		//}
+		//just collect, everything is emitted in endDraw
+		quads_.push_back(QuadRef{ &obj, std::get<0>(cache), obj.getPosition()(2, 3) });
+	}
+
+	void endDraw() const override {
+		//back to front, ties grouped by texture so they land in the same draw
+		std::sort(quads_.begin(), quads_.end(), [](const QuadRef& a, const QuadRef& b) {
+			if (a.layer != b.layer) {
+				return a.layer > b.layer;
+			}
+			return a.cache.tex_id < b.cache.tex_id;
+		});
+		for (const QuadRef& quad : quads_) {
+			writeQuad(quad);
+		}
+
+		stats_.n_quads = quads_.size();
+		stats_.n_draw_calls = 0;
+		if (!quads_.empty()) {
+			GLState::bindVertexArray(VAO_);
+			GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_);
+			vbo_capacity_ = std::max<size_t>(vbo_capacity_, 1);
+			while (vbo_capacity_ < verts_.size()) {
+				vbo_capacity_ *= 2;
+			}
+			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vbo_capacity_, NULL, GL_DYNAMIC_DRAW);//orphan last frames storage
+			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * verts_.size(), verts_.data());
+			GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+			size_t run_start = 0;
+			for (size_t i = 1; i <= quads_.size(); i++) {
+				if (i == quads_.size() || quads_[i].cache.tex_id != quads_[run_start].cache.tex_id) {
+					GLState::bindTexture(quads_[run_start].cache.tex_id);
+					glDrawArrays(GL_TRIANGLES, run_start * verts_per_quad_, (i - run_start) * verts_per_quad_);
+					stats_.n_draw_calls++;
+					run_start = i;
+				}
+			}
+		}
+		stats_.n_atlas_textures = atlas_.size();
+		stats_.n_loose_textures = loose_textures_.size();
+		stats_.cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - draw_start_).count();
+	}
+
+	//numbers from the last drawAll
+	const Default2dStats& getStats() const {
+		return stats_;
 	}
 };
@@ -6,6 +6,7 @@ const char* Default3d::vertex_code = "\n"
 "layout (location = 0) in vec3 pos;\n"
 "layout (location = 1) in vec3 norm;\n"
 "layout (location = 2) in vec2 vt;\n"
+"layout (location = 3) in vec2 baked;\n" //only static batches with baked lighting have this
 
 "uniform mat4 perspective;\n"
 "uniform mat4 camera;\n"
@@ -14,9 +15,11 @@ const char* Default3d::vertex_code = "\n"
 "out vec2 texCoord;\n"
 "out vec3 position;\n"
 "out vec3 normal;"
+"out vec2 baked_light;\n"
 
 "void main()\n"
 "{\n"
+"	baked_light = baked;\n"
 "	position = ( model * vec4(pos.x, pos.y, pos.z, 1.0)).xyz;"
 "	normal = (model *  vec4(norm.x, norm.y, norm.z, 0.0)).xyz;"
 "   gl_Position = perspective * camera *vec4(position.x, position.y, position.z, 1.0);\n"
@@ -27,10 +30,12 @@ const char* Default3d::fragment_code = "#version 330 core\n"
 "in vec2 texCoord;\n "
 "in vec3 position;\n"
 "in vec3 normal;\n"
+"in vec2 baked_light;\n" //direct light, ambient occlusion
 
 "uniform sampler2D tex;\n"
 
 "uniform vec4 overlay_color;\n"
+"uniform bool use_baked;\n"
 
 "uniform vec4 atmosphere_color;\n" //alpha is atmosphere strength
 "uniform vec4 light_color;\n"
@@ -48,12 +53,41 @@ const char* Default3d::fragment_code = "#version 330 core\n"
 "uniform vec3 light_position_3;\n"
 "uniform float light_strength_3;\n"
 
+"uniform sampler2DShadow shadow_map;\n"
+"uniform mat4 light_space;\n"
+"uniform vec3 shadow_light_direction;\n"
+"uniform float shadow_light_strength;\n"
+
 "out vec4 FragColor;\n"
 
+//fraction of the 3x3 texels around position that the shadow light reaches. each lookup is already
+//a 2x2 compare thanks to linear filtering. the bias grows on surfaces the light grazes
+"float shadowFactor(vec3 world_pos, float n_dot_l)\n"
+"{\n"
+"	vec4 light_pos = light_space * vec4(world_pos, 1.0);\n"
+"	vec3 coord = light_pos.xyz / light_pos.w * 0.5 + 0.5;\n"
+"	if (coord.z > 1.0) return 1.0;\n"
+"	float bias = max(0.002 * (1.0 - n_dot_l), 0.0005);\n"
+"	vec2 texel = 1.0 / vec2(textureSize(shadow_map, 0));\n"
+"	float lit = 0.0;\n"
+"	for (int x = -1; x <= 1; x++) {\n"
+"		for (int y = -1; y <= 1; y++) {\n"
+"			lit += texture(shadow_map, vec3(coord.xy + vec2(x, y) * texel, coord.z - bias));\n"
+"		}\n"
+"	}\n"
+"	return lit / 9.0;\n"
+"}\n"
+
 "void main()\n"
 "{\n"
 "   float a = atmosphere_color.w * (length(position));"
 "	float diff = 0;"
+"	float ambient = .3;\n"
+//the static lights were already traced into the vertices, with shadows
+"	if (use_baked) {\n"
+"		diff = baked_light.x;\n"
+"		ambient *= baked_light.y;\n"
+"	} else {\n"
 "   vec3 light_dir = (light_position - position);\n"
 "	diff += (max(dot(normal, normalize(light_dir)), 0.0)*light_strength*light_strength)/(light_strength*light_strength+dot(light_dir, light_dir));\n"//strength scaling
 
@@ -63,8 +97,14 @@ const char* Default3d::fragment_code = "#version 330 core\n"
 "	diff += (max(dot(normal, normalize(light_dir)), 0.0)*light_strength_2*light_strength_2)/(light_strength_2*light_strength_2+dot(light_dir, light_dir));\n"
 "   light_dir = (light_position_3 - position); \n"
 "	diff += (max(dot(normal, normalize(light_dir)), 0.0)*light_strength_3*light_strength_3)/(light_strength_3*light_strength_3+dot(light_dir, light_dir));\n"
+"	}\n"
+
+"	if (shadow_light_strength > 0) {\n"
+"		float n_dot_l = max(dot(normalize(normal), -shadow_light_direction), 0.0);\n"
+"		diff += n_dot_l * shadow_light_strength * shadowFactor(position, n_dot_l);\n"
+"	}\n"
 
-"	vec3 tex_color = (diff + .3) * texture(tex,texCoord).xyz;\n"
+"	vec3 tex_color = (diff + ambient) * texture(tex,texCoord).xyz;\n"
 //apply atmospheric perspective
 "	FragColor.xyz = (tex_color + atmosphere_color.xyz * a)/(1 + a)*(1-overlay_color.w) + overlay_color.xyz*overlay_color.w;\n"
 "	FragColor.w = texture(tex,texCoord).w;\n"
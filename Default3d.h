@@ -5,23 +5,47 @@
 
 #include <Eigen/Dense>
 #include <cmath>
+#include <memory>
+#include <map>
+#include <unordered_set>
 
 #include "Graphics.hpp"
 #include "camera.h"
 #include "GameObject.h"
 #include "scene.hpp"
+#include "draw_order.hpp"
+#include "static_batch.hpp"
+#include "impostor.hpp"
+#include "shadow_map.hpp"
+#include "texture_streamer.hpp"
 
 using Eigen::Matrix4f;
 
+struct Default3dStats {
+	size_t n_opaque;
+	size_t n_transparent;
+	unsigned int samples_passed; //fragments shaded, from the frame before last (0 unless overdraw measuring is on)
+	size_t n_static_drawn; //static chunks that survived culling
+	size_t n_static_culled;
+	size_t n_multi_draws; //one per static batch with anything visible
+	size_t n_triangles;
+	size_t n_triangles_full; //what the same draws would have cost with every lod at 0
+	size_t n_impostored; //objects left out because an impostor is drawn instead
+};
+
 struct Default3dCache {
 	int VAO;
 	int tex_id;
 	size_t n_elems;
 	Eigen::Vector4f overlay_color;
+	bool transparent; //texture has alpha, goes in the blended pass
+	std::vector<std::pair<int, size_t>> lods; //VAO, n_elems for every lod, VAO and n_elems above are the current one
+	int lod;
+	float texels_across; //see TextureStreamer::texelsAcross
 
-	Default3dCache() : VAO(-1), tex_id(-1), n_elems(0), overlay_color(0, 0, 0, 0) {
+	Default3dCache() : VAO(-1), tex_id(-1), n_elems(0), overlay_color(0, 0, 0, 0), transparent(false), lod(0), texels_across(0) {
 	};
-	Default3dCache(int VAO, int tex_id, size_t n_elems) : VAO(VAO),tex_id(tex_id), n_elems(n_elems),overlay_color(0.0f,0.0f,0.0f,0.0f){
+	Default3dCache(int VAO, int tex_id, size_t n_elems, bool transparent = false) : VAO(VAO),tex_id(tex_id), n_elems(n_elems),overlay_color(0.0f,0.0f,0.0f,0.0f), transparent(transparent), lods{ {VAO, n_elems} }, lod(0), texels_across(0) {
 	};
 
 
@@ -42,6 +66,21 @@ private:
 
 	static constexpr int max_lights = 3;
 
+	mutable DrawOrder<GameObject, Cache> draw_order_;
+	mutable Eigen::Matrix4f camera_matrix_;
+	mutable Eigen::Matrix4f perspective_matrix_;
+	bool sort_draws_;
+	SamplesPassedCounter* overdraw_counter_; //null unless measuring
+	mutable Default3dStats stats_;
+
+	mutable std::unordered_map<const Texture*, int> textures_; //uploaded once, shared by every object using them
+	mutable TextureStreamer streamer_; //owns the mips of every texture in textures_
+	mutable int viewport_height_;
+	std::vector<std::unique_ptr<StaticBatch>> static_batches_;
+	std::unordered_set<const GameObject*> impostored_;
+	const ShadowInfo* shadows_;
+	int bake_fbo_; //-1 until the first bakeImpostor, always Impostor::resolution square
+
 	int& getVAO(Cache cache) const {
 		return std::get<0>(cache).VAO;
 	}
@@ -57,6 +96,15 @@ private:
 		const Model& model = *(obj.getModel());
 		const Texture& tex = *(obj.getTexture());
 
+		Default3dCache cache(makeVAO(model), makeTexture(tex), model.flen(), tex.hasTransparency());
+		for (int lod = 1; lod < model.getNLods(); lod++) {
+			cache.lods.push_back({ makeVAO(model.getLod(lod)), model.getLod(lod).flen() });
+		}
+		cache.texels_across = TextureStreamer::texelsAcross(model, tex);
+		return cache;
+	}
+
+	int makeVAO(const Model& model) const {
 		unsigned int VAO;
 		glGenVertexArrays(1, &(VAO));
 		unsigned int VBO[3];
@@ -64,49 +112,36 @@ private:
 		//unsigned int EBO;
 		//glGenBuffers(1, &EBO);
 
-		glBindVertexArray(VAO);
+		GLState::bindVertexArray(VAO);
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[0]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.flen() * 9, model.getVerts().data(), GL_STATIC_DRAW);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(0);
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]); //size is wrong here! need to change it depending on how we implement norm EBO
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[1]); //size is wrong here! need to change it depending on how we implement norm EBO
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.flen() * 9, model.getNorms().data(), GL_STATIC_DRAW);
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[2]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.flen() * 6, model.getTexCoords().data(), GL_STATIC_DRAW);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(2);
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-
-		//texture code:
-
-		unsigned int tex_id;
-		glGenTextures(1, &(tex_id));
-		glBindTexture(GL_TEXTURE_2D, tex_id);
-		//this->tex_id = static_cast<int>(tex_id);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		if (tex.n_channels == 3) {
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tex.width, tex.height, 0, GL_RGB, GL_UNSIGNED_BYTE, tex.getData().data());
-		}
-		else if (tex.n_channels == 4) {
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width, tex.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex.getData().data());
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+		return static_cast<int>(VAO);
+	}
 
+	int makeTexture(const Texture& tex) const {
+		if (textures_.contains(&tex)) {
+			return textures_.at(&tex);
 		}
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		return Default3dCache(VAO, tex_id, model.flen());
+		//starts with only the small mips, the rest come in as objects get close enough to need them
+		unsigned int tex_id = streamer_.add(tex);
+		textures_[&tex] = static_cast<int>(tex_id);
+		return static_cast<int>(tex_id);
 	}
 
 	virtual void deleteDataCache(Cache cache) const override {
@@ -124,8 +159,38 @@ public:
 	}
 
 	void drawObj(const GameObject& obj, Cache cache) const override {
-			glBindTexture(GL_TEXTURE_2D, getTexID(cache));
-			glBindVertexArray(getVAO(cache));
+		if (impostored_.contains(&obj)) {
+			return;
+		}
+		//the cache passed in is a copy, keep a pointer to the real one so the sort doesnt copy anything
+		Cache& real_cache = cached_data_.at(obj.getID());
+		selectLod(obj, std::get<0>(real_cache));
+		requestMip(obj, std::get<0>(real_cache));
+		draw_order_.push(obj, real_cache, camera_matrix_, std::get<0>(cache).transparent);
+	}
+
+	void selectLod(const GameObject& obj, Default3dCache& cache) const {
+		if (cache.lods.size() < 2) {
+			return;
+		}
+		float center_depth, radius;
+		DrawOrder<GameObject, Cache>::boundsDepth(camera_matrix_, obj.getPosition(), *obj.getModel(), center_depth, radius);
+		cache.lod = LodSelector::select(LodSelector::screenSize(perspective_matrix_, center_depth, radius), cache.lod, static_cast<int>(cache.lods.size()));
+		cache.VAO = cache.lods[cache.lod].first;
+		cache.n_elems = cache.lods[cache.lod].second;
+	}
+
+	//asks the streamer for the mip this object shows its texture at, one texel per pixel
+	void requestMip(const GameObject& obj, const Default3dCache& cache) const {
+		float center_depth, radius;
+		DrawOrder<GameObject, Cache>::boundsDepth(camera_matrix_, obj.getPosition(), *obj.getModel(), center_depth, radius);
+		float pixels = LodSelector::screenSize(perspective_matrix_, center_depth, radius) * viewport_height_;
+		streamer_.request(cache.tex_id, std::log2(cache.texels_across / std::max(pixels, 1.f)));
+	}
+
+	void drawSorted(const GameObject& obj, const Cache& cache) const {
+			GLState::bindTexture(getTexID(cache));
+			GLState::bindVertexArray(getVAO(cache));
 
 			glUniform4fv(glGetUniformLocation(gl_id, "overlay_color"), 1, std::get<0>(cache).overlay_color.data());
 
@@ -133,6 +198,8 @@ public:
 
 			glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getPosition().data());
 			glDrawArrays(GL_TRIANGLES, 0, 3 * getNElems(cache));
+			stats_.n_triangles += getNElems(cache);
+			stats_.n_triangles_full += std::get<0>(cache).lods[0].second;
 
 
 			//glDrawElements(GL_TRIANGLES, 3 * getNElems(cache), GL_UNSIGNED_INT, 0);
@@ -143,12 +210,25 @@ public:
 
 	void beginDraw() const override {
 
-		glEnable(GL_DEPTH_TEST);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::polygonMode(GL_FILL);
+
+		perspective_matrix_ = scene_->camera->getPerspective();
+		glUniformMatrix4fv(perspective_location_, 1, GL_FALSE, perspective_matrix_.data());
+		camera_matrix_ = scene_->camera->getCameraMatrix();
+		glUniformMatrix4fv(camera_location_, 1, GL_FALSE, camera_matrix_.data());
+		draw_order_.clear();
+		int viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		viewport_height_ = viewport[3];
+		stats_.n_triangles = 0;
+		stats_.n_triangles_full = 0;
+		setLightUniforms();
 
-		glUniformMatrix4fv(perspective_location_, 1, GL_FALSE, scene_->camera->getPerspective().data());
-		glUniformMatrix4fv(camera_location_, 1, GL_FALSE, scene_->camera->getCameraMatrix().data());
+		//default3d specific code
+	}
 
+	void setLightUniforms() const {
 		glUniform4f(glGetUniformLocation(gl_id, "atmosphere_color"), scene_->atmosphere_color(0), scene_->atmosphere_color(1), scene_->atmosphere_color(2), scene_->atmosphere_strength);
 		if (scene_->primary_light_ != nullptr) {
 			glUniform3fv(glGetUniformLocation(gl_id, "light_position"), 1, scene_->primary_light_->position.data());
@@ -168,15 +248,218 @@ public:
 				glUniform1f(glGetUniformLocation(gl_id, ("light_strength_" + std::to_string(i + 1)).c_str()), 0);
 			}
 		}
+		ShadowInfo::setUniforms(gl_id, shadows_);
+	}
+
+	void endDraw() const override {
+		if (sort_draws_) {
+			draw_order_.sort();
+		}
+		if (overdraw_counter_ != nullptr) {
+			overdraw_counter_->begin();
+		}
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::disable(GL_BLEND);
+		drawStatic();
+		for (const auto& entry : draw_order_.getOpaque()) {
+			drawSorted(*entry.obj, *entry.cache);
+		}
 
+		//transparents test against the opaque depth but dont write it, so they dont hide each other
+		GLState::enable(GL_BLEND);
+		GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::depthMask(false);
+		for (const auto& entry : draw_order_.getTransparent()) {
+			drawSorted(*entry.obj, *entry.cache);
+		}
+		GLState::depthMask(true);
+
+		if (overdraw_counter_ != nullptr) {
+			overdraw_counter_->end();
+			stats_.samples_passed = overdraw_counter_->getLastResult();
+		}
+		stats_.n_opaque = draw_order_.getOpaque().size();
+		stats_.n_transparent = draw_order_.getTransparent().size();
+		stats_.n_impostored = impostored_.size();
+		//what was asked for this frame gets streamed for the next one
+		streamer_.update();
 		//default3d specific code
 	}
 
-	void endDraw() const override {
-		//default3d specific code
+	//static geometry goes first, it is most of the screen and fills the depth buffer for the rest
+	void drawStatic() const {
+		stats_.n_static_drawn = 0;
+		stats_.n_static_culled = 0;
+		stats_.n_multi_draws = 0;
+		if (static_batches_.empty()) {
+			return;
+		}
+		glUniform4f(glGetUniformLocation(gl_id, "overlay_color"), 0, 0, 0, 0);
+		glUniformMatrix4fv(model_location_, 1, GL_FALSE, Matrix4f::Identity().eval().data());
+		for (const auto& batch : static_batches_) {
+			glUniform1i(glGetUniformLocation(gl_id, "use_baked"), batch->isBaked());
+			StaticBatch::DrawStats batch_stats = batch->draw(camera_matrix_, perspective_matrix_, impostored_);
+			stats_.n_static_drawn += batch_stats.n_chunks;
+			stats_.n_static_culled += batch->getChunks().size() - batch_stats.n_chunks;
+			stats_.n_multi_draws += batch_stats.n_chunks > 0;
+			stats_.n_triangles += batch_stats.n_triangles;
+			stats_.n_triangles_full += batch_stats.n_triangles_full;
+			if (batch_stats.n_chunks > 0) {
+				streamer_.request(batch->getTexID(), std::log2(batch_stats.texels_per_screen / std::max(viewport_height_, 1)));
+			}
+		}
+		glUniform1i(glGetUniformLocation(gl_id, "use_baked"), false);
+	}
+
+	//merges objects that never move into one batch per texture. they are drawn from the batches
+	//only, so dont also add() them. the vertices are baked with the current positions and overlay
+	//colors dont apply to them. transparent textures arent worth batching, those fall back to add()
+	void addStatic(const std::vector<const GameObject*>& objs) {
+		std::map<int, std::vector<const GameObject*>> by_texture;
+		for (const GameObject* obj : objs) {
+			const Texture& tex = *(obj->getTexture());
+			if (tex.hasTransparency()) {
+				add(*obj);
+				continue;
+			}
+			by_texture[makeTexture(tex)].push_back(obj);
+		}
+		for (const auto& [tex_id, group] : by_texture) {
+			static_batches_.push_back(std::make_unique<StaticBatch>(group, tex_id));
+		}
+	}
+
+	//while set, obj (static or not) isnt drawn, something else is standing in for it
+	void setImpostored(const GameObject& obj, bool impostored) {
+		if (impostored) {
+			impostored_.insert(&obj);
+		} else {
+			impostored_.erase(&obj);
+		}
+	}
+
+	//impostors get their own target rather than the screenshot fbo, that one keeps whatever size the
+	//first screenshot asked for and is busy while one is being taken
+	void makeBakeFBO() {
+		unsigned int fbo, color_buffer, depth_buffer;
+		glGenFramebuffers(1, &fbo);
+		bake_fbo_ = static_cast<int>(fbo);
+		glGenRenderbuffers(1, &color_buffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Impostor::resolution, Impostor::resolution);
+		glGenRenderbuffers(1, &depth_buffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Impostor::resolution, Impostor::resolution);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+	}
+
+	//renders obj from each of the impostors views into its textures, lit the same way it would be
+	//in the scene. whatever was bound before, e.g. the frame scheduler's scaled target or a
+	//screenshot, is bound again after. leaves this program in use
+	void bakeImpostor(const GameObject& obj, Impostor& impostor) {
+		int bound_fbo;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound_fbo);
+		int viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		float clear_color[4];
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+
+		if (bake_fbo_ == -1) {
+			makeBakeFBO();
+		}
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(bake_fbo_));
+		GLState::useProgram(gl_id);
+		setLightUniforms();
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::disable(GL_BLEND);
+		GLState::disable(GL_SCISSOR_TEST);
+		GLState::depthMask(true);
+		GLState::polygonMode(GL_FILL);
+		glUniform4f(glGetUniformLocation(gl_id, "overlay_color"), 0, 0, 0, 0);
+
+		const StaticBatch* batch = nullptr;
+		for (const auto& static_batch : static_batches_) {
+			if (static_batch->contains(obj)) {
+				batch = static_batch.get();
+			}
+		}
+
+		glViewport(0, 0, Impostor::resolution, Impostor::resolution);
+		glClearColor(0, 0, 0, 0);
+		for (int view = 0; view < Impostor::n_views; view++) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glUniformMatrix4fv(perspective_location_, 1, GL_FALSE, impostor.projection().data());
+			glUniformMatrix4fv(camera_location_, 1, GL_FALSE, impostor.viewCamera(view).data());
+			if (batch != nullptr) {
+				glUniformMatrix4fv(model_location_, 1, GL_FALSE, Matrix4f::Identity().eval().data());
+				glUniform1i(glGetUniformLocation(gl_id, "use_baked"), batch->isBaked());
+				batch->drawChunk(obj);
+				glUniform1i(glGetUniformLocation(gl_id, "use_baked"), false);
+			} else {
+				const Default3dCache& cache = std::get<0>(cached_data_.at(obj.getID()));
+				GLState::bindTexture(cache.tex_id);
+				GLState::bindVertexArray(cache.lods[0].first);
+				glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getPosition().data());
+				glDrawArrays(GL_TRIANGLES, 0, 3 * cache.lods[0].second);
+			}
+
+			GLState::bindTexture(impostor.color_tex);
+			glCopyTexSubImage2D(GL_TEXTURE_2D, 0, view * Impostor::resolution, 0, 0, 0, Impostor::resolution, Impostor::resolution);
+			GLState::bindTexture(impostor.depth_tex);
+			glCopyTexSubImage2D(GL_TEXTURE_2D, 0, view * Impostor::resolution, 0, 0, 0, Impostor::resolution, Impostor::resolution);
+		}
+		glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(bound_fbo));
+		impostor.baked = true;
+	}
+
+	const Scene* getScene() const {
+		return scene_;
+	}
+
+	const std::vector<std::unique_ptr<StaticBatch>>& getStaticBatches() const {
+		return static_batches_;
+	}
+
+	void setShadowLight(const Scene::orthogonalLight* light) {
+		if (scene_ == nullptr) {
+			scene_ = new Scene();
+		}
+		scene_->shadow_light = light;
+	}
+
+	//null turns shadows off
+	void setShadows(const ShadowInfo* shadows) {
+		shadows_ = shadows;
+		GLState::useProgram(gl_id);
+		glUniform1i(glGetUniformLocation(gl_id, "shadow_map"), ShadowInfo::texture_unit);
+	}
+
+	//turning sorting off keeps the two passes but draws in hash map order, for comparing overdraw
+	void setSortDraws(bool sort_draws) {
+		sort_draws_ = sort_draws;
+	}
+
+	void setMeasureOverdraw(bool measure) {
+		if (measure && overdraw_counter_ == nullptr) {
+			overdraw_counter_ = new SamplesPassedCounter();
+		}
+		else if (!measure && overdraw_counter_ != nullptr) {
+			delete overdraw_counter_;
+			overdraw_counter_ = nullptr;
+			stats_.samples_passed = 0;
+		}
+	}
+
+	const Default3dStats& getStats() const {
+		return stats_;
+	}
+
+	const TextureStreamer::Stats& getTextureStats() const {
+		return streamer_.getStats();
 	}
 
 	void setCamera(Camera* camera) {
@@ -198,7 +481,15 @@ public:
 		model_location_(glGetUniformLocation(gl_id, "model")),
 		camera_location_(glGetUniformLocation(gl_id, "camera")),
 		perspective_location_(glGetUniformLocation(gl_id, "perspective")),
-		scene_(nullptr){
+		scene_(nullptr),
+		camera_matrix_(Eigen::Matrix4f::Identity()),
+		perspective_matrix_(Eigen::Matrix4f::Identity()),
+		sort_draws_(true),
+		overdraw_counter_(nullptr),
+		viewport_height_(1),
+		shadows_(nullptr),
+		bake_fbo_(-1),
+		stats_{ 0, 0, 0, 0, 0, 0, 0, 0, 0 } {
 
 		//perspective_ << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1;
 	}
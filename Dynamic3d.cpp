@@ -45,8 +45,31 @@ const char* Dynamic3d::fragment_code = "#version 330 core\n"
 "uniform vec4 light_color_3;\n"
 "uniform vec3 light_position_3;\n"
 "uniform float light_strength_3;\n"
+"uniform sampler2DShadow shadow_map;\n"
+"uniform mat4 light_space;\n"
+"uniform vec3 shadow_light_direction;\n"
+"uniform float shadow_light_strength;\n"
+
 "out vec4 FragColor;\n"
 
+//fraction of the 3x3 texels around position that the shadow light reaches. each lookup is already
+//a 2x2 compare thanks to linear filtering. the bias grows on surfaces the light grazes
+"float shadowFactor(vec3 world_pos, float n_dot_l)\n"
+"{\n"
+"	vec4 light_pos = light_space * vec4(world_pos, 1.0);\n"
+"	vec3 coord = light_pos.xyz / light_pos.w * 0.5 + 0.5;\n"
+"	if (coord.z > 1.0) return 1.0;\n"
+"	float bias = max(0.002 * (1.0 - n_dot_l), 0.0005);\n"
+"	vec2 texel = 1.0 / vec2(textureSize(shadow_map, 0));\n"
+"	float lit = 0.0;\n"
+"	for (int x = -1; x <= 1; x++) {\n"
+"		for (int y = -1; y <= 1; y++) {\n"
+"			lit += texture(shadow_map, vec3(coord.xy + vec2(x, y) * texel, coord.z - bias));\n"
+"		}\n"
+"	}\n"
+"	return lit / 9.0;\n"
+"}\n"
+
 "void main()\n"
 "{\n"
 "   float a = atmosphere_color.w * (length(position));"
@@ -64,6 +87,11 @@ const char* Dynamic3d::fragment_code = "#version 330 core\n"
 
 "	vec4 tex_pixel_data = texture(tex,texCoord);\n"
 "   if(tex_pixel_data.w < .2) discard;\n"
+"	if (shadow_light_strength > 0) {\n"
+"		float n_dot_l = max(dot(normalize(normal), -shadow_light_direction), 0.0);\n"
+"		diff += n_dot_l * shadow_light_strength * shadowFactor(position, n_dot_l);\n"
+"	}\n"
+
 "	vec3 tex_color = (diff + .3) * tex_pixel_data.xyz;\n"
 //apply atmospheric perspective
 "	FragColor.xyz = (tex_color + atmosphere_color.xyz * a)/(1 + a)*(1-overlay_color.w) + overlay_color.xyz*overlay_color.w;\n"
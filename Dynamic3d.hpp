@@ -11,6 +11,8 @@
 #include "GameObject.h"
 #include "scene.hpp"
 #include "dynamic_model.hpp"
+#include "draw_order.hpp"
+#include "shadow_map.hpp"
 #include "tuple"
 
 using Eigen::Matrix4f;
@@ -26,13 +28,14 @@ struct Dynamic3dCache {
 	std::vector<std::tuple<unsigned int, unsigned int, const Eigen::Matrix4f*>> static_VAOs;
 
 	Eigen::Vector4f overlay_color;
+	bool transparent;
 
-	Dynamic3dCache() : VAO(-1), tex_id(-1), n_elems(0), pos_vbo(0),norm_vbo(0), overlay_color(0, 0, 0, 0) {
+	Dynamic3dCache() : VAO(-1), tex_id(-1), n_elems(0), pos_vbo(0),norm_vbo(0), overlay_color(0, 0, 0, 0), transparent(false) {
 	};
-	Dynamic3dCache(int VAO, int tex_id, size_t n_elems,unsigned int pos_vbo,unsigned int norm_vbo, std::vector<std::tuple<unsigned int, unsigned int, const Eigen::Matrix4f*>> static_VAOs)
+	Dynamic3dCache(int VAO, int tex_id, size_t n_elems,unsigned int pos_vbo,unsigned int norm_vbo, std::vector<std::tuple<unsigned int, unsigned int, const Eigen::Matrix4f*>> static_VAOs, bool transparent = false)
 		: VAO(VAO), tex_id(tex_id), n_elems(n_elems),
 			pos_vbo(pos_vbo), norm_vbo(norm_vbo),static_VAOs(static_VAOs),
-			overlay_color(0.0f, 0.0f, 0.0f, 0.0f) {
+			overlay_color(0.0f, 0.0f, 0.0f, 0.0f), transparent(transparent) {
 	};
 };
 
@@ -44,29 +47,33 @@ private:
 	const unsigned int model_location_;
 
 	Scene* scene_;
+	const ShadowInfo* shadows_;
 
 	static constexpr int max_lights = 3;
 
+	mutable DrawOrder<GameObject, Cache> draw_order_; //same opaque/transparent split as default3d
+	mutable Eigen::Matrix4f camera_matrix_;
 
-	int& getVAO(Cache cache) const {
+
+	const int& getVAO(const Cache& cache) const {
 		return std::get<0>(cache).VAO;
 	}
 
-	int& getTexID(Cache cache) const {
+	const int& getTexID(const Cache& cache) const {
 		return std::get<0>(cache).tex_id;
 	}
-	size_t& getNElems(Cache cache) const {
+	const size_t& getNElems(const Cache& cache) const {
 		return std::get<0>(cache).n_elems;
 	}
-	unsigned int& getPosVBO(Cache cache) const {
+	const unsigned int& getPosVBO(const Cache& cache) const {
 		return std::get<0>(cache).pos_vbo;
 	}
 
-	unsigned int& getNormVBO(Cache cache) const {
+	const unsigned int& getNormVBO(const Cache& cache) const {
 		return std::get<0>(cache).norm_vbo;
 	}
 
-	const std::vector<std::tuple<unsigned int, unsigned int, const Eigen::Matrix4f*>>& getStaticVAOs(Cache& cache) const {
+	const std::vector<std::tuple<unsigned int, unsigned int, const Eigen::Matrix4f*>>& getStaticVAOs(const Cache& cache) const {
 		return std::get<0>(cache).static_VAOs;
 	}
 
@@ -82,7 +89,7 @@ private:
 		//unsigned int EBO;
 		//glGenBuffers(1, &EBO);
 
-		glBindVertexArray(VAO);
+		GLState::bindVertexArray(VAO);
 
 		std::vector<float>* vert_pos = new std::vector<float>(3 * model.vlen());
 		vert_pos->reserve(3 * model.vlen());
@@ -95,7 +102,16 @@ private:
 		for (int i = 0; i < vert_norm->size(); i++) {
 			(*vert_norm)[i] = 0.;
 		}
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
+		//pos and norm get their data every frame, but the layout is vao state so it only needs setting once
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(1);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[2]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.getTexCoords().size(), model.getTexCoords().data(), GL_STATIC_DRAW);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(2);
@@ -108,7 +124,7 @@ private:
 		std::vector<std::tuple<unsigned int, unsigned int, const Eigen::Matrix4f*>> static_VAOs;
 		if (dyn_model != nullptr) {
 			for (auto& stat_mod : dyn_model->getStaticModels()) {
-				Model static_model = *stat_mod.second;
+				const Model& static_model = *stat_mod.second;
 
 				unsigned int sVAO;
 				glGenVertexArrays(1, &sVAO);
@@ -116,19 +132,19 @@ private:
 				unsigned int sVBO[3];
 				glGenBuffers(3, sVBO);
 
-				glBindVertexArray(sVAO);
+				GLState::bindVertexArray(sVAO);
 
-				glBindBuffer(GL_ARRAY_BUFFER, sVBO[0]);
+				GLState::bindBuffer(GL_ARRAY_BUFFER, sVBO[0]);
 				glBufferData(GL_ARRAY_BUFFER, sizeof(float) * static_model.flen() * 9, static_model.getVerts().data(), GL_STATIC_DRAW);
 				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 				glEnableVertexAttribArray(0);
 
-				glBindBuffer(GL_ARRAY_BUFFER, sVBO[1]); //size is wrong here! need to change it depending on how we implement norm EBO
+				GLState::bindBuffer(GL_ARRAY_BUFFER, sVBO[1]); //size is wrong here! need to change it depending on how we implement norm EBO
 				glBufferData(GL_ARRAY_BUFFER, sizeof(float) * static_model.flen() * 9, static_model.getNorms().data(), GL_STATIC_DRAW);
 				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 				glEnableVertexAttribArray(1);
 
-				glBindBuffer(GL_ARRAY_BUFFER, sVBO[2]);
+				GLState::bindBuffer(GL_ARRAY_BUFFER, sVBO[2]);
 				glBufferData(GL_ARRAY_BUFFER, sizeof(float) * static_model.flen() * 6, static_model.getTexCoords().data(), GL_STATIC_DRAW);
 				glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
 				glEnableVertexAttribArray(2);
@@ -137,14 +153,14 @@ private:
 			}
 		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
 
 		//texture code:
 
 		unsigned int tex_id;
 		glGenTextures(1, &(tex_id));
-		glBindTexture(GL_TEXTURE_2D, tex_id);
+		GLState::bindTexture(tex_id);
 		//this->tex_id = static_cast<int>(tex_id);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -162,7 +178,7 @@ private:
 		}
 		glGenerateMipmap(GL_TEXTURE_2D);
 
-		return Dynamic3dCache(VAO,tex_id, model.flen(), VBO[0], VBO[1],static_VAOs);
+		return Dynamic3dCache(VAO,tex_id, model.flen(), VBO[0], VBO[1],static_VAOs, tex.hasTransparency());
 	}
 
 	virtual void deleteDataCache(Cache cache) const override {
@@ -172,24 +188,24 @@ private:
 public:
 
 	void drawObj(const GameObject& obj, Cache cache) const override {
+		draw_order_.push(obj, cached_data_.at(obj.getID()), camera_matrix_, std::get<0>(cache).transparent);
+	}
+
+	void drawSorted(const GameObject& obj, const Cache& cache) const {
 		if (!obj.isHidden()) {
 			glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getPosition().data());
 			glUniform4fv(glGetUniformLocation(gl_id, "overlay_color"), 1, std::get<0>(cache).overlay_color.data());
 
 
-			glBindTexture(GL_TEXTURE_2D, getTexID(cache));
-			glBindVertexArray(getVAO(cache));
+			GLState::bindTexture(getTexID(cache));
+			GLState::bindVertexArray(getVAO(cache));
 
-			glBindBuffer(GL_ARRAY_BUFFER, getPosVBO(cache));
+			GLState::bindBuffer(GL_ARRAY_BUFFER, getPosVBO(cache));
 
 			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * obj.getModel()->vlen() * 3, obj.getModel()->getVerts().data(), GL_DYNAMIC_DRAW);
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
 
-			glBindBuffer(GL_ARRAY_BUFFER, getNormVBO(cache));
+			GLState::bindBuffer(GL_ARRAY_BUFFER, getNormVBO(cache));
 			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * obj.getModel()->getNorms().size(), obj.getModel()->getNorms().data(), GL_DYNAMIC_DRAW);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(1);
 
 			glDrawArrays(GL_TRIANGLES, 0, 3 * getNElems(cache));
 
@@ -199,7 +215,7 @@ public:
 				for (int i = 0; i < getStaticVAOs(cache).size(); i++) {
 					const auto& sVAO_pos_pair = getStaticVAOs(cache)[i];
 					//glBindTexture(GL_TEXTURE_2D, getTexID(cache));
-					glBindVertexArray(std::get<0>(sVAO_pos_pair));
+					GLState::bindVertexArray(std::get<0>(sVAO_pos_pair));
 					
 					glUniformMatrix4fv(model_location_, 1, GL_FALSE, std::get<2>(sVAO_pos_pair)->data());
 					glDrawArrays(GL_TRIANGLES, 0, 3 * std::get<1>(sVAO_pos_pair));
@@ -215,11 +231,13 @@ public:
 	}
 
 	void beginDraw() const override {
-		glEnable(GL_DEPTH_TEST);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::polygonMode(GL_FILL);
 
 		glUniformMatrix4fv(perspective_location_, 1, GL_FALSE, scene_->camera->getPerspective().data());
-		glUniformMatrix4fv(camera_location_, 1, GL_FALSE, scene_->camera->getCameraMatrix().data());
+		camera_matrix_ = scene_->camera->getCameraMatrix();
+		glUniformMatrix4fv(camera_location_, 1, GL_FALSE, camera_matrix_.data());
+		draw_order_.clear();
 
 		glUniform4f(glGetUniformLocation(gl_id, "atmosphere_color"), scene_->atmosphere_color(0), scene_->atmosphere_color(1), scene_->atmosphere_color(2), scene_->atmosphere_strength);
 		if (scene_->primary_light_ != nullptr) {
@@ -240,13 +258,25 @@ public:
 				glUniform1f(glGetUniformLocation(gl_id, ("light_strength_" + std::to_string(i + 1)).c_str()), 0);
 			}
 		}
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
+		ShadowInfo::setUniforms(gl_id, shadows_);
 		//default3d specific code
 	}
 
 	void endDraw() const override {
+		draw_order_.sort();
+
+		GLState::disable(GL_BLEND);
+		for (const auto& entry : draw_order_.getOpaque()) {
+			drawSorted(*entry.obj, *entry.cache);
+		}
+
+		GLState::enable(GL_BLEND);
+		GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::depthMask(false);
+		for (const auto& entry : draw_order_.getTransparent()) {
+			drawSorted(*entry.obj, *entry.cache);
+		}
+		GLState::depthMask(true);
 		//default3d specific code
 	}
 
@@ -261,6 +291,20 @@ public:
 		scene_ = scene;
 	}
 
+	void setShadowLight(const Scene::orthogonalLight* light) {
+		if (scene_ == nullptr) {
+			scene_ = new Scene();
+		}
+		scene_->shadow_light = light;
+	}
+
+	//null turns shadows off
+	void setShadows(const ShadowInfo* shadows) {
+		shadows_ = shadows;
+		GLState::useProgram(gl_id);
+		glUniform1i(glGetUniformLocation(gl_id, "shadow_map"), ShadowInfo::texture_unit);
+	}
+
 	void setOverlayColor(const GameObject& obj, Eigen::Vector4f color) {
 		std::get<0>(getCache(obj)).overlay_color = color;
 	}
@@ -269,7 +313,9 @@ public:
 		model_location_(glGetUniformLocation(gl_id, "model")),
 		camera_location_(glGetUniformLocation(gl_id, "camera")),
 		perspective_location_(glGetUniformLocation(gl_id, "perspective")),
-		scene_(nullptr) {
+		scene_(nullptr),
+		shadows_(nullptr),
+		camera_matrix_(Eigen::Matrix4f::Identity()) {
 
 		//perspective_ << 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1;
 	}
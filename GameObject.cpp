@@ -1,9 +1,84 @@
 #include "GameObject.h"
 #include "UI.h"
 #include "textbox_object.hpp"
+#include "collision_world.hpp"
 
 float GameObject::global_game_speed_ = 1.0f;
+float GameObject::max_dt_ = .1f; //10 fps, the frame scheduler keeps ordinary frames well under this
 std::unordered_set<GameObject*> GameObject::global_game_objects;
+CollisionWorld* GameObject::pair_world_ = nullptr;
+std::unordered_set<GameObject*> GameObject::pair_owners_;
+
+void GameObject::addCollisionPair(const GameObject* other, CollisionPairBase* collision_pair) {
+	collidors_.insert({ other,collision_pair });
+	collision_flags_.insert({ collision_pair,false });
+	pair_owners_.insert(this);
+	if (pair_world_ != nullptr) {
+		pair_world_->addPair(this, other, collision_pair);
+	}
+}
+
+void GameObject::removeCollisionPair(const GameObject* other, CollisionPairBase* collision_pair) {
+	collidors_.erase({ other,collision_pair });
+	collision_flags_.erase(collision_pair);
+	if (collidors_.empty()) {
+		pair_owners_.erase(this);
+	}
+	if (pair_world_ != nullptr) {
+		pair_world_->removePair(collision_pair);
+	}
+}
+
+void GameObject::setPairWorld(CollisionWorld* world) {
+	if (world == pair_world_) {
+		return;
+	}
+	//pairs touching as they move get onDecollision, the new world starts them out apart. called after
+	//everything has moved, so the callbacks can add and remove pairs
+	struct Moved {
+		GameObject* owner;
+		const GameObject* other;
+		CollisionPairBase* collision_pair;
+	};
+	std::vector<Moved> ended;
+	for (GameObject* owner : pair_owners_) {
+		for (auto& [other, collision_pair] : owner->collidors_) {
+			bool colliding = pair_world_ != nullptr ? pair_world_->isPairColliding(collision_pair) : owner->collision_flags_.at(collision_pair);
+			if (colliding) {
+				ended.push_back({ owner, other, collision_pair });
+			}
+			if (pair_world_ != nullptr) {
+				pair_world_->removePair(collision_pair);
+			}
+			if (world != nullptr) {
+				world->addPair(owner, other, collision_pair);
+			}
+			owner->collision_flags_.at(collision_pair) = false;
+		}
+	}
+	pair_world_ = world;
+	for (Moved& moved : ended) {
+		moved.owner->onDecollision(moved.other, moved.collision_pair);
+	}
+}
+
+void GameObject::leavePairWorld() {
+	if (pair_world_ != nullptr) {
+		for (auto& [other, collision_pair] : collidors_) {
+			pair_world_->removePair(collision_pair);
+		}
+	}
+	pair_owners_.erase(this);
+}
+
+void GameObject::leaveWorlds() {
+	//remove would take each out of world_bodies_ as it went
+	std::vector<std::pair<CollisionWorld*, int>> bodies;
+	bodies.swap(world_bodies_);
+	for (auto [world, id] : bodies) {
+		world->remove(id);
+	}
+}
 
 void GameObject::openDebugUI(GameObject* UI_container, GLFWwindow* window, GraphicsRaw<GameObject>& graphics_2d, GraphicsRaw<Textbox>& text_graphics) {
 	/*
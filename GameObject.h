@@ -32,7 +32,10 @@ using std::chrono::time_point;
 using std::chrono::system_clock;
 using std::chrono::duration_cast;
 
+class CollisionWorld;
+
 class GameObject: public InternalObject {
+	friend class CollisionWorld; //calls the collision callbacks
 
 private:
 
@@ -75,6 +78,17 @@ private:
 	std::unordered_map<CollisionPairBase*, bool> collision_flags_;
 	bool active_hitbox_;
 
+	static CollisionWorld* pair_world_; //the current level's, it checks collidors_ instead of update
+	static std::unordered_set<GameObject*> pair_owners_; //everything with collidors_, to move them between worlds
+
+	//takes collidors_ out of pair_world_ before this goes away
+	void leavePairWorld();
+
+	std::vector<std::pair<CollisionWorld*, int>> world_bodies_; //ids CollisionWorld::add gave this, kept up by the worlds
+
+	//takes world_bodies_ out of their worlds before this goes away
+	void leaveWorlds();
+
 	const GameObject* parent_;
 	PositionConstraint* connector_;
 
@@ -85,6 +99,7 @@ private:
 	GraphicsRaw<GameObject>* graphics_;
 
 	static float global_game_speed_;
+	static float max_dt_;
 
 	
 protected:
@@ -99,43 +114,22 @@ protected:
 	}
 
 
-	Eigen::Vector3f onInvalidTranslation(Eigen::Vector3f translation, BoundaryConstraint* broken_constraint, int n_iters) {
-		//motion constraint::bestTranslate/limitTranslate will NEVER return an invalid translation, however if the
+	Eigen::Vector3f onInvalidTranslation(Eigen::Vector3f translation, BoundaryConstraint* broken_constraint, int n_slides) {
+		//motion constraint::bestTranslate/slideTranslate will NEVER return an invalid translation, however if the
 		//user wants to perform some chikanery here and decide to do something else they are allowed
-		//default algorithm is just bounce
-		Eigen::Vector3f normal;
-		Eigen::Vector3f binormal;
+		//default algorithm is slide along whatever was hit, bouncing off sideways if that gets nowhere
 		if (abs(translation.dot(getPosition()(seq(0, 2), 1))) == translation.norm()) {//if translation is purely vertical
-			//normal = getPosition()(seq(0, 2), 2);
-			//binormal = getPosition()(seq(0, 2), 0);
-			return broken_constraint->limitTranslate(getPosition(), translation,n_iters);
-		}
-		else {
-			normal = translation.cross(Eigen::Vector3f(getPosition()(seq(0, 2), 1)));
-			binormal = translation.cross(normal);
-			normal.normalize();
-			binormal.normalize();
+			return broken_constraint->slideTranslate(getPosition(), translation, n_slides);
 		}
-		return broken_constraint->bestTranslate(getPosition(), translation, normal, binormal,n_iters);
+		Eigen::Vector3f normal = translation.cross(Eigen::Vector3f(getPosition()(seq(0, 2), 1))).normalized();
+		Eigen::Vector3f binormal = translation.cross(normal).normalized();
+		return broken_constraint->bestTranslate(getPosition(), translation, normal, binormal, n_slides);
 	}
 
 	virtual Eigen::Vector3f onInvalidTranslation(Eigen::Vector3f translation, BoundaryConstraint* broken_constraint) {
-		//motion constraint::bestTranslate/limitTranslate will NEVER return an invalid translation, however if the
+		//motion constraint::bestTranslate/slideTranslate will NEVER return an invalid translation, however if the
 		//user wants to perform some chikanery here and decide to do something else they are allowed
-		Eigen::Vector3f normal;
-		Eigen::Vector3f binormal;
-		if (abs(translation.dot(getPosition()(seq(0, 2), 1))) == translation.norm()) {//if translation is purely vertical
-			//normal = getPosition()(seq(0, 2), 2);
-			//binormal = getPosition()(seq(0, 2), 0);
-			return broken_constraint->limitTranslate(getPosition(), translation);
-		}
-		else {
-			normal = translation.cross(Eigen::Vector3f(getPosition()(seq(0, 2), 1)));
-			binormal = translation.cross(normal);
-			normal.normalize();
-			binormal.normalize();
-		}
-		return broken_constraint->bestTranslate(getPosition(), translation, normal, binormal);
+		return onInvalidTranslation(translation, broken_constraint, 3);
 	}
 
 	virtual Eigen::Matrix3f onInvalidRotation(Eigen::Matrix3f rotation, BoundaryConstraint* broken_constraint) {
@@ -200,6 +194,11 @@ public:
 	static void setGlobalGameSpeed(float game_speed) {
 		global_game_speed_ = game_speed;
 	}
+
+	//the longest step getdt returns
+	static void setMaxdt(float max_dt) {
+		max_dt_ = max_dt;
+	}
 	
 	static std::unordered_set<GameObject*> global_game_objects;
 
@@ -212,6 +211,7 @@ public:
 	GameObject(std::string name=InternalObject::no_name, const KeyStateCallback_base& key_state_callback_caller=InternalObject::no_key_state_callback, const ControllerStateCallback_base& controller_state_callback_caller = InternalObject::no_controller_state_callback) :
 		position_(Eigen::Matrix4f::Identity()),
 		last_position_(position_),
+		dG_(Eigen::Matrix4f::Identity()),
 		InternalObject(name, key_state_callback_caller, controller_state_callback_caller),
 		t_ref_(system_clock::now()),
 		parent_(nullptr),
@@ -220,6 +220,12 @@ public:
 	}
 
 	~GameObject() {
+		if (!collidors_.empty()) {
+			leavePairWorld();
+		}
+		if (!world_bodies_.empty()) {
+			leaveWorlds();
+		}
 		dependents_.clear();
 		//if (parent_ != nullptr) {
 		//	//EVIL EVIL CODE!
@@ -262,29 +268,31 @@ public:
 			}
 		}
 		
-		//check collisions
-		for (auto& collidor : collidors_) {
-			auto& other = collidor.first;
-			auto& collision_pair = collidor.second;
-			if (active_hitbox_ && collidor.first->active_hitbox_ && collision_pair->isCollision()) {
-				collision_pair->fullCollisionInfo();
-				if (collision_flags_.at(collision_pair) == false) {
-					//is colliding, hasnt called onCollision
-					onCollision(other, collision_pair);
-					collision_flags_.at(collision_pair) = true;
+		//check collisions, only outside a level. in one they are checked with the level's other pairs
+		if (pair_world_ == nullptr) {
+			for (auto& collidor : collidors_) {
+				auto& other = collidor.first;
+				auto& collision_pair = collidor.second;
+				if (active_hitbox_ && collidor.first->active_hitbox_ && collision_pair->isCollision()) {
+					collision_pair->fullCollisionInfo();
+					if (collision_flags_.at(collision_pair) == false) {
+						//is colliding, hasnt called onCollision
+						onCollision(other, collision_pair);
+						collision_flags_.at(collision_pair) = true;
+					} else {
+						//is collidiing, has called onCollision
+						whileCollision(other, collision_pair);
+					}
 				} else {
-					//is collidiing, has called onCollision
-					whileCollision(other, collision_pair);
-				}
-			} else {
-				if (collision_flags_.at(collision_pair) == true) {
-					//isnt colliding, has called onCllision
-					onDecollision(other, collision_pair);
-					collision_flags_.at(collision_pair) = false;
-				} else {
-					//isnt colliding hasn't called onCollision
-				}
+					if (collision_flags_.at(collision_pair) == true) {
+						//isnt colliding, has called onCllision
+						onDecollision(other, collision_pair);
+						collision_flags_.at(collision_pair) = false;
+					} else {
+						//isnt colliding hasn't called onCollision
+					}
 
+				}
 			}
 		}
 
@@ -310,16 +318,14 @@ public:
 	}
 
 
-	void addCollisionPair(const GameObject* other, CollisionPairBase* collision_pair) {
-		this->collidors_.insert({ other,collision_pair });
-		this->collision_flags_.insert({ collision_pair,false });
-		//this->collision_flags_.emplace_back(false);
-	}
-	void removeCollisionPair(const GameObject* other, CollisionPairBase* collision_pair) {
-		this->collidors_.erase({other,collision_pair});
-		this->collision_flags_.erase(collision_pair);
-		//this->collision_flags_.emplace_back(false);
-	}
+	//checked by the current level's CollisionWorld with the rest of its pairs, on its worker pool. before
+	//there is a level they are checked in update, one pair after another
+	void addCollisionPair(const GameObject* other, CollisionPairBase* collision_pair);
+	void removeCollisionPair(const GameObject* other, CollisionPairBase* collision_pair);
+
+	//where pairs added with addCollisionPair are checked from now on, every pair already added moves
+	//over and starts out not colliding. nullptr goes back to checking them in update
+	static void setPairWorld(CollisionWorld* world);
 
 	template<PrimaryHitbox PrimaryHitbox_T, SecondaryHitbox<PrimaryHitbox_T> SecondaryHitbox_T>
 	void addCollidor(const PrimaryHitbox_T& primary_hbox, const SecondaryHitbox_T& secondary_hbox, GameObject* other) {
@@ -356,8 +362,8 @@ public:
 	void directMessage(GameObject* recipient, const std::string message, const void* attachments=nullptr) {};
 
 	float getdt() const {
-		//below 30 fps, game will just slow down
-		return std::min(.03333f, dt_.count()*global_game_speed_);
+		//frames longer than max_dt_ (breakpoints, loading) slow the game down instead of jumping it ahead
+		return std::min(max_dt_, dt_.count()*global_game_speed_);
 	}//note this is a copy, not a ref
 
 	const Eigen::Matrix4f& getdG() const {
@@ -608,10 +614,11 @@ public:
 				vec = onInvalidTranslation(vec, m_c);
 			}
 		}
-		//ensure invalid translate vec is still valid
+		//ensure invalid translate vec is still valid. a sweep crosses the same things either way along a
+		//move so it is only checked forwards, and a move no constraint changed is the sweep it just did
 		new_pos(seq(0, 2), 3) = getPosition()(seq(0, 2), 3) + vec;
 		for (auto m_c : motion_constraints_) {
-			if (m_c->breaksConstraint(getPosition(), new_pos) || m_c->breaksConstraint(new_pos, getPosition())) {
+			if (m_c->breaksConstraint(getPosition(), new_pos)) {
 				return Eigen::Vector3f::Zero();
 			}
 		}
@@ -698,6 +705,9 @@ public:
 	void deactivateHitbox() {
 		active_hitbox_ = false;
 	}
+	bool isHitboxActive() const {
+		return active_hitbox_;
+	}
 
 
 
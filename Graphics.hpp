@@ -9,6 +9,7 @@
 #include <concepts>
 
 #include "graphics_raw.hpp"
+#include "gl_state.hpp"
 
 /*
 template<class T>
@@ -122,6 +123,11 @@ protected:
 		return cached_data_.at(obj.getID());
 	}
 
+	//-1 until the first startScreenshot
+	int getScreenshotFBO() const {
+		return FBO_;
+	}
+
 public:
 	
 
@@ -130,7 +136,7 @@ public:
 	}*/
 
 	void drawAll() const {
-		glUseProgram(gl_id);
+		GLState::useProgram(gl_id);
 		beginDraw();
 		for (const auto& obj : draw_targets_) {
 			if (!((obj.second)->isHidden())) {
@@ -138,8 +144,7 @@ public:
 			}
 		}
 		endDraw();
-		glBindVertexArray(0);
-		glUseProgram(0);
+		//no unbinding here, the next pass binds what it needs through GLState anyway
 	}
 
 
@@ -177,12 +182,12 @@ public:
 			glBindRenderbuffer(GL_RENDERBUFFER, depth_render_buffer);
 			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
 
-			glBindFramebuffer(GL_FRAMEBUFFER,static_cast<unsigned int>(FBO_));
+			GLState::bindFramebuffer(GL_FRAMEBUFFER,static_cast<unsigned int>(FBO_));
 			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, render_buffer_);
 			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_render_buffer);
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 		}
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<unsigned int>(FBO_));
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<unsigned int>(FBO_));
 		screenshot_width_ = width;
 		screenshot_height_ = height;
 	}
@@ -190,11 +195,11 @@ public:
 	template <class T, unsigned int gl_data_type_enum>
 	void finishScreenshot(std::vector<T>* img) {
 		img->reserve(screenshot_width_ * screenshot_height_ * 4); //4 buffers
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<unsigned int>(FBO_));
+		GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<unsigned int>(FBO_));
 		glReadBuffer(GL_COLOR_ATTACHMENT0);
 		glReadPixels(0, 0, screenshot_width_, screenshot_height_, GL_RGBA, gl_data_type_enum,img->data());
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 	}
 
 	template <class T, unsigned int gl_data_type_enum>
@@ -10,6 +10,8 @@
 
 #include "GameObject.h"
 #include "dynamic_model.hpp"
+#include "skinned_mesh_surface.hpp"
+#include "collision_world.hpp"
 #include "UI.h"
 #include "animation.hpp"
 
@@ -86,6 +88,9 @@ private:
 	MeshSurface hitbox_;
 	MeshSurface exact_hitbox_;
 	MeshSurface enlarged_hitbox_;
+	HitboxHierarchy hitbox_hierarchy_; //hitbox_ in front of exact_hitbox_
+	SkinnedMeshSurface posed_hitbox_; //exact_hitbox_ following the model's pose
+	int n_posed_bodies_; //worlds posed_hitbox_ is in, it is only posed while there is one
 
 
 	void refreshDebugSliders() {
@@ -189,6 +194,9 @@ protected:
 		}
 		setState(new_state);*/
 		dyn_model_->updateData();
+		if (n_posed_bodies_ > 0) {
+			posed_hitbox_.update();
+		}
 
 		refreshDebugSliders();
 	}
@@ -247,7 +255,10 @@ public:
 		animation_iterator_(.3,.6),
 		hitbox_("human_static_hitbox.obj", AnimationBase::debug_path),
 		exact_hitbox_("human_B.obj",AnimationBase::debug_path),
-		enlarged_hitbox_("human_combat_hitbox.obj", AnimationBase::debug_path){
+		enlarged_hitbox_("human_combat_hitbox.obj", AnimationBase::debug_path),
+		hitbox_hierarchy_(hitbox_, exact_hitbox_),
+		posed_hitbox_("human_B.obj", AnimationBase::debug_path),
+		n_posed_bodies_(0){
 
 		arm_L_.setRootTransform(&chest_rotation_.getEndTransform());
 		arm_R_.setRootTransform(&chest_rotation_.getEndTransform());
@@ -299,6 +310,8 @@ public:
 
 
 
+		//has to see the verts before offsetVerts moves them into their groups' frames
+		posed_hitbox_.bind(*model, &getPosition());
 		model->offsetVerts();
 		model->setRootTransform(&getPosition());
 		dyn_model_ = model;
@@ -500,10 +513,44 @@ public:
 		return exact_hitbox_;
 	}
 
+	const HitboxHierarchy& getHitboxHierarchy() const {
+		return hitbox_hierarchy_;
+	}
+
+	const SkinnedMeshSurface& getPosedHitbox() const {
+		return posed_hitbox_;
+	}
+
 	const DynamicModel* getDynamicModel() const {
 		return dyn_model_;
 	}
 
+	//puts the hitbox hierarchy in a level's collision world so the broad phase pairs it with anything in
+	//a layer of mask, another humanoid through the whole hierarchy. returns the id to remove it with
+	int addHitboxTo(CollisionWorld& world, uint32_t layer = CollisionWorld::npc_layer, uint32_t mask = CollisionWorld::player_layer | CollisionWorld::camera_layer | CollisionWorld::npc_layer | CollisionWorld::limb_layer) {
+		return world.add(this, hitbox_hierarchy_, layer, mask);
+	}
+
+	void removeHitboxFrom(CollisionWorld& world, int id) {
+		world.remove(id);
+	}
+
+	//puts the posed hitbox in a level's collision world, for hits that have to follow the arms and legs.
+	//it is posed every step from then on, until removePosedHitboxFrom takes it out of every world
+	int addPosedHitboxTo(CollisionWorld& world, uint32_t layer = CollisionWorld::limb_layer, uint32_t mask = CollisionWorld::npc_layer | CollisionWorld::limb_layer) {
+		n_posed_bodies_++;
+		if (n_posed_bodies_ == 1) {
+			//it may have been left in an old pose
+			posed_hitbox_.update();
+		}
+		return world.add(this, posed_hitbox_, layer, mask);
+	}
+
+	void removePosedHitboxFrom(CollisionWorld& world, int id) {
+		world.remove(id);
+		n_posed_bodies_--;
+	}
+
 	void TPose() {
 		setState(Eigen::Vector<float, n_dofs>::Zero());
 	}
@@ -0,0 +1,52 @@
+#include "Impostor3d.hpp"
+
+
+const char* Impostor3d::vertex_code = "\n"
+"#version 330 core\n"
+"layout (location = 0) in vec2 corner;\n"
+
+"uniform mat4 perspective;\n"
+"uniform mat4 camera;\n"
+"uniform vec3 center;\n"
+"uniform vec3 right;\n"
+"uniform float radius;\n"
+"uniform int view;\n"
+"uniform float n_views;\n"
+
+"out vec2 texCoord;\n"
+"out vec3 position;\n"
+
+"void main()\n"
+"{\n"
+//the card lies on the plane through the center that the view was taken facing
+"	position = center + (corner.x * right + corner.y * vec3(0.0, 1.0, 0.0)) * radius;\n"
+"   gl_Position = perspective * camera * vec4(position, 1.0);\n"
+"	texCoord = vec2((corner.x * 0.5 + 0.5 + float(view)) / n_views, corner.y * 0.5 + 0.5);\n"
+"}\0";
+
+const char* Impostor3d::fragment_code = "#version 330 core\n"
+"in vec2 texCoord;\n"
+"in vec3 position;\n"
+
+"uniform sampler2D color_tex;\n"
+"uniform sampler2D depth_tex;\n"
+
+"uniform mat4 perspective;\n"
+"uniform mat4 camera;\n"
+"uniform vec3 view_dir;\n"
+"uniform float radius;\n"
+
+"out vec4 FragColor;\n"
+
+"void main()\n"
+"{\n"
+"	float depth = texture(depth_tex, texCoord).r;\n"
+"	if (depth >= 1.0) {\n"
+"		discard;\n" //nothing was there when baking
+"	}\n"
+//baked depth 0..1 covers one radius in front of the card to one radius behind it
+"	vec3 surface = position - view_dir * (2.0 * radius * depth - radius);\n"
+"	vec4 clip = perspective * camera * vec4(surface, 1.0);\n"
+"	gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;\n"
+"	FragColor = vec4(texture(color_tex, texCoord).xyz, 1.0);\n"
+" } ";
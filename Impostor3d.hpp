@@ -0,0 +1,147 @@
+#pragma once
+
+#ifndef PUPPET_GRAPHICS_IMPOSTOR3D
+#define PUPPET_GRAPHICS_IMPOSTOR3D
+
+#include <Eigen/Dense>
+
+#include "Graphics.hpp"
+#include "GameObject.h"
+#include "Default3d.h"
+#include "impostor.hpp"
+#include "draw_order.hpp"
+
+//draws far away objects as impostor cards and keeps source from drawing their real geometry in the
+//meantime. an impostor is baked through source the first time it is needed, so it matches source's
+//lighting at that moment. objects are assumed not to move, the bounds are taken when they are added.
+//has to draw before source every frame so the swap happens within one frame
+class Impostor3d : public Graphics<GameObject, Impostor*> {
+
+	static constexpr float impostor_screen_size_ = .3f; //same units as LodSelector
+	static constexpr float hysteresis_ = .15f;
+
+	Default3d& source_;
+
+	unsigned int VAO_;
+	unsigned int VBO_;
+	const unsigned int perspective_location_;
+	const unsigned int camera_location_;
+	const unsigned int center_location_;
+	const unsigned int right_location_;
+	const unsigned int view_dir_location_;
+	const unsigned int radius_location_;
+	const unsigned int view_location_;
+
+	mutable Eigen::Matrix4f camera_matrix_;
+	mutable Eigen::Matrix4f perspective_matrix_;
+	mutable Eigen::Vector3f eye_;
+	mutable size_t n_drawn_;
+
+	Cache makeDataCache(const GameObject& obj) const override {
+		float center_depth, radius;
+		DrawOrder<GameObject, Cache>::boundsDepth(Eigen::Matrix4f::Identity(), obj.getPosition(), *obj.getModel(), center_depth, radius);
+		Eigen::Vector3f center = (obj.getPosition() * obj.getModel()->getBoxCenter().homogeneous()).head<3>();
+		return Cache{ new Impostor(center, radius) };
+	}
+
+	void deleteDataCache(Cache cache) const override {
+		delete std::get<0>(cache);
+	}
+
+	void drawCard(const Impostor& impostor) const {
+		int view = impostor.closestView(eye_);
+		Eigen::Vector3f right = Impostor::viewRight(view);
+		Eigen::Vector3f view_dir = Impostor::viewDir(view);
+		glUniform3fv(center_location_, 1, impostor.center.data());
+		glUniform3fv(right_location_, 1, right.data());
+		glUniform3fv(view_dir_location_, 1, view_dir.data());
+		glUniform1f(radius_location_, impostor.radius);
+		glUniform1i(view_location_, view);
+
+		GLState::activeTexture(1);
+		GLState::bindTexture(impostor.depth_tex);
+		GLState::activeTexture(0);
+		GLState::bindTexture(impostor.color_tex);
+		GLState::bindVertexArray(VAO_);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		n_drawn_++;
+	}
+
+public:
+	Impostor3d(Default3d& source) :
+		source_(source),
+		perspective_location_(glGetUniformLocation(gl_id, "perspective")),
+		camera_location_(glGetUniformLocation(gl_id, "camera")),
+		center_location_(glGetUniformLocation(gl_id, "center")),
+		right_location_(glGetUniformLocation(gl_id, "right")),
+		view_dir_location_(glGetUniformLocation(gl_id, "view_dir")),
+		radius_location_(glGetUniformLocation(gl_id, "radius")),
+		view_location_(glGetUniformLocation(gl_id, "view")),
+		camera_matrix_(Eigen::Matrix4f::Identity()),
+		perspective_matrix_(Eigen::Matrix4f::Identity()),
+		eye_(0, 0, 0),
+		n_drawn_(0) {
+		float corners[] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+		glGenVertexArrays(1, &VAO_);
+		glGenBuffers(1, &VBO_);
+		GLState::bindVertexArray(VAO_);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+
+		GLState::useProgram(gl_id);
+		glUniform1i(glGetUniformLocation(gl_id, "color_tex"), 0);
+		glUniform1i(glGetUniformLocation(gl_id, "depth_tex"), 1);
+		glUniform1f(glGetUniformLocation(gl_id, "n_views"), static_cast<float>(Impostor::n_views));
+	}
+
+	~Impostor3d() {
+		GLState::deleteBuffers(1, &VBO_);
+		GLState::deleteVertexArrays(1, &VAO_);
+	}
+
+	void beginDraw() const override {
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::disable(GL_BLEND);
+		GLState::depthMask(true);
+		GLState::polygonMode(GL_FILL);
+
+		const Camera& camera = *(source_.getScene()->camera);
+		perspective_matrix_ = camera.getPerspective();
+		camera_matrix_ = camera.getCameraMatrix();
+		eye_ = -camera_matrix_.block<3, 3>(0, 0).transpose() * camera_matrix_.block<3, 1>(0, 3);
+		glUniformMatrix4fv(perspective_location_, 1, GL_FALSE, perspective_matrix_.data());
+		glUniformMatrix4fv(camera_location_, 1, GL_FALSE, camera_matrix_.data());
+		n_drawn_ = 0;
+	}
+
+	void drawObj(const GameObject& obj, Cache cache) const override {
+		Impostor& impostor = *std::get<0>(cache);
+		float center_depth = -(camera_matrix_ * impostor.center.homogeneous())(2);
+		float screen_size = LodSelector::screenSize(perspective_matrix_, center_depth, impostor.radius);
+		if (!impostor.active && screen_size < impostor_screen_size_ * (1 - hysteresis_)) {
+			if (!impostor.baked) {
+				source_.bakeImpostor(obj, impostor);
+				GLState::useProgram(gl_id); //baking switches to source's program
+			}
+			impostor.active = true;
+		} else if (impostor.active && screen_size > impostor_screen_size_ * (1 + hysteresis_)) {
+			impostor.active = false;
+		}
+		source_.setImpostored(obj, impostor.active);
+
+		if (impostor.active && sphereInFrustum(perspective_matrix_ * camera_matrix_, impostor.center, impostor.radius)) {
+			drawCard(impostor);
+		}
+	}
+
+	//cards drawn in the last drawAll
+	size_t getNDrawn() const {
+		return n_drawn_;
+	}
+};
+
+#endif
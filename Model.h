@@ -4,6 +4,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -77,6 +78,9 @@ protected:
 	bool loaded;
 	bool shade_smooth_;
 
+	std::vector<std::unique_ptr<Model>> lods_; //coarser versions, lods_[0] is one level down from this
+	std::vector<std::vector<float>> baked_light_; //per lod, direct light and ambient occlusion per vertex. empty until baked
+
 private:
 	//deprecated
 	void shadeByVertex() {
@@ -198,6 +202,25 @@ public:
 		calculateBoundingBox();
 	}
 
+	//data already in gl layout (three verts per face, nothing shared), like obj2gl leaves it
+	Model(std::vector<float> verts, std::vector<float> norms, std::vector<float> tex_coords) :
+		vert_data_(verts),
+		norm_data_(norms),
+		tex_coord_data_(tex_coords),
+		n_verts_(verts.size() / 3),
+		n_faces_(verts.size() / 9),
+		fname_(""),
+		loaded(true),
+		shade_smooth_(false) {
+		face_data_ = std::vector<unsigned int>(n_verts_);
+		for (size_t i = 0; i < n_verts_; i++) {
+			face_data_[i] = i;
+		}
+		face_norm_data_ = face_data_;
+		face_tex_data_ = face_data_;
+		calculateBoundingBox();
+	}
+
 	Model(std::string fname, bool force_shade_hard=true) : Model(fname, default_path, force_shade_hard) {
 	}
 
@@ -360,6 +383,32 @@ public:
 		box_center_ << 0, 0, 0;
 	}
 
+	void addLod(std::unique_ptr<Model> lod) {
+		lods_.push_back(std::move(lod));
+	}
+
+	//level 0 is this model
+	const Model& getLod(int level) const {
+		return level == 0 ? *this : *lods_[level - 1];
+	}
+
+	int getNLods() const {
+		return 1 + static_cast<int>(lods_.size());
+	}
+
+	void setBakedLight(int level, std::vector<float> light) {
+		if (baked_light_.size() <= level) {
+			baked_light_.resize(level + 1);
+		}
+		baked_light_[level] = std::move(light);
+	}
+
+	//empty if that lod hasnt been baked
+	const std::vector<float>& getBakedLight(int level) const {
+		static const std::vector<float> none;
+		return level < baked_light_.size() ? baked_light_[level] : none;
+	}
+
 	int getID() const {
 		std::cerr << "no ID available for Model class";
 		return 0;
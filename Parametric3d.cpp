@@ -0,0 +1,122 @@
+#include "Parametric3d.hpp"
+
+
+const char* Parametric3d::vertex_code = "\n"
+"#version 330 core\n"
+"layout (location = 0) in vec3 pos;\n"
+"layout (location = 1) in vec3 norm;\n"
+"layout (location = 2) in vec2 vt;\n"
+"layout (location = 3) in int hinge;\n" //-1 never moves
+
+"uniform mat4 perspective;\n"
+"uniform mat4 camera;\n"
+"uniform mat4 model;\n"
+"uniform float parameters[32];\n" //ParametricModel::max_parameters
+
+"layout (std140) uniform Hinges {\n"
+"	vec4 hinge_axis[32];\n"
+"	vec4 hinge_pivot[32];\n" //w is the parent hinge
+"};\n"
+
+"out vec2 texCoord;\n"
+"out vec3 position;\n"
+"out vec3 normal;\n"
+
+//rodrigues, axis is unit length
+"vec3 rotate(vec3 v, vec3 axis, float angle)\n"
+"{\n"
+"	float c = cos(angle);\n"
+"	return v * c + cross(axis, v) * sin(angle) + axis * dot(axis, v) * (1.0 - c);\n"
+"}\n"
+
+"void main()\n"
+"{\n"
+"	vec3 bent_pos = pos;\n"
+"	vec3 bent_norm = norm;\n"
+//child hinges first, each parent then carries everything below it. parents always have lower indices
+"	for (int h = hinge; h >= 0; h = int(hinge_pivot[h].w)) {\n"
+"		bent_pos = hinge_pivot[h].xyz + rotate(bent_pos - hinge_pivot[h].xyz, hinge_axis[h].xyz, parameters[h]);\n"
+"		bent_norm = rotate(bent_norm, hinge_axis[h].xyz, parameters[h]);\n"
+"	}\n"
+"	position = (model * vec4(bent_pos, 1.0)).xyz;\n"
+"	normal = (model * vec4(bent_norm, 0.0)).xyz;\n"
+"   gl_Position = perspective * camera * vec4(position, 1.0);\n"
+"	texCoord = vt;\n"
+"}\0";
+
+const char* Parametric3d::fragment_code = "#version 330 core\n"
+"in vec2 texCoord;\n "
+"in vec3 position;\n"
+"in vec3 normal;\n"
+
+"uniform sampler2D tex;\n"
+
+"uniform vec4 overlay_color;\n"
+
+"uniform vec4 atmosphere_color;\n" //alpha is atmosphere strength
+"uniform vec4 light_color;\n"
+"uniform vec3 light_position;\n"
+"uniform float light_strength;\n"
+
+"uniform vec4 light_color_1;\n"
+"uniform vec3 light_position_1;\n"
+"uniform float light_strength_1;\n"
+"uniform vec4 light_color_2;\n"
+"uniform vec3 light_position_2;\n"
+"uniform float light_strength_2;\n"
+"uniform vec4 light_color_3;\n"
+"uniform vec3 light_position_3;\n"
+"uniform float light_strength_3;\n"
+"uniform sampler2DShadow shadow_map;\n"
+"uniform mat4 light_space;\n"
+"uniform vec3 shadow_light_direction;\n"
+"uniform float shadow_light_strength;\n"
+
+"out vec4 FragColor;\n"
+
+//fraction of the 3x3 texels around position that the shadow light reaches. each lookup is already
+//a 2x2 compare thanks to linear filtering. the bias grows on surfaces the light grazes
+"float shadowFactor(vec3 world_pos, float n_dot_l)\n"
+"{\n"
+"	vec4 light_pos = light_space * vec4(world_pos, 1.0);\n"
+"	vec3 coord = light_pos.xyz / light_pos.w * 0.5 + 0.5;\n"
+"	if (coord.z > 1.0) return 1.0;\n"
+"	float bias = max(0.002 * (1.0 - n_dot_l), 0.0005);\n"
+"	vec2 texel = 1.0 / vec2(textureSize(shadow_map, 0));\n"
+"	float lit = 0.0;\n"
+"	for (int x = -1; x <= 1; x++) {\n"
+"		for (int y = -1; y <= 1; y++) {\n"
+"			lit += texture(shadow_map, vec3(coord.xy + vec2(x, y) * texel, coord.z - bias));\n"
+"		}\n"
+"	}\n"
+"	return lit / 9.0;\n"
+"}\n"
+
+"void main()\n"
+"{\n"
+"   float a = atmosphere_color.w * (length(position));"
+
+"	float diff = 0; "
+"   vec3 light_dir = (light_position - position);\n"
+"	diff += (max(dot(normal, normalize(light_dir)), 0.0)*light_strength*light_strength)/(light_strength*light_strength+dot(light_dir, light_dir));\n"//strength scaling
+
+"   light_dir = (light_position_1 - position);\n"
+"	diff += (max(dot(normal, normalize(light_dir)), 0.0)*light_strength_1*light_strength_1)/(light_strength_1*light_strength_1+dot(light_dir, light_dir));\n"
+"   light_dir = (light_position_2 - position); \n"
+"	diff += (max(dot(normal, normalize(light_dir)), 0.0)*light_strength_2*light_strength_2)/(light_strength_2*light_strength_2+dot(light_dir, light_dir));\n"
+"   light_dir = (light_position_3 - position); \n"
+"	diff += (max(dot(normal, normalize(light_dir)), 0.0)*light_strength_3*light_strength_3)/(light_strength_3*light_strength_3+dot(light_dir, light_dir));\n"
+
+"	vec4 tex_pixel_data = texture(tex,texCoord);\n"
+"   if(tex_pixel_data.w < .2) discard;\n"
+"	if (shadow_light_strength > 0) {\n"
+"		float n_dot_l = max(dot(normalize(normal), -shadow_light_direction), 0.0);\n"
+"		diff += n_dot_l * shadow_light_strength * shadowFactor(position, n_dot_l);\n"
+"	}\n"
+
+"	vec3 tex_color = (diff + .3) * tex_pixel_data.xyz;\n"
+//apply atmospheric perspective
+"	FragColor.xyz = (tex_color + atmosphere_color.xyz * a)/(1 + a)*(1-overlay_color.w) + overlay_color.xyz*overlay_color.w;\n"
+
+"	FragColor.w = tex_pixel_data.w;\n"
+" } ";
\ No newline at end of file
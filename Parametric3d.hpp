@@ -3,105 +3,59 @@
 #ifndef PUPPET_PARAMETRIC3D
 #define PUPPET_PARAMETRIC3D
 
-#include "graphics_base.hpp"
+#include <Eigen/Dense>
+#include <vector>
+
+#include "Graphics.hpp"
+#include "scene.hpp"
 #include "ParametricObject.hpp"
+#include "parametric_model.hpp"
+#include "shadow_map.hpp"
+
+struct Parametric3dCache {
+	unsigned int VAO;
+	int tex_id;
+	size_t n_elems;
+	unsigned int hinge_ubo; //the model's hinges, uploaded once
+	int n_parameters;
+	Eigen::Vector4f overlay_color;
+
+	Parametric3dCache() : VAO(0), tex_id(-1), n_elems(0), hinge_ubo(0), n_parameters(0), overlay_color(0, 0, 0, 0) {}
+	Parametric3dCache(unsigned int VAO, int tex_id, size_t n_elems, unsigned int hinge_ubo, int n_parameters) :
+		VAO(VAO), tex_id(tex_id), n_elems(n_elems), hinge_ubo(hinge_ubo), n_parameters(n_parameters), overlay_color(0, 0, 0, 0) {}
+};
 
-template<int n_dofs>
-class Parametric3d : public Graphics<ParametricObject<n_dofs>,int,int,size_t,unsigned int, std::vector<float>*, unsigned int, std::vector<float>*> {
+//draws ParametricObjects bent in the vertex shader. the mesh, which hinge every vertex hangs off and
+//the hinges themselves go to the gpu once when an object is added, after that a frame only uploads
+//the object's parameters and its position, no matter how many vertices it has
+class Parametric3d : public Graphics<Parameterized, Parametric3dCache> {
+
+	static constexpr int hinge_binding_ = 0; //uniform buffer binding point
+	static constexpr int max_lights = 3;
 
 	const unsigned int perspective_location_;
 	const unsigned int camera_location_;
 	const unsigned int model_location_;
-
+	const unsigned int parameters_location_;
+	const unsigned int overlay_color_location_;
 
 	Scene* scene_;
+	const ShadowInfo* shadows_;
 
-	constexpr int& getVAO(Cache cache) const {
-		return std::get<0>(cache);
-	}
-
-	constexpr int& getTexID(Cache cache) const {
-		return std::get<1>(cache);
-	}
-	constexpr size_t& getNElems(Cache cache) const {
-		return std::get<2>(cache);
-	}
-
-	constexpr int& getVAO(Cache cache) const {
-		return std::get<0>(cache);
-	}
-
-	constexpr int& getTexID(Cache cache) const {
-		return std::get<1>(cache);
-	}
-	constexpr size_t& getNElems(Cache cache) const {
-		return std::get<2>(cache);
-	}
-
-	constexpr unsigned int& getRotmVBO(Cache cache) const {
-		return std::get<3>(cache);
-	}
-	constexpr std::vector<float>* getRotmMemory(Cache cache) const {
-		return std::get<4>(cache);
-	}
-	constexpr unsigned int& getPosVBO(Cache cache) const {
-		return std::get<5>(cache);
-	}
-	constexpr std::vector<float>* getPosMemory(Cache cache) const {
-		return std::get<6>(cache);
-	}
-
-	virtual Cache makeDataCache(const ParametricObject<n_dofs>& obj) const override {
-		const ParametricModel<n_dofs>* model = obj.getParametricModel();
-		const Texture& tex = *(obj.getTexture());
-
-		unsigned int VAO;
-		glGenVertexArrays(1, &(VAO));
-		unsigned int VBO[5];
-		glGenBuffers(5, VBO);
-
-		glBindVertexArray(VAO);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model->flen() * 9, model->getVerts().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]); //size is wrong here! need to change it depending on how we implement norm EBO
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model->flen() * 9, model->getNorms().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[2]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.getTexCoords().size(), model.getTexCoords().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(2);
-
-		std::vector<float>* vert_rotm = new std::vector<float>(9 * 3 * model.flen());
-		vert_rotm->reserve(9 * model.vlen());
-		for (int i = 0; i < vert_rotm->size(); i++) {
-			(*vert_rotm)[i] = 0.;
-		}
+	mutable std::unordered_map<const Texture*, int> textures_;
 
-		std::vector<float>* vert_pos = new std::vector<float>(3 * 3 * model.flen());
-		vert_pos->reserve(3 * model.vlen());
-		for (int i = 0; i < vert_pos->size(); i++) {
-			(*vert_pos)[i] = 0.;
+	int makeTexture(const Texture& tex) const {
+		if (textures_.contains(&tex)) {
+			return textures_.at(&tex);
 		}
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-
-		//texture code:
-
 		unsigned int tex_id;
 		glGenTextures(1, &(tex_id));
-		glBindTexture(GL_TEXTURE_2D, tex_id);
-		//this->tex_id = static_cast<int>(tex_id);
+		GLState::bindTexture(tex_id);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 		if (tex.n_channels == 3) {
@@ -109,63 +63,150 @@ class Parametric3d : public Graphics<ParametricObject<n_dofs>,int,int,size_t,uns
 		}
 		else if (tex.n_channels == 4) {
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex.width, tex.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex.getData().data());
-
 		}
 		glGenerateMipmap(GL_TEXTURE_2D);
-
-		return Cache{ VAO,tex_id, model.flen(), VBO[3], vert_rotm, VBO[4], vert_pos};
+		textures_[&tex] = static_cast<int>(tex_id);
+		return static_cast<int>(tex_id);
 	}
 
+	Cache makeDataCache(const Parameterized& obj) const override {
+		const ParametricModel& model = *(obj.getParametricModel());
+		const Texture& tex = *(obj.getTexture());
 
-	void drawObj(const GameObject& obj, Cache cache) const override {
-		if (!obj.isHidden()) {
-			glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getPosition().data());
-
-			glBindTexture(GL_TEXTURE_2D, getTexID(cache));
-			glBindVertexArray(getVAO(cache));
+		unsigned int VAO;
+		glGenVertexArrays(1, &VAO);
+		unsigned int VBO[4];
+		glGenBuffers(4, VBO);
+		GLState::bindVertexArray(VAO);
 
-			glBindBuffer(GL_ARRAY_BUFFER, getRotmVBO(cache));
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.flen() * 9, model.getVerts().data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
 
-			obj.getParametricModel()->getRotations(getRotmMemory(cache));
-			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * obj.getParametricModel()->vlen() * 9, getRotmMemory(cache)->data(), GL_DYNAMIC_DRAW);
-			glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(3);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.flen() * 9, model.getNorms().data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(1);
 
-			obj.getParametricModel()->getPositions(getPosMemory(cache));
-			glBindBuffer(GL_ARRAY_BUFFER, getPosVBO(cache));
-			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * obj.getParametricModel()->vlen() * 3, getPosMemory(cache)->data(), GL_DYNAMIC_DRAW);
-			glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(4);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[2]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.flen() * 6, model.getTexCoords().data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(2);
 
-			glDrawArrays(GL_TRIANGLES, 0, 3 * getNElems(cache));
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[3]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(int) * model.getVertHinges().size(), model.getVertHinges().data(), GL_STATIC_DRAW);
+		glVertexAttribIPointer(3, 1, GL_INT, sizeof(int), (void*)0);
+		glEnableVertexAttribArray(3);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+
+		//std140, two vec4 arrays: axis, then pivot with the parent in w
+		std::vector<float> hinge_data(8 * ParametricModel::max_parameters, 0);
+		const std::vector<ParametricModel::Hinge>& hinges = model.getHinges();
+		for (int i = 0; i < hinges.size(); i++) {
+			float* axis = &hinge_data[4 * i];
+			float* pivot = &hinge_data[4 * (ParametricModel::max_parameters + i)];
+			axis[0] = hinges[i].axis(0);
+			axis[1] = hinges[i].axis(1);
+			axis[2] = hinges[i].axis(2);
+			pivot[0] = hinges[i].pivot(0);
+			pivot[1] = hinges[i].pivot(1);
+			pivot[2] = hinges[i].pivot(2);
+			pivot[3] = static_cast<float>(hinges[i].parent);
 		}
-		//for (auto const& o : obj.getChildren()) {
-		//	draw(*o);
-		//}
+		unsigned int hinge_ubo;
+		glGenBuffers(1, &hinge_ubo);
+		GLState::bindBuffer(GL_UNIFORM_BUFFER, hinge_ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(float) * hinge_data.size(), hinge_data.data(), GL_STATIC_DRAW);
+		GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		return Parametric3dCache(VAO, makeTexture(tex), model.flen(), hinge_ubo, model.getNParameters());
+	}
+
+	void deleteDataCache(Cache cache) const override {
+		GLState::deleteBuffers(1, &std::get<0>(cache).hinge_ubo);
+		GLState::deleteVertexArrays(1, &std::get<0>(cache).VAO);
+	}
+
+public:
+	Parametric3d() :
+		perspective_location_(glGetUniformLocation(gl_id, "perspective")),
+		camera_location_(glGetUniformLocation(gl_id, "camera")),
+		model_location_(glGetUniformLocation(gl_id, "model")),
+		parameters_location_(glGetUniformLocation(gl_id, "parameters")),
+		overlay_color_location_(glGetUniformLocation(gl_id, "overlay_color")),
+		scene_(nullptr),
+		shadows_(nullptr) {
+		glUniformBlockBinding(gl_id, glGetUniformBlockIndex(gl_id, "Hinges"), hinge_binding_);
 	}
 
 	void beginDraw() const override {
-		glEnable(GL_DEPTH_TEST);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::disable(GL_BLEND);
+		GLState::depthMask(true);
+		GLState::polygonMode(GL_FILL);
 
 		glUniformMatrix4fv(perspective_location_, 1, GL_FALSE, scene_->camera->getPerspective().data());
 		glUniformMatrix4fv(camera_location_, 1, GL_FALSE, scene_->camera->getCameraMatrix().data());
 
 		glUniform4f(glGetUniformLocation(gl_id, "atmosphere_color"), scene_->atmosphere_color(0), scene_->atmosphere_color(1), scene_->atmosphere_color(2), scene_->atmosphere_strength);
-		if (scene_->lights.size() > 0) {
-			glUniform3fv(glGetUniformLocation(gl_id, "light_position"), 1, scene_->lights[0]->position.data());
-			glUniform3fv(glGetUniformLocation(gl_id, "light_color"), 1, scene_->lights[0]->color.data());
-			glUniform1f(glGetUniformLocation(gl_id, "light_strength"), scene_->lights[0]->brightness);
+		if (scene_->primary_light_ != nullptr) {
+			glUniform3fv(glGetUniformLocation(gl_id, "light_position"), 1, scene_->primary_light_->position.data());
+			glUniform3fv(glGetUniformLocation(gl_id, "light_color"), 1, scene_->primary_light_->color.data());
+			glUniform1f(glGetUniformLocation(gl_id, "light_strength"), scene_->primary_light_->brightness);
+		}
+		else {
+			glUniform1f(glGetUniformLocation(gl_id, "light_strength"), 0);
 		}
+		for (int i = 0; i < max_lights; i++) {
+			if (i < scene_->secondary_lights_.size()) {
+				glUniform3fv(glGetUniformLocation(gl_id, ("light_position_" + std::to_string(i + 1)).c_str()), 1, scene_->secondary_lights_[i]->position.data());
+				glUniform3fv(glGetUniformLocation(gl_id, ("light_color_" + std::to_string(i + 1)).c_str()), 1, scene_->secondary_lights_[i]->color.data());
+				glUniform1f(glGetUniformLocation(gl_id, ("light_strength_" + std::to_string(i + 1)).c_str()), scene_->secondary_lights_[i]->brightness);
+			}
+			else {
+				glUniform1f(glGetUniformLocation(gl_id, ("light_strength_" + std::to_string(i + 1)).c_str()), 0);
+			}
+		}
+		ShadowInfo::setUniforms(gl_id, shadows_);
+	}
 
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	void drawObj(const Parameterized& obj, Cache cache) const override {
+		const Parametric3dCache& param_cache = std::get<0>(cache);
+		glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getPosition().data());
+		glUniform4fv(overlay_color_location_, 1, param_cache.overlay_color.data());
+		//the only per vertex work that changes between frames, n_parameters floats
+		glUniform1fv(parameters_location_, param_cache.n_parameters, obj.getParameters());
+		glBindBufferBase(GL_UNIFORM_BUFFER, hinge_binding_, param_cache.hinge_ubo);
+
+		GLState::bindTexture(param_cache.tex_id);
+		GLState::bindVertexArray(param_cache.VAO);
+		glDrawArrays(GL_TRIANGLES, 0, 3 * param_cache.n_elems);
+	}
 
-		//default3d specific code
+	void setCamera(Camera* camera) {
+		if (scene_ == nullptr) {
+			scene_ = new Scene();
+		}
+		scene_->camera = camera;
 	}
 
+	void setScene(Scene* scene) {
+		scene_ = scene;
+	}
 
+	//null turns shadows off
+	void setShadows(const ShadowInfo* shadows) {
+		shadows_ = shadows;
+		GLState::useProgram(gl_id);
+		glUniform1i(glGetUniformLocation(gl_id, "shadow_map"), ShadowInfo::texture_unit);
+	}
 
+	void setOverlayColor(const Parameterized& obj, Eigen::Vector4f color) {
+		std::get<0>(getCache(obj)).overlay_color = color;
+	}
 };
 
-#endif
\ No newline at end of file
+#endif
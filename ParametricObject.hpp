@@ -6,14 +6,25 @@
 
 #include "GameObject.h"
 #include "dynamic_model.hpp"
+#include "parametric_model.hpp"
 #include "UI.h"
 #include "animation.hpp"
 
 #ifndef PUPPET_PARAMETRICOBJECT
 #define PUPPET_PARAMETRICOBJECT
 
+//what Parametric3d needs from a ParametricObject, whatever its number of dofs
+class Parameterized : public GameObject {
+public:
+	using GameObject::GameObject;
+
+	virtual const ParametricModel* getParametricModel() const = 0;
+	//one per hinge of getParametricModel(), in radians
+	virtual const float* getParameters() const = 0;
+};
+
 template<int n_dofs>
-class ParametricObject : public GameObject {
+class ParametricObject : public Parameterized {
 
 private:
 
@@ -27,6 +38,7 @@ private:
 	Animation<n_dofs>* edit_animation_;
 
 	DynamicModel* dyn_model_;
+	ParametricModel* param_model_; //bent on the gpu, so nothing to update on the cpu
 
 	Eigen::Vector<float, n_dofs> state_;
 
@@ -124,8 +136,6 @@ private:
 
 protected:
 
-	static constexpr int n_dofs = n_dofs;
-
 	const Eigen::Vector<float, n_dofs>& getState() const {
 		return state_;
 	}
@@ -165,8 +175,10 @@ protected:
 public:
 
 	ParametricObject(std::string name, const KeyStateCallback_base& key_state_callback_caller = InternalObject::no_key_state_callback, const ControllerStateCallback_base& controller_state_callback_caller = InternalObject::no_controller_state_callback) :
-		GameObject(name, key_state_callback_caller, controller_state_callback_caller),
+		Parameterized(name, key_state_callback_caller, controller_state_callback_caller),
 		animation_iterator_(.3, .6),
+		dyn_model_(nullptr),
+		param_model_(nullptr),
 		state_(Eigen::Vector<float,n_dofs>::Zero()){
 
 		edit_animation_mode_ = false;
@@ -341,6 +353,25 @@ public:
 		dyn_model_ = dyn_model;
 	}
 
+	//the model's hinges are driven by the first getNParameters() dofs. a model with more hinges than
+	//there are dofs is refused, the renderer uploads one parameter per hinge straight from state_
+	void setParametricModel(ParametricModel* param_model) {
+		if (param_model->getNParameters() > n_dofs) {
+			std::cerr << "parametric model has more hinges than the object has dofs, not using it\n";
+			return;
+		}
+		setModel(param_model);
+		param_model_ = param_model;
+	}
+
+	const ParametricModel* getParametricModel() const override {
+		return param_model_;
+	}
+
+	const float* getParameters() const override {
+		return state_.data();
+	}
+
 	bool inEditMode() {
 		return edit_animation_mode_;
 	}
@@ -0,0 +1,20 @@
+#include "Shadow3d.hpp"
+
+
+const char* Shadow3d::vertex_code = "\n"
+"#version 330 core\n"
+"layout (location = 0) in vec3 pos;\n"
+
+"uniform mat4 light_space;\n"
+"uniform mat4 model;\n"
+
+"void main()\n"
+"{\n"
+"   gl_Position = light_space * model * vec4(pos.x, pos.y, pos.z, 1.0);\n"
+"}\0";
+
+//depth only, nothing to write
+const char* Shadow3d::fragment_code = "#version 330 core\n"
+"void main()\n"
+"{\n"
+" } ";
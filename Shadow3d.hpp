@@ -0,0 +1,293 @@
+#pragma once
+
+#ifndef PUPPET_GRAPHICS_SHADOW3D
+#define PUPPET_GRAPHICS_SHADOW3D
+
+#include <Eigen/Dense>
+#include <vector>
+#include <tuple>
+
+#include "Graphics.hpp"
+#include "GameObject.h"
+#include "Default3d.h"
+#include "dynamic_model.hpp"
+#include "shadow_map.hpp"
+#include "level.h"
+
+struct Shadow3dCache {
+	unsigned int VAO;
+	unsigned int pos_vbo;
+	std::vector<std::tuple<unsigned int, size_t, const Eigen::Matrix4f*>> static_VAOs; //VAO, n_elems, position, same as dynamic3d
+
+	Shadow3dCache() : VAO(0), pos_vbo(0) {}
+	Shadow3dCache(unsigned int VAO, unsigned int pos_vbo, std::vector<std::tuple<unsigned int, size_t, const Eigen::Matrix4f*>> static_VAOs) :
+		VAO(VAO), pos_vbo(pos_vbo), static_VAOs(static_VAOs) {}
+};
+
+//shadow map for the scenes shadow_light. the static batches of statics are rendered into their own
+//depth map only when the light, the current level or which static objects are hidden changes. every
+//frame that map is copied and only the added objects (the dynamic casters) are drawn on top, so the
+//per frame cost goes with the number of casters, not the size of the levels. the map is fit to the
+//current level and its neighbours. draw before the lit renderers, they read getShadowInfo
+class Shadow3d : public Graphics<GameObject, Shadow3dCache> {
+
+	static constexpr int resolution_ = 2048;
+
+	const Default3d& statics_;
+
+	unsigned int static_depth_tex_;
+	unsigned int static_fbo_;
+	unsigned int fbo_; //shadow_.depth_tex, static depth plus casters
+	mutable ShadowInfo shadow_;
+
+	const unsigned int light_space_location_;
+	const unsigned int model_location_;
+
+	//what the cached static map was rendered with
+	mutable Eigen::Vector3f cached_direction_;
+	mutable const Level* cached_level_;
+	mutable std::vector<bool> cached_hidden_;
+	mutable bool static_valid_;
+
+	mutable bool drawing_; //false while the scene has no shadow light
+	mutable int saved_draw_fbo_;
+	mutable int saved_read_fbo_;
+	mutable int saved_viewport_[4];
+	mutable size_t n_static_renders_;
+	mutable size_t n_casters_;
+
+	static void makeDepthTarget(unsigned int& tex, unsigned int& fbo) {
+		glGenTextures(1, &tex);
+		GLState::bindTexture(tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, resolution_, resolution_, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		//linear + compare gives 2x2 pcf per lookup for free
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		float border[] = { 1, 1, 1, 1 }; //outside the map counts as lit
+		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		glGenFramebuffers(1, &fbo);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, tex, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	//orthographic view down the light direction, covering a sphere. the depth range reaches well
+	//behind the sphere towards the light so casters just outside it still land in the map
+	static Eigen::Matrix4f lightSpace(const Eigen::Vector3f& direction, const Eigen::Vector3f& center, float radius) {
+		Eigen::Vector3f back = -direction.normalized();
+		Eigen::Vector3f up = std::abs(back(1)) > .99f ? Eigen::Vector3f::UnitX() : Eigen::Vector3f::UnitY();
+		Eigen::Vector3f right = up.cross(back).normalized();
+		up = back.cross(right);
+
+		Eigen::Matrix3f rotation;
+		rotation.row(0) = right;
+		rotation.row(1) = up;
+		rotation.row(2) = back;
+		Eigen::Matrix4f camera = Eigen::Matrix4f::Identity();
+		camera.block<3, 3>(0, 0) = rotation;
+		camera.block<3, 1>(0, 3) = -rotation * (center + 3 * radius * back);
+
+		float far_clip = 5 * radius;
+		Eigen::Matrix4f projection;
+		projection << 1 / radius, 0, 0, 0,
+			0, 1 / radius, 0, 0,
+			0, 0, -2 / far_clip, -1,
+			0, 0, 0, 1;
+		return projection * camera;
+	}
+
+	std::vector<bool> hiddenStatics() const {
+		std::vector<bool> hidden;
+		for (const auto& batch : statics_.getStaticBatches()) {
+			for (const StaticBatch::Chunk& chunk : batch->getChunks()) {
+				hidden.push_back(chunk.obj->isHidden());
+			}
+		}
+		return hidden;
+	}
+
+	void renderStatic(const Scene::orthogonalLight& light) const {
+		//fit to the levels the player can currently see into, or everything if there is no level
+		const Level* level = Level::getCurrentLevel();
+		Eigen::Vector3f low = Eigen::Vector3f::Constant(INFINITY);
+		Eigen::Vector3f high = Eigen::Vector3f::Constant(-INFINITY);
+		for (const auto& batch : statics_.getStaticBatches()) {
+			for (const StaticBatch::Chunk& chunk : batch->getChunks()) {
+				bool focused = level == nullptr || chunk.obj == level;
+				if (level != nullptr) {
+					for (const Level* neighbor : level->getNeighbors()) {
+						focused = focused || chunk.obj == neighbor;
+					}
+				}
+				if (focused) {
+					low = low.cwiseMin(chunk.center - Eigen::Vector3f::Constant(chunk.radius));
+					high = high.cwiseMax(chunk.center + Eigen::Vector3f::Constant(chunk.radius));
+				}
+			}
+		}
+		if (low(0) > high(0)) {
+			low = Eigen::Vector3f::Constant(-1);
+			high = Eigen::Vector3f::Constant(1);
+		}
+
+		shadow_.light_space = lightSpace(light.direction_, (low + high) / 2, (high - low).norm() / 2);
+		glUniformMatrix4fv(light_space_location_, 1, GL_FALSE, shadow_.light_space.data());
+		glUniformMatrix4fv(model_location_, 1, GL_FALSE, Eigen::Matrix4f::Identity().eval().data());
+
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, static_fbo_);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		for (const auto& batch : statics_.getStaticBatches()) {
+			batch->drawDepth();
+		}
+
+		cached_direction_ = light.direction_;
+		cached_level_ = level;
+		cached_hidden_ = hiddenStatics();
+		static_valid_ = true;
+		n_static_renders_++;
+	}
+
+	Cache makeDataCache(const GameObject& obj) const override {
+		unsigned int VAO;
+		glGenVertexArrays(1, &VAO);
+		unsigned int pos_vbo;
+		glGenBuffers(1, &pos_vbo);
+		GLState::bindVertexArray(VAO);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, pos_vbo);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		//rigid parts never change shape, they only need positions once
+		std::vector<std::tuple<unsigned int, size_t, const Eigen::Matrix4f*>> static_VAOs;
+		const DynamicModel* dyn_model = dynamic_cast<const DynamicModel*>(obj.getModel());
+		if (dyn_model != nullptr) {
+			for (auto& stat_mod : dyn_model->getStaticModels()) {
+				const Model& static_model = *stat_mod.second;
+				unsigned int sVAO;
+				glGenVertexArrays(1, &sVAO);
+				unsigned int sVBO;
+				glGenBuffers(1, &sVBO);
+				GLState::bindVertexArray(sVAO);
+				GLState::bindBuffer(GL_ARRAY_BUFFER, sVBO);
+				glBufferData(GL_ARRAY_BUFFER, sizeof(float) * static_model.flen() * 9, static_model.getVerts().data(), GL_STATIC_DRAW);
+				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+				glEnableVertexAttribArray(0);
+				static_VAOs.push_back({ sVAO, static_model.flen(), stat_mod.first->getTform() });
+			}
+		}
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+		return Shadow3dCache(VAO, pos_vbo, static_VAOs);
+	}
+
+	void deleteDataCache(Cache cache) const override {
+
+	}
+
+public:
+	Shadow3d(const Default3d& statics) :
+		statics_(statics),
+		light_space_location_(glGetUniformLocation(gl_id, "light_space")),
+		model_location_(glGetUniformLocation(gl_id, "model")),
+		cached_direction_(Eigen::Vector3f::Zero()),
+		cached_level_(nullptr),
+		static_valid_(false),
+		drawing_(false),
+		saved_draw_fbo_(0),
+		saved_read_fbo_(0),
+		saved_viewport_{ 0, 0, 0, 0 },
+		n_static_renders_(0),
+		n_casters_(0) {
+		makeDepthTarget(static_depth_tex_, static_fbo_);
+		makeDepthTarget(shadow_.depth_tex, fbo_);
+	}
+
+	void beginDraw() const override {
+		const Scene* scene = statics_.getScene();
+		drawing_ = scene != nullptr && scene->shadow_light != nullptr;
+		if (!drawing_) {
+			shadow_.valid = false;
+			return;
+		}
+		const Scene::orthogonalLight& light = *(scene->shadow_light);
+
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &saved_draw_fbo_);
+		glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &saved_read_fbo_);
+		glGetIntegerv(GL_VIEWPORT, saved_viewport_);
+		glViewport(0, 0, resolution_, resolution_);
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::disable(GL_BLEND);
+		GLState::depthMask(true);
+		GLState::polygonMode(GL_FILL);
+		GLState::enable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.f, 4.f);
+
+		if (!static_valid_ || light.direction_ != cached_direction_ || Level::getCurrentLevel() != cached_level_ || hiddenStatics() != cached_hidden_) {
+			renderStatic(light);
+		}
+		shadow_.direction = light.direction_.normalized();
+		shadow_.strength = light.brightness;
+
+		//start from the cached static depth, casters go on top
+		GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, static_fbo_);
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo_);
+		glBlitFramebuffer(0, 0, resolution_, resolution_, 0, 0, resolution_, resolution_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, fbo_);
+		glUniformMatrix4fv(light_space_location_, 1, GL_FALSE, shadow_.light_space.data());
+		n_casters_ = 0;
+	}
+
+	void drawObj(const GameObject& obj, Cache cache) const override {
+		if (!drawing_) {
+			return;
+		}
+		const Shadow3dCache& caster = std::get<0>(cache);
+		const Model& model = *(obj.getModel());
+		glUniformMatrix4fv(model_location_, 1, GL_FALSE, obj.getPosition().data());
+		GLState::bindVertexArray(caster.VAO);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, caster.pos_vbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.vlen() * 3, model.getVerts().data(), GL_STREAM_DRAW);
+		glDrawArrays(GL_TRIANGLES, 0, 3 * model.flen());
+
+		for (const auto& static_VAO : caster.static_VAOs) {
+			GLState::bindVertexArray(std::get<0>(static_VAO));
+			glUniformMatrix4fv(model_location_, 1, GL_FALSE, std::get<2>(static_VAO)->data());
+			glDrawArrays(GL_TRIANGLES, 0, 3 * std::get<1>(static_VAO));
+		}
+		n_casters_++;
+	}
+
+	void endDraw() const override {
+		if (!drawing_) {
+			return;
+		}
+		GLState::disable(GL_POLYGON_OFFSET_FILL);
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<unsigned int>(saved_draw_fbo_));
+		GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<unsigned int>(saved_read_fbo_));
+		glViewport(saved_viewport_[0], saved_viewport_[1], saved_viewport_[2], saved_viewport_[3]);
+		shadow_.valid = true;
+	}
+
+	const ShadowInfo* getShadowInfo() const {
+		return &shadow_;
+	}
+
+	//how many times the static map has been rendered, should only go up on light or level changes
+	size_t getNStaticRenders() const {
+		return n_static_renders_;
+	}
+
+	size_t getNCasters() const {
+		return n_casters_;
+	}
+};
+
+#endif
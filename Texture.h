@@ -54,6 +54,19 @@ public:
 		return image_data;
 	}
 
+	//true if any texel is not fully opaque, used to decide which render pass something goes in
+	bool hasTransparency() const {
+		if (n_channels != 4) {
+			return false;
+		}
+		for (size_t i = 3; i < image_data.size(); i += 4) {
+			if (image_data[i] < 255) {
+				return true;
+			}
+		}
+		return false;
+	}
+
 };
 
 #endif
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "textbox_object.hpp"
 #include "solid_tex.hpp"
 #include "math_constants.hpp"
+#include "ui_binding.hpp"
 
 class Rect2d : public Model {
 private:
@@ -196,6 +197,7 @@ class Slider : public GameObject {
 	bool mouse_drag_mode_;
 
 	TextboxObject current_value_;
+	TextBinding<float> value_text_; //current_value_'s text, only re-formatted when the shown digits change
 	TextboxObject lower_limit_value_;
 	TextboxObject upper_limit_value_;
 
@@ -209,6 +211,10 @@ class Slider : public GameObject {
 	GraphicsRaw<GameObject>* graphics_2d_;
 	GraphicsRaw<Textbox>* text_graphics_;
 
+	static std::string formatValue(float value) {
+		return std::format("{:.3f}", value);
+	}
+
 	static void incrementCallback(void* must_be_this) {
 		Slider* this_ = static_cast<Slider*>(must_be_this);
 		float new_val = this_->current_position_ + this_->increment_fraction_ * (this_->upper_limit_ - this_->lower_limit_);
@@ -264,7 +270,8 @@ public:
 		current_val_offset_(0, 2*height_,0),
 		lower_lim_offset_(0, 2*height_, 0),
 		upper_lim_offset_(0, 2*height_, 0),
-		slider_connector_(Eigen::Vector3f(1.,0.,0.)){
+		slider_connector_(Eigen::Vector3f(1.,0.,0.)),
+		value_text_(.001f){
 		
 		setTexture(&Rect2d::rect_tex);
 		setModel(&slider_model_);
@@ -311,7 +318,8 @@ public:
 		//graphics_2d.add(decrement_);
 		//graphics_2d.add(slider_);
 		
-		current_value_.text = std::to_string(current_position_);
+		value_text_.update(current_position_, formatValue);
+		current_value_.text = value_text_.getText();
 		lower_limit_value_.text = std::to_string(lower_limit_);
 		upper_limit_value_.text = std::to_string(upper_limit_);
 
@@ -350,9 +358,16 @@ public:
 		text_graphics.unload(upper_limit_value_);
 	}
 	
+	//cheap to call every frame with the same value, nothing happens unless it changed
 	void setCurrentValue(float new_val) {
+		if (new_val == current_position_) {
+			return;
+		}
 		if (new_val <= upper_limit_ && new_val >= lower_limit_) {
 			current_position_ = new_val;
+			if (value_text_.update(current_position_, formatValue)) {
+				current_value_.text = value_text_.getText();
+			}
 			if (slider_change_callback_ != nullptr) {
 				slider_change_callback_(new_val, callback_input_);
 			}
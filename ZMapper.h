@@ -90,23 +90,23 @@ private:
 		unsigned int EBO;
 		glGenBuffers(1, &EBO);
 
-		glBindVertexArray(VAO);
+		GLState::bindVertexArray(VAO);
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[0]);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.vlen() * 3, model.getVerts().data(), GL_STATIC_DRAW);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(0);
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]); //size is wrong here! need to change it depending on how we implement norm EBO
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO[1]); //size is wrong here! need to change it depending on how we implement norm EBO
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.getNorms().size(), model.getNorms().data(), GL_STATIC_DRAW);
 		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 		glEnableVertexAttribArray(1);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);//have to change this to face length not vertex len
+		GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);//have to change this to face length not vertex len
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * model.flen() * 3, model.getFaces().data(), GL_STATIC_DRAW);
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
 
 		//return std::tuple<int, size_t, float, float>{VAO, model.flen(), model.getBoundingBox()[0], model.getBoundingBox()[2]};
 		return Cache{VAO, model.flen(), last_room_id_++,};
@@ -122,7 +122,7 @@ private:
 	}
 
 	void drawObj(const GameObject& obj, Cache cache) const override {
-		glBindVertexArray(getVAO(cache));
+		GLState::bindVertexArray(getVAO(cache));
 		glUniform1f(room_id_location_, static_cast<float>(getRoomID(cache))/256.);
 		glUniformMatrix4fv(position_location_, 1, GL_FALSE,obj.getPosition().data());
 		//glUniformMatrix4fv(position_location_, 1, GL_FALSE, Matrix4f( Matrix4f::Identity()).data());
@@ -138,8 +138,8 @@ private:
 
 	void beginDraw() const override {
 
-		glEnable(GL_DEPTH_TEST);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		GLState::enable(GL_DEPTH_TEST);
+		GLState::polygonMode(GL_FILL);
 
 		//glEnable(GL_CULL_FACE);
 		//glCullFace(GL_BACK);
@@ -155,7 +155,7 @@ private:
 	void endDraw() const override {
 		//default3d specific code
 
-		glDisable(GL_CULL_FACE);
+		GLState::disable(GL_CULL_FACE);
 		//glCullFace(GL_BACK);
 
 	}
@@ -0,0 +1,86 @@
+#include <cmath>
+
+#include "bench.hpp"
+#include "math_constants.hpp"
+
+static const Bench benches[] = {
+	{ "ui_batching", benchUiBatching, "default2d draw calls and cpu time, atlas against a texture per quad" },
+	{ "draw_sorting", benchDrawSorting, "default3d fragments shaded per pixel and frame time, sorted against unsorted opaques" },
+	{ "lod", benchLod, "lod chains of the level models, simplifier time and triangles drawn by distance" },
+	{ "triangle_simd", benchTriangleSimd, "segment against faces, packed TriangleSoA test against the old per face loop" },
+	{ "mesh_bvh", benchMeshBvh, "segment queries on tessellated spheres, bvh against the linear pack scan" },
+	{ "broad_phase", benchBroadPhase, "sweep and prune over a moving crowd of boxes against testing every pair" },
+	{ "hitbox_crowd", benchHitboxCrowd, "humanoid pairs through the hitbox hierarchy against the exact meshes both ways" },
+	{ "pair_threads", benchPairThreads, "500 hand made pairs in a level's collision world over 1 to every thread, against the serial loop" },
+	{ "skinned_refit", benchSkinnedRefit, "a posed mesh refitting its bvh against building it again, and segment queries on each" },
+	{ "probe", benchProbe, "100k rays a frame through CollisionProbe against a level mesh, one by one, batched and threaded" },
+};
+
+void benchSphere(int rings, std::vector<Eigen::Vector3f>* verts, std::vector<std::tuple<int, int, int>>* faces) {
+	verts->clear();
+	faces->clear();
+	int segments = 2 * rings;
+	//poles first, then each ring between them
+	verts->emplace_back(0, 0, 1);
+	verts->emplace_back(0, 0, -1);
+	for (int ring = 1; ring < rings; ring++) {
+		float theta = M_PI * ring / rings;
+		for (int seg = 0; seg < segments; seg++) {
+			float phi = 2 * M_PI * seg / segments;
+			verts->emplace_back(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+		}
+	}
+	auto at = [segments](int ring, int seg) { return 2 + (ring - 1) * segments + seg % segments; };
+	for (int seg = 0; seg < segments; seg++) {
+		faces->emplace_back(0, at(1, seg), at(1, seg + 1));
+		faces->emplace_back(1, at(rings - 1, seg + 1), at(rings - 1, seg));
+		for (int ring = 1; ring < rings - 1; ring++) {
+			faces->emplace_back(at(ring, seg), at(ring + 1, seg), at(ring + 1, seg + 1));
+			faces->emplace_back(at(ring, seg), at(ring + 1, seg + 1), at(ring, seg + 1));
+		}
+	}
+}
+
+static void listBenchmarks() {
+	std::cout << "benchmarks:" << std::endl;
+	for (const Bench& bench : benches) {
+		std::cout << "  " << bench.name << "  " << bench.about << std::endl;
+	}
+}
+
+bool runBenchmarks(int argc, char** argv, GLFWwindow* window) {
+	std::vector<std::string> names;
+	bool asked = false;
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--bench") {
+			asked = true;
+			//names up to the next flag
+			for (; i + 1 < argc && argv[i + 1][0] != '-'; i++) {
+				names.push_back(argv[i + 1]);
+			}
+		}
+	}
+	if (!asked) {
+		return false;
+	}
+	if (names.empty()) {
+		listBenchmarks();
+		return true;
+	}
+	for (const std::string& name : names) {
+		bool found = false;
+		for (const Bench& bench : benches) {
+			if (name == "all" || name == bench.name) {
+				std::cout << "== " << bench.name << " ==" << std::endl;
+				bench.run(window);
+				std::cout << std::endl;
+				found = true;
+			}
+		}
+		if (!found) {
+			std::cout << "no benchmark called " << name << std::endl;
+			listBenchmarks();
+		}
+	}
+	return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef PUPPET_BENCH
+#define PUPPET_BENCH
+
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <Eigen/Dense>
+#include <GLFW/glfw3.h>
+
+//the benchmarks behind the numbers in the commit log. run them with
+//	Puppet2 --bench <name> [<name> ...]
+//or --bench all. they run once gl is up, before any level is loaded, print a table each to stdout
+//and then the program exits. anything they load comes from the working directory like the game's assets
+
+typedef void (*BenchFunction)(GLFWwindow* window);
+
+struct Bench {
+	const char* name;
+	BenchFunction run;
+	const char* about;
+};
+
+//runs the benchmarks argv asks for, false if it didnt ask for any
+bool runBenchmarks(int argc, char** argv, GLFWwindow* window);
+
+//best of n_runs of f, in ms. best rather than mean since anything else running only ever adds time
+template<typename F>
+double benchMs(F f, int n_runs = 5) {
+	double best = -1;
+	for (int i = 0; i < n_runs; i++) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (best < 0 || ms < best) {
+			best = ms;
+		}
+	}
+	return best;
+}
+
+//results of timed work go through here so the optimizer cant drop the work
+inline volatile int bench_sink = 0;
+
+inline void benchKeep(int result) {
+	bench_sink = result;
+}
+
+//one row of a table, columns padded to width
+inline void benchRow(const std::vector<std::string>& columns, int width = 14) {
+	for (const std::string& column : columns) {
+		std::cout << std::setw(width) << column;
+	}
+	std::cout << std::endl;
+}
+
+inline std::string benchNum(double x, int precision = 3) {
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(precision) << x;
+	return out.str();
+}
+
+//a unit sphere in rings bands of latitude and 2*rings of longitude, 4*rings*(rings-1) faces facing out
+void benchSphere(int rings, std::vector<Eigen::Vector3f>* verts, std::vector<std::tuple<int, int, int>>* faces);
+
+void benchUiBatching(GLFWwindow* window);
+void benchDrawSorting(GLFWwindow* window);
+void benchLod(GLFWwindow* window);
+void benchTriangleSimd(GLFWwindow* window);
+void benchMeshBvh(GLFWwindow* window);
+void benchBroadPhase(GLFWwindow* window);
+void benchHitboxCrowd(GLFWwindow* window);
+void benchPairThreads(GLFWwindow* window);
+void benchSkinnedRefit(GLFWwindow* window);
+void benchProbe(GLFWwindow* window);
+
+#endif
@@ -0,0 +1,143 @@
+#include <random>
+
+#include "bench.hpp"
+#include "collision_world.hpp"
+
+//boxes a bit bigger than a person wandering around a room, each frame they move a step and the
+//broad phase is asked for the pairs
+struct Crowd {
+	std::vector<Eigen::Vector3f> centers;
+	std::vector<Eigen::Vector3f> velocities;
+	std::vector<Eigen::Vector3f> halves;
+	float room;
+
+	Crowd(size_t n, float room, std::mt19937& rng) : room(room) {
+		std::uniform_real_distribution<float> unit(0, 1);
+		for (size_t i = 0; i < n; i++) {
+			centers.emplace_back(room * unit(rng), 2 * unit(rng), room * unit(rng));
+			velocities.emplace_back(unit(rng) - .5f, 0, unit(rng) - .5f);
+			halves.emplace_back(.3f + .2f * unit(rng), .9f, .3f + .2f * unit(rng));
+		}
+	}
+
+	//walks everyone one frame at 60 fps, bouncing off the walls
+	void step() {
+		for (size_t i = 0; i < centers.size(); i++) {
+			centers[i] += velocities[i] * (4.f / 60);
+			for (int axis : { 0, 2 }) {
+				if (centers[i](axis) < 0 || centers[i](axis) > room) {
+					velocities[i](axis) = -velocities[i](axis);
+				}
+			}
+		}
+	}
+
+	Eigen::AlignedBox3f box(size_t i) const {
+		return Eigen::AlignedBox3f(centers[i] - halves[i], centers[i] + halves[i]);
+	}
+};
+
+//every pair against every other, what the broad phase replaces
+static void bruteForce(const Crowd& crowd, std::vector<std::pair<int, int>>* pairs) {
+	pairs->clear();
+	for (int i = 0; i < crowd.centers.size(); i++) {
+		Eigen::AlignedBox3f a = crowd.box(i);
+		for (int j = i + 1; j < crowd.centers.size(); j++) {
+			if (a.intersects(crowd.box(j))) {
+				pairs->emplace_back(i, j);
+			}
+		}
+	}
+}
+
+//n boxes over frames frames. the room grows with n so about as many people stand near each other
+static void crowdRow(size_t n, int frames) {
+	std::mt19937 rng(5);
+	float room = 2 * std::sqrt(static_cast<float>(n));
+	Crowd crowd(n, room, rng);
+	SweepAndPrune broad_phase;
+	for (size_t i = 0; i < n; i++) {
+		broad_phase.add(crowd.box(i), CollisionWorld::npc_layer, CollisionWorld::npc_layer);
+	}
+	std::vector<std::pair<int, int>> pairs;
+	broad_phase.findPairs(&pairs); //first sort from insertion order
+
+	size_t swaps = 0, axis_overlaps = 0, candidates = 0;
+	double sap_ms = benchMs([&]() {
+		swaps = axis_overlaps = candidates = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			crowd.step();
+			for (size_t i = 0; i < n; i++) {
+				broad_phase.setBox(static_cast<int>(i), crowd.box(i));
+			}
+			broad_phase.findPairs(&pairs);
+			swaps += broad_phase.getStats().n_swaps;
+			axis_overlaps += broad_phase.getStats().n_axis_overlaps;
+			candidates += broad_phase.getStats().n_candidates;
+		}
+	}, 3) / frames;
+
+	std::vector<std::pair<int, int>> brute_pairs;
+	double brute_ms = benchMs([&]() {
+		for (int frame = 0; frame < frames; frame++) {
+			crowd.step();
+			bruteForce(crowd, &brute_pairs);
+			benchKeep(static_cast<int>(brute_pairs.size()));
+		}
+	}, 3) / frames;
+
+	//both on the same frame
+	for (size_t i = 0; i < n; i++) {
+		broad_phase.setBox(static_cast<int>(i), crowd.box(i));
+	}
+	broad_phase.findPairs(&pairs);
+	std::sort(pairs.begin(), pairs.end());
+	size_t mismatches = pairs.size() != brute_pairs.size() ? std::max(pairs.size(), brute_pairs.size()) : 0;
+	for (size_t i = 0; mismatches == 0 && i < pairs.size(); i++) {
+		mismatches += pairs[i] != brute_pairs[i];
+	}
+
+	int runs = 3 * frames;
+	benchRow({ std::to_string(n), benchNum(sap_ms), benchNum(brute_ms), std::to_string(swaps / runs), std::to_string(axis_overlaps / runs), std::to_string(candidates / runs), std::to_string(mismatches) });
+}
+
+//half the crowd is npcs that dont collide with each other, only with the players. the sweep still
+//meets the npc pairs, the filter throws them out before the box test
+static void filteredRow(size_t n, int frames) {
+	std::mt19937 rng(5);
+	Crowd crowd(n, 2 * std::sqrt(static_cast<float>(n)), rng);
+	SweepAndPrune broad_phase;
+	for (size_t i = 0; i < n; i++) {
+		if (i % 2 == 0) {
+			broad_phase.add(crowd.box(i), CollisionWorld::player_layer, CollisionWorld::player_layer | CollisionWorld::npc_layer);
+		} else {
+			broad_phase.add(crowd.box(i), CollisionWorld::npc_layer, CollisionWorld::player_layer);
+		}
+	}
+	std::vector<std::pair<int, int>> pairs;
+	broad_phase.findPairs(&pairs);
+
+	size_t candidates = 0;
+	double sap_ms = benchMs([&]() {
+		candidates = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			crowd.step();
+			for (size_t i = 0; i < n; i++) {
+				broad_phase.setBox(static_cast<int>(i), crowd.box(i));
+			}
+			broad_phase.findPairs(&pairs);
+			candidates += broad_phase.getStats().n_candidates;
+		}
+	}, 3) / frames;
+	benchRow({ std::to_string(n), benchNum(sap_ms), std::to_string(candidates / (3 * frames)) });
+}
+
+void benchBroadPhase(GLFWwindow* window) {
+	benchRow({ "boxes", "sap ms", "brute ms", "swaps", "axis overlaps", "candidates", "mismatches" });
+	for (size_t n : { 100, 1000, 4000 }) {
+		crowdRow(n, 60);
+	}
+	std::cout << std::endl << "half players half npcs, npcs ignore each other" << std::endl;
+	benchRow({ "boxes", "sap ms", "candidates" });
+	filteredRow(1000, 60);
+}
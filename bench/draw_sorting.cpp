@@ -0,0 +1,69 @@
+#include <memory>
+#include <random>
+
+#include "bench.hpp"
+#include "Default3d.h"
+#include "camera.h"
+#include "solid_tex.hpp"
+
+//n_layers opaque screen covering quads, drawn in a shuffled order so the unsorted pass isnt sorted
+//by accident. prints fragments shaded per pixel and the frame time with and without sorting
+static void drawLayers(GLFWwindow* window, Camera& camera, Model& quad, Texture& tex, size_t n_layers) {
+	std::vector<size_t> depths(n_layers);
+	for (size_t i = 0; i < n_layers; i++) {
+		depths[i] = i;
+	}
+	std::shuffle(depths.begin(), depths.end(), std::mt19937(7));
+
+	std::vector<std::unique_ptr<GameObject>> objects;
+	Default3d default3d;
+	default3d.setCamera(&camera);
+	default3d.setAtmosphere(Eigen::Vector3f(.7f, .7f, .7f), .2f);
+	for (size_t i = 0; i < n_layers; i++) {
+		//a quad from -1 to 1 covers the whole 90 degree view at a depth of 1, so scale it by its depth
+		float depth = 1.f + .5f * depths[i];
+		Eigen::Matrix4f position = Eigen::Matrix4f::Identity();
+		position.diagonal().head<2>() *= depth;
+		position(2, 3) = -depth;
+		objects.emplace_back(new GameObject());
+		objects.back()->setModel(&quad);
+		objects.back()->setTexture(&tex);
+		objects.back()->setPosition(position);
+		default3d.add(*objects.back());
+	}
+	default3d.setMeasureOverdraw(true);
+
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	for (bool sort : { false, true }) {
+		default3d.setSortDraws(sort);
+		auto frame = [&]() {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			default3d.drawAll();
+			glFinish();
+			glfwSwapBuffers(window);
+		};
+		//the counter reads a frame behind
+		frame();
+		frame();
+		double frame_ms = benchMs(frame, 20);
+		double per_pixel = static_cast<double>(default3d.getStats().samples_passed) / (static_cast<double>(width) * height);
+		benchRow({ std::to_string(n_layers), sort ? "front to back" : "unsorted", benchNum(per_pixel, 2), benchNum(frame_ms) });
+	}
+	for (auto& object : objects) {
+		default3d.unload(*object);
+	}
+}
+
+void benchDrawSorting(GLFWwindow* window) {
+	Camera camera(.1f, 1000.f, 90.f);
+	Model quad(
+		{ -1, -1, 0, 1, -1, 0, -1, 1, 0, -1, 1, 0, 1, -1, 0, 1, 1, 0 },
+		{ 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1 },
+		{ 0, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 1 });
+	SolidTexture tex(120, 100, 80, 255);
+	benchRow({ "layers", "order", "frags/pixel", "frame ms" });
+	for (size_t n_layers : { 1, 4, 16, 64 }) {
+		drawLayers(window, camera, quad, tex, n_layers);
+	}
+}
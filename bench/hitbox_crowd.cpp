@@ -0,0 +1,136 @@
+#include <random>
+
+#include "bench.hpp"
+#include "collision.hpp"
+
+//people on a jittered grid spacing apart, each turned some way, walking a little every frame
+struct HitboxCrowd {
+	std::vector<Eigen::Matrix4f> positions;
+	std::vector<Eigen::Matrix4f> motions; //dG of each, the same every frame
+	std::vector<std::pair<int, int>> pairs; //what a broad phase would hand over on the first frame
+
+	HitboxCrowd(int side, float spacing, const MeshSurface& exact, std::mt19937& rng) {
+		std::uniform_real_distribution<float> jitter(-.25f, .25f);
+		std::uniform_real_distribution<float> unit(0, 1);
+		for (int i = 0; i < side; i++) {
+			for (int j = 0; j < side; j++) {
+				Eigen::Matrix4f position = Eigen::Matrix4f::Identity();
+				position.block<3, 3>(0, 0) = Eigen::AngleAxisf(6.2832f * unit(rng), Eigen::Vector3f::UnitY()).toRotationMatrix();
+				position.block<3, 1>(0, 3) = spacing * Eigen::Vector3f(i + jitter(rng), 0, j + jitter(rng));
+				positions.push_back(position);
+				Eigen::Matrix4f motion = Eigen::Matrix4f::Identity();
+				motion.block<3, 1>(0, 3) = Eigen::Vector3f(unit(rng) - .5f, 0, unit(rng) - .5f) * (2.f / 60);
+				motions.push_back(motion);
+			}
+		}
+		std::vector<Eigen::AlignedBox3f> boxes;
+		for (const Eigen::Matrix4f& position : positions) {
+			Eigen::AlignedBox3f box;
+			for (const Eigen::Vector3f& v : exact.getVerts()) {
+				box.extend(position.block<3, 3>(0, 0) * v + position.block<3, 1>(0, 3));
+			}
+			boxes.push_back(box);
+		}
+		for (int a = 0; a < boxes.size(); a++) {
+			for (int b = a + 1; b < boxes.size(); b++) {
+				if (boxes[a].intersects(boxes[b])) {
+					pairs.emplace_back(a, b);
+				}
+			}
+		}
+	}
+
+	void step() {
+		for (size_t i = 0; i < positions.size(); i++) {
+			positions[i] = positions[i] * motions[i];
+		}
+	}
+};
+
+//the exact mesh's box grown a little, a coarse mesh that is sure to hold it
+static void boxAround(const MeshSurface& exact, MeshSurface* box_mesh) {
+	Eigen::AlignedBox3f box;
+	for (const Eigen::Vector3f& v : exact.getVerts()) {
+		box.extend(v);
+	}
+	box.min() -= Eigen::Vector3f::Constant(.02f);
+	box.max() += Eigen::Vector3f::Constant(.02f);
+	for (int corner = 0; corner < 8; corner++) {
+		box_mesh->addVert(box.corner(static_cast<Eigen::AlignedBox3f::CornerType>(corner)));
+	}
+	const int faces[12][3] = { { 0, 1, 3 }, { 0, 3, 2 }, { 4, 6, 7 }, { 4, 7, 5 }, { 0, 4, 5 }, { 0, 5, 1 }, { 2, 3, 7 }, { 2, 7, 6 }, { 0, 2, 6 }, { 0, 6, 4 }, { 1, 5, 7 }, { 1, 7, 3 } };
+	for (const auto& face : faces) {
+		box_mesh->addFace(face[0], face[1], face[2]);
+		box_mesh->addEdge(face[0], face[1]);
+		box_mesh->addEdge(face[1], face[2]);
+		box_mesh->addEdge(face[2], face[0]);
+	}
+	box_mesh->buildBVH();
+}
+
+//the crowd's box pairs through the hierarchy and through the exact meshes both ways round, over frames
+static void crowdRow(const MeshSurface& coarse, const MeshSurface& exact, int side, float spacing, int frames) {
+	HitboxHierarchy hierarchy(coarse, exact);
+	std::mt19937 rng(7);
+	HitboxCrowd crowd(side, spacing, exact, rng);
+
+	int hierarchy_hits = 0;
+	double hierarchy_ms = benchMs([&]() {
+		hierarchy.resetStats();
+		hierarchy_hits = 0;
+		HitboxCrowd walking = crowd;
+		for (int frame = 0; frame < frames; frame++) {
+			walking.step();
+			for (auto [a, b] : walking.pairs) {
+				hierarchy_hits += CollisionPair<HitboxHierarchy, HitboxHierarchy>::checkCollision(hierarchy, hierarchy, walking.positions[a], walking.positions[b], walking.motions[b]);
+			}
+		}
+	}, 3) / frames;
+	HitboxHierarchy::Stats stats = hierarchy.getStats();
+
+	int exact_hits = 0;
+	double exact_ms = benchMs([&]() {
+		exact_hits = 0;
+		HitboxCrowd walking = crowd;
+		for (int frame = 0; frame < frames; frame++) {
+			walking.step();
+			for (auto [a, b] : walking.pairs) {
+				exact_hits += CollisionPair<MeshSurface, MeshSurface>::checkCollision(exact, exact, walking.positions[a], walking.positions[b], walking.motions[b]) ||
+					CollisionPair<MeshSurface, MeshSurface>::checkCollision(exact, exact, walking.positions[b], walking.positions[a]);
+			}
+		}
+	}, 3) / frames;
+
+	//the info of every pair against the exact meshes', where they start
+	int info_mismatches = 0;
+	for (auto [a, b] : crowd.pairs) {
+		const Eigen::Matrix4f& position_a = crowd.positions[a];
+		const Eigen::Matrix4f& position_b = crowd.positions[b];
+		CollisionInfo<HitboxHierarchy, HitboxHierarchy> info;
+		getFullCollision<HitboxHierarchy, HitboxHierarchy>(hierarchy, hierarchy, position_a, position_b, Eigen::Matrix4f::Identity(), &info);
+		CollisionInfo<MeshSurface, MeshSurface> exact_info;
+		getFullCollision<MeshSurface, MeshSurface>(exact, exact, position_a, position_b, Eigen::Matrix4f::Identity(), &exact_info);
+		bool exact_colliding = exact_info.is_colliding || CollisionPair<MeshSurface, MeshSurface>::checkCollision(exact, exact, position_b, position_a);
+		info_mismatches += info.is_colliding != exact_colliding || (info.exact_tested && info.getEdgeInfo().size() != exact_info.getEdgeInfo().size());
+	}
+
+	size_t runs = static_cast<size_t>(frames); //the stats are of the last run
+	benchRow({ std::to_string(side * side), benchNum(spacing, 1), std::to_string(crowd.pairs.size()), std::to_string(stats.n_sphere_rejects / runs), std::to_string(stats.n_ellipsoid_rejects / runs),
+		std::to_string(stats.n_coarse_rejects / runs), std::to_string(stats.n_exact_tests / runs), benchNum(hierarchy_ms), benchNum(exact_ms), std::to_string(hierarchy_hits - exact_hits), std::to_string(info_mismatches) });
+}
+
+void benchHitboxCrowd(GLFWwindow* window) {
+	MeshSurface static_hitbox("human_static_hitbox.obj");
+	MeshSurface exact("human.obj");
+	MeshSurface box_mesh;
+	boxAround(exact, &box_mesh);
+	for (const auto& [name, coarse] : { std::make_pair("static hitbox", &static_hitbox), std::make_pair("box", &box_mesh) }) {
+		HitboxHierarchy hierarchy(*coarse, exact);
+		std::cout << name << " as the coarse mesh, " << (hierarchy.usesCoarse() ? "used" : "skipped, it doesnt hold the exact one") << std::endl;
+		benchRow({ "people", "spacing", "box pairs", "sphere rej", "ellipsoid rej", "coarse rej", "exact tests", "hierarchy ms", "exact ms", "hit diff", "info diff" });
+		for (float spacing : { 1.f, .6f, .4f }) {
+			crowdRow(*coarse, exact, 20, spacing, 10);
+		}
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,61 @@
+#include <memory>
+
+#include "bench.hpp"
+#include "Default3d.h"
+#include "camera.h"
+#include "mesh_utils.hpp"
+
+//the level models main loads
+static const char* level_models[] = {
+	"spiral_staircase_cult_exit.obj", "cult_exit_landing.obj", "cult_exit_hallway.obj", "cult_ascencion_stairs.obj",
+	"cult_impluvium.obj", "cult_ritual_room.obj", "path_to_town.obj"
+};
+
+//triangles drawn against triangles at full detail for the model seen from n_radii bounding radii away
+static void drawAtDistances(GLFWwindow* window, Model& model, Texture& tex) {
+	Camera camera(.1f, 5000.f, 90.f);
+	GameObject obj;
+	obj.setModel(&model);
+	obj.setTexture(&tex);
+	Default3d default3d;
+	default3d.setCamera(&camera);
+	default3d.setAtmosphere(Eigen::Vector3f(.7f, .7f, .7f), .2f);
+	default3d.add(obj);
+
+	float radius = .5f * model.getBoundingBox().norm();
+	for (float n_radii : { 1.f, 2.f, 4.f, 8.f, 16.f, 32.f }) {
+		camera.moveTo(model.getBoxCenter() + Eigen::Vector3f(0, 0, n_radii * radius));
+		double frame_ms = benchMs([&]() {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			default3d.drawAll();
+			glFinish();
+			glfwSwapBuffers(window);
+		}, 10);
+		const Default3dStats& stats = default3d.getStats();
+		benchRow({ model.getFilename(), benchNum(n_radii, 0), std::to_string(stats.n_triangles), std::to_string(stats.n_triangles_full), benchNum(frame_ms) }, 18);
+	}
+	default3d.unload(obj);
+}
+
+void benchLod(GLFWwindow* window) {
+	Texture tex("soil.jpg");
+	std::vector<std::unique_ptr<Model>> models;
+	benchRow({ "model", "faces", "lod faces", "simplify ms" }, 18);
+	for (const char* fname : level_models) {
+		models.emplace_back(new Model(fname));
+		Model& model = *models.back();
+		auto start = std::chrono::steady_clock::now();
+		generateLods(model);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::string lod_faces;
+		for (int lod = 1; lod < model.getNLods(); lod++) {
+			lod_faces += (lod > 1 ? " " : "") + std::to_string(model.getLod(lod).flen());
+		}
+		benchRow({ fname, std::to_string(model.flen()), lod_faces.empty() ? "-" : lod_faces, benchNum(ms, 1) }, 18);
+	}
+	std::cout << std::endl;
+	benchRow({ "model", "radii away", "triangles", "full detail", "frame ms" }, 18);
+	for (auto& model : models) {
+		drawAtDistances(window, *model, tex);
+	}
+}
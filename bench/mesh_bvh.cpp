@@ -0,0 +1,117 @@
+#include <random>
+
+#include "bench.hpp"
+#include "surface.hpp"
+#include "mesh_bvh.hpp"
+
+//a sphere with rings bands as a MeshSurface, with or without its bvh
+static void sphereSurface(int rings, bool with_bvh, MeshSurface* surface) {
+	std::vector<Eigen::Vector3f> verts;
+	std::vector<std::tuple<int, int, int>> faces;
+	benchSphere(rings, &verts, &faces);
+	for (const Eigen::Vector3f& vert : verts) {
+		surface->addVert(vert);
+	}
+	for (const auto& [a, b, c] : faces) {
+		surface->addFace(a, b, c);
+	}
+	if (with_bvh) {
+		surface->buildBVH();
+	}
+}
+
+//short segments near the surface of the unit sphere, about half cross it
+static std::vector<MeshBVH::Segment> nearSurface(size_t n, float length, std::mt19937& rng) {
+	std::uniform_real_distribution<float> unit(-1, 1);
+	std::vector<MeshBVH::Segment> segments;
+	while (segments.size() < n) {
+		Eigen::Vector3f p(unit(rng), unit(rng), unit(rng));
+		Eigen::Vector3f d(unit(rng), unit(rng), unit(rng));
+		if (p.norm() < 1e-3f || d.norm() < 1e-3f) {
+			continue;
+		}
+		p = p.normalized() * (1 + .5f * length * unit(rng));
+		segments.emplace_back(p - .5f * length * d.normalized(), p + .5f * length * d.normalized());
+	}
+	return segments;
+}
+
+static void querySphere(int rings, size_t n_segments) {
+	MeshSurface linear;
+	MeshSurface with_bvh;
+	sphereSurface(rings, false, &linear);
+	sphereSurface(rings, false, &with_bvh);
+	double build_ms = benchMs([&]() { with_bvh.buildBVH(); });
+
+	std::mt19937 rng(11);
+	std::vector<MeshBVH::Segment> segments = nearSurface(n_segments, .1f, rng);
+
+	//the first hit in face order has to be the same face whichever way it is found
+	size_t mismatches = 0;
+	for (const auto& [e1, e2] : segments) {
+		float k_linear = 0, k_bvh = 0;
+		bool hit_linear = linear.crossesSurface(e1, e2, &k_linear);
+		bool hit_bvh = with_bvh.crossesSurface(e1, e2, &k_bvh);
+		mismatches += hit_linear != hit_bvh || (hit_linear && k_linear != k_bvh);
+		mismatches += linear.crossesSurface(e1, e2) != with_bvh.crossesSurface(e1, e2);
+	}
+
+	auto per_segment_us = [&](auto query) {
+		return 1e3 * benchMs([&]() {
+			int sum = 0;
+			for (const auto& [e1, e2] : segments) {
+				sum += query(e1, e2);
+			}
+			benchKeep(sum);
+		}) / n_segments;
+	};
+	double linear_us = per_segment_us([&](const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) { return linear.crossesSurface(e1, e2); });
+	double any_us = per_segment_us([&](const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) { return with_bvh.crossesSurface(e1, e2); });
+	double first_us = per_segment_us([&](const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) {
+		float k;
+		return with_bvh.crossesSurface(e1, e2, &k);
+	});
+	benchRow({ std::to_string(with_bvh.getFaces().size()), benchNum(build_ms), benchNum(linear_us), benchNum(any_us), benchNum(first_us), std::to_string(mismatches) });
+}
+
+//the edges of a small sphere next to the big one's surface, the kind of batch the mesh against mesh
+//check sends, one by one against all at once
+static void queryBatch(int rings) {
+	MeshSurface big;
+	sphereSurface(rings, true, &big);
+	MeshSurface small;
+	sphereSurface(5, false, &small);
+	std::vector<MeshBVH::Segment> edges;
+	for (const auto& [a, b, c] : small.getFaces()) {
+		for (auto [from, to] : { std::pair<int, int>{ a, b }, { b, c }, { c, a } }) {
+			Eigen::Vector3f offset(1.15f, 0, 0);
+			edges.emplace_back(.2f * small.getVerts()[from] + offset, .2f * small.getVerts()[to] + offset);
+		}
+	}
+
+	std::vector<bool> hits;
+	double one_by_one_us = 1e3 * benchMs([&]() {
+		int sum = 0;
+		for (const auto& [e1, e2] : edges) {
+			sum += big.crossesSurface(e1, e2);
+		}
+		benchKeep(sum);
+	});
+	double batch_us = 1e3 * benchMs([&]() {
+		big.crossesSurface(edges, &hits);
+		benchKeep(static_cast<int>(std::count(hits.begin(), hits.end(), true)));
+	});
+	benchRow({ std::to_string(big.getFaces().size()), std::to_string(edges.size()), benchNum(one_by_one_us), benchNum(batch_us), std::to_string(std::count(hits.begin(), hits.end(), true)) });
+}
+
+void benchMeshBvh(GLFWwindow* window) {
+	benchRow({ "faces", "build ms", "linear us", "bvh any us", "bvh first us", "mismatches" });
+	for (int rings : { 5, 16, 50, 158 }) {
+		querySphere(rings, 2000);
+	}
+	std::cout << std::endl;
+	benchRow({ "faces", "edges", "one by one us", "batch us", "edges hit" });
+	for (int rings : { 5, 16, 50, 158 }) {
+		queryBatch(rings);
+	}
+}
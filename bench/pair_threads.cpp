@@ -0,0 +1,88 @@
+#include <cmath>
+#include <thread>
+
+#include "bench.hpp"
+#include "collision_world.hpp"
+
+//n_pairs people, each paired by hand with someone walking back and forth through them, so about half
+//the pairs collide on any frame and none of them stand still long enough for coherence to answer
+struct PairedCrowd {
+	std::vector<GameObject> objects; //primary of pair i at 2i, secondary at 2i+1
+	std::vector<std::unique_ptr<CollisionPair<MeshSurface, MeshSurface>>> pairs;
+
+	PairedCrowd(size_t n_pairs, const MeshSurface& hitbox) : objects(2 * n_pairs) {
+		for (size_t i = 0; i < n_pairs; i++) {
+			Eigen::Matrix4f position = Eigen::Matrix4f::Identity();
+			position(0, 3) = 3.f * i;
+			objects[2 * i].setPosition(position);
+			objects[2 * i + 1].setPosition(position);
+			pairs.push_back(std::make_unique<CollisionPair<MeshSurface, MeshSurface>>(hitbox, objects[2 * i].getPosition(), hitbox, objects[2 * i + 1].getPosition(), objects[2 * i + 1].getdG()));
+		}
+	}
+
+	void step(int frame) {
+		for (size_t i = 0; i < pairs.size(); i++) {
+			Eigen::Matrix4f position = objects[2 * i].getPosition();
+			position(0, 3) += 1.2f * std::sin(.1f * frame + i);
+			position(2, 3) = .1f * std::cos(.3f * frame + i);
+			objects[2 * i + 1].setPosition(position);
+		}
+	}
+};
+
+//what GameObject::update did for each pair before they went to the level's world
+static int serialFrame(PairedCrowd& crowd) {
+	int n_colliding = 0;
+	for (auto& pair : crowd.pairs) {
+		if (pair->isCollision()) {
+			pair->fullCollisionInfo();
+			n_colliding++;
+		}
+	}
+	return n_colliding;
+}
+
+void benchPairThreads(GLFWwindow* window) {
+	const size_t n_pairs = 500;
+	const int frames = 60;
+	MeshSurface hitbox("human_static_hitbox.obj");
+	PairedCrowd crowd(n_pairs, hitbox);
+
+	size_t serial_colliding = 0;
+	double serial_ms = benchMs([&]() {
+		serial_colliding = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			crowd.step(frame);
+			serial_colliding += serialFrame(crowd);
+		}
+	}, 3) / frames;
+	std::cout << n_pairs << " pairs added by hand, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	benchRow({ "threads", "ms/frame", "speedup", "colliding" });
+	benchRow({ "serial loop", benchNum(serial_ms), benchNum(1), std::to_string(serial_colliding / frames) });
+
+	//doubling up to every hardware thread
+	unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> thread_counts;
+	for (unsigned int n_threads = 1; n_threads < max_threads; n_threads *= 2) {
+		thread_counts.push_back(n_threads);
+	}
+	thread_counts.push_back(max_threads);
+	for (unsigned int n_threads : thread_counts) {
+		WorkerPool workers(n_threads);
+		CollisionWorld world;
+		world.setWorkers(&workers);
+		for (size_t i = 0; i < n_pairs; i++) {
+			world.addPair(&crowd.objects[2 * i], &crowd.objects[2 * i + 1], crowd.pairs[i].get());
+		}
+		size_t world_colliding = 0;
+		double world_ms = benchMs([&]() {
+			world_colliding = 0;
+			for (int frame = 0; frame < frames; frame++) {
+				crowd.step(frame);
+				world.step();
+				world_colliding += world.getStats().n_colliding;
+			}
+		}, 3) / frames;
+		benchRow({ std::to_string(n_threads), benchNum(world_ms), benchNum(serial_ms / world_ms), std::to_string(world_colliding / frames) });
+	}
+}
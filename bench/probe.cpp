@@ -0,0 +1,136 @@
+#include <cmath>
+#include <random>
+#include <thread>
+
+#include "bench.hpp"
+#include "CollisionProbe.hpp"
+
+//rays from anywhere in box at about head height, every way, the kind of thing line of sight and
+//aim checks ask for
+static std::vector<CollisionProbe::Segment> raysIn(const Eigen::AlignedBox3f& box, size_t n, float length, std::mt19937& rng) {
+	std::uniform_real_distribution<float> unit(0, 1);
+	std::normal_distribution<float> normal(0, 1);
+	std::vector<CollisionProbe::Segment> rays;
+	while (rays.size() < n) {
+		Eigen::Vector3f origin = box.min() + box.sizes().cwiseProduct(Eigen::Vector3f(unit(rng), unit(rng), unit(rng)));
+		Eigen::Vector3f dir(normal(rng), normal(rng), normal(rng));
+		if (dir.norm() < 1e-3f) {
+			continue;
+		}
+		rays.emplace_back(origin, origin + length * dir.normalized());
+	}
+	return rays;
+}
+
+//rolling ground size across in cells squares of two faces each, about as big as an outdoor level gets
+static void terrain(int cells, float size, MeshSurface* ground) {
+	for (int i = 0; i <= cells; i++) {
+		for (int j = 0; j <= cells; j++) {
+			float x = size * i / cells - size / 2;
+			float z = size * j / cells - size / 2;
+			ground->addVert(Eigen::Vector3f(x, 2 * std::sin(x / 7) * std::cos(z / 5) + .3f * std::sin(x + z), z));
+		}
+	}
+	auto at = [cells](int i, int j) { return i * (cells + 1) + j; };
+	for (int i = 0; i < cells; i++) {
+		for (int j = 0; j < cells; j++) {
+			ground->addFace(at(i, j), at(i, j + 1), at(i + 1, j + 1));
+			ground->addFace(at(i, j), at(i + 1, j + 1), at(i + 1, j));
+		}
+	}
+	ground->buildBVH();
+}
+
+//people standing anywhere on the floor of box
+static void standAbout(const Eigen::AlignedBox3f& box, std::mt19937& rng, std::vector<GameObject>* people) {
+	std::uniform_real_distribution<float> unit(0, 1);
+	for (GameObject& person : *people) {
+		Eigen::Matrix4f position = Eigen::Matrix4f::Identity();
+		position.block<3, 1>(0, 3) = Eigen::Vector3f(box.min()(0) + box.sizes()(0) * unit(rng), box.min()(1) + 1, box.min()(2) + box.sizes()(2) * unit(rng));
+		person.setPosition(position);
+	}
+}
+
+static void probeRow(const std::string& name, const MeshSurface& level_mesh, int n_people, size_t n_rays, int frames) {
+	GameObject level;
+	std::vector<GameObject> people(n_people);
+	MeshSurface hitbox("human_static_hitbox.obj");
+	Eigen::AlignedBox3f box;
+	for (const Eigen::Vector3f& v : level_mesh.getVerts()) {
+		box.extend(v);
+	}
+	std::mt19937 rng(5);
+	standAbout(box, rng, &people);
+
+	CollisionWorld world;
+	world.add(&level, level_mesh, CollisionWorld::level_layer);
+	for (GameObject& person : people) {
+		world.add(&person, hitbox, CollisionWorld::npc_layer);
+	}
+	world.step();
+	CollisionProbe probe(world);
+
+	//a new batch every frame, like the game would ask for
+	std::vector<std::vector<CollisionProbe::Segment>> batches;
+	for (int frame = 0; frame < frames; frame++) {
+		batches.push_back(raysIn(box, n_rays, 10, rng));
+	}
+
+	size_t one_hits = 0;
+	double one_ms = benchMs([&]() {
+		one_hits = 0;
+		for (const auto& batch : batches) {
+			ProbeHit hit;
+			for (const auto& [from, to] : batch) {
+				one_hits += probe.segment(from, to, &hit);
+			}
+		}
+	}, 1) / frames;
+
+	std::vector<ProbeHit> hits;
+	auto batchMs = [&](WorkerPool* workers, size_t* n_hits) {
+		world.setWorkers(workers);
+		return benchMs([&]() {
+			*n_hits = 0;
+			for (const auto& batch : batches) {
+				probe.segments(batch, &hits);
+				for (const ProbeHit& hit : hits) {
+					*n_hits += hit.owner != nullptr;
+				}
+			}
+		}, 1) / frames;
+	};
+	size_t serial_hits = 0, threaded_hits = 0;
+	double serial_ms = batchMs(nullptr, &serial_hits);
+	double threaded_ms = batchMs(&WorkerPool::shared(), &threaded_hits);
+
+	//the level's mesh on its own, what the probe adds on top of the bvh
+	size_t mesh_hits = 0;
+	double mesh_ms = benchMs([&]() {
+		mesh_hits = 0;
+		for (const auto& batch : batches) {
+			for (const auto& [from, to] : batch) {
+				float k;
+				mesh_hits += level_mesh.crossesSurface(from, to, &k);
+			}
+		}
+		benchKeep(static_cast<int>(mesh_hits));
+	}, 1) / frames;
+
+	benchRow({ name, std::to_string(level_mesh.getFaces().size()), std::to_string(n_people), benchNum(mesh_ms), benchNum(one_ms), benchNum(serial_ms), benchNum(threaded_ms),
+		benchNum(100. * one_hits / frames / n_rays, 1), std::to_string((one_hits != serial_hits) + (serial_hits != threaded_hits)) });
+}
+
+void benchProbe(GLFWwindow* window) {
+	const size_t n_rays = 100000;
+	std::cout << n_rays << " rays of 10 a frame, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	benchRow({ "level", "faces", "people", "mesh ms", "one by one ms", "batch ms", "threaded ms", "hit %", "mismatches" });
+	MeshSurface ritual_room("cult_ritual_room.obj");
+	MeshSurface ground;
+	terrain(256, 200, &ground);
+	for (const auto& [name, level_mesh] : { std::make_pair("ritual room", &ritual_room), std::make_pair("terrain", &ground) }) {
+		for (int n_people : { 0, 30 }) {
+			probeRow(name, *level_mesh, n_people, n_rays, 5);
+		}
+	}
+}
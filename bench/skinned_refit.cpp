@@ -0,0 +1,86 @@
+#include <cmath>
+#include <random>
+
+#include "bench.hpp"
+#include "surface.hpp"
+
+//rest swung about like a walk, everything to either side of the body turned about the shoulders and
+//everything low about the hips, the two sides opposite ways. swing is the largest angle
+static void swingPose(const std::vector<Eigen::Vector3f>& rest, float swing, float phase, std::vector<Eigen::Vector3f>* posed) {
+	const Eigen::Vector3f shoulder(0, .6f, 0);
+	const Eigen::Vector3f hip(0, -.1f, 0);
+	posed->resize(rest.size());
+	for (size_t i = 0; i < rest.size(); i++) {
+		const Eigen::Vector3f& v = rest[i];
+		float side = v(0) < 0 ? -1.f : 1.f;
+		if (std::abs(v(0)) > .2f && v(1) > 0) {
+			(*posed)[i] = Eigen::AngleAxisf(side * swing * std::sin(phase), Eigen::Vector3f::UnitX()) * (v - shoulder) + shoulder;
+		} else if (v(1) < hip(1)) {
+			(*posed)[i] = Eigen::AngleAxisf(-side * swing * std::sin(phase), Eigen::Vector3f::UnitX()) * (v - hip) + hip;
+		} else {
+			(*posed)[i] = v;
+		}
+	}
+}
+
+//short segments anywhere in the mesh's box, about what a batch from the narrow phase looks like
+static std::vector<MeshBVH::Segment> segmentsIn(const Eigen::AlignedBox3f& box, size_t n, std::mt19937& rng) {
+	std::uniform_real_distribution<float> unit(0, 1);
+	std::vector<MeshBVH::Segment> segments;
+	for (size_t i = 0; i < n; i++) {
+		Eigen::Vector3f a = box.min() + box.sizes().cwiseProduct(Eigen::Vector3f(unit(rng), unit(rng), unit(rng)));
+		Eigen::Vector3f d = Eigen::Vector3f(unit(rng), unit(rng), unit(rng)) - Eigen::Vector3f::Constant(.5f);
+		segments.emplace_back(a, a + .2f * d);
+	}
+	return segments;
+}
+
+//frames of one swing, the pose moved onto one mesh with a refit and onto another with the bvh built
+//again, then the same segments through both
+static void swingRow(const std::string& fname, float swing, int frames) {
+	MeshSurface refit(fname);
+	MeshSurface rebuilt(fname);
+	const std::vector<Eigen::Vector3f> rest = refit.getVerts();
+	Eigen::AlignedBox3f box;
+	for (const Eigen::Vector3f& v : rest) {
+		box.extend(v);
+	}
+	std::mt19937 rng(3);
+	std::vector<MeshBVH::Segment> segments = segmentsIn(box, 20000, rng);
+
+	std::vector<std::vector<Eigen::Vector3f>> poses(frames);
+	for (int frame = 0; frame < frames; frame++) {
+		swingPose(rest, swing, 6.2832f * frame / frames, &poses[frame]);
+	}
+
+	double refit_ms = 0, rebuild_ms = 0, refit_query_ms = 0, rebuilt_query_ms = 0;
+	size_t mismatches = 0;
+	std::vector<bool> refit_hits, rebuilt_hits;
+	for (int frame = 0; frame < frames; frame++) {
+		refit_ms += benchMs([&]() {
+			refit.moveVerts(poses[frame]);
+		}, 1);
+		rebuild_ms += benchMs([&]() {
+			rebuilt.moveVerts(poses[frame]);
+			rebuilt.buildBVH();
+		}, 1);
+		refit_query_ms += benchMs([&]() {
+			refit.crossesSurface(segments, &refit_hits);
+		}, 1);
+		rebuilt_query_ms += benchMs([&]() {
+			rebuilt.crossesSurface(segments, &rebuilt_hits);
+		}, 1);
+		for (size_t i = 0; i < segments.size(); i++) {
+			mismatches += refit_hits[i] != rebuilt_hits[i];
+		}
+	}
+	benchRow({ benchNum(swing, 2), std::to_string(refit.getFaces().size()), benchNum(refit_ms / frames), benchNum(rebuild_ms / frames),
+		benchNum(1e3 * refit_query_ms / frames / segments.size()), benchNum(1e3 * rebuilt_query_ms / frames / segments.size()), std::to_string(mismatches) });
+}
+
+void benchSkinnedRefit(GLFWwindow* window) {
+	benchRow({ "swing rad", "faces", "refit ms", "rebuild ms", "refit us/seg", "built us/seg", "mismatches" });
+	for (float swing : { .2f, .6f, 1.2f }) {
+		swingRow("human.obj", swing, 30);
+	}
+}
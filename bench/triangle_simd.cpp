@@ -0,0 +1,151 @@
+#include <random>
+
+#include "bench.hpp"
+#include "surface.hpp"
+#include "triangle_soa.hpp"
+
+//the per face test MeshSurface::crossesSurface ran before TriangleSoA, kept here to compare against
+static bool crossesTriangle(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, const Eigen::Vector3f& t1, const Eigen::Vector3f& t2, const Eigen::Vector3f& t3, float* k) {
+	Eigen::Matrix3f tmp;
+	tmp.col(0) = t2 - t1;
+	tmp.col(1) = t3 - t1;
+	tmp.col(2) = e1 - e2;
+	if (tmp.determinant() == 0) {
+		return false;
+	}
+	Eigen::Vector3f abk = tmp.inverse() * (e1 - t1);
+	if (abk(2) > 1. || abk(2) < 0 || abk(0) < 0 || abk(1) < 0 || abk(0) + abk(1) > 1.) {
+		return false;
+	}
+	*k = abk(2);
+	return true;
+}
+
+//first face in face order the segment crosses, -1 for none
+static int firstHitPerFace(const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& faces, const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, float* k) {
+	for (size_t i = 0; i < faces.size(); i++) {
+		const auto& [a, b, c] = faces[i];
+		if (crossesTriangle(e1, e2, verts[a], verts[b], verts[c], k)) {
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+static TriangleSoA packFaces(const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& faces) {
+	TriangleSoA triangles;
+	for (const auto& [a, b, c] : faces) {
+		triangles.add(verts[a], verts[b], verts[c]);
+	}
+	return triangles;
+}
+
+//random triangles in a unit cube against random segments, checks the packed test finds the same
+//first face as the per face one
+static void randomTriangles(size_t n_faces, size_t n_segments) {
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<float> unit(-1, 1);
+	auto random_point = [&]() { return Eigen::Vector3f(unit(rng), unit(rng), unit(rng)); };
+
+	std::vector<Eigen::Vector3f> verts;
+	std::vector<std::tuple<int, int, int>> faces;
+	for (size_t i = 0; i < n_faces; i++) {
+		for (int j = 0; j < 3; j++) {
+			verts.push_back(random_point());
+		}
+		faces.emplace_back(3 * i, 3 * i + 1, 3 * i + 2);
+	}
+	std::vector<MeshBVH::Segment> segments;
+	for (size_t i = 0; i < n_segments; i++) {
+		segments.emplace_back(random_point(), random_point());
+	}
+	TriangleSoA triangles = packFaces(verts, faces);
+
+	size_t mismatches = 0;
+	size_t n_hits = 0;
+	float max_k_error = 0;
+	for (const auto& [e1, e2] : segments) {
+		float k_face = 0, k_pack = 0;
+		int face = firstHitPerFace(verts, faces, e1, e2, &k_face);
+		int pack = triangles.firstHit(e1, e2, &k_pack);
+		mismatches += face != pack;
+		n_hits += face >= 0;
+		if (face >= 0 && face == pack) {
+			max_k_error = std::max(max_k_error, std::abs(k_face - k_pack));
+		}
+	}
+
+	double face_ms = benchMs([&]() {
+		int sum = 0;
+		float k;
+		for (const auto& [e1, e2] : segments) {
+			sum += firstHitPerFace(verts, faces, e1, e2, &k);
+		}
+		benchKeep(sum);
+	});
+	double pack_ms = benchMs([&]() {
+		int sum = 0;
+		float k;
+		for (const auto& [e1, e2] : segments) {
+			sum += triangles.firstHit(e1, e2, &k);
+		}
+		benchKeep(sum);
+	});
+	benchRow({ std::to_string(n_faces), std::to_string(n_segments), std::to_string(n_hits), std::to_string(mismatches), benchNum(max_k_error, 7),
+		benchNum(1e3 * face_ms / n_segments), benchNum(1e3 * pack_ms / n_segments) });
+}
+
+//what checkCollision does for a pair of meshes that arent touching, every edge of sword against
+//every face of shield, sword moved into shield's frame
+static void meshPair(const std::string& shield_fname, const std::string& sword_fname, size_t n_pairs) {
+	MeshSurface shield(shield_fname);
+	MeshSurface sword(sword_fname);
+	TriangleSoA triangles = packFaces(shield.getVerts(), shield.getFaces());
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> unit(-1, 1);
+	std::vector<Eigen::Vector3f> offsets;
+	for (size_t i = 0; i < n_pairs; i++) {
+		offsets.push_back(3 * Eigen::Vector3f(unit(rng), unit(rng), unit(rng)));
+	}
+
+	int n_hit = 0;
+	auto edges_of = [&](const Eigen::Vector3f& offset, auto test) {
+		for (const auto& [a, b] : sword.getEdges()) {
+			if (test(sword.getVerts()[a] + offset, sword.getVerts()[b] + offset)) {
+				n_hit++;
+				return;
+			}
+		}
+	};
+	double face_ms = benchMs([&]() {
+		n_hit = 0;
+		for (const Eigen::Vector3f& offset : offsets) {
+			edges_of(offset, [&](const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) {
+				float k;
+				return firstHitPerFace(shield.getVerts(), shield.getFaces(), e1, e2, &k) >= 0;
+			});
+		}
+	});
+	double pack_ms = benchMs([&]() {
+		n_hit = 0;
+		for (const Eigen::Vector3f& offset : offsets) {
+			edges_of(offset, [&](const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) {
+				return triangles.firstHit(e1, e2) >= 0;
+			});
+		}
+	});
+	benchRow({ shield_fname, sword_fname, std::to_string(shield.getFaces().size()), std::to_string(sword.getEdges().size()),
+		benchNum(1e3 * face_ms / n_pairs), benchNum(1e3 * pack_ms / n_pairs), std::to_string(n_hit) }, 22);
+}
+
+void benchTriangleSimd(GLFWwindow* window) {
+	std::cout << TriangleSoA::lanes() << " lanes" << std::endl;
+	benchRow({ "faces", "segments", "hits", "mismatches", "max k error", "per face us", "packed us" });
+	for (size_t n_faces : { 8, 37, 256 }) {
+		randomTriangles(n_faces, 200000);
+	}
+	std::cout << std::endl;
+	benchRow({ "shield", "sword", "faces", "edges", "per face us/pair", "packed us/pair", "pairs hit" }, 22);
+	meshPair("human_static_hitbox.obj", "cam_box.obj", 2000);
+}
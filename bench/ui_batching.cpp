@@ -0,0 +1,90 @@
+#include <memory>
+
+#include "bench.hpp"
+#include "Default2d.hpp"
+#include "solid_tex.hpp"
+
+//a quad the size of Rect2d, uvs_to 1 samples the texture once, more than 1 makes it repeat
+static Model* benchQuad(float uvs_to) {
+	return new Model(
+		{ -.05f, -.05f, 0, .05f, -.05f, 0, -.05f, .05f, 0, .05f, .05f, 0 },
+		{ 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1 },
+		{ 0, 0, uvs_to, 0, 0, uvs_to, uvs_to, uvs_to },
+		{ 0, 1, 2, 3 }, { 0, 1, 2, 3 }, { 0, 1, 2, 3 });
+}
+
+//n_quads spread over 4 layers and n_textures solid colors, drawn by a fresh Default2d
+static void drawQuads(GLFWwindow* window, size_t n_quads, size_t n_textures, bool repeat) {
+	std::unique_ptr<Model> quad(benchQuad(repeat ? 2.f : 1.f));
+	std::vector<std::unique_ptr<SolidTexture>> textures;
+	for (size_t i = 0; i < n_textures; i++) {
+		textures.emplace_back(new SolidTexture(static_cast<uint8_t>(37 * i), static_cast<uint8_t>(91 * i), static_cast<uint8_t>(153 * i), 255));
+	}
+	std::vector<std::unique_ptr<GameObject>> objects;
+	Default2d default2d;
+	for (size_t i = 0; i < n_quads; i++) {
+		objects.emplace_back(new GameObject());
+		objects.back()->setModel(quad.get());
+		objects.back()->setTexture(textures[i % n_textures].get());
+		objects.back()->moveTo(-.95f + .1f * (i % 20), -.95f + .1f * ((i / 20) % 20), -.2f * (i % 4));
+		default2d.add(*objects.back());
+	}
+
+	double cpu_ms = 0;
+	double frame_ms = benchMs([&]() {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		default2d.drawAll();
+		cpu_ms = default2d.getStats().cpu_ms;
+		glFinish();
+		glfwSwapBuffers(window);
+	}, 20);
+
+	const Default2dStats& stats = default2d.getStats();
+	benchRow({ std::to_string(n_quads), std::to_string(n_textures), repeat ? "loose" : "atlas",
+		std::to_string(stats.n_quads), std::to_string(stats.n_draw_calls), benchNum(cpu_ms), benchNum(frame_ms) });
+
+	for (auto& object : objects) {
+		default2d.unload(*object);
+	}
+}
+
+//buttons being recolored with setTexture(new SolidTexture(...)), the atlas should stay the same size
+static void recolorQuads(size_t n_quads, size_t n_frames) {
+	std::unique_ptr<Model> quad(benchQuad(1.f));
+	std::vector<std::unique_ptr<SolidTexture>> textures;
+	std::vector<std::unique_ptr<GameObject>> objects;
+	Default2d default2d;
+	for (size_t i = 0; i < n_quads; i++) {
+		textures.emplace_back(new SolidTexture(0, 0, 0, 255));
+		objects.emplace_back(new GameObject());
+		objects.back()->setModel(quad.get());
+		objects.back()->setTexture(textures.back().get());
+		default2d.add(*objects.back());
+	}
+	for (size_t frame = 0; frame < n_frames; frame++) {
+		size_t i = frame % n_quads;
+		std::unique_ptr<SolidTexture> recolored(new SolidTexture(static_cast<uint8_t>(frame), 0, 0, 255));
+		default2d.unload(*objects[i]);
+		objects[i]->setTexture(recolored.get());
+		default2d.add(*objects[i]);
+		textures[i] = std::move(recolored);
+		default2d.drawAll();
+	}
+	std::cout << n_frames << " recolors of " << n_quads << " quads: " << default2d.getStats().n_atlas_textures
+		<< " textures in the atlas, " << default2d.getStats().n_loose_textures << " loose" << std::endl;
+	for (auto& object : objects) {
+		default2d.unload(*object);
+	}
+}
+
+void benchUiBatching(GLFWwindow* window) {
+	//before the atlas every quad was its own draw with its own texture bind, so draws was always quads
+	benchRow({ "quads", "textures", "sampled from", "drawn", "draws", "cpu ms", "frame ms" });
+	for (size_t n_quads : { 64, 256, 1024 }) {
+		for (size_t n_textures : { 1, 8, 64 }) {
+			drawQuads(window, n_quads, n_textures, false);
+		}
+		drawQuads(window, n_quads, 64, true);
+	}
+	recolorQuads(32, 1000);
+}
@@ -1,12 +1,56 @@
+#include <algorithm>
+
 #include "collision.hpp"
 
 template<PrimaryHitbox PrimaryHitbox_T, SecondaryHitbox<PrimaryHitbox_T> SecondaryHitbox_T>
-bool CollisionPair<PrimaryHitbox_T, SecondaryHitbox_T>::checkCollision(const PrimaryHitbox_T& PrimarySurf, const SecondaryHitbox_T& SecondarySurf, Eigen::Matrix4f PrimaryPosition, Eigen::Matrix4f SecondaryPosition,Eigen::Matrix4f secondary_motion) {
+bool CollisionPair<PrimaryHitbox_T, SecondaryHitbox_T>::checkCollision(const PrimaryHitbox_T& PrimarySurf, const SecondaryHitbox_T& SecondarySurf, Eigen::Matrix4f PrimaryPosition, Eigen::Matrix4f SecondaryPosition,Eigen::Matrix4f secondary_motion, CollisionCoherence* coherence) {
 	//static_assert(false, "Not A Function");
 	std::cerr << "cannot call generic collision function!" << "\n";
 	return true;
 };
 
+TimeOfImpact sweepCollision(const Surface<3>& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f& PrimaryPosition, const Eigen::Matrix4f& secondary_from, const Eigen::Matrix4f& secondary_to) {
+	TimeOfImpact toi{ false, 1, Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero() };
+	//secondary's verts in primary's frame
+	Eigen::Matrix4f from = PrimaryPosition.inverse() * secondary_from;
+	Eigen::Matrix4f to = PrimaryPosition.inverse() * secondary_to;
+	for (const Eigen::Vector3f& v : SecondarySurf.getVerts()) {
+		Eigen::Vector3f start = from.block<3, 3>(0, 0) * v + from.block<3, 1>(0, 3);
+		Eigen::Vector3f end = to.block<3, 3>(0, 0) * v + to.block<3, 1>(0, 3);
+		float k;
+		Eigen::Vector3f normal;
+		//only as far as the earliest hit so far, nothing after it matters
+		if (PrimarySurf.firstCrossing(start, start + toi.t * (end - start), &k, &normal) && k < 1) {
+			k *= toi.t;
+			toi = { true, k, start + k * (end - start), normal };
+		}
+	}
+	if (toi.hit) {
+		toi.point = PrimaryPosition.block<3, 3>(0, 0) * toi.point + PrimaryPosition.block<3, 1>(0, 3);
+		toi.normal = (PrimaryPosition.block<3, 3>(0, 0) * toi.normal).normalized();
+	}
+
+	const MeshSurface* primary_mesh = dynamic_cast<const MeshSurface*>(&PrimarySurf);
+	if (primary_mesh == nullptr) {
+		return toi;
+	}
+	//primary's verts in secondary's frame, secondary standing still and primary moving back
+	from = secondary_from.inverse() * PrimaryPosition;
+	to = secondary_to.inverse() * PrimaryPosition;
+	for (const Eigen::Vector3f& v : primary_mesh->getVerts()) {
+		Eigen::Vector3f start = from.block<3, 3>(0, 0) * v + from.block<3, 1>(0, 3);
+		Eigen::Vector3f end = to.block<3, 3>(0, 0) * v + to.block<3, 1>(0, 3);
+		float k;
+		Eigen::Vector3f normal;
+		if (SecondarySurf.firstCrossing(start, start + toi.t * (end - start), &k, &normal) && k < 1) {
+			k *= toi.t;
+			//the normal faces against primary's vert moving back, flipped it faces against secondary's move
+			toi = { true, k, PrimaryPosition.block<3, 3>(0, 0) * v + PrimaryPosition.block<3, 1>(0, 3), (secondary_from.block<3, 3>(0, 0) * -normal).normalized() };
+		}
+	}
+	return toi;
+}
+
 bool SurfaceNodeCollision(const Surface<3>& PrimarySurf, const MeshSurface& SecondarySurf, Eigen::Matrix4f SecondaryPosition) {
 	Eigen::Matrix3f R = SecondaryPosition(seq(0, 2), seq(0, 2));
 	Eigen::Vector3f p = SecondaryPosition(seq(0, 2), 3);
@@ -69,7 +113,37 @@ bool SurfaceNodeCollision(const MeshSurface& PrimarySurf, const MeshSurface& Sec
 	return result;
 }
 
-bool CollisionPair<Surface<3>, MeshSurface>::checkCollision(const Surface<3>& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion) {
+//segment i of secondary as CollisionCoherence numbers them, in primary's frame
+static MeshBVH::Segment secondarySegment(const MeshSurface& SecondarySurf, int i, const Eigen::Matrix3f& R_f, const Eigen::Vector3f& p_f, const Eigen::Matrix3f& R_i, const Eigen::Vector3f& p_i) {
+	int n_edges = static_cast<int>(SecondarySurf.getEdges().size());
+	if (i < n_edges) {
+		const auto& e = SecondarySurf.getEdges()[i];
+		return { R_f * SecondarySurf.getVerts()[e.first] + p_f, R_f * SecondarySurf.getVerts()[e.second] + p_f };
+	}
+	const Eigen::Vector3f& v = SecondarySurf.getVerts()[i - n_edges];
+	return { R_f * v + p_f, R_i * v + p_i };
+}
+
+//tries the last witness, true if it still crosses. clears what the last check left either way
+static bool checkWitness(const Surface<3>& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix3f& R_f, const Eigen::Vector3f& p_f, const Eigen::Matrix3f& R_i, const Eigen::Vector3f& p_i, CollisionCoherence* coherence) {
+	coherence->segment_hits.clear();
+	coherence->witness_hit = false;
+	coherence->convex_apart = false;
+	int n_segments = static_cast<int>(SecondarySurf.getEdges().size() + SecondarySurf.getVerts().size());
+	if (coherence->witness < 0 || coherence->witness >= n_segments) {
+		coherence->witness = -1;
+		return false;
+	}
+	auto [first_state, second_state] = secondarySegment(SecondarySurf, coherence->witness, R_f, p_f, R_i, p_i);
+	if (PrimarySurf.crossesSurface(first_state, second_state)) {
+		coherence->witness_hit = true;
+		return true;
+	}
+	coherence->witness = -1;
+	return false;
+}
+
+bool CollisionPair<Surface<3>, MeshSurface>::checkCollision(const Surface<3>& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion, CollisionCoherence* coherence) {
 	Eigen::Matrix4f secondary_last_position = SecondaryPosition * secondary_motion.inverse();
 	Eigen::Matrix4f secondary_relative_position = PrimaryPosition.inverse() * SecondaryPosition;
 	Eigen::Matrix4f secondary_relative_last_position = PrimaryPosition.inverse() * secondary_last_position;
@@ -77,22 +151,24 @@ bool CollisionPair<Surface<3>, MeshSurface>::checkCollision(const Surface<3>& Pr
 	Eigen::Vector3f p_f = secondary_relative_position(seq(0, 2), 3);
 	Eigen::Matrix3f R_i = secondary_relative_last_position(seq(0, 2), seq(0, 2));
 	Eigen::Vector3f p_i = secondary_relative_last_position(seq(0, 2), 3);
-	for (auto& e : SecondarySurf.getEdges()) {
-		//if (PrimarySurf->crossesSurface(R*SecondarySurf->getVerts()[e.first]+p, R*SecondarySurf->getVerts()[e.second]+p)) {
-		//should at least let the user choose is the mesh is irrotational?
-		if (PrimarySurf.crossesSurface(R_f * SecondarySurf.getVerts()[e.first] + p_f, R_f * SecondarySurf.getVerts()[e.second] + p_f)) {
-			return true;
-		}
+	if (coherence != nullptr && checkWitness(PrimarySurf, SecondarySurf, R_f, p_f, R_i, p_i, coherence)) {
+		return true;
 	}
-	for (const Eigen::Vector3f& v : SecondarySurf.getVerts()) {
-		if (PrimarySurf.crossesSurface(R_f * v + p_f, R_i * v + p_i)) {
+	int n_segments = static_cast<int>(SecondarySurf.getEdges().size() + SecondarySurf.getVerts().size());
+	for (int i = 0; i < n_segments; i++) {
+		//should at least let the user choose is the mesh is irrotational?
+		auto [first_state, second_state] = secondarySegment(SecondarySurf, i, R_f, p_f, R_i, p_i);
+		if (PrimarySurf.crossesSurface(first_state, second_state)) {
+			if (coherence != nullptr) {
+				coherence->witness = i;
+			}
 			return true;
 		}
 	}
 	return false;
 }
 
-bool CollisionPair<MeshSurface,MeshSurface>::checkCollision(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion) {
+bool CollisionPair<MeshSurface,MeshSurface>::checkCollision(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion, CollisionCoherence* coherence) {
 	Eigen::Matrix4f secondary_last_position = SecondaryPosition * secondary_motion.inverse();
 	Eigen::Matrix4f secondary_relative_position = PrimaryPosition.inverse() * SecondaryPosition;
 	Eigen::Matrix4f secondary_relative_last_position = PrimaryPosition.inverse() * secondary_last_position;
@@ -100,25 +176,171 @@ bool CollisionPair<MeshSurface,MeshSurface>::checkCollision(const MeshSurface& P
 	Eigen::Vector3f p_f = secondary_relative_position(seq(0, 2), 3);
 	Eigen::Matrix3f R_i = secondary_relative_last_position(seq(0, 2), seq(0, 2));
 	Eigen::Vector3f p_i = secondary_relative_last_position(seq(0, 2), 3);
-	for (auto& e : SecondarySurf.getEdges()) {
-		//if (PrimarySurf->crossesSurface(R*SecondarySurf->getVerts()[e.first]+p, R*SecondarySurf->getVerts()[e.second]+p)) {
-		//should at least let the user choose is the mesh is irrotational?
-		if (PrimarySurf.crossesSurface(R_f * SecondarySurf.getVerts()[e.first] + p_f, R_f * SecondarySurf.getVerts()[e.second] + p_f)) {
-			return true;
+	if (coherence != nullptr && checkWitness(PrimarySurf, SecondarySurf, R_f, p_f, R_i, p_i, coherence)) {
+		return true;
+	}
+	//no vert of secondary moved further than this since last frame, so if the convex pieces are further
+	//apart than that neither its edges nor its verts' paths can reach primary
+	float moved = (R_f - R_i).norm() * SecondarySurf.getHullReach() + (p_f - p_i).norm();
+	if (convexApart(PrimarySurf, SecondarySurf, secondary_relative_position, moved, coherence != nullptr ? &coherence->convex_cache : nullptr)) {
+		if (coherence != nullptr) {
+			coherence->convex_apart = true;
 		}
+		return false;
 	}
-	for (const Eigen::Vector3f& v : SecondarySurf.getVerts()) {
-		if (PrimarySurf.crossesSurface(R_f * v + p_f, R_i * v + p_i)) {
-			return true;
+	//every edge where it is now and every vert's path since last frame, down the bvh as one batch
+	int n_segments = static_cast<int>(SecondarySurf.getEdges().size() + SecondarySurf.getVerts().size());
+	std::vector<MeshBVH::Segment> segments;
+	segments.reserve(n_segments);
+	for (int i = 0; i < n_segments; i++) {
+		segments.push_back(secondarySegment(SecondarySurf, i, R_f, p_f, R_i, p_i));
+	}
+	if (coherence == nullptr) {
+		return PrimarySurf.crossesSurface(segments);
+	}
+	//with somewhere to keep them every result is kept, so fullCollisionInfo doesnt sweep the edges again
+	PrimarySurf.crossesSurface(segments, &coherence->segment_hits);
+	auto hit = std::find(coherence->segment_hits.begin(), coherence->segment_hits.end(), true);
+	if (hit == coherence->segment_hits.end()) {
+		return false;
+	}
+	coherence->witness = static_cast<int>(hit - coherence->segment_hits.begin());
+	return true;
+}
+
+
+//the sphere and ellipsoid, then the coarse meshes if both have them. with count what they turned away
+//goes in primary's stats
+static bool hierarchyApart(const HitboxHierarchy& PrimarySurf, const HitboxHierarchy& SecondarySurf, const Eigen::Matrix4f& PrimaryPosition, const Eigen::Matrix4f& SecondaryPosition, const Eigen::Matrix4f& secondary_motion, bool count) {
+	if (!PrimarySurf.boundsOverlap(SecondarySurf, PrimaryPosition, SecondaryPosition, secondary_motion, count)) {
+		return true;
+	}
+	if (!PrimarySurf.usesCoarse() || !SecondarySurf.usesCoarse()) {
+		return false;
+	}
+	bool apart = !CollisionPair<MeshSurface, MeshSurface>::checkCollision(PrimarySurf.getCoarse(), SecondarySurf.getCoarse(), PrimaryPosition, SecondaryPosition, secondary_motion) &&
+		!CollisionPair<MeshSurface, MeshSurface>::checkCollision(SecondarySurf.getCoarse(), PrimarySurf.getCoarse(), SecondaryPosition, PrimaryPosition) &&
+		PrimarySurf.coarseApart(SecondarySurf, PrimaryPosition, SecondaryPosition);
+	if (apart && count) {
+		PrimarySurf.countCoarseReject();
+	}
+	return apart;
+}
+
+//the levels before the exact meshes, then the exact meshes tested both ways round. coherence follows
+//the exact meshes
+bool CollisionPair<HitboxHierarchy, HitboxHierarchy>::checkCollision(const HitboxHierarchy& PrimarySurf, const HitboxHierarchy& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion, CollisionCoherence* coherence) {
+	if (hierarchyApart(PrimarySurf, SecondarySurf, PrimaryPosition, SecondaryPosition, secondary_motion, true)) {
+		if (coherence != nullptr) {
+			coherence->segment_hits.clear();
+			coherence->witness = -1;
+			coherence->witness_hit = false;
+			coherence->convex_apart = false;
 		}
+		return false;
 	}
-	return false;
+	PrimarySurf.countExactTest();
+	return CollisionPair<MeshSurface, MeshSurface>::checkCollision(PrimarySurf.getExact(), SecondarySurf.getExact(), PrimaryPosition, SecondaryPosition, secondary_motion, coherence) ||
+		CollisionPair<MeshSurface, MeshSurface>::checkCollision(SecondarySurf.getExact(), PrimarySurf.getExact(), SecondaryPosition, PrimaryPosition);
+}
+
+//the exact meshes' info, the pair was already counted by the check before it
+template<>
+void getFullCollision<HitboxHierarchy, HitboxHierarchy>(const HitboxHierarchy& PrimarySurf, const HitboxHierarchy& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, Eigen::Matrix4f secondary_motion, CollisionInfo<HitboxHierarchy, HitboxHierarchy>* collision_info) {
+	collision_info->exact_tested = !hierarchyApart(PrimarySurf, SecondarySurf, PrimaryPosition, SecondaryPosition, secondary_motion, false);
+	if (!collision_info->exact_tested) {
+		for (auto& edge : collision_info->getEdgeInfo()) {
+			edge.is_colliding = false;
+			edge.colliding_faces.clear();
+		}
+		collision_info->is_colliding = false;
+		collision_info->has_contact = false;
+		return;
+	}
+	getFullCollision<MeshSurface, MeshSurface>(PrimarySurf.getExact(), SecondarySurf.getExact(), PrimaryPosition, SecondaryPosition, secondary_motion, collision_info);
+	//none of secondary's edges crossing can still be primary's going through secondary
+	collision_info->is_colliding = collision_info->is_colliding ||
+		CollisionPair<MeshSurface, MeshSurface>::checkCollision(SecondarySurf.getExact(), PrimarySurf.getExact(), SecondaryPosition, PrimaryPosition);
+}
+
+ConvexContact convexContact(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f& PrimaryPosition, const Eigen::Matrix4f& SecondaryPosition, std::vector<GJKCache>* cache) {
+	const std::vector<ConvexHull>& primary_hulls = PrimarySurf.getHulls();
+	const std::vector<ConvexHull>& secondary_hulls = SecondarySurf.getHulls();
+	cache->resize(primary_hulls.size() * secondary_hulls.size(), GJKCache{});
+	Eigen::Matrix4f relative_position = PrimaryPosition.inverse() * SecondaryPosition;
+	ConvexContact best{};
+	bool found = false;
+	for (int i = 0; i < primary_hulls.size(); i++) {
+		for (int j = 0; j < secondary_hulls.size(); j++) {
+			ConvexContact contact = convexContact(primary_hulls[i], secondary_hulls[j], relative_position, &(*cache)[i * secondary_hulls.size() + j]);
+			bool better = !found || (contact.overlap ? !best.overlap || contact.depth > best.depth : !best.overlap && contact.distance < best.distance);
+			if (better) {
+				best = contact;
+				found = true;
+			}
+		}
+	}
+	Eigen::Matrix3f R = PrimaryPosition(seq(0, 2), seq(0, 2));
+	Eigen::Vector3f p = PrimaryPosition(seq(0, 2), 3);
+	best.normal = R * best.normal;
+	best.primary_point = R * best.primary_point + p;
+	best.secondary_point = R * best.secondary_point + p;
+	return best;
 }
 
+bool convexApart(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f& relative, float margin, std::vector<GJKCache>* cache) {
+	const std::vector<ConvexHull>& primary_hulls = PrimarySurf.getHulls();
+	const std::vector<ConvexHull>& secondary_hulls = SecondarySurf.getHulls();
+	if (primary_hulls.empty() || secondary_hulls.empty()) {
+		return false;
+	}
+	if (cache != nullptr) {
+		cache->resize(primary_hulls.size() * secondary_hulls.size(), GJKCache{});
+	}
+	for (int i = 0; i < primary_hulls.size(); i++) {
+		for (int j = 0; j < secondary_hulls.size(); j++) {
+			if (!convexApart(primary_hulls[i], secondary_hulls[j], relative, margin, cache != nullptr ? &(*cache)[i * secondary_hulls.size() + j] : nullptr)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//the contact from the convex pieces if both meshes have them
+static void fillContact(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f& PrimaryPosition, const Eigen::Matrix4f& SecondaryPosition, CollisionInfo<MeshSurface, MeshSurface>* collision_info) {
+	collision_info->has_contact = !PrimarySurf.getHulls().empty() && !SecondarySurf.getHulls().empty();
+	if (collision_info->has_contact) {
+		collision_info->contact = convexContact(PrimarySurf, SecondarySurf, PrimaryPosition, SecondaryPosition, &collision_info->convex_cache);
+	}
+}
 
 template<>
 void getFullCollision<MeshSurface, MeshSurface>(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, Eigen::Matrix4f secondary_motion, CollisionInfo<MeshSurface, MeshSurface>* collision_info){
 	SurfaceNodeCollision(PrimarySurf, SecondarySurf, PrimaryPosition.inverse() * SecondaryPosition, collision_info);
+	fillContact(PrimarySurf, SecondarySurf, PrimaryPosition, SecondaryPosition, collision_info);
+}
+
+void getFullCollision(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const std::vector<bool>& segment_hits, CollisionInfo<MeshSurface, MeshSurface>* collision_info) {
+	Eigen::Matrix4f relative_position = PrimaryPosition.inverse() * SecondaryPosition;
+	Eigen::Matrix3f R = relative_position(seq(0, 2), seq(0, 2));
+	Eigen::Vector3f p = relative_position(seq(0, 2), 3);
+	const auto& edges = SecondarySurf.getEdges();
+	if (collision_info->getEdgeInfo_const().size() < edges.size()) {
+		collision_info->getEdgeInfo().resize(edges.size());
+	}
+	bool result = false;
+	for (int i = 0; i < edges.size(); i++) {
+		auto& edge_info = collision_info->getEdgeInfo()[i];
+		edge_info.is_colliding = false;
+		if (segment_hits[i]) {
+			const auto& e = edges[i];
+			edge_info.is_colliding = PrimarySurf.crossesSurface(R * SecondarySurf.getVerts()[e.first] + p, R * SecondarySurf.getVerts()[e.second] + p, &edge_info.collision_location);
+			result = result || edge_info.is_colliding;
+		}
+	}
+	collision_info->is_colliding = result;
+	fillContact(PrimarySurf, SecondarySurf, PrimaryPosition, SecondaryPosition, collision_info);
 }
 
 template<>
@@ -4,6 +4,8 @@
 #define PUPPET_MATH_COLLISION
 
 #include "surface.hpp"
+#include "hitbox_hierarchy.hpp"
+#include "gjk.hpp"
 
 //theres probably a very cool solution to mesh-mesh collision using probablistic methods
 //also you could us ML to precompute a probabalistic function between two known meshes
@@ -21,10 +23,90 @@ template<class secondary, class primary>
 concept SecondaryHitbox = std::derived_from<secondary, Surface<3>>;
 
 
+//the earliest moment in a move that anything touches. t is how far through the move, point and normal
+//are in world space, the normal is of what was hit and faces back against the move
+struct TimeOfImpact {
+	bool hit;
+	float t;
+	Eigen::Vector3f point;
+	Eigen::Vector3f normal;
+};
+
+//secondary moving from secondary_from to secondary_to past primary, in one pass. every vertex of
+//secondary is swept against primary, and if primary is a mesh too its vertices are swept against
+//secondary going the other way, which catches edges hitting edges. the motion in between is taken
+//as straight lines for each vertex, the same as CollisionPair::checkCollision
+TimeOfImpact sweepCollision(const Surface<3>& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f& PrimaryPosition, const Eigen::Matrix4f& secondary_from, const Eigen::Matrix4f& secondary_to);
+
+//what a pair remembers from its last narrow phase, so a pair that hasnt moved since doesnt redo it and
+//one that has starts where it crossed last time. segments are numbered the way checkCollision goes
+//through them, secondary's edges where they are now and then the paths of its verts
+struct CollisionCoherence {
+	bool valid; //nothing below means anything until the first check
+	Eigen::Matrix4f relative_position; //secondary in primary's frame at the last check
+	Eigen::Matrix4f secondary_motion; //secondary's dG at the last check
+	bool result;
+	int witness; //a segment that crossed at the last check, -1 if none did
+	bool witness_hit; //the last check was answered by the witness crossing again
+	std::vector<bool> segment_hits; //every segment's result at the last check, empty if it stopped early
+	bool info_valid;
+	Eigen::Matrix4f info_relative_position; //relative_position when the collision info was last filled in
+	std::vector<GJKCache> convex_cache; //for every pair of convex pieces, when both are meshes that have them
+	bool convex_apart; //the last check was answered by the convex pieces being too far apart to have crossed
+};
+
 class CollisionPairBase {
 public:
+	struct CoherenceStats {
+		size_t n_checks;
+		size_t n_unmoved; //checks answered from the last one, nothing had moved
+		size_t n_witness; //checks answered by the last witness crossing again
+		size_t n_convex_apart; //checks answered by GJK, the convex pieces too far apart to have crossed
+		size_t n_infos;
+		size_t n_infos_unmoved; //infos left as they were, nothing had moved
+		size_t n_infos_from_check; //infos filled in from the check's segment_hits rather than a new sweep
+	};
+
+	//transforms closer than this in every entry count as not having moved
+	static constexpr float coherence_epsilon = 1e-5f;
+
+protected:
+	mutable CollisionCoherence coherence_;
+	mutable CoherenceStats coherence_stats_;
+
+	static bool unmoved(const Eigen::Matrix4f& now, const Eigen::Matrix4f& then) {
+		return (now - then).cwiseAbs().maxCoeff() <= coherence_epsilon;
+	}
+
+public:
+	CollisionPairBase() : coherence_{}, coherence_stats_{} {
+		coherence_.witness = -1;
+	}
+	virtual ~CollisionPairBase() {}
 	virtual bool isCollision() const = 0;
 	virtual void fullCollisionInfo() = 0;
+
+	//what the last isCollision found, without checking again. false before the first check or after
+	//resetCoherence
+	bool lastCollision() const {
+		return coherence_.valid && coherence_.result;
+	}
+
+	//for when a hitbox changes shape rather than moving, the next check starts from nothing
+	void resetCoherence() {
+		coherence_.valid = false;
+		coherence_.info_valid = false;
+		coherence_.witness = -1;
+		coherence_.segment_hits.clear();
+		coherence_.convex_cache.clear();
+	}
+
+	const CoherenceStats& getCoherenceStats() const {
+		return coherence_stats_;
+	}
+	void resetCoherenceStats() {
+		coherence_stats_ = {};
+	}
 };
 
 template<PrimaryHitbox Prim_T, SecondaryHitbox<Prim_T> Sec_T>
@@ -65,6 +147,11 @@ class CollisionInfo<MeshSurface, MeshSurface> {
 
 public:
 	bool is_colliding;
+	//both meshes have convex pieces, the contact is only filled in then. its depth and normal are how to
+	//push secondary out, from the deepest overlapping pair of pieces
+	bool has_contact;
+	ConvexContact contact;
+	std::vector<GJKCache> convex_cache; //last contact's simplices, the next one starts from them
 
 	std::vector<EdgeCollisionInfo>& getEdgeInfo() {
 		return edge_info_;
@@ -74,12 +161,25 @@ public:
 		return edge_info_;
 	}
 
-	CollisionInfo(int n_edges=0):edge_info_(n_edges) {
+	CollisionInfo(int n_edges=0):edge_info_(n_edges), is_colliding(false), has_contact(false), contact{} {
 
 	}
 
 };
 
+//what the exact meshes found, edges are secondary's exact edges through primary's exact faces.
+//is_colliding also counts primary's edges through secondary. cleared when a coarser level kept the pair
+//apart
+template<>
+class CollisionInfo<HitboxHierarchy, HitboxHierarchy> : public CollisionInfo<MeshSurface, MeshSurface> {
+public:
+	bool exact_tested; //got past the sphere, ellipsoid and coarse meshes
+
+	CollisionInfo(int n_edges = 0) :CollisionInfo<MeshSurface, MeshSurface>(n_edges), exact_tested(false) {
+
+	}
+};
+
 template<class A, class B>
 void getFullCollision(const A& PrimarySurf, const B& SecondarySurf, Eigen::Matrix4f PrimaryPosition, Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion, CollisionInfo<A,B>* collision_info);
 
@@ -96,6 +196,22 @@ void getFullCollision<Surface<3>, MeshSurface>(const Surface<3>& PrimarySurf, co
 template<>
 void getFullCollision<MeshSurface, MeshSurface>(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion, CollisionInfo<MeshSurface, MeshSurface>* collision_info);
 
+template<>
+void getFullCollision<HitboxHierarchy, HitboxHierarchy>(const HitboxHierarchy& PrimarySurf, const HitboxHierarchy& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion, CollisionInfo<HitboxHierarchy, HitboxHierarchy>* collision_info);
+
+//every convex piece of secondary against every one of primary, the deepest overlap or if none overlap
+//the closest pair, in world space. cache is resized to one GJKCache per pair of pieces. both meshes
+//need pieces
+ConvexContact convexContact(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f& PrimaryPosition, const Eigen::Matrix4f& SecondaryPosition, std::vector<GJKCache>* cache);
+
+//every pair of convex pieces is further apart than margin, relative is secondary in primary's frame.
+//false if either mesh has no pieces. cache can be nullptr
+bool convexApart(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f& relative, float margin, std::vector<GJKCache>* cache);
+
+//the same as getFullCollision but only the edges segment_hits says cross are looked at again, for
+//where they cross, the rest are taken as clear. segment_hits is numbered as in CollisionCoherence
+void getFullCollision(const MeshSurface& PrimarySurf, const MeshSurface& SecondarySurf, const Eigen::Matrix4f PrimaryPosition, const Eigen::Matrix4f SecondaryPosition, const std::vector<bool>& segment_hits, CollisionInfo<MeshSurface, MeshSurface>* collision_info);
+
 
 template<PrimaryHitbox PrimaryHitbox_T, SecondaryHitbox<PrimaryHitbox_T> SecondaryHitbox_T>
 class CollisionPair : public CollisionPairBase {
@@ -111,7 +227,13 @@ class CollisionPair : public CollisionPairBase {
 
 public:
 
-	static bool checkCollision(const PrimaryHitbox_T& PrimarySurf, const SecondaryHitbox_T& SecondarySurf, Eigen::Matrix4f PrimaryPosition, Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion);
+	//with coherence the witness is tried first and is set to whatever crosses, segment_hits is filled in
+	//if every segment gets tested
+	static bool checkCollision(const PrimaryHitbox_T& PrimarySurf, const SecondaryHitbox_T& SecondarySurf, Eigen::Matrix4f PrimaryPosition, Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion, CollisionCoherence* coherence);
+
+	static bool checkCollision(const PrimaryHitbox_T& PrimarySurf, const SecondaryHitbox_T& SecondarySurf, Eigen::Matrix4f PrimaryPosition, Eigen::Matrix4f SecondaryPosition, const Eigen::Matrix4f secondary_motion) {
+		return checkCollision(PrimarySurf, SecondarySurf, PrimaryPosition, SecondaryPosition, secondary_motion, nullptr);
+	}
 
 	static bool checkCollision(const PrimaryHitbox_T& PrimarySurf, const SecondaryHitbox_T& SecondarySurf, Eigen::Matrix4f PrimaryPosition, Eigen::Matrix4f SecondaryPosition) {
 		return checkCollision(PrimarySurf, SecondarySurf, PrimaryPosition, SecondaryPosition, Eigen::Matrix4f::Identity());
@@ -120,13 +242,49 @@ public:
 	const PrimaryHitbox_T& first;
 	const SecondaryHitbox_T& second;
 
+	//if neither the pair nor secondary's last move has changed since the last check its answer stands
 	bool isCollision() const final override {
-		return checkCollision(first, second, primary_base_transform_, secondary_base_transform_, secondary_dG_transform_);
+		coherence_stats_.n_checks++;
+		Eigen::Matrix4f relative = primary_base_transform_.inverse() * secondary_base_transform_;
+		if (coherence_.valid && unmoved(relative, coherence_.relative_position) && unmoved(secondary_dG_transform_, coherence_.secondary_motion)) {
+			coherence_stats_.n_unmoved++;
+			return coherence_.result;
+		}
+		coherence_.result = checkCollision(first, second, primary_base_transform_, secondary_base_transform_, secondary_dG_transform_, &coherence_);
+		if (coherence_.witness_hit) {
+			coherence_stats_.n_witness++;
+		}
+		if (coherence_.convex_apart) {
+			coherence_stats_.n_convex_apart++;
+		}
+		coherence_.valid = true;
+		coherence_.relative_position = relative;
+		coherence_.secondary_motion = secondary_dG_transform_;
+		return coherence_.result;
 	}
 
+	//the info only depends on where the pair is, so it stands until that changes. two meshes fill it in
+	//from the last check's results when they have them
 	void fullCollisionInfo() final override {
-		getFullCollision<PrimaryHitbox_T, SecondaryHitbox_T>(first, second, primary_base_transform_, secondary_base_transform_, secondary_dG_transform_, &collision_info_);
-
+		coherence_stats_.n_infos++;
+		Eigen::Matrix4f relative = primary_base_transform_.inverse() * secondary_base_transform_;
+		if (coherence_.info_valid && unmoved(relative, coherence_.info_relative_position)) {
+			coherence_stats_.n_infos_unmoved++;
+			return;
+		}
+		bool from_check = false;
+		if constexpr (std::same_as<PrimaryHitbox_T, MeshSurface> && std::same_as<SecondaryHitbox_T, MeshSurface>) {
+			if (coherence_.valid && !coherence_.segment_hits.empty() && unmoved(relative, coherence_.relative_position)) {
+				getFullCollision(first, second, primary_base_transform_, secondary_base_transform_, coherence_.segment_hits, &collision_info_);
+				coherence_stats_.n_infos_from_check++;
+				from_check = true;
+			}
+		}
+		if (!from_check) {
+			getFullCollision<PrimaryHitbox_T, SecondaryHitbox_T>(first, second, primary_base_transform_, secondary_base_transform_, secondary_dG_transform_, &collision_info_);
+		}
+		coherence_.info_valid = true;
+		coherence_.info_relative_position = relative;
 	}
 
 	//void GetCollisionData(Eigen::Matrix4f primary_position, Eigen::Matrix4f secondary_position)
@@ -0,0 +1,159 @@
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "collision_mesh.hpp"
+
+//size and last write time of the source, zero for both if it isnt there
+static void sourceStamp(const std::string& source_fname, uint64_t* size, int64_t* time) {
+	std::error_code error;
+	*size = std::filesystem::file_size(source_fname, error);
+	if (error) {
+		*size = 0;
+		*time = 0;
+		return;
+	}
+	*time = std::filesystem::last_write_time(source_fname, error).time_since_epoch().count();
+	if (error) {
+		*time = 0;
+	}
+}
+
+void CollisionMeshFile::map(const std::string& fname) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL) {
+		view_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		//the view keeps the file open on its own
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (view_ != nullptr) {
+		size_ = static_cast<size_t>(size.QuadPart);
+	}
+#else
+	int file = open(fname.c_str(), O_RDONLY);
+	if (file < 0) {
+		return;
+	}
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0) {
+		void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED) {
+			view_ = static_cast<const char*>(view);
+			size_ = static_cast<size_t>(info.st_size);
+		}
+	}
+	close(file);
+#endif
+}
+
+void CollisionMeshFile::unmap() {
+	if (view_ == nullptr) {
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(view_);
+#else
+	munmap(const_cast<char*>(view_), size_);
+#endif
+	view_ = nullptr;
+	size_ = 0;
+}
+
+CollisionMeshFile::CollisionMeshFile(const std::string& fname) : view_(nullptr), size_(0), data_{}, valid_(false) {
+	map(fname);
+	if (view_ == nullptr || size_ < sizeof(Header)) {
+		return;
+	}
+	const Header* header = reinterpret_cast<const Header*>(view_);
+	if (std::memcmp(header->magic, magic_, 4) != 0 || header->version != version_ ||
+		header->n_verts < 0 || header->n_edges < 0 || header->n_faces < 0 || header->n_hulls < 0 || header->n_hull_verts < 0 || header->n_hull_faces < 0 ||
+		size_ != sizeof(Header) + arraysSize(header->n_verts, header->n_edges, header->n_faces, header->n_hulls, header->n_hull_verts, header->n_hull_faces)) {
+		return;
+	}
+
+	data_.n_verts = header->n_verts;
+	data_.n_edges = header->n_edges;
+	data_.n_faces = header->n_faces;
+	data_.n_hulls = header->n_hulls;
+	data_.n_hull_verts = header->n_hull_verts;
+	data_.n_hull_faces = header->n_hull_faces;
+	const char* next = view_ + sizeof(Header);
+	auto floats = [&next](int n) { const float* arr = reinterpret_cast<const float*>(next); next += 4 * static_cast<size_t>(n); return arr; };
+	auto ints = [&next](int n) { const int* arr = reinterpret_cast<const int*>(next); next += 4 * static_cast<size_t>(n); return arr; };
+	data_.vert_x = floats(data_.n_verts); data_.vert_y = floats(data_.n_verts); data_.vert_z = floats(data_.n_verts);
+	data_.edge_a = ints(data_.n_edges); data_.edge_b = ints(data_.n_edges);
+	data_.edge_face_0 = ints(data_.n_edges); data_.edge_face_1 = ints(data_.n_edges);
+	data_.face_a = ints(data_.n_faces); data_.face_b = ints(data_.n_faces); data_.face_c = ints(data_.n_faces);
+	data_.plane_x = floats(data_.n_faces); data_.plane_y = floats(data_.n_faces); data_.plane_z = floats(data_.n_faces); data_.plane_d = floats(data_.n_faces);
+	data_.hull_verts_end = ints(data_.n_hulls); data_.hull_faces_end = ints(data_.n_hulls);
+	data_.hull_x = floats(data_.n_hull_verts); data_.hull_y = floats(data_.n_hull_verts); data_.hull_z = floats(data_.n_hull_verts);
+	data_.hull_face_a = ints(data_.n_hull_faces); data_.hull_face_b = ints(data_.n_hull_faces); data_.hull_face_c = ints(data_.n_hull_faces);
+	valid_ = true;
+}
+
+CollisionMeshFile::~CollisionMeshFile() {
+	unmap();
+}
+
+bool CollisionMeshFile::isCurrent(const std::string& source_fname) const {
+	if (!valid_) {
+		return false;
+	}
+	if (!std::filesystem::exists(source_fname)) {
+		return true;
+	}
+	const Header* header = reinterpret_cast<const Header*>(view_);
+	uint64_t size;
+	int64_t time;
+	sourceStamp(source_fname, &size, &time);
+	return header->source_size == size && header->source_time == time;
+}
+
+bool CollisionMeshFile::write(const std::string& fname, const std::string& source_fname, const CollisionMeshData& data) {
+	std::ofstream file(fname, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	Header header{};
+	std::memcpy(header.magic, magic_, 4);
+	header.version = version_;
+	sourceStamp(source_fname, &header.source_size, &header.source_time);
+	header.n_verts = data.n_verts;
+	header.n_edges = data.n_edges;
+	header.n_faces = data.n_faces;
+	header.n_hulls = data.n_hulls;
+	header.n_hull_verts = data.n_hull_verts;
+	header.n_hull_faces = data.n_hull_faces;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	auto array = [&file](const void* arr, int n) { file.write(static_cast<const char*>(arr), 4 * static_cast<size_t>(n)); };
+	array(data.vert_x, data.n_verts); array(data.vert_y, data.n_verts); array(data.vert_z, data.n_verts);
+	array(data.edge_a, data.n_edges); array(data.edge_b, data.n_edges);
+	array(data.edge_face_0, data.n_edges); array(data.edge_face_1, data.n_edges);
+	array(data.face_a, data.n_faces); array(data.face_b, data.n_faces); array(data.face_c, data.n_faces);
+	array(data.plane_x, data.n_faces); array(data.plane_y, data.n_faces); array(data.plane_z, data.n_faces); array(data.plane_d, data.n_faces);
+	array(data.hull_verts_end, data.n_hulls); array(data.hull_faces_end, data.n_hulls);
+	array(data.hull_x, data.n_hull_verts); array(data.hull_y, data.n_hull_verts); array(data.hull_z, data.n_hull_verts);
+	array(data.hull_face_a, data.n_hull_faces); array(data.hull_face_b, data.n_hull_faces); array(data.hull_face_c, data.n_hull_faces);
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef PUPPET_COLLISION_MESH
+#define PUPPET_COLLISION_MESH
+
+#include <string>
+#include <cstdint>
+
+//a cooked collision mesh, everything MeshSurface works out from an obj stored ready to use so
+//loading doesnt parse anything. verts are welded, edges are undirected and only there once, each
+//face has its plane and each edge the faces on either side of it. a closed mesh also has the convex
+//pieces it was cut into, each piece's verts and faces one after the other with where each piece ends.
+//every array is its own run of 4 byte values, structure of arrays, laid out one after the other
+//after the header in this order
+struct CollisionMeshData {
+	int n_verts;
+	int n_edges;
+	int n_faces;
+	const float* vert_x; const float* vert_y; const float* vert_z;
+	const int* edge_a; const int* edge_b;
+	const int* edge_face_0; const int* edge_face_1; //-1 where the edge has no face on that side
+	const int* face_a; const int* face_b; const int* face_c;
+	const float* plane_x; const float* plane_y; const float* plane_z; const float* plane_d; //n.p = d on the face
+	int n_hulls;
+	int n_hull_verts;
+	int n_hull_faces;
+	const int* hull_verts_end; const int* hull_faces_end; //piece i's run ends here, it starts where i - 1 ends
+	const float* hull_x; const float* hull_y; const float* hull_z;
+	const int* hull_face_a; const int* hull_face_b; const int* hull_face_c; //into their own piece's verts
+};
+
+//a cooked file mapped into memory read only, the arrays in getData point straight into the mapping
+//so they are only good for as long as this is around
+class CollisionMeshFile {
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t source_size; //of the obj it was cooked from, to tell when it is stale
+		int64_t source_time;
+		int32_t n_verts;
+		int32_t n_edges;
+		int32_t n_faces;
+		int32_t n_hulls;
+		int32_t n_hull_verts;
+		int32_t n_hull_faces;
+	};
+
+	static constexpr char magic_[4] = { 'P', 'C', 'M', 'S' };
+	static constexpr uint32_t version_ = 2;
+
+	const char* view_;
+	size_t size_;
+	CollisionMeshData data_;
+	bool valid_;
+
+	//size of the arrays after the header for these counts
+	static size_t arraysSize(int n_verts, int n_edges, int n_faces, int n_hulls, int n_hull_verts, int n_hull_faces) {
+		return 4 * (3 * static_cast<size_t>(n_verts) + 4 * static_cast<size_t>(n_edges) + 7 * static_cast<size_t>(n_faces) +
+			2 * static_cast<size_t>(n_hulls) + 3 * static_cast<size_t>(n_hull_verts) + 3 * static_cast<size_t>(n_hull_faces));
+	}
+
+	void map(const std::string& fname);
+	void unmap();
+
+public:
+	//maps fname, isValid says if it is a cooked mesh from this version
+	explicit CollisionMeshFile(const std::string& fname);
+	~CollisionMeshFile();
+
+	CollisionMeshFile(const CollisionMeshFile&) = delete;
+	CollisionMeshFile& operator=(const CollisionMeshFile&) = delete;
+
+	bool isValid() const {
+		return valid_;
+	}
+
+	//was cooked from source_fname as it is now. a missing source counts as current, so a build can
+	//ship only the cooked files
+	bool isCurrent(const std::string& source_fname) const;
+
+	const CollisionMeshData& getData() const {
+		return data_;
+	}
+
+	static bool write(const std::string& fname, const std::string& source_fname, const CollisionMeshData& data);
+};
+
+#endif
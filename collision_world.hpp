@@ -0,0 +1,682 @@
+#pragma once
+
+#ifndef PUPPET_COLLISION_WORLD
+#define PUPPET_COLLISION_WORLD
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+
+#include "GameObject.h"
+#include "collision.hpp"
+#include "worker_pool.hpp"
+#include "skinned_mesh_surface.hpp"
+
+//broad phase. boxes are sorted by their min along one axis and swept, a box only has to be checked
+//against the boxes that start before it ends. the order is kept between updates and re-sorted with
+//an insertion sort, boxes barely move between frames so that is close to linear.
+//a box is in the layers of its layer bits and collides with the layers of its mask bits, a pair is
+//only a candidate if each is in a layer the other collides with
+class SweepAndPrune {
+public:
+	struct Stats {
+		size_t n_boxes;
+		size_t n_swaps; //done by the last sort
+		size_t n_axis_overlaps; //pairs overlapping along the sweep axis
+		size_t n_candidates;
+	};
+
+private:
+	struct Entry {
+		Eigen::AlignedBox3f box;
+		uint32_t layer;
+		uint32_t mask;
+		bool alive;
+	};
+
+	std::vector<Entry> entries_;
+	std::vector<int> free_;
+	std::vector<int> order_; //live entries by box min along axis_
+	int axis_;
+	Stats stats_;
+
+	float minAlong(int entry) const {
+		return entries_[entry].box.min()(axis_);
+	}
+
+	//the axis the boxes are most spread out along, so the sweep skips the most pairs
+	int pickAxis() const {
+		Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+		Eigen::Vector3f sum_sq = Eigen::Vector3f::Zero();
+		for (int entry : order_) {
+			Eigen::Vector3f c = entries_[entry].box.center();
+			sum += c;
+			sum_sq += c.cwiseProduct(c);
+		}
+		Eigen::Vector3f variance = sum_sq - sum.cwiseProduct(sum) / std::max<size_t>(order_.size(), 1);
+		int axis;
+		variance.maxCoeff(&axis);
+		return axis;
+	}
+
+	void sort() {
+		stats_.n_swaps = 0;
+		for (size_t i = 1; i < order_.size(); i++) {
+			int entry = order_[i];
+			float key = minAlong(entry);
+			size_t j = i;
+			while (j > 0 && minAlong(order_[j - 1]) > key) {
+				order_[j] = order_[j - 1];
+				j--;
+				stats_.n_swaps++;
+			}
+			order_[j] = entry;
+		}
+	}
+
+public:
+	SweepAndPrune() : axis_(0), stats_{ 0, 0, 0, 0 } {}
+
+	//returns the id the box goes by from now on
+	int add(const Eigen::AlignedBox3f& box, uint32_t layer, uint32_t mask) {
+		int id;
+		if (free_.empty()) {
+			id = static_cast<int>(entries_.size());
+			entries_.push_back(Entry{ box, layer, mask, true });
+		} else {
+			id = free_.back();
+			free_.pop_back();
+			entries_[id] = Entry{ box, layer, mask, true };
+		}
+		order_.push_back(id);
+		return id;
+	}
+
+	void remove(int id) {
+		entries_[id].alive = false;
+		free_.push_back(id);
+		order_.erase(std::find(order_.begin(), order_.end(), id));
+	}
+
+	void setBox(int id, const Eigen::AlignedBox3f& box) {
+		entries_[id].box = box;
+	}
+
+	void setFilter(int id, uint32_t layer, uint32_t mask) {
+		entries_[id].layer = layer;
+		entries_[id].mask = mask;
+	}
+
+	uint32_t getLayer(int id) const {
+		return entries_[id].layer;
+	}
+
+	//pairs of ids whose boxes overlap and whose filters let them collide, lower id first
+	void findPairs(std::vector<std::pair<int, int>>* pairs) {
+		pairs->clear();
+		//switching axes makes that one sort slow, the sweeps after it make up for it
+		axis_ = pickAxis();
+		sort();
+
+		stats_.n_boxes = order_.size();
+		stats_.n_axis_overlaps = 0;
+		for (size_t i = 0; i < order_.size(); i++) {
+			const Entry& a = entries_[order_[i]];
+			float end = a.box.max()(axis_);
+			for (size_t j = i + 1; j < order_.size() && minAlong(order_[j]) <= end; j++) {
+				stats_.n_axis_overlaps++;
+				const Entry& b = entries_[order_[j]];
+				if ((a.layer & b.mask) == 0 || (b.layer & a.mask) == 0 || !a.box.intersects(b.box)) {
+					continue;
+				}
+				pairs->emplace_back(std::min(order_[i], order_[j]), std::max(order_[i], order_[j]));
+			}
+		}
+		stats_.n_candidates = pairs->size();
+	}
+
+	const Stats& getStats() const {
+		return stats_;
+	}
+};
+
+//every hitbox in a level, paired up by a broad phase instead of by hand. objects add their hitboxes
+//with a layer and a mask, step() (the level calls it after updating everything in it) finds the
+//pairs whose swept world boxes overlap and only those reach CollisionPair::isCollision. the
+//callbacks are the same ones GameObject::update calls for pairs added with addCollisionPair, and
+//both objects of a pair get them, each with the pair it is the primary of where there is one.
+//two meshes are checked both ways round, an edge of either going through a face of the other.
+//a hitbox that isnt a MeshSurface needs its bounds passed in and only collides with meshes, the
+//same as CollisionPair.
+//a SkinnedMeshSurface gets a new box whenever its pose changes, its contacts forget what they knew
+//about the last pose, and a pair whose world boxes overlap but where none of its capsules reach the
+//other's box is let go before the narrow phase.
+//a HitboxHierarchy is its exact mesh to everything else, two of them go through the hierarchy once
+//for both ways round
+//the narrow phase runs on a worker pool, each pair only reads the transforms and hitboxes and writes
+//its own state. the callbacks all come after on the calling thread, contacts in order of their body
+//ids and then pairs added with addPair in the order they were added, so they go the same way every run
+//however the work was split up. a callback can remove bodies and add or remove pairs, the world holds
+//on to them until the callbacks are done and never calls anything about a body after its remove.
+//a body with a mask of 0 is never paired with anything, it is only there for CollisionProbe to find
+class CollisionWorld {
+	friend class CollisionProbe; //reads the bodies
+
+public:
+	//layers the game's hitboxes go in. a level's own surface is in level_layer, limb_layer is for hitboxes
+	//that follow a pose
+	enum Layer : uint32_t { level_layer = 1, player_layer = 2, camera_layer = 4, npc_layer = 8, limb_layer = 16 };
+
+	struct Stats {
+		SweepAndPrune::Stats broad_phase;
+		size_t n_bodies_moved; //world boxes recomputed this step
+		size_t n_narrow_phase;
+		size_t n_colliding;
+		CollisionPairBase::CoherenceStats coherence; //over every pair that reached the narrow phase this step
+	};
+
+private:
+	struct Body {
+		GameObject* owner;
+		const Surface<3>* surface;
+		const MeshSurface* mesh; //surface again if it is a mesh, nullptr if not
+		const SkinnedMeshSurface* skinned; //surface again if it follows a pose, nullptr if not
+		const HitboxHierarchy* hierarchy; //surface again if it is one, nullptr if not
+		size_t pose; //skinned's pose the box was made for
+		Eigen::AlignedBox3f local_box;
+		bool placed; //world box has been computed at least once
+		bool moving; //moved last step, its box still has the swept part in it
+		bool reposed; //skinned changed pose since last step
+	};
+
+	//a candidate pair that stays alive for as long as the boxes overlap, so collision state carries
+	//over between steps
+	struct Contact {
+		std::unique_ptr<CollisionPairBase> forward; //first body primary
+		std::unique_ptr<CollisionPairBase> backward; //second body primary, only for two meshes
+		bool colliding;
+		bool seen;
+	};
+
+	//a pair made by hand rather than found by the broad phase, only the primary gets callbacks the same
+	//as with GameObject::addCollisionPair
+	struct HandPair {
+		GameObject* primary;
+		const GameObject* secondary;
+		CollisionPairBase* pair;
+		bool colliding;
+		bool hit; //this step's result
+		bool removed; //by removePair while callbacks were running, erased after
+	};
+
+	//a contact the narrow phase looks at this step, hit is filled in on a worker
+	struct Check {
+		uint64_t key;
+		Contact* contact;
+		bool active; //both hitboxes are on and the capsules dont rule it out
+		bool hit;
+	};
+
+	//below this many checks waking the workers costs more than it saves
+	static constexpr size_t min_parallel_checks_ = 8;
+
+	SweepAndPrune broad_phase_;
+	std::vector<Body> bodies_; //by broad phase id
+	std::unordered_map<uint64_t, Contact> contacts_;
+	std::vector<HandPair> hand_pairs_;
+	std::vector<std::pair<int, int>> candidates_;
+	std::vector<Check> checks_;
+	std::vector<uint64_t> ended_;
+	bool dispatching_; //callbacks are running, what they remove waits for tidy
+	std::vector<int> removed_; //bodies removed while callbacks were running
+	std::vector<HandPair> added_pairs_; //pairs added while callbacks were running
+	WorkerPool* workers_;
+	Stats stats_;
+
+	static uint64_t key(int a, int b) {
+		return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+	}
+
+	//box of the local box under a transform
+	static Eigen::AlignedBox3f transformBox(const Eigen::AlignedBox3f& box, const Eigen::Matrix4f& transform) {
+		Eigen::Vector3f center = transform.block<3, 3>(0, 0) * box.center() + transform.block<3, 1>(0, 3);
+		Eigen::Vector3f half = transform.block<3, 3>(0, 0).cwiseAbs() * (box.sizes() / 2);
+		return Eigen::AlignedBox3f(center - half, center + half);
+	}
+
+	//where it is now joined with where it was before its last move, so fast things dont skip pairs
+	static Eigen::AlignedBox3f sweptBox(const Body& body) {
+		const Eigen::Matrix4f& position = body.owner->getPosition();
+		Eigen::AlignedBox3f box = transformBox(body.local_box, position);
+		box.extend(transformBox(body.local_box, position * body.owner->getdG().inverse()));
+		return box;
+	}
+
+	static Eigen::AlignedBox3f meshBox(const MeshSurface& mesh) {
+		Eigen::AlignedBox3f box;
+		for (const Eigen::Vector3f& v : mesh.getVerts()) {
+			box.extend(v);
+		}
+		return box;
+	}
+
+	//nullptr if secondary isnt a mesh, there is no narrow phase for that
+	static std::unique_ptr<CollisionPairBase> makePair(const Body& primary, const Body& secondary) {
+		if (secondary.mesh == nullptr) {
+			return nullptr;
+		}
+		const Eigen::Matrix4f& primary_position = primary.owner->getPosition();
+		const Eigen::Matrix4f& secondary_position = secondary.owner->getPosition();
+		const Eigen::Matrix4f& secondary_dG = secondary.owner->getdG();
+		if (primary.hierarchy != nullptr && secondary.hierarchy != nullptr) {
+			return std::make_unique<CollisionPair<HitboxHierarchy, HitboxHierarchy>>(*primary.hierarchy, primary_position, *secondary.hierarchy, secondary_position, secondary_dG);
+		}
+		if (primary.mesh != nullptr) {
+			return std::make_unique<CollisionPair<MeshSurface, MeshSurface>>(*primary.mesh, primary_position, *secondary.mesh, secondary_position, secondary_dG);
+		}
+		return std::make_unique<CollisionPair<Surface<3>, MeshSurface>>(*primary.surface, primary_position, *secondary.mesh, secondary_position, secondary_dG);
+	}
+
+	int addBody(GameObject* owner, const Surface<3>& hitbox, const MeshSurface* mesh, const Eigen::AlignedBox3f& local_box, uint32_t layer, uint32_t mask) {
+		int id = broad_phase_.add(Eigen::AlignedBox3f(), layer, mask);
+		if (id >= bodies_.size()) {
+			bodies_.resize(id + 1);
+		}
+		bodies_[id] = Body{ owner, &hitbox, mesh, nullptr, nullptr, 0, local_box, false, false, false };
+		owner->world_bodies_.emplace_back(this, id);
+		return id;
+	}
+
+	//takes body id off its owner's list, the owner doesnt have to take it out of here when it goes away
+	void disown(int id) {
+		std::vector<std::pair<CollisionWorld*, int>>& owned = bodies_[id].owner->world_bodies_;
+		owned.erase(std::remove(owned.begin(), owned.end(), std::make_pair(this, id)), owned.end());
+	}
+
+	//none of skinned's capsules, where it is now or before its last move, reach other's world box
+	static bool capsulesApart(const Body& skinned, const Body& other) {
+		if (skinned.skinned == nullptr || !skinned.skinned->capsulesCoverMesh()) {
+			return false;
+		}
+		Eigen::AlignedBox3f other_box = sweptBox(other);
+		const Eigen::Matrix4f& position = skinned.owner->getPosition();
+		const Eigen::Matrix4f last_position = position * skinned.owner->getdG().inverse();
+		for (const SkinnedMeshSurface::Capsule& capsule : skinned.skinned->getCapsules()) {
+			Eigen::AlignedBox3f box;
+			for (const Eigen::Matrix4f* tform : { &position, &last_position }) {
+				box.extend(tform->block<3, 3>(0, 0) * capsule.a + tform->block<3, 1>(0, 3));
+				box.extend(tform->block<3, 3>(0, 0) * capsule.b + tform->block<3, 1>(0, 3));
+			}
+			box.min() -= Eigen::Vector3f::Constant(capsule.radius);
+			box.max() += Eigen::Vector3f::Constant(capsule.radius);
+			if (box.intersects(other_box)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void addCoherenceStats(CollisionPairBase* pair) {
+		const CollisionPairBase::CoherenceStats& pair_stats = pair->getCoherenceStats();
+		stats_.coherence.n_checks += pair_stats.n_checks;
+		stats_.coherence.n_unmoved += pair_stats.n_unmoved;
+		stats_.coherence.n_witness += pair_stats.n_witness;
+		stats_.coherence.n_convex_apart += pair_stats.n_convex_apart;
+		stats_.coherence.n_infos += pair_stats.n_infos;
+		stats_.coherence.n_infos_unmoved += pair_stats.n_infos_unmoved;
+		stats_.coherence.n_infos_from_check += pair_stats.n_infos_from_check;
+		pair->resetCoherenceStats();
+	}
+
+	//b isnt told if a's callback removed either of them
+	void endContact(int a, int b, Contact& contact) {
+		if (contact.colliding) {
+			contact.colliding = false;
+			GameObject* owner_a = bodies_[a].owner;
+			GameObject* owner_b = bodies_[b].owner;
+			owner_a->onDecollision(owner_b, contact.forward.get());
+			if (bodies_[a].owner != nullptr && bodies_[b].owner != nullptr) {
+				owner_b->onDecollision(owner_a, contact.backward ? contact.backward.get() : contact.forward.get());
+			}
+		}
+	}
+
+	//ends and erases the contacts in ended_, in key order. only while dispatching_, so the callbacks
+	//cant erase any of them first
+	void endContacts() {
+		std::sort(ended_.begin(), ended_.end());
+		for (uint64_t contact_key : ended_) {
+			auto found = contacts_.find(contact_key);
+			int a = static_cast<int>(contact_key >> 32);
+			int b = static_cast<int>(contact_key & 0xffffffff);
+			if (bodies_[a].owner != nullptr && bodies_[b].owner != nullptr) {
+				endContact(a, b, found->second);
+			}
+			contacts_.erase(found);
+		}
+	}
+
+	//erases what was removed while callbacks were running and adds the pairs that were added
+	void tidy() {
+		if (!removed_.empty()) {
+			auto removed = [this](int id) { return std::find(removed_.begin(), removed_.end(), id) != removed_.end(); };
+			for (auto it = contacts_.begin(); it != contacts_.end();) {
+				if (removed(static_cast<int>(it->first >> 32)) || removed(static_cast<int>(it->first & 0xffffffff))) {
+					it = contacts_.erase(it);
+				} else {
+					++it;
+				}
+			}
+			for (int id : removed_) {
+				broad_phase_.remove(id);
+			}
+			removed_.clear();
+		}
+		hand_pairs_.erase(std::remove_if(hand_pairs_.begin(), hand_pairs_.end(), [](const HandPair& hand_pair) { return hand_pair.removed; }), hand_pairs_.end());
+		hand_pairs_.insert(hand_pairs_.end(), added_pairs_.begin(), added_pairs_.end());
+		added_pairs_.clear();
+	}
+
+	static void narrowPhase(Check& check) {
+		Contact& contact = *check.contact;
+		check.hit = contact.forward->isCollision() || (contact.backward && contact.backward->isCollision());
+		if (check.hit) {
+			contact.forward->fullCollisionInfo();
+			if (contact.backward) {
+				contact.backward->fullCollisionInfo();
+			}
+		}
+	}
+
+	static void narrowPhase(HandPair& hand_pair) {
+		hand_pair.hit = hand_pair.primary->isHitboxActive() && hand_pair.secondary->isHitboxActive() && hand_pair.pair->isCollision();
+		if (hand_pair.hit) {
+			hand_pair.pair->fullCollisionInfo();
+		}
+	}
+
+public:
+	CollisionWorld() : dispatching_(false), workers_(&WorkerPool::shared()), stats_{} {}
+
+	//owners still in here are left alone, nothing is called about their contacts
+	~CollisionWorld() {
+		for (int id = 0; id < bodies_.size(); id++) {
+			if (bodies_[id].owner != nullptr) {
+				disown(id);
+			}
+		}
+	}
+
+	CollisionWorld(const CollisionWorld&) = delete;
+	CollisionWorld& operator=(const CollisionWorld&) = delete;
+
+	//returns an id for remove and setFilter. the hitbox has to outlive it, the owner takes it out when it
+	//goes away
+	int add(GameObject* owner, const MeshSurface& hitbox, uint32_t layer = 1, uint32_t mask = ~0u) {
+		return addBody(owner, hitbox, &hitbox, meshBox(hitbox), layer, mask);
+	}
+
+	//the box follows the hitbox's pose, the hitbox has to be updated before step
+	int add(GameObject* owner, const SkinnedMeshSurface& hitbox, uint32_t layer = 1, uint32_t mask = ~0u) {
+		int id = addBody(owner, hitbox, &hitbox, hitbox.getBounds(), layer, mask);
+		bodies_[id].skinned = &hitbox;
+		bodies_[id].pose = hitbox.getPose();
+		return id;
+	}
+
+	//paired with another hierarchy the sphere, ellipsoid and coarse meshes go first, with anything else
+	//it is the exact mesh
+	int add(GameObject* owner, const HitboxHierarchy& hitbox, uint32_t layer = 1, uint32_t mask = ~0u) {
+		Eigen::AlignedBox3f box = meshBox(hitbox.getExact());
+		box.extend(meshBox(hitbox.getCoarse()));
+		int id = addBody(owner, hitbox, &hitbox.getExact(), box, layer, mask);
+		bodies_[id].hierarchy = &hitbox;
+		return id;
+	}
+
+	//local_box bounds the surface in the owner's frame
+	int add(GameObject* owner, const Surface<3>& hitbox, const Eigen::AlignedBox3f& local_box, uint32_t layer = 1, uint32_t mask = ~0u) {
+		const MeshSurface* mesh = dynamic_cast<const MeshSurface*>(&hitbox);
+		return addBody(owner, hitbox, mesh, local_box, layer, mask);
+	}
+
+	//ends any collisions it is in, with onDecollision in key order. from a callback the body is let go
+	//once the callbacks are done, nothing is called about it from here on either way
+	void remove(int id) {
+		if (bodies_[id].owner == nullptr) {
+			return;
+		}
+		disown(id);
+		bool outer = !dispatching_;
+		dispatching_ = true;
+		std::vector<uint64_t> ending;
+		for (auto& [contact_key, contact] : contacts_) {
+			if (static_cast<int>(contact_key >> 32) == id || static_cast<int>(contact_key & 0xffffffff) == id) {
+				ending.push_back(contact_key);
+			}
+		}
+		std::sort(ending.begin(), ending.end());
+		for (uint64_t contact_key : ending) {
+			int a = static_cast<int>(contact_key >> 32);
+			int b = static_cast<int>(contact_key & 0xffffffff);
+			if (bodies_[a].owner != nullptr && bodies_[b].owner != nullptr) {
+				endContact(a, b, contacts_.find(contact_key)->second);
+			}
+		}
+		bodies_[id].owner = nullptr;
+		removed_.push_back(id);
+		if (outer) {
+			dispatching_ = false;
+			tidy();
+		}
+	}
+
+	//a pair checked in the same stage as the broad phase's, for pairs that are known ahead of time.
+	//GameObject::addCollisionPair puts its pairs here in a level.
+	//primary gets the callbacks with secondary. the pair isnt owned and has to outlive this or removePair
+	void addPair(GameObject* primary, const GameObject* secondary, CollisionPairBase* pair) {
+		(dispatching_ ? added_pairs_ : hand_pairs_).push_back(HandPair{ primary, secondary, pair, false, false, false });
+	}
+
+	//without onDecollision, the same as GameObject::removeCollisionPair
+	void removePair(CollisionPairBase* pair) {
+		auto same = [pair](const HandPair& hand_pair) { return hand_pair.pair == pair; };
+		added_pairs_.erase(std::remove_if(added_pairs_.begin(), added_pairs_.end(), same), added_pairs_.end());
+		if (!dispatching_) {
+			hand_pairs_.erase(std::remove_if(hand_pairs_.begin(), hand_pairs_.end(), same), hand_pairs_.end());
+			return;
+		}
+		for (HandPair& hand_pair : hand_pairs_) {
+			hand_pair.removed = hand_pair.removed || same(hand_pair);
+		}
+	}
+
+	//whether a pair added with addPair was colliding as of the last step
+	bool isPairColliding(const CollisionPairBase* pair) const {
+		for (const HandPair& hand_pair : hand_pairs_) {
+			if (hand_pair.pair == pair && !hand_pair.removed) {
+				return hand_pair.colliding;
+			}
+		}
+		return false;
+	}
+
+	//nullptr checks everything on the thread calling step
+	void setWorkers(WorkerPool* workers) {
+		workers_ = workers;
+	}
+
+	void setFilter(int id, uint32_t layer, uint32_t mask) {
+		broad_phase_.setFilter(id, layer, mask);
+	}
+
+	//after everything has moved for the frame
+	void step() {
+		//only bodies that moved since last frame need a new box
+		stats_.n_bodies_moved = 0;
+		for (int id = 0; id < bodies_.size(); id++) {
+			Body& body = bodies_[id];
+			if (body.owner == nullptr) {
+				continue;
+			}
+			body.reposed = body.skinned != nullptr && body.skinned->getPose() != body.pose;
+			if (body.reposed) {
+				body.local_box = body.skinned->getBounds();
+				body.pose = body.skinned->getPose();
+			}
+			bool moved = !body.owner->getdG().isIdentity() || body.reposed;
+			if (body.placed && !moved && !body.moving) {
+				continue;
+			}
+			broad_phase_.setBox(id, sweptBox(body));
+			body.placed = true;
+			body.moving = moved;
+			stats_.n_bodies_moved++;
+		}
+
+		broad_phase_.findPairs(&candidates_);
+
+		checks_.clear();
+		for (auto& [a, b] : candidates_) {
+			Body& body_a = bodies_[a];
+			Body& body_b = bodies_[b];
+			if (body_a.owner == body_b.owner) {
+				continue;
+			}
+			auto found = contacts_.find(key(a, b));
+			if (found == contacts_.end()) {
+				std::unique_ptr<CollisionPairBase> forward = makePair(body_a, body_b);
+				//a hierarchy pair already checks both ways round
+				std::unique_ptr<CollisionPairBase> backward = body_a.hierarchy != nullptr && body_b.hierarchy != nullptr ? nullptr : makePair(body_b, body_a);
+				if (!forward) {
+					//only b's faces against a's edges
+					std::swap(forward, backward);
+					if (!forward) {
+						continue;
+					}
+				}
+				found = contacts_.emplace(key(a, b), Contact{ std::move(forward), std::move(backward), false, false }).first;
+			}
+			Contact& contact = found->second;
+			contact.seen = true;
+			if (body_a.reposed || body_b.reposed) {
+				//a result kept from before is for the old pose
+				contact.forward->resetCoherence();
+				if (contact.backward) {
+					contact.backward->resetCoherence();
+				}
+			}
+			bool active = body_a.owner->isHitboxActive() && body_b.owner->isHitboxActive() && !capsulesApart(body_a, body_b) && !capsulesApart(body_b, body_a);
+			checks_.push_back(Check{ found->first, &contact, active, false });
+		}
+		//the broad phase hands pairs over in sweep order, which changes as things move
+		std::sort(checks_.begin(), checks_.end(), [](const Check& first, const Check& second) { return first.key < second.key; });
+
+		//the narrow phase, every pair on its own
+		size_t n_jobs = checks_.size() + hand_pairs_.size();
+		auto job = [this](size_t i) {
+			if (i < checks_.size()) {
+				if (checks_[i].active) {
+					narrowPhase(checks_[i]);
+				}
+			} else {
+				narrowPhase(hand_pairs_[i - checks_.size()]);
+			}
+		};
+		if (workers_ != nullptr && n_jobs >= min_parallel_checks_) {
+			workers_->parallelFor(n_jobs, job);
+		} else {
+			for (size_t i = 0; i < n_jobs; i++) {
+				job(i);
+			}
+		}
+
+		//callbacks, in order. contacts are only erased and hand pairs only added or erased after, so
+		//check.contact and the hand pairs stay put while user code runs
+		dispatching_ = true;
+		stats_.n_narrow_phase = 0;
+		stats_.n_colliding = 0;
+		stats_.coherence = {};
+		for (Check& check : checks_) {
+			int a = static_cast<int>(check.key >> 32);
+			int b = static_cast<int>(check.key & 0xffffffff);
+			GameObject* owner_a = bodies_[a].owner;
+			GameObject* owner_b = bodies_[b].owner;
+			if (owner_a == nullptr || owner_b == nullptr) {
+				continue; //removed by an earlier callback
+			}
+			Contact& contact = *check.contact;
+			CollisionPairBase* pair_a = contact.forward.get();
+			CollisionPairBase* pair_b = contact.backward ? contact.backward.get() : contact.forward.get();
+			if (check.active) {
+				stats_.n_narrow_phase++;
+			}
+			if (check.hit) {
+				stats_.n_colliding++;
+				//a remove from a's callback ends the contact, b hears about it from there
+				if (!contact.colliding) {
+					contact.colliding = true;
+					owner_a->onCollision(owner_b, pair_a);
+					if (contact.colliding) {
+						owner_b->onCollision(owner_a, pair_b);
+					}
+				} else {
+					owner_a->whileCollision(owner_b, pair_a);
+					if (contact.colliding) {
+						owner_b->whileCollision(owner_a, pair_b);
+					}
+				}
+			} else {
+				endContact(a, b, contact);
+			}
+			addCoherenceStats(contact.forward.get());
+			if (contact.backward) {
+				addCoherenceStats(contact.backward.get());
+			}
+		}
+		//by index, a callback may mark any of them removed but none are added or erased until tidy
+		for (size_t i = 0; i < hand_pairs_.size(); i++) {
+			HandPair& hand_pair = hand_pairs_[i];
+			if (hand_pair.removed) {
+				continue;
+			}
+			stats_.n_narrow_phase++;
+			if (hand_pair.hit) {
+				stats_.n_colliding++;
+				if (!hand_pair.colliding) {
+					hand_pair.primary->onCollision(hand_pair.secondary, hand_pair.pair);
+					hand_pair.colliding = true;
+				} else {
+					hand_pair.primary->whileCollision(hand_pair.secondary, hand_pair.pair);
+				}
+			} else if (hand_pair.colliding) {
+				hand_pair.primary->onDecollision(hand_pair.secondary, hand_pair.pair);
+				hand_pair.colliding = false;
+			}
+			addCoherenceStats(hand_pair.pair);
+		}
+
+		//boxes that stopped overlapping end their contacts
+		ended_.clear();
+		for (auto& [contact_key, contact] : contacts_) {
+			if (!contact.seen) {
+				ended_.push_back(contact_key);
+			}
+			contact.seen = false;
+		}
+		endContacts();
+		dispatching_ = false;
+		tidy();
+		stats_.broad_phase = broad_phase_.getStats();
+	}
+
+	const Stats& getStats() const {
+		return stats_;
+	}
+};
+
+#endif
@@ -0,0 +1,357 @@
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <limits>
+
+#include "convex_hull.hpp"
+
+ConvexHull::ConvexHull(std::vector<Eigen::Vector3f> verts, std::vector<std::tuple<int, int, int>> faces) : verts_(std::move(verts)), faces_(std::move(faces)) {
+	buildNeighbors();
+}
+
+void ConvexHull::buildNeighbors() {
+	neighbor_start_.clear();
+	neighbors_.clear();
+	if (faces_.empty()) {
+		return;
+	}
+	//each edge shows up once in each direction, the face on its other side has it the other way round
+	std::vector<std::vector<int>> adjacent(verts_.size());
+	for (const auto& [a, b, c] : faces_) {
+		adjacent[a].push_back(b);
+		adjacent[b].push_back(c);
+		adjacent[c].push_back(a);
+	}
+	neighbor_start_.push_back(0);
+	for (const std::vector<int>& list : adjacent) {
+		neighbors_.insert(neighbors_.end(), list.begin(), list.end());
+		neighbor_start_.push_back(static_cast<int>(neighbors_.size()));
+	}
+}
+
+ConvexHull ConvexHull::around(const std::vector<Eigen::Vector3f>& input) {
+	if (input.size() < 4) {
+		return ConvexHull(input, {});
+	}
+	//in doubles, in floats the normal of a long thin face is too rough to say which side of it a point
+	//on its plane is, which a cut leaves plenty of
+	std::vector<Eigen::Vector3d> points;
+	points.reserve(input.size());
+	for (const Eigen::Vector3f& p : input) {
+		points.push_back(p.cast<double>());
+	}
+	Eigen::AlignedBox3d box;
+	for (const Eigen::Vector3d& p : points) {
+		box.extend(p);
+	}
+	const double eps = 1e-5 * std::max(box.sizes().maxCoeff(), 1e-6);
+
+	//a tetrahedron to start from. the points furthest apart along the longest side of the box, the
+	//point furthest from the line through them and the point furthest from the plane through all three
+	int axis;
+	box.sizes().maxCoeff(&axis);
+	int i0 = 0;
+	int i1 = 0;
+	for (int i = 0; i < points.size(); i++) {
+		if (points[i](axis) < points[i0](axis)) {
+			i0 = i;
+		}
+		if (points[i](axis) > points[i1](axis)) {
+			i1 = i;
+		}
+	}
+	Eigen::Vector3d line = (points[i1] - points[i0]).normalized();
+	int i2 = -1;
+	double furthest = eps;
+	for (int i = 0; i < points.size(); i++) {
+		double distance = (points[i] - points[i0]).cross(line).norm();
+		if (distance > furthest) {
+			furthest = distance;
+			i2 = i;
+		}
+	}
+	if (i2 < 0) {
+		return ConvexHull(input, {});
+	}
+	Eigen::Vector3d plane = (points[i1] - points[i0]).cross(points[i2] - points[i0]).normalized();
+	int i3 = -1;
+	furthest = eps;
+	for (int i = 0; i < points.size(); i++) {
+		double distance = std::abs(plane.dot(points[i] - points[i0]));
+		if (distance > furthest) {
+			furthest = distance;
+			i3 = i;
+		}
+	}
+	if (i3 < 0) {
+		return ConvexHull(input, {});
+	}
+
+	struct Face {
+		int a, b, c;
+		Eigen::Vector3d normal;
+		double offset;
+		bool alive;
+		std::vector<int> outside; //points outside this face and not yet on the hull
+	};
+	std::vector<Face> faces;
+	std::unordered_map<uint64_t, int> edge_faces; //the face each edge, first vert in the top half, goes round
+	auto addFace = [&](int a, int b, int c) {
+		Eigen::Vector3d normal = (points[b] - points[a]).cross(points[c] - points[a]);
+		double length = normal.norm();
+		//a sliver has no direction to face, it is never seen from anywhere and goes with its neighbours
+		normal = length > 0 ? Eigen::Vector3d(normal / length) : Eigen::Vector3d::Zero();
+		for (auto [first, second] : { std::pair<int, int>(a, b), std::pair<int, int>(b, c), std::pair<int, int>(c, a) }) {
+			edge_faces[static_cast<uint64_t>(first) << 32 | static_cast<uint32_t>(second)] = static_cast<int>(faces.size());
+		}
+		faces.push_back(Face{ a, b, c, normal, normal.dot(points[a]), true, {} });
+	};
+	for (auto [a, b, c, opposite] : { std::array<int, 4>{ i0, i1, i2, i3 }, std::array<int, 4>{ i0, i1, i3, i2 }, std::array<int, 4>{ i0, i2, i3, i1 }, std::array<int, 4>{ i1, i2, i3, i0 } }) {
+		Eigen::Vector3d normal = (points[b] - points[a]).cross(points[c] - points[a]);
+		if (normal.dot(points[opposite] - points[a]) > 0) {
+			std::swap(b, c);
+		}
+		addFace(a, b, c);
+	}
+	//hands a point to the first face from first on it is outside of and says which, points outside none
+	//are inside
+	auto assign = [&](int i, int first) {
+		for (int f = first; f < faces.size(); f++) {
+			if (faces[f].alive && faces[f].normal.dot(points[i]) - faces[f].offset > eps) {
+				faces[f].outside.push_back(i);
+				return f;
+			}
+		}
+		return -1;
+	};
+	for (int i = 0; i < points.size(); i++) {
+		if (i != i0 && i != i1 && i != i2 && i != i3) {
+			assign(i, 0);
+		}
+	}
+
+	//the point furthest outside a face grows the hull next, the faces it can see come off and the edges
+	//round them are joined up to it. going furthest first keeps points just outside from making slivers,
+	//most of them end up inside
+	std::unordered_set<uint64_t> visible_edges;
+	std::vector<std::pair<int, int>> horizon;
+	std::vector<int> orphans;
+	std::vector<int> search;
+	for (int next = 0; next < faces.size(); next++) {
+		if (!faces[next].alive || faces[next].outside.empty()) {
+			continue;
+		}
+		int i = faces[next].outside[0];
+		for (int candidate : faces[next].outside) {
+			if (faces[next].normal.dot(points[candidate]) > faces[next].normal.dot(points[i])) {
+				i = candidate;
+			}
+		}
+		//the faces it can see spread out from the one it is outside of. a sliver between two of them
+		//goes too, it cant be seen but it would be left hanging. so does a face the point is too close
+		//to the plane of to be seen if the face joining the point to their edge would fold back over it
+		visible_edges.clear();
+		orphans.clear();
+		faces[next].alive = false;
+		search.assign(1, next);
+		while (!search.empty()) {
+			Face& face = faces[search.back()];
+			search.pop_back();
+			for (auto [first, second] : { std::pair<int, int>(face.a, face.b), std::pair<int, int>(face.b, face.c), std::pair<int, int>(face.c, face.a) }) {
+				visible_edges.insert(static_cast<uint64_t>(first) << 32 | static_cast<uint32_t>(second));
+				int across = edge_faces[static_cast<uint64_t>(second) << 32 | static_cast<uint32_t>(first)];
+				Face& other = faces[across];
+				if (!other.alive) {
+					continue;
+				}
+				//the face joining it to the edge folds over other if other's far corner is in front of it, or
+				//on it and on the same side of the edge
+				Eigen::Vector3d edge = (points[second] - points[first]).normalized();
+				Eigen::Vector3d to_point = points[i] - points[first];
+				Eigen::Vector3d to_opposite = points[other.a + other.b + other.c - first - second] - points[first];
+				double in_front = edge.cross(to_point).normalized().dot(to_opposite);
+				bool folds = in_front > eps || (in_front > -eps && (to_point - edge.dot(to_point) * edge).dot(to_opposite - edge.dot(to_opposite) * edge) > 0);
+				if (other.normal.dot(points[i]) - other.offset > eps || other.normal.isZero() || folds) {
+					other.alive = false;
+					search.push_back(across);
+				}
+			}
+			orphans.insert(orphans.end(), face.outside.begin(), face.outside.end());
+			face.outside.clear();
+		}
+		horizon.clear();
+		for (uint64_t edge : visible_edges) {
+			int first = static_cast<int>(edge >> 32);
+			int second = static_cast<int>(edge & 0xffffffff);
+			if (!visible_edges.contains(static_cast<uint64_t>(second) << 32 | static_cast<uint32_t>(first))) {
+				horizon.emplace_back(first, second);
+			}
+		}
+		int first_new = static_cast<int>(faces.size());
+		for (auto [first, second] : horizon) {
+			addFace(first, second, i);
+		}
+		//the new faces are the likely ones, but an orphan can still be outside an old face too, which
+		//then has to be gone back to
+		int back_to = next;
+		for (int orphan : orphans) {
+			if (orphan != i && assign(orphan, first_new) < 0) {
+				int f = assign(orphan, 0);
+				if (f >= 0) {
+					back_to = std::min(back_to, f - 1);
+				}
+			}
+		}
+		next = back_to;
+	}
+
+	//only the points the faces use
+	std::vector<int> remap(points.size(), -1);
+	std::vector<Eigen::Vector3f> verts;
+	std::vector<std::tuple<int, int, int>> hull_faces;
+	auto use = [&](int i) {
+		if (remap[i] < 0) {
+			remap[i] = static_cast<int>(verts.size());
+			verts.push_back(input[i]);
+		}
+		return remap[i];
+	};
+	for (const Face& face : faces) {
+		if (face.alive) {
+			int a = use(face.a);
+			int b = use(face.b);
+			int c = use(face.c);
+			hull_faces.emplace_back(a, b, c);
+		}
+	}
+	return ConvexHull(std::move(verts), std::move(hull_faces));
+}
+
+//the part of polygon on the side of the plane at along axis that side points to
+static void clipPolygon(const std::vector<Eigen::Vector3f>& polygon, int axis, float at, float side, std::vector<Eigen::Vector3f>* clipped) {
+	clipped->clear();
+	for (int i = 0; i < polygon.size(); i++) {
+		const Eigen::Vector3f& from = polygon[i];
+		const Eigen::Vector3f& to = polygon[(i + 1) % polygon.size()];
+		float from_side = side * (from(axis) - at);
+		float to_side = side * (to(axis) - at);
+		if (from_side >= 0) {
+			clipped->push_back(from);
+		}
+		if ((from_side >= 0) != (to_side >= 0)) {
+			clipped->push_back(from + (to - from) * (from_side / (from_side - to_side)));
+		}
+	}
+}
+
+struct HullPiece {
+	std::vector<std::vector<Eigen::Vector3f>> polygons; //what is left of the mesh's faces inside the piece
+	ConvexHull hull;
+	float concavity; //furthest any point of the polygons is inside the hull
+	Eigen::AlignedBox3f box;
+};
+
+//fills in everything but the polygons
+static void shapePiece(HullPiece* piece) {
+	std::vector<Eigen::Vector3f> points;
+	piece->box.setEmpty();
+	for (const std::vector<Eigen::Vector3f>& polygon : piece->polygons) {
+		for (const Eigen::Vector3f& p : polygon) {
+			points.push_back(p);
+			piece->box.extend(p);
+		}
+	}
+	//neighbouring faces each bring their own copy of the verts they share
+	std::sort(points.begin(), points.end(), [](const Eigen::Vector3f& first, const Eigen::Vector3f& second) {
+		return std::lexicographical_compare(first.data(), first.data() + 3, second.data(), second.data() + 3);
+	});
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+	piece->hull = ConvexHull::around(points);
+	piece->concavity = 0;
+	const ConvexHull& hull = piece->hull;
+	std::vector<std::pair<Eigen::Vector3f, float>> planes;
+	for (const auto& [a, b, c] : hull.getFaces()) {
+		Eigen::Vector3f normal = (hull.getVerts()[b] - hull.getVerts()[a]).cross(hull.getVerts()[c] - hull.getVerts()[a]).normalized();
+		if (normal.allFinite()) {
+			planes.emplace_back(normal, normal.dot(hull.getVerts()[a]));
+		}
+	}
+	if (planes.empty()) {
+		return;
+	}
+	for (const Eigen::Vector3f& p : points) {
+		float depth = std::numeric_limits<float>::max();
+		for (const auto& [normal, offset] : planes) {
+			depth = std::min(depth, offset - normal.dot(p));
+		}
+		piece->concavity = std::max(piece->concavity, depth);
+	}
+}
+
+//a closed surface cut by a plane, each side's faces with the cut through them still hold that side of
+//the inside between their hulls, as the cap over the cut is inside the hull of its rim
+static void splitPiece(const HullPiece& piece, int axis, float at, HullPiece* below, HullPiece* above) {
+	below->polygons.clear();
+	above->polygons.clear();
+	std::vector<Eigen::Vector3f> clipped;
+	for (const std::vector<Eigen::Vector3f>& polygon : piece.polygons) {
+		clipPolygon(polygon, axis, at, -1, &clipped);
+		if (clipped.size() >= 3) {
+			below->polygons.push_back(clipped);
+		}
+		clipPolygon(polygon, axis, at, 1, &clipped);
+		if (clipped.size() >= 3) {
+			above->polygons.push_back(clipped);
+		}
+	}
+	shapePiece(below);
+	shapePiece(above);
+}
+
+std::vector<ConvexHull> ConvexHull::decompose(const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& faces, float tolerance, int max_pieces) {
+	std::vector<HullPiece> pieces(1);
+	for (const auto& [a, b, c] : faces) {
+		pieces[0].polygons.push_back({ verts[a], verts[b], verts[c] });
+	}
+	shapePiece(&pieces[0]);
+
+	while (pieces.size() < max_pieces) {
+		auto worst = std::max_element(pieces.begin(), pieces.end(), [](const HullPiece& first, const HullPiece& second) { return first.concavity < second.concavity; });
+		if (worst->concavity <= tolerance) {
+			break;
+		}
+		//a quarter, half and three quarters along each axis, whichever leaves the worse half best
+		HullPiece best_below;
+		HullPiece best_above;
+		float best_score = std::numeric_limits<float>::max();
+		HullPiece below;
+		HullPiece above;
+		for (int axis = 0; axis < 3; axis++) {
+			for (float fraction : { .25f, .5f, .75f }) {
+				float at = worst->box.min()(axis) + fraction * worst->box.sizes()(axis);
+				splitPiece(*worst, axis, at, &below, &above);
+				if (below.polygons.empty() || above.polygons.empty()) {
+					continue;
+				}
+				float score = std::max(below.concavity, above.concavity) + 1e-3f * (below.concavity + above.concavity);
+				if (score < best_score) {
+					best_score = score;
+					std::swap(best_below, below);
+					std::swap(best_above, above);
+				}
+			}
+		}
+		if (best_score == std::numeric_limits<float>::max()) {
+			break;
+		}
+		*worst = std::move(best_below);
+		pieces.push_back(std::move(best_above));
+	}
+
+	std::vector<ConvexHull> hulls;
+	for (HullPiece& piece : pieces) {
+		hulls.push_back(std::move(piece.hull));
+	}
+	return hulls;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef PUPPET_CONVEX_HULL
+#define PUPPET_CONVEX_HULL
+
+#include <Eigen/Dense>
+#include <vector>
+#include <tuple>
+
+//a convex polyhedron as its verts and the triangles of its surface, wound to face out. each vert knows
+//the verts it shares an edge with, so support can climb from where the last search ended rather than
+//look at every vert. a hull with no faces is flat or too small to have any, support then looks at
+//every vert
+class ConvexHull {
+	std::vector<Eigen::Vector3f> verts_;
+	std::vector<std::tuple<int, int, int>> faces_;
+	std::vector<int> neighbor_start_; //vert i's neighbours are neighbors_[neighbor_start_[i]] up to neighbor_start_[i + 1]
+	std::vector<int> neighbors_;
+
+	void buildNeighbors();
+
+public:
+	ConvexHull() {}
+
+	//verts and faces that already make a convex hull, like one read back from a cooked mesh
+	ConvexHull(std::vector<Eigen::Vector3f> verts, std::vector<std::tuple<int, int, int>> faces);
+
+	//the hull around points, only the points on it are kept. points all on a plane give a hull with
+	//no faces
+	static ConvexHull around(const std::vector<Eigen::Vector3f>& points);
+
+	//convex pieces whose hulls between them hold everything inside the closed mesh verts and faces
+	//make. the mesh is cut in two along axis aligned planes, the piece furthest from convex first,
+	//until every piece is within tolerance of its hull or there are max_pieces. slow, for cooking
+	static std::vector<ConvexHull> decompose(const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& faces, float tolerance, int max_pieces);
+
+	//the vert furthest along dir. hint is a vert to start from, -1 for none, and is set to the answer
+	int support(const Eigen::Vector3f& dir, int* hint) const {
+		int best = hint != nullptr && *hint >= 0 && *hint < verts_.size() ? *hint : 0;
+		float best_along = verts_[best].dot(dir);
+		if (neighbors_.empty()) {
+			for (int i = 0; i < verts_.size(); i++) {
+				float along = verts_[i].dot(dir);
+				if (along > best_along) {
+					best = i;
+					best_along = along;
+				}
+			}
+		} else {
+			//on a convex hull a vert with no neighbour further along is the furthest of all
+			for (int last = -1; last != best;) {
+				last = best;
+				for (int n = neighbor_start_[last]; n < neighbor_start_[last + 1]; n++) {
+					float along = verts_[neighbors_[n]].dot(dir);
+					if (along > best_along) {
+						best = neighbors_[n];
+						best_along = along;
+					}
+				}
+			}
+		}
+		if (hint != nullptr) {
+			*hint = best;
+		}
+		return best;
+	}
+
+	const std::vector<Eigen::Vector3f>& getVerts() const {
+		return verts_;
+	}
+
+	const std::vector<std::tuple<int, int, int>>& getFaces() const {
+		return faces_;
+	}
+};
+
+#endif
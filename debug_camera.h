@@ -137,6 +137,15 @@ public:
 		return hitbox_;
 	}
 
+	//the camera flies through the level, it only runs into the player and npcs
+	int addHitboxTo(CollisionWorld& world) {
+		return world.add(this, hitbox_, CollisionWorld::camera_layer, CollisionWorld::player_layer | CollisionWorld::npc_layer);
+	}
+
+	void removeHitboxFrom(CollisionWorld& world, int id) {
+		world.remove(id);
+	}
+
 	const std::vector<bool>& getCollisionInfo() const {//this is a terrible way of doing this
 		return collision_info;
 	}
@@ -0,0 +1,172 @@
+#pragma once
+
+#ifndef PUPPET_DEBUG_DRAW
+#define PUPPET_DEBUG_DRAW
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <vector>
+#include <algorithm>
+
+#include "surface.hpp"
+#include "gl_state.hpp"
+
+//immediate mode debug drawing. line, triangle and the mesh helpers append world space vertices with
+//a color to per frame arrays, flush() uploads all of them into one streaming buffer and draws every
+//line with one call and every triangle with another, then starts the next frame empty. nothing is
+//allocated per call once the arrays have grown to a frame's worth.
+//flush draws with whatever program is bound, it needs a vec3 position at location 0 and a vec4 color
+//at location 1, and the vertices are already in world space
+class DebugDraw {
+public:
+	struct Stats {
+		size_t n_lines;
+		size_t n_triangles;
+		size_t n_draw_calls;
+	};
+
+private:
+	static constexpr size_t floats_per_vert_ = 7; //x,y,z,r,g,b,a
+
+	std::vector<float> lines_;
+	std::vector<float> triangles_;
+	unsigned int VAO_;
+	unsigned int VBO_;
+	size_t vbo_capacity_; //in floats
+	Stats stats_;
+
+	static void writeVert(std::vector<float>& out, const Eigen::Vector3f& p, const Eigen::Vector4f& color) {
+		out.insert(out.end(), { p(0), p(1), p(2), color(0), color(1), color(2), color(3) });
+	}
+
+	static Eigen::Vector3f transform(const Eigen::Matrix4f& position, const Eigen::Vector3f& p) {
+		return position.block<3, 3>(0, 0) * p + position.block<3, 1>(0, 3);
+	}
+
+public:
+	DebugDraw(size_t initial_vert_capacity = 4096) :
+		vbo_capacity_(initial_vert_capacity * floats_per_vert_),
+		stats_{ 0, 0, 0 } {
+		glGenVertexArrays(1, &VAO_);
+		glGenBuffers(1, &VBO_);
+
+		GLState::bindVertexArray(VAO_);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vbo_capacity_, NULL, GL_STREAM_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, floats_per_vert_ * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, floats_per_vert_ * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+	}
+
+	~DebugDraw() {
+		GLState::deleteBuffers(1, &VBO_);
+		GLState::deleteVertexArrays(1, &VAO_);
+	}
+
+	DebugDraw(const DebugDraw&) = delete;
+	DebugDraw& operator=(const DebugDraw&) = delete;
+
+	void line(const Eigen::Vector3f& a, const Eigen::Vector3f& b, const Eigen::Vector4f& color) {
+		writeVert(lines_, a, color);
+		writeVert(lines_, b, color);
+	}
+
+	void triangle(const Eigen::Vector3f& a, const Eigen::Vector3f& b, const Eigen::Vector3f& c, const Eigen::Vector4f& color) {
+		writeVert(triangles_, a, color);
+		writeVert(triangles_, b, color);
+		writeVert(triangles_, c, color);
+	}
+
+	//the mesh's edges as lines, or its faces as triangles if filled. a filled mesh without faces
+	//falls back to its edges
+	void wireMesh(const MeshSurface& mesh, const Eigen::Matrix4f& position, const Eigen::Vector4f& color, bool filled = false) {
+		const std::vector<Eigen::Vector3f>& verts = mesh.getVerts();
+		if (filled && !mesh.getFaces().empty()) {
+			for (const auto& [a, b, c] : mesh.getFaces()) {
+				triangle(transform(position, verts[a]), transform(position, verts[b]), transform(position, verts[c]), color);
+			}
+			return;
+		}
+		for (const auto& [a, b] : mesh.getEdges()) {
+			line(transform(position, verts[a]), transform(position, verts[b]), color);
+		}
+	}
+
+	//every edge's colors in edge_colors, one per edge, e.g. to show which edges collided
+	void wireMesh(const MeshSurface& mesh, const Eigen::Matrix4f& position, const std::vector<Eigen::Vector4f>& edge_colors) {
+		const std::vector<Eigen::Vector3f>& verts = mesh.getVerts();
+		const std::vector<std::pair<int, int>>& edges = mesh.getEdges();
+		for (size_t i = 0; i < edges.size() && i < edge_colors.size(); i++) {
+			line(transform(position, verts[edges[i].first]), transform(position, verts[edges[i].second]), edge_colors[i]);
+		}
+	}
+
+	//the surface each edge sweeps moving back by dG, in the mesh's own frame, before position is
+	//applied. what a collision check against a moving mesh tests against
+	void sweptMesh(const MeshSurface& mesh, const Eigen::Matrix4f& position, const Eigen::Matrix4f& dG, const Eigen::Vector4f& color, bool filled = false) {
+		const std::vector<Eigen::Vector3f>& verts = mesh.getVerts();
+		Eigen::Matrix4f moved = position * dG.inverse();
+		for (const auto& [a, b] : mesh.getEdges()) {
+			Eigen::Vector3f a0 = transform(position, verts[a]);
+			Eigen::Vector3f b0 = transform(position, verts[b]);
+			Eigen::Vector3f a1 = transform(moved, verts[a]);
+			Eigen::Vector3f b1 = transform(moved, verts[b]);
+			if (filled) {
+				triangle(a0, b0, b1, color);
+				triangle(a0, a1, b1, color);
+			} else {
+				line(a0, b0, color);
+				line(a1, b1, color);
+				line(a0, a1, color);
+				line(b0, b1, color);
+			}
+		}
+	}
+
+	//draws everything added since the last flush with the bound program and clears it
+	void flush() {
+		stats_.n_lines = lines_.size() / (2 * floats_per_vert_);
+		stats_.n_triangles = triangles_.size() / (3 * floats_per_vert_);
+		stats_.n_draw_calls = 0;
+		size_t total_floats = lines_.size() + triangles_.size();
+		if (total_floats == 0) {
+			return;
+		}
+
+		GLState::bindVertexArray(VAO_);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_);
+		vbo_capacity_ = std::max<size_t>(vbo_capacity_, 1);
+		while (vbo_capacity_ < total_floats) {
+			vbo_capacity_ *= 2;
+		}
+		//orphan the old storage so the driver doesnt stall on last frames draw
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vbo_capacity_, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * lines_.size(), lines_.data());
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * lines_.size(), sizeof(float) * triangles_.size(), triangles_.data());
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+
+		if (!lines_.empty()) {
+			glDrawArrays(GL_LINES, 0, lines_.size() / floats_per_vert_);
+			stats_.n_draw_calls++;
+		}
+		if (!triangles_.empty()) {
+			GLState::polygonMode(GL_FILL);
+			glDrawArrays(GL_TRIANGLES, lines_.size() / floats_per_vert_, triangles_.size() / floats_per_vert_);
+			stats_.n_draw_calls++;
+		}
+
+		//capacity is kept, so a steady amount of debug drawing doesnt allocate
+		lines_.clear();
+		triangles_.clear();
+	}
+
+	//from the last flush
+	const Stats& getStats() const {
+		return stats_;
+	}
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include "motion_constraint.h"
 #include "UI.h"
 #include "zdata.hpp"
+#include "Default3d.h"
 
 class DebugMenu : public GameObject {
 
@@ -18,6 +19,9 @@ class DebugMenu : public GameObject {
 	//Button next_target_;
 	//Button prev_target_;
 	TextboxObject fps_tbox_;
+	//the stats under the fps get a box each, so a number changing only rebuilds its own box
+	TextboxObject ui_stats_tbox_;
+	TextboxObject stats_3d_tbox_;
 	TextGraphics& text_graphics_;
 	//Slider test_slider_;
 	Button reposition_target_;
@@ -30,8 +34,12 @@ class DebugMenu : public GameObject {
 
 	UIIterator<GameObject> target_iterator_;
 	GameObject* debug_target_;
-	//TextboxObject target_name_;
-	//TextboxObject target_dbg_info_;
+	//TextboxObject target_name_; the target and level names are shown by their iterators
+	//the targets getDebugInfo, only re-made when the target, the level or where the target is changes
+	const GameObject* shown_target_;
+	const Level* shown_level_; //getDebugInfo can read the current level, like the debug camera's does
+	TextBinding<Eigen::Matrix4f> target_info_;
+	TextboxObject target_info_tbox_;
 
 	UIIterator<Level> level_iterator_;
 	std::unordered_set<Level*> all_levels_;
@@ -42,6 +50,7 @@ class DebugMenu : public GameObject {
 	float avg_fps_;
 	float time_since_last_fps_avg_;
 	int frame_counter_;
+	double update_ms_; //cpu time of the last update, widgets included
 
 	GLFWwindow* window_;
 	Default2d& graphics_2d_;
@@ -55,6 +64,9 @@ class DebugMenu : public GameObject {
 	Scene* debug_scene_;
 	const Camera* game_cam_;
 
+	Default3d* watched_3d_; //overdraw/pass stats get shown with the fps if this is set
+	bool sort_3d_;
+
 	//Button show_hitboxes_;
 
 	void onKeyPress(int key) override {
@@ -67,6 +79,11 @@ class DebugMenu : public GameObject {
 				debug_scene_->camera = &debug_camera_;
 			}
 		}
+		if (key == GLFW_KEY_F4 && watched_3d_ != nullptr) {
+			//flip draw sorting so the overdraw numbers can be compared
+			sort_3d_ = !sort_3d_;
+			watched_3d_->setSortDraws(sort_3d_);
+		}
 	}
 
 	void onKeyDown(int key) override {
@@ -251,10 +268,16 @@ public:
 		cam_clamp_(Eigen::Matrix4f::Identity()),
 		window_(window),
 		debug_target_(nullptr),
+		shown_target_(nullptr),
+		shown_level_(nullptr),
+		target_info_(.0005f), //getDebugInfo shows 3 digits
+		update_ms_(0),
 		target_iterator_(.3,.6),
 		level_iterator_(.3,.6),
 		debug_camera_(.1, 5000, 120, 1600, 800, 1.0,true),
-		edit_pane_(1.,1.,.1){
+		edit_pane_(1.,1.,.1),
+		watched_3d_(nullptr),
+		sort_3d_(true){
 		
 		/*
 		test_button_.activateMouseInput(window);
@@ -294,6 +317,24 @@ public:
 		text_graphics.add(fps_tbox_);//for some reason removing this and beginning with the menu hidden causes an error
 		fps_tbox_.clampTo(this);
 
+		//half size text so no line wraps, ui stats are 4 lines and 3d stats below them 6
+		float small_line = .5f * char_info(' ').unscaled_height;
+		float stats_top = .94f - 2 * fps_tbox_.box_height;
+		for (TextboxObject* tbox : { &ui_stats_tbox_, &stats_3d_tbox_, &target_info_tbox_ }) {
+			addDependent(tbox);
+			tbox->text = "";
+			tbox->font_size = .5f;
+			tbox->box_height = small_line;
+			tbox->box_width = .9f;
+			text_graphics.add(*tbox);
+		}
+		ui_stats_tbox_.moveTo(.08f, stats_top, 0);
+		stats_3d_tbox_.moveTo(.08f, stats_top - 4 * small_line, 0);
+		target_info_tbox_.moveTo(-.95f, .35f, 0);
+		ui_stats_tbox_.clampTo(this);
+		stats_3d_tbox_.clampTo(this);
+		target_info_tbox_.clampTo(this);
+
 
 		/*
 		test_slider_.load(window, graphics, text_graphics);
@@ -394,6 +435,7 @@ public:
 	}
 
 	void update(GLFWwindow* window) override {
+		std::chrono::steady_clock::time_point update_start = std::chrono::steady_clock::now();
 		GameObject::update(window);
 
 		frame_counter_++;
@@ -402,9 +444,23 @@ public:
 			avg_fps_ = static_cast<float>(frame_counter_) / time_since_last_fps_avg_;
 			time_since_last_fps_avg_ = 0.;
 			frame_counter_ = 0;
-			text_graphics_.unload(fps_tbox_);
-			fps_tbox_.text = std::to_string(avg_fps_);
-			text_graphics_.add(fps_tbox_);
+			const Default2dStats& ui_stats = graphics_2d_.getStats();
+			//text graphics only rebuilds a box whose text is different from last time
+			fps_tbox_.text = std::format("{:.1f}", avg_fps_);
+			const GLState::Stats& gl_stats = GLState::getLastFrameStats();
+			ui_stats_tbox_.text = std::format("ui {} quads {} draws {:.3f}ms\ngl {} issued {} elided", ui_stats.n_quads, ui_stats.n_draw_calls, ui_stats.cpu_ms, gl_stats.issued, gl_stats.elided);
+			ui_stats_tbox_.text += std::format("\nmenu {:.3f}ms\ntext {} glyphs {} rebuilt{}", update_ms_, text_graphics_.getNGlyphs(), text_graphics_.getNRebuilt(), text_graphics_.wasUploaded() ? " uploaded" : "");
+			if (watched_3d_ != nullptr) {
+				const Default3dStats& stats_3d = watched_3d_->getStats();
+				int width, height;
+				glfwGetWindowSize(window_, &width, &height);
+				float overdraw = static_cast<float>(stats_3d.samples_passed) / std::max(width * height, 1);
+				stats_3d_tbox_.text = std::format("3d {} opaque {} transparent {}\nshaded {:.2f}x screen", stats_3d.n_opaque, stats_3d.n_transparent, sort_3d_ ? "sorted" : "unsorted", overdraw);
+				stats_3d_tbox_.text += std::format("\nstatic {} drawn {} culled {} multidraws", stats_3d.n_static_drawn, stats_3d.n_static_culled, stats_3d.n_multi_draws);
+				stats_3d_tbox_.text += std::format("\ntris {} of {} full, {} impostored", stats_3d.n_triangles, stats_3d.n_triangles_full, stats_3d.n_impostored);
+				const TextureStreamer::Stats& tex_stats = watched_3d_->getTextureStats();
+				stats_3d_tbox_.text += std::format("\ntex {}KB resident {}KB requested\nof {}KB, {} up {} evicted", tex_stats.resident_bytes >> 10, tex_stats.requested_bytes >> 10, tex_stats.budget_bytes >> 10, tex_stats.n_uploads, tex_stats.n_evictions);
+			}
 		}
 
 		//test_slider_.update(window);
@@ -413,49 +469,31 @@ public:
 	//	test_button_.update(window);
 
 		if (!isHidden()) {
-			std::string dbg_info;
-			std::string name_text;
-			if (debug_target_ == nullptr) {
-				dbg_info = "";
-				name_text = "no Target";
-			}else {
-				dbg_info = debug_target_->getDebugInfo();
-				name_text = debug_target_->getName();
+			if (debug_target_ != shown_target_ || Level::getCurrentLevel() != shown_level_) {
+				shown_target_ = debug_target_;
+				shown_level_ = Level::getCurrentLevel();
+				target_info_.invalidate();
+				if (debug_target_ == nullptr) {
+					target_info_tbox_.text = "";
+				}
 			}
-			/*if (dbg_info != target_dbg_info_.text) {
-				text_graphics_.unload(target_dbg_info_);
-				target_dbg_info_.text = dbg_info;
-				text_graphics_.add(target_dbg_info_);
-			}*/
-			if (name_text == InternalObject::no_name) {
-				name_text = "unnamed";
+			if (debug_target_ != nullptr && target_info_.update(debug_target_->getPosition(), [this](const Eigen::Matrix4f&) { return debug_target_->getDebugInfo(); })) {
+				target_info_tbox_.text = target_info_.getText();
 			}
-			/*
-			if (name_text != target_name_.text) {
-				text_graphics_.unload(target_name_);
-				target_name_.text = name_text;
-				text_graphics_.add(target_name_);
-			}*/
-			std::string level_name;
-			if (Level::getCurrentLevel() == nullptr) {
-				level_name = "base room";
-			} else {
-				level_name = Level::getCurrentLevel()->getName();
-			}
-			/*
-			if (level_name != level_display_.text) {
-				text_graphics_.unload(level_display_);
-				level_display_.text = level_name;
-				text_graphics_.add(level_display_);
-			}*/
-
 		}
+		update_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - update_start).count();
 	}
 
 	void setDebugTarget(GameObject* target) {
 		debug_target_ = target;
 	}
 
+	void watchRenderer(Default3d* renderer) {
+		watched_3d_ = renderer;
+		watched_3d_->setMeasureOverdraw(true);
+		watched_3d_->setSortDraws(sort_3d_);
+	}
+
 	void setDebugScene(Scene* scene) {
 		debug_scene_ = scene;
 		game_cam_ = scene->camera;
@@ -0,0 +1,162 @@
+#pragma once
+
+#ifndef PUPPET_DRAW_ORDER
+#define PUPPET_DRAW_ORDER
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <vector>
+#include <algorithm>
+
+#include "Model.h"
+
+//collects a frames draws for a 3d renderer and splits them into an opaque pass (front to back, so
+//early z rejects as much as possible) and a transparent pass (back to front, so blending is right).
+//entries point into the renderers cache so nothing gets copied per frame
+template <class Object, class Cache>
+class DrawOrder {
+public:
+	struct Entry {
+		const Object* obj;
+		const Cache* cache;
+		float depth;
+	};
+
+private:
+	std::vector<Entry> opaque_;
+	std::vector<Entry> transparent_;
+
+public:
+	void clear() {
+		opaque_.clear();
+		transparent_.clear();
+	}
+
+	//opaques are keyed on the nearest point of the bounds, transparents on the center
+	void push(const Object& obj, const Cache& cache, const Eigen::Matrix4f& camera, bool transparent) {
+		float center_depth, radius;
+		boundsDepth(camera, obj.getPosition(), *obj.getModel(), center_depth, radius);
+		if (transparent) {
+			transparent_.push_back(Entry{ &obj, &cache, center_depth });
+		} else {
+			opaque_.push_back(Entry{ &obj, &cache, center_depth - radius });
+		}
+	}
+
+	void sort() {
+		std::sort(opaque_.begin(), opaque_.end(), [](const Entry& a, const Entry& b) {return a.depth < b.depth; });
+		std::sort(transparent_.begin(), transparent_.end(), [](const Entry& a, const Entry& b) {return a.depth > b.depth; });
+	}
+
+	const std::vector<Entry>& getOpaque() const {
+		return opaque_;
+	}
+
+	const std::vector<Entry>& getTransparent() const {
+		return transparent_;
+	}
+
+	//distance in front of the camera (camera looks down -z) of the model bounding box center, plus a
+	//bounding sphere radius so callers can get the near/far extent
+	static void boundsDepth(const Eigen::Matrix4f& camera, const Eigen::Matrix4f& position, const Model& model, float& center_depth, float& radius) {
+		Eigen::Vector4f center;
+		center << model.getBoxCenter(), 1;
+		center_depth = -(camera * position * center)(2);
+		float scale = position(Eigen::seq(0, 2), Eigen::seq(0, 2)).colwise().norm().maxCoeff();
+		radius = .5f * model.getBoundingBox().norm() * scale;
+	}
+
+};
+
+//true if the sphere is at least partly inside the frustum of view_proj (perspective * camera). the
+//planes come straight from the rows of the matrix, they arent normalized so the radius is scaled
+//by each planes normal length instead
+inline bool sphereInFrustum(const Eigen::Matrix4f& view_proj, const Eigen::Vector3f& center, float radius) {
+	const Eigen::Vector4f p = center.homogeneous();
+	for (int axis = 0; axis < 3; axis++) {
+		for (float sign : {1.f, -1.f}) {
+			Eigen::Vector4f plane = view_proj.row(3).transpose() + sign * view_proj.row(axis).transpose();
+			if (plane.dot(p) < -radius * plane.head<3>().norm()) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+//lod i is used once the bounding sphere covers less than lod_screen_sizes_[i - 1] of the screen
+//height. a level only changes after the size has gone past its threshold by the hysteresis band,
+//so something sitting right on a threshold doesnt flicker between two levels
+class LodSelector {
+	static constexpr float lod_screen_sizes_[] = { .5f, .25f, .1f };
+	static constexpr float hysteresis_ = .15f;
+
+public:
+	static float screenSize(const Eigen::Matrix4f& perspective, float center_depth, float radius) {
+		//perspective(1, 1) is cot(fov / 2), so this is the diameter over the visible height at that depth
+		return radius * perspective(1, 1) / std::max(center_depth, radius);
+	}
+
+	static int select(float screen_size, int current, int n_lods) {
+		int coarser = 0;
+		int finer = 0;
+		for (float threshold : lod_screen_sizes_) {
+			coarser += screen_size < threshold * (1 - hysteresis_);
+			finer += screen_size < threshold * (1 + hysteresis_);
+		}
+		if (coarser > current) {
+			return std::min(coarser, n_lods - 1);
+		}
+		if (finer < current) {
+			return finer;
+		}
+		return std::min(current, n_lods - 1);
+	}
+};
+
+//counts fragments that pass the depth test between begin and end. with no discard in the shader
+//this is the number of fragments that got shaded, so comparing it against the pixel count gives
+//the overdraw. double buffered so reading last frames result never stalls
+class SamplesPassedCounter {
+	unsigned int queries_[2];
+	int current_;
+	bool pending_[2];
+	unsigned int last_result_;
+
+public:
+	SamplesPassedCounter() :current_(0), pending_{ false, false }, last_result_(0) {
+		glGenQueries(2, queries_);
+	}
+
+	~SamplesPassedCounter() {
+		glDeleteQueries(2, queries_);
+	}
+
+	SamplesPassedCounter(const SamplesPassedCounter&) = delete;
+	SamplesPassedCounter& operator=(const SamplesPassedCounter&) = delete;
+
+	void begin() {
+		glBeginQuery(GL_SAMPLES_PASSED, queries_[current_]);
+	}
+
+	void end() {
+		glEndQuery(GL_SAMPLES_PASSED);
+		pending_[current_] = true;
+		current_ = 1 - current_;
+		//the other query was issued last frame, pick it up if the gpu is done with it
+		if (pending_[current_]) {
+			int available = 0;
+			glGetQueryObjectiv(queries_[current_], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				glGetQueryObjectuiv(queries_[current_], GL_QUERY_RESULT, &last_result_);
+				pending_[current_] = false;
+			}
+		}
+	}
+
+	unsigned int getLastResult() const {
+		return last_result_;
+	}
+};
+
+#endif
@@ -0,0 +1,293 @@
+#pragma once
+
+#ifndef PUPPET_FRAME_SCHEDULER
+#define PUPPET_FRAME_SCHEDULER
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <string>
+#include <algorithm>
+
+#include "gl_state.hpp"
+
+//gpu time spent between begin and end. double buffered like SamplesPassedCounter so reading the
+//result from the frame before never stalls, it is just one frame late
+class GpuTimer {
+	unsigned int queries_[2];
+	int current_;
+	bool pending_[2];
+	double last_ms_;
+
+public:
+	GpuTimer() :current_(0), pending_{ false, false }, last_ms_(0) {
+		glGenQueries(2, queries_);
+	}
+
+	~GpuTimer() {
+		glDeleteQueries(2, queries_);
+	}
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	void begin() {
+		glBeginQuery(GL_TIME_ELAPSED, queries_[current_]);
+	}
+
+	void end() {
+		glEndQuery(GL_TIME_ELAPSED);
+		pending_[current_] = true;
+		current_ = 1 - current_;
+		if (pending_[current_]) {
+			int available = 0;
+			glGetQueryObjectiv(queries_[current_], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 ns = 0;
+				glGetQueryObjectui64v(queries_[current_], GL_QUERY_RESULT, &ns);
+				last_ms_ = ns * 1e-6;
+				pending_[current_] = false;
+			}
+		}
+	}
+
+	double getLastMs() const {
+		return last_ms_;
+	}
+};
+
+//paces the main loop and scales the resolution of the 3d pass to hold a target frame time.
+//	beginFrame				at the top of the loop
+//	beginScene/endScene		around the 3d passes, the ui goes after endScene at full resolution
+//	endFrame				right before glfwSwapBuffers, sleeps off whatever is left of the frame
+//the 3d pass renders into an fbo at render scale times the window size and is blitted up to the
+//window in endScene. the scale goes down when the gpu time of the 3d pass gets close to the target
+//and back up once there is room again, at most once every adjust_interval frames so it doesnt
+//oscillate. at a scale of 1 the fbo is skipped and the pass goes straight to the window.
+//while the window is unfocused or minimized the loop is throttled to idle_fps.
+//with a log file set, the timings of every frame where the scale changed or the loop went idle or
+//came back go to a csv for looking at offline, so the file only grows as fast as decisions are made
+class FrameScheduler {
+public:
+	struct Settings {
+		float frame_cap; //fps, 0 for uncapped
+		float idle_fps;
+		float target_ms; //gpu time of the 3d pass to hold
+		float min_scale;
+		float scale_step;
+		int adjust_interval; //frames
+		std::string log_fname; //empty for no log, main sets it from --frame-log <file>
+	};
+
+	static Settings defaultSettings() {
+		return Settings{ 144, 10, 1000.f / 60.f, .5f, .1f, 15, "" };
+	}
+
+private:
+	GLFWwindow* window_;
+	Settings settings_;
+
+	std::chrono::steady_clock::time_point frame_start_;
+	std::chrono::steady_clock::time_point last_frame_start_;
+	double frame_ms_; //start to start
+	double cpu_ms_; //start to endFrame, before sleeping
+	double sleep_ms_;
+	bool idle_;
+	bool was_idle_;
+
+	float render_scale_;
+	int frames_since_adjust_;
+	GpuTimer scene_timer_;
+
+	unsigned int fbo_;
+	unsigned int color_rb_;
+	unsigned int depth_rb_;
+	int fbo_width_, fbo_height_;
+	int window_width_, window_height_;
+	bool in_scene_fbo_;
+
+	std::ofstream log_;
+	size_t frame_index_;
+	size_t last_logged_frame_;
+
+	void resizeTarget(int width, int height) {
+		if (width == fbo_width_ && height == fbo_height_) {
+			return;
+		}
+		if (fbo_ == 0) {
+			glGenFramebuffers(1, &fbo_);
+			glGenRenderbuffers(1, &color_rb_);
+			glGenRenderbuffers(1, &depth_rb_);
+		}
+		glBindRenderbuffer(GL_RENDERBUFFER, color_rb_);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth_rb_);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, fbo_);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb_);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rb_);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+		fbo_width_ = width;
+		fbo_height_ = height;
+	}
+
+	//returns what was decided, for the log
+	const char* adjustScale() {
+		frames_since_adjust_++;
+		double gpu_ms = scene_timer_.getLastMs();
+		if (idle_ || frames_since_adjust_ < settings_.adjust_interval || gpu_ms <= 0) {
+			return "";
+		}
+		if (gpu_ms > .9 * settings_.target_ms && render_scale_ > settings_.min_scale) {
+			render_scale_ = std::max(settings_.min_scale, render_scale_ - settings_.scale_step);
+			frames_since_adjust_ = 0;
+			return "scale down";
+		}
+		//pixels go with the square of the scale, only step up if the bigger one would still fit
+		float up = std::min(1.f, render_scale_ + settings_.scale_step);
+		if (render_scale_ < 1 && gpu_ms * (up * up) / (render_scale_ * render_scale_) < .8 * settings_.target_ms) {
+			render_scale_ = up;
+			frames_since_adjust_ = 0;
+			return "scale up";
+		}
+		return "";
+	}
+
+public:
+	FrameScheduler(GLFWwindow* window, Settings settings = defaultSettings()) :
+		window_(window),
+		settings_(settings),
+		frame_start_(std::chrono::steady_clock::now()),
+		last_frame_start_(frame_start_),
+		frame_ms_(0),
+		cpu_ms_(0),
+		sleep_ms_(0),
+		idle_(false),
+		was_idle_(false),
+		render_scale_(1),
+		frames_since_adjust_(0),
+		fbo_(0),
+		color_rb_(0),
+		depth_rb_(0),
+		fbo_width_(0),
+		fbo_height_(0),
+		window_width_(0),
+		window_height_(0),
+		in_scene_fbo_(false),
+		frame_index_(0),
+		last_logged_frame_(0) {
+		if (!settings_.log_fname.empty()) {
+			log_.open(settings_.log_fname);
+			log_ << "frame,frames_since_last_row,frame_ms,cpu_ms,gpu_scene_ms,sleep_ms,render_scale,cap_fps,decision\n";
+		}
+	}
+
+	~FrameScheduler() {
+		if (fbo_ != 0) {
+			glDeleteFramebuffers(1, &fbo_);
+			glDeleteRenderbuffers(1, &color_rb_);
+			glDeleteRenderbuffers(1, &depth_rb_);
+		}
+	}
+
+	FrameScheduler(const FrameScheduler&) = delete;
+	FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+	void beginFrame() {
+		last_frame_start_ = frame_start_;
+		frame_start_ = std::chrono::steady_clock::now();
+		frame_ms_ = std::chrono::duration<double, std::milli>(frame_start_ - last_frame_start_).count();
+		idle_ = !glfwGetWindowAttrib(window_, GLFW_FOCUSED) || glfwGetWindowAttrib(window_, GLFW_ICONIFIED);
+	}
+
+	//binds the scaled target, sets the viewport to it and starts timing. clear after this
+	void beginScene() {
+		glfwGetFramebufferSize(window_, &window_width_, &window_height_);
+		in_scene_fbo_ = render_scale_ < 1 && window_width_ > 0 && window_height_ > 0;
+		if (in_scene_fbo_) {
+			resizeTarget(std::max(1, static_cast<int>(window_width_ * render_scale_)), std::max(1, static_cast<int>(window_height_ * render_scale_)));
+			GLState::bindFramebuffer(GL_FRAMEBUFFER, fbo_);
+			glViewport(0, 0, fbo_width_, fbo_height_);
+		}
+		scene_timer_.begin();
+	}
+
+	//upscales the 3d pass into the window and leaves the window bound at full resolution
+	void endScene() {
+		scene_timer_.end();
+		if (!in_scene_fbo_) {
+			return;
+		}
+		GLState::bindFramebuffer(GL_READ_FRAMEBUFFER, fbo_);
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, fbo_width_, fbo_height_, 0, 0, window_width_, window_height_, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, window_width_, window_height_);
+		//only the color comes across, the ui still depth tests against the window's own buffer
+		glClear(GL_DEPTH_BUFFER_BIT);
+		in_scene_fbo_ = false;
+	}
+
+	//adjusts the scale for the next frame and sleeps until the frame cap allows the next one
+	void endFrame() {
+		const char* decision = adjustScale();
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		cpu_ms_ = std::chrono::duration<double, std::milli>(now - frame_start_).count();
+		float cap = idle_ ? settings_.idle_fps : settings_.frame_cap;
+		sleep_ms_ = 0;
+		if (cap > 0) {
+			std::chrono::steady_clock::time_point deadline = frame_start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1. / cap));
+			//sleep most of it, the os wakes up late by up to a millisecond or so, then spin the rest
+			if (deadline - now > std::chrono::milliseconds(2)) {
+				std::this_thread::sleep_until(deadline - std::chrono::milliseconds(1));
+			}
+			while (std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::yield();
+			}
+			sleep_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+		}
+
+		if (idle_ != was_idle_) {
+			decision = idle_ ? "idle" : "active";
+			was_idle_ = idle_;
+		}
+		if (log_.is_open() && decision[0] != '\0') {
+			log_ << frame_index_ << ',' << frame_index_ - last_logged_frame_ << ',' << frame_ms_ << ',' << cpu_ms_ << ',' << scene_timer_.getLastMs() << ','
+				<< sleep_ms_ << ',' << render_scale_ << ',' << cap << ',' << decision << '\n';
+			last_logged_frame_ = frame_index_;
+		}
+		frame_index_++;
+	}
+
+	float getRenderScale() const {
+		return render_scale_;
+	}
+
+	//pins the scale, e.g. to 1 for screenshots. adjusting carries on from there
+	void setRenderScale(float scale) {
+		render_scale_ = std::clamp(scale, settings_.min_scale, 1.f);
+		frames_since_adjust_ = 0;
+	}
+
+	void setFrameCap(float fps) {
+		settings_.frame_cap = fps;
+	}
+
+	double getFrameMs() const {
+		return frame_ms_;
+	}
+
+	double getSceneGpuMs() const {
+		return scene_timer_.getLastMs();
+	}
+
+	bool isIdle() const {
+		return idle_;
+	}
+};
+
+#endif
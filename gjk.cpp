@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <unordered_set>
+#include <limits>
+#include <cmath>
+
+#include "gjk.hpp"
+
+//closer to the origin than this counts as touching it
+static constexpr float gjk_tolerance_sq = 1e-10f;
+//close enough once a new support point gets the distance no more than this much closer
+static constexpr float gjk_tolerance_rel = 1e-5f;
+//EPA stops once a new support point gets less than this further out
+static constexpr float epa_tolerance = 1e-5f;
+static constexpr int max_iterations = 64;
+
+//primary minus secondary, the hulls overlap when the origin is inside it and are as far apart as it is
+//from the origin. secondary is moved into primary's frame as its verts are needed
+struct MinkowskiDifference {
+	const ConvexHull& primary;
+	const ConvexHull& secondary;
+	Eigen::Matrix3f R;
+	Eigen::Vector3f p;
+	int primary_hint;
+	int secondary_hint;
+
+	Eigen::Vector3f secondaryVert(int i) const {
+		return R * secondary.getVerts()[i] + p;
+	}
+};
+
+//a point of the difference and the verts it came from
+struct SimplexPoint {
+	Eigen::Vector3f w;
+	int primary;
+	int secondary;
+};
+
+struct Simplex {
+	std::array<SimplexPoint, 4> points;
+	std::array<float, 4> weights; //of the closest point to the origin
+	int n;
+};
+
+static SimplexPoint support(MinkowskiDifference& m, const Eigen::Vector3f& dir) {
+	int a = m.primary.support(dir, &m.primary_hint);
+	int b = m.secondary.support(-(m.R.transpose() * dir), &m.secondary_hint);
+	return { m.primary.getVerts()[a] - m.secondaryVert(b), a, b };
+}
+
+static Eigen::Vector3f keep(Simplex* s, std::initializer_list<SimplexPoint> points, std::initializer_list<float> weights) {
+	s->n = 0;
+	auto weight = weights.begin();
+	Eigen::Vector3f closest = Eigen::Vector3f::Zero();
+	for (const SimplexPoint& point : points) {
+		s->weights[s->n] = *weight;
+		closest += *weight * point.w;
+		s->points[s->n++] = point;
+		weight++;
+	}
+	return closest;
+}
+
+//the closest point to the origin on the segment or triangle, s is cut down to the points it needs.
+//the triangle follows Ericson's Real-Time Collision Detection, going region by region
+static Eigen::Vector3f closestOnSegment(SimplexPoint A, SimplexPoint B, Simplex* s) {
+	Eigen::Vector3f ab = B.w - A.w;
+	float length_sq = ab.squaredNorm();
+	float t = length_sq > 0 ? -A.w.dot(ab) / length_sq : 0;
+	if (t <= 0) {
+		return keep(s, { A }, { 1 });
+	}
+	if (t >= 1) {
+		return keep(s, { B }, { 1 });
+	}
+	return keep(s, { A, B }, { 1 - t, t });
+}
+
+static Eigen::Vector3f closestOnTriangle(SimplexPoint A, SimplexPoint B, SimplexPoint C, Simplex* s) {
+	const Eigen::Vector3f& a = A.w;
+	const Eigen::Vector3f& b = B.w;
+	const Eigen::Vector3f& c = C.w;
+	Eigen::Vector3f ab = b - a;
+	Eigen::Vector3f ac = c - a;
+	float d1 = -ab.dot(a);
+	float d2 = -ac.dot(a);
+	if (d1 <= 0 && d2 <= 0) {
+		return keep(s, { A }, { 1 });
+	}
+	float d3 = -ab.dot(b);
+	float d4 = -ac.dot(b);
+	if (d3 >= 0 && d4 <= d3) {
+		return keep(s, { B }, { 1 });
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+		float v = d1 / (d1 - d3);
+		return keep(s, { A, B }, { 1 - v, v });
+	}
+	float d5 = -ab.dot(c);
+	float d6 = -ac.dot(c);
+	if (d6 >= 0 && d5 <= d6) {
+		return keep(s, { C }, { 1 });
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+		float w = d2 / (d2 - d6);
+		return keep(s, { A, C }, { 1 - w, w });
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+		float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		return keep(s, { B, C }, { 1 - w, w });
+	}
+	float sum = va + vb + vc;
+	if (sum <= 0) {
+		//flat, the closest of its sides
+		Simplex side;
+		Eigen::Vector3f best = closestOnSegment(A, B, s);
+		for (auto [first, second] : { std::pair<SimplexPoint, SimplexPoint>(B, C), std::pair<SimplexPoint, SimplexPoint>(A, C) }) {
+			Eigen::Vector3f closest = closestOnSegment(first, second, &side);
+			if (closest.squaredNorm() < best.squaredNorm()) {
+				best = closest;
+				*s = side;
+			}
+		}
+		return best;
+	}
+	float v = vb / sum;
+	float w = vc / sum;
+	return keep(s, { A, B, C }, { 1 - v - w, v, w });
+}
+
+//n is left at 4 if the origin is inside the tetrahedron
+static Eigen::Vector3f closestOnTetrahedron(Simplex* s) {
+	const std::array<SimplexPoint, 4> p = s->points;
+	static constexpr int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+	Eigen::Vector3f best = Eigen::Vector3f::Zero();
+	float best_sq = std::numeric_limits<float>::max();
+	Simplex face_simplex;
+	for (const auto& [a, b, c, opposite] : faces) {
+		Eigen::Vector3f normal = (p[b].w - p[a].w).cross(p[c].w - p[a].w);
+		//the origin and the opposite corner on different sides, or a flat tetrahedron
+		if (normal.dot(-p[a].w) * normal.dot(p[opposite].w - p[a].w) > 0) {
+			continue;
+		}
+		Eigen::Vector3f closest = closestOnTriangle(p[a], p[b], p[c], &face_simplex);
+		if (closest.squaredNorm() < best_sq) {
+			best_sq = closest.squaredNorm();
+			best = closest;
+			*s = face_simplex;
+		}
+	}
+	return best;
+}
+
+static Eigen::Vector3f closestOnSimplex(Simplex* s) {
+	switch (s->n) {
+	case 1:
+		s->weights[0] = 1;
+		return s->points[0].w;
+	case 2:
+		return closestOnSegment(s->points[0], s->points[1], s);
+	case 3:
+		return closestOnTriangle(s->points[0], s->points[1], s->points[2], s);
+	default:
+		return closestOnTetrahedron(s);
+	}
+}
+
+//true if the origin is in the difference, s is then a simplex around it or with it on its surface.
+//otherwise closest is the closest point to the origin. with margin at least 0 it stops as soon as the
+//distance is sure to be past it, setting past_margin
+static bool gjk(MinkowskiDifference& m, GJKCache* cache, float margin, Simplex* s, Eigen::Vector3f* closest, bool* past_margin) {
+	s->n = 0;
+	if (cache != nullptr) {
+		m.primary_hint = cache->primary_hint;
+		m.secondary_hint = cache->secondary_hint;
+		for (int i = 0; i < cache->n_points; i++) {
+			int a = cache->primary[i];
+			int b = cache->secondary[i];
+			if (a < 0 || a >= m.primary.getVerts().size() || b < 0 || b >= m.secondary.getVerts().size()) {
+				s->n = 0;
+				break;
+			}
+			s->points[s->n++] = { m.primary.getVerts()[a] - m.secondaryVert(b), a, b };
+		}
+	}
+	if (s->n == 0) {
+		s->points[0] = support(m, Eigen::Vector3f::UnitX());
+		s->n = 1;
+	}
+
+	*past_margin = false;
+	bool overlap = false;
+	Eigen::Vector3f v;
+	Simplex last = *s;
+	Eigen::Vector3f last_v;
+	for (int i = 0; i < max_iterations; i++) {
+		v = closestOnSimplex(s);
+		if (s->n == 4 || v.squaredNorm() <= gjk_tolerance_sq) {
+			overlap = true;
+			break;
+		}
+		//in floats it can end up going round the same few points without getting any closer, the last
+		//simplex is then as close as it gets
+		if (i > 0 && v.squaredNorm() >= last_v.squaredNorm()) {
+			*s = last;
+			v = last_v;
+			break;
+		}
+		last = *s;
+		last_v = v;
+		SimplexPoint w = support(m, -v);
+		float along = v.dot(w.w);
+		//everything in the difference is at least along/|v| from the origin
+		if (margin >= 0 && along > 0 && along * along > margin * margin * v.squaredNorm()) {
+			*past_margin = true;
+			break;
+		}
+		if (v.squaredNorm() - along <= gjk_tolerance_rel * v.squaredNorm()) {
+			break;
+		}
+		bool seen = false;
+		for (int j = 0; j < s->n; j++) {
+			seen = seen || (s->points[j].primary == w.primary && s->points[j].secondary == w.secondary);
+		}
+		if (seen || i + 1 == max_iterations) {
+			break;
+		}
+		s->points[s->n++] = w;
+	}
+
+	if (cache != nullptr) {
+		cache->n_points = s->n;
+		for (int i = 0; i < s->n; i++) {
+			cache->primary[i] = s->points[i].primary;
+			cache->secondary[i] = s->points[i].secondary;
+		}
+		cache->primary_hint = m.primary_hint;
+		cache->secondary_hint = m.secondary_hint;
+	}
+	*closest = v;
+	return overlap;
+}
+
+static Eigen::Vector3f barycentric(const Eigen::Vector3f& p, const Eigen::Vector3f& a, const Eigen::Vector3f& b, const Eigen::Vector3f& c) {
+	Eigen::Vector3f v0 = b - a;
+	Eigen::Vector3f v1 = c - a;
+	Eigen::Vector3f v2 = p - a;
+	float d00 = v0.dot(v0);
+	float d01 = v0.dot(v1);
+	float d11 = v1.dot(v1);
+	float d20 = v2.dot(v0);
+	float d21 = v2.dot(v1);
+	float denom = d00 * d11 - d01 * d01;
+	if (denom <= 0) {
+		return Eigen::Vector3f(1, 0, 0);
+	}
+	float v = (d11 * d20 - d01 * d21) / denom;
+	float w = (d00 * d21 - d01 * d20) / denom;
+	return Eigen::Vector3f(1 - v - w, v, w);
+}
+
+//grows the simplex GJK finished on into a polytope around the origin until its face closest to the
+//origin is on the surface of the difference, that face's distance is the depth
+static void epa(MinkowskiDifference& m, const Simplex& s, ConvexContact* contact) {
+	std::vector<SimplexPoint> points(s.points.begin(), s.points.begin() + s.n);
+	Eigen::AlignedBox3f box;
+	for (const Eigen::Vector3f& v : m.primary.getVerts()) {
+		box.extend(v);
+	}
+	const float eps = 1e-6f * std::max(box.sizes().maxCoeff(), 1e-3f);
+
+	//GJK can stop on a point, a segment or a triangle with the origin on it, it needs to be a tetrahedron
+	if (points.size() == 1) {
+		for (int axis = 0; axis < 6; axis++) {
+			SimplexPoint w = support(m, (axis % 2 == 0 ? 1.f : -1.f) * Eigen::Vector3f::Unit(axis / 2));
+			if ((w.w - points[0].w).norm() > eps) {
+				points.push_back(w);
+				break;
+			}
+		}
+	}
+	if (points.size() == 2) {
+		Eigen::Vector3f line = (points[1].w - points[0].w).normalized();
+		int smallest;
+		line.cwiseAbs().minCoeff(&smallest);
+		Eigen::Vector3f across = line.cross(Eigen::Vector3f::Unit(smallest)).normalized();
+		for (int k = 0; k < 6; k++) {
+			float angle = k * 3.14159265f / 3;
+			SimplexPoint w = support(m, std::cos(angle) * across + std::sin(angle) * line.cross(across));
+			if ((w.w - points[0].w).cross(line).norm() > eps) {
+				points.push_back(w);
+				break;
+			}
+		}
+	}
+	if (points.size() == 3) {
+		Eigen::Vector3f normal = (points[1].w - points[0].w).cross(points[2].w - points[0].w).normalized();
+		for (Eigen::Vector3f dir : { normal, Eigen::Vector3f(-normal) }) {
+			SimplexPoint w = support(m, dir);
+			if (std::abs(normal.dot(w.w - points[0].w)) > eps) {
+				points.push_back(w);
+				break;
+			}
+		}
+	}
+	contact->overlap = true;
+	contact->distance = 0;
+	if (points.size() < 4) {
+		//flat hulls lying in the same plane, there is no depth to find
+		contact->depth = 0;
+		contact->normal = Eigen::Vector3f::UnitY();
+		contact->primary_point = m.primary.getVerts()[points[0].primary];
+		contact->secondary_point = m.secondaryVert(points[0].secondary);
+		return;
+	}
+
+	struct Face {
+		int a, b, c;
+		Eigen::Vector3f normal;
+		float distance;
+		bool alive;
+	};
+	std::vector<Face> faces;
+	auto addFace = [&](int a, int b, int c) {
+		Eigen::Vector3f normal = (points[b].w - points[a].w).cross(points[c].w - points[a].w);
+		float length = normal.norm();
+		if (length <= 0) {
+			//a sliver, never the closest
+			faces.push_back(Face{ a, b, c, Eigen::Vector3f::Zero(), std::numeric_limits<float>::max(), true });
+			return;
+		}
+		normal /= length;
+		faces.push_back(Face{ a, b, c, normal, normal.dot(points[a].w), true });
+	};
+	for (auto [a, b, c, opposite] : { std::array<int, 4>{ 0, 1, 2, 3 }, std::array<int, 4>{ 0, 1, 3, 2 }, std::array<int, 4>{ 0, 2, 3, 1 }, std::array<int, 4>{ 1, 2, 3, 0 } }) {
+		Eigen::Vector3f normal = (points[b].w - points[a].w).cross(points[c].w - points[a].w);
+		if (normal.dot(points[opposite].w - points[a].w) > 0) {
+			std::swap(b, c);
+		}
+		addFace(a, b, c);
+	}
+
+	std::unordered_set<uint64_t> visible_edges;
+	int closest = 0;
+	for (int i = 0; i < max_iterations; i++) {
+		closest = -1;
+		for (int f = 0; f < faces.size(); f++) {
+			if (faces[f].alive && (closest < 0 || faces[f].distance < faces[closest].distance)) {
+				closest = f;
+			}
+		}
+		const Face nearest = faces[closest];
+		SimplexPoint w = support(m, nearest.normal);
+		if (nearest.normal.dot(w.w) - nearest.distance <= epa_tolerance) {
+			break;
+		}
+		bool seen = false;
+		for (const SimplexPoint& point : points) {
+			seen = seen || (point.primary == w.primary && point.secondary == w.secondary);
+		}
+		if (seen || i + 1 == max_iterations) {
+			break;
+		}
+		int added = static_cast<int>(points.size());
+		points.push_back(w);
+		visible_edges.clear();
+		for (Face& face : faces) {
+			if (face.alive && face.normal.dot(w.w - points[face.a].w) > 0) {
+				face.alive = false;
+				for (auto [first, second] : { std::pair<int, int>(face.a, face.b), std::pair<int, int>(face.b, face.c), std::pair<int, int>(face.c, face.a) }) {
+					visible_edges.insert(static_cast<uint64_t>(first) << 32 | static_cast<uint32_t>(second));
+				}
+			}
+		}
+		if (visible_edges.empty()) {
+			break;
+		}
+		for (uint64_t edge : visible_edges) {
+			int first = static_cast<int>(edge >> 32);
+			int second = static_cast<int>(edge & 0xffffffff);
+			if (!visible_edges.contains(static_cast<uint64_t>(second) << 32 | static_cast<uint32_t>(first))) {
+				addFace(first, second, added);
+			}
+		}
+	}
+	closest = -1;
+	for (int f = 0; f < faces.size(); f++) {
+		if (faces[f].alive && (closest < 0 || faces[f].distance < faces[closest].distance)) {
+			closest = f;
+		}
+	}
+
+	const Face& face = faces[closest];
+	contact->depth = std::max(face.distance, 0.f);
+	contact->normal = face.normal;
+	//where the origin's closest point on the face came from on each hull
+	Eigen::Vector3f weights = barycentric(face.normal * face.distance, points[face.a].w, points[face.b].w, points[face.c].w);
+	contact->primary_point = Eigen::Vector3f::Zero();
+	contact->secondary_point = Eigen::Vector3f::Zero();
+	int corner = 0;
+	for (int index : { face.a, face.b, face.c }) {
+		contact->primary_point += weights(corner) * m.primary.getVerts()[points[index].primary];
+		contact->secondary_point += weights(corner) * m.secondaryVert(points[index].secondary);
+		corner++;
+	}
+}
+
+ConvexContact convexContact(const ConvexHull& primary, const ConvexHull& secondary, const Eigen::Matrix4f& relative, GJKCache* cache) {
+	MinkowskiDifference m{ primary, secondary, relative.block<3, 3>(0, 0), relative.block<3, 1>(0, 3), -1, -1 };
+	Simplex s;
+	Eigen::Vector3f v;
+	bool past_margin;
+	ConvexContact contact{};
+	if (gjk(m, cache, -1, &s, &v, &past_margin)) {
+		epa(m, s, &contact);
+		return contact;
+	}
+	contact.overlap = false;
+	contact.distance = v.norm();
+	contact.depth = 0;
+	contact.normal = contact.distance > 0 ? Eigen::Vector3f(-v / contact.distance) : Eigen::Vector3f::UnitY();
+	contact.primary_point = Eigen::Vector3f::Zero();
+	contact.secondary_point = Eigen::Vector3f::Zero();
+	for (int i = 0; i < s.n; i++) {
+		contact.primary_point += s.weights[i] * primary.getVerts()[s.points[i].primary];
+		contact.secondary_point += s.weights[i] * m.secondaryVert(s.points[i].secondary);
+	}
+	return contact;
+}
+
+bool convexApart(const ConvexHull& primary, const ConvexHull& secondary, const Eigen::Matrix4f& relative, float margin, GJKCache* cache) {
+	MinkowskiDifference m{ primary, secondary, relative.block<3, 3>(0, 0), relative.block<3, 1>(0, 3), -1, -1 };
+	Simplex s;
+	Eigen::Vector3f v;
+	bool past_margin;
+	if (gjk(m, cache, std::max(margin, 0.f), &s, &v, &past_margin)) {
+		return false;
+	}
+	//v can be a little further than the hulls really are, only what the support points prove counts
+	return past_margin;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef PUPPET_GJK
+#define PUPPET_GJK
+
+#include <Eigen/Dense>
+
+#include "convex_hull.hpp"
+
+//what a pair of hulls keeps between frames so GJK starts from last frame's answer. the simplex is
+//kept as the verts of each hull its points came from, so it is still good after either moves, and
+//the hints are where each hull's support search last ended
+struct GJKCache {
+	int n_points; //0 starts from nothing
+	int primary[4];
+	int secondary[4];
+	int primary_hint;
+	int secondary_hint;
+};
+
+//closest points of two hulls, or how far they overlap
+struct ConvexContact {
+	bool overlap;
+	float distance; //between them, 0 when they overlap
+	float depth; //how far secondary has to move along normal to come out, 0 when they dont overlap
+	Eigen::Vector3f normal; //overlapping, the way secondary comes out. apart, from primary towards secondary
+	Eigen::Vector3f primary_point; //closest or deepest point of each
+	Eigen::Vector3f secondary_point;
+};
+
+//GJK for the distance between the hulls and EPA after it for the depth and normal if they overlap.
+//relative is secondary in primary's frame and the contact comes back in primary's frame. cache can be
+//nullptr
+ConvexContact convexContact(const ConvexHull& primary, const ConvexHull& secondary, const Eigen::Matrix4f& relative, GJKCache* cache);
+
+//just GJK, stopping as soon as it is sure the hulls are more than margin apart or not
+bool convexApart(const ConvexHull& primary, const ConvexHull& secondary, const Eigen::Matrix4f& relative, float margin, GJKCache* cache);
+
+#endif
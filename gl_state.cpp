@@ -0,0 +1,49 @@
+#include "gl_state.hpp"
+
+//everything starts unknown so the first call of each kind always goes through
+unsigned int GLState::program_ = GLState::unknown_;
+unsigned int GLState::vertex_array_ = GLState::unknown_;
+unsigned int GLState::array_buffer_ = GLState::unknown_;
+unsigned int GLState::element_array_buffer_ = GLState::unknown_;
+unsigned int GLState::active_texture_unit_ = 0; //gl default
+std::array<unsigned int, GLState::n_texture_units_> GLState::texture_2d_ = [] {
+	std::array<unsigned int, GLState::n_texture_units_> bound;
+	bound.fill(GLState::unknown_);
+	return bound;
+}();
+unsigned int GLState::draw_framebuffer_ = GLState::unknown_;
+unsigned int GLState::read_framebuffer_ = GLState::unknown_;
+
+int GLState::depth_test_ = -1;
+int GLState::blend_ = -1;
+int GLState::cull_face_ = -1;
+int GLState::scissor_test_ = -1;
+int GLState::depth_mask_ = -1;
+unsigned int GLState::blend_src_ = GLState::unknown_;
+unsigned int GLState::blend_dst_ = GLState::unknown_;
+unsigned int GLState::polygon_mode_ = GLState::unknown_;
+float GLState::line_width_ = -1.f;
+
+GLState::Stats GLState::frame_stats_ = { 0, 0 };
+GLState::Stats GLState::last_frame_stats_ = { 0, 0 };
+
+void GLState::invalidate() {
+	program_ = unknown_;
+	vertex_array_ = unknown_;
+	array_buffer_ = unknown_;
+	element_array_buffer_ = unknown_;
+	active_texture_unit_ = 0;
+	glActiveTexture(GL_TEXTURE0);
+	texture_2d_.fill(unknown_);
+	draw_framebuffer_ = unknown_;
+	read_framebuffer_ = unknown_;
+	depth_test_ = -1;
+	blend_ = -1;
+	cull_face_ = -1;
+	scissor_test_ = -1;
+	depth_mask_ = -1;
+	blend_src_ = unknown_;
+	blend_dst_ = unknown_;
+	polygon_mode_ = unknown_;
+	line_width_ = -1.f;
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#ifndef PUPPET_GL_STATE
+#define PUPPET_GL_STATE
+
+#include <glad/glad.h>
+#include <array>
+#include <cstddef>
+
+//shadows the bits of gl state the renderers touch so binds/enables that wouldnt change anything
+//never reach the driver. everything that binds a program, vao, texture, buffer or framebuffer or
+//changes blend/depth/polygon state should go through here, otherwise the shadow goes stale.
+//there is only one context so this is all static
+class GLState {
+public:
+	struct Stats {
+		size_t issued;
+		size_t elided;
+	};
+
+private:
+	static constexpr unsigned int unknown_ = 0xFFFFFFFF;
+	static constexpr int n_texture_units_ = 8;
+
+	static unsigned int program_;
+	static unsigned int vertex_array_;
+	static unsigned int array_buffer_;
+	static unsigned int element_array_buffer_; //part of vao state, reset whenever the vao changes
+	static unsigned int active_texture_unit_;
+	static std::array<unsigned int, n_texture_units_> texture_2d_;
+	static unsigned int draw_framebuffer_;
+	static unsigned int read_framebuffer_;
+
+	static int depth_test_;
+	static int blend_;
+	static int cull_face_;
+	static int scissor_test_;
+	static int depth_mask_;
+	static unsigned int blend_src_, blend_dst_;
+	static unsigned int polygon_mode_;
+	static float line_width_;
+
+	static Stats frame_stats_;
+	static Stats last_frame_stats_;
+
+	static bool changed(unsigned int& shadow, unsigned int value) {
+		if (shadow == value) {
+			frame_stats_.elided++;
+			return false;
+		}
+		shadow = value;
+		frame_stats_.issued++;
+		return true;
+	}
+
+	static int* capFlag(unsigned int cap) {
+		switch (cap) {
+		case GL_DEPTH_TEST: return &depth_test_;
+		case GL_BLEND: return &blend_;
+		case GL_CULL_FACE: return &cull_face_;
+		case GL_SCISSOR_TEST: return &scissor_test_;
+		default: return nullptr;
+		}
+	}
+
+public:
+	static void useProgram(unsigned int program) {
+		if (changed(program_, program)) {
+			glUseProgram(program);
+		}
+	}
+
+	static void bindVertexArray(unsigned int vao) {
+		if (changed(vertex_array_, vao)) {
+			glBindVertexArray(vao);
+			element_array_buffer_ = unknown_;
+		}
+	}
+
+	static void bindBuffer(unsigned int target, unsigned int buffer) {
+		switch (target) {
+		case GL_ARRAY_BUFFER:
+			if (changed(array_buffer_, buffer)) {
+				glBindBuffer(target, buffer);
+			}
+			break;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			if (changed(element_array_buffer_, buffer)) {
+				glBindBuffer(target, buffer);
+			}
+			break;
+		default:
+			frame_stats_.issued++;
+			glBindBuffer(target, buffer);
+		}
+	}
+
+	static void activeTexture(unsigned int unit) {
+		if (changed(active_texture_unit_, unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+		}
+	}
+
+	//2d textures only, thats all the renderers use
+	static void bindTexture(unsigned int texture) {
+		if (active_texture_unit_ >= n_texture_units_) {
+			frame_stats_.issued++;
+			glBindTexture(GL_TEXTURE_2D, texture);
+			return;
+		}
+		if (changed(texture_2d_[active_texture_unit_], texture)) {
+			glBindTexture(GL_TEXTURE_2D, texture);
+		}
+	}
+
+	static void bindFramebuffer(unsigned int target, unsigned int fbo) {
+		switch (target) {
+		case GL_FRAMEBUFFER:
+			if (draw_framebuffer_ == fbo && read_framebuffer_ == fbo) {
+				frame_stats_.elided++;
+				return;
+			}
+			draw_framebuffer_ = fbo;
+			read_framebuffer_ = fbo;
+			frame_stats_.issued++;
+			glBindFramebuffer(target, fbo);
+			break;
+		case GL_DRAW_FRAMEBUFFER:
+			if (changed(draw_framebuffer_, fbo)) {
+				glBindFramebuffer(target, fbo);
+			}
+			break;
+		case GL_READ_FRAMEBUFFER:
+			if (changed(read_framebuffer_, fbo)) {
+				glBindFramebuffer(target, fbo);
+			}
+			break;
+		}
+	}
+
+	static void enable(unsigned int cap) {
+		int* flag = capFlag(cap);
+		if (flag != nullptr && *flag == 1) {
+			frame_stats_.elided++;
+			return;
+		}
+		if (flag != nullptr) {
+			*flag = 1;
+		}
+		frame_stats_.issued++;
+		glEnable(cap);
+	}
+
+	static void disable(unsigned int cap) {
+		int* flag = capFlag(cap);
+		if (flag != nullptr && *flag == 0) {
+			frame_stats_.elided++;
+			return;
+		}
+		if (flag != nullptr) {
+			*flag = 0;
+		}
+		frame_stats_.issued++;
+		glDisable(cap);
+	}
+
+	static void depthMask(bool write) {
+		if (depth_mask_ == static_cast<int>(write)) {
+			frame_stats_.elided++;
+			return;
+		}
+		depth_mask_ = static_cast<int>(write);
+		frame_stats_.issued++;
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+
+	static void blendFunc(unsigned int src, unsigned int dst) {
+		if (blend_src_ == src && blend_dst_ == dst) {
+			frame_stats_.elided++;
+			return;
+		}
+		blend_src_ = src;
+		blend_dst_ = dst;
+		frame_stats_.issued++;
+		glBlendFunc(src, dst);
+	}
+
+	//front and back are always set together in this engine
+	static void polygonMode(unsigned int mode) {
+		if (changed(polygon_mode_, mode)) {
+			glPolygonMode(GL_FRONT_AND_BACK, mode);
+		}
+	}
+
+	static void lineWidth(float width) {
+		if (line_width_ == width) {
+			frame_stats_.elided++;
+			return;
+		}
+		line_width_ = width;
+		frame_stats_.issued++;
+		glLineWidth(width);
+	}
+
+	//deleting objects whose names are still shadowed would let a recycled name get skipped
+	static void deleteTextures(int n, const unsigned int* textures) {
+		for (int i = 0; i < n; i++) {
+			for (unsigned int& bound : texture_2d_) {
+				if (bound == textures[i]) {
+					bound = unknown_;
+				}
+			}
+		}
+		glDeleteTextures(n, textures);
+	}
+
+	static void deleteBuffers(int n, const unsigned int* buffers) {
+		for (int i = 0; i < n; i++) {
+			if (array_buffer_ == buffers[i]) {
+				array_buffer_ = unknown_;
+			}
+			if (element_array_buffer_ == buffers[i]) {
+				element_array_buffer_ = unknown_;
+			}
+		}
+		glDeleteBuffers(n, buffers);
+	}
+
+	static void deleteVertexArrays(int n, const unsigned int* vaos) {
+		for (int i = 0; i < n; i++) {
+			if (vertex_array_ == vaos[i]) {
+				vertex_array_ = unknown_;
+				element_array_buffer_ = unknown_;
+			}
+		}
+		glDeleteVertexArrays(n, vaos);
+	}
+
+	//for code outside the renderers that touched gl directly
+	static void invalidate();
+
+	//call once per frame, rolls the counters over
+	static void endFrame() {
+		last_frame_stats_ = frame_stats_;
+		frame_stats_ = Stats{ 0, 0 };
+	}
+
+	static const Stats& getLastFrameStats() {
+		return last_frame_stats_;
+	}
+
+};
+
+#endif
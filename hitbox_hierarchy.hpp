@@ -0,0 +1,214 @@
+#pragma once
+
+#ifndef PUPPET_HITBOX_HIERARCHY
+#define PUPPET_HITBOX_HIERARCHY
+
+#include <algorithm>
+#include <atomic>
+
+#include "surface.hpp"
+#include "Hitbox.h"
+
+//one hitbox tested coarsest first, a bounding sphere, then an ellipsoid, then the coarse mesh and only
+//then the exact mesh, going on to the next only while the last one overlaps. the sphere and the
+//ellipsoid are fit around both meshes, so they never turn away a pair the exact meshes would hit.
+//the coarse mesh is only used if it has edges and every vert of the exact mesh inside it, otherwise it
+//is skipped.
+//as a Surface it is the exact mesh, with the sphere and ellipsoid in front of it
+class HitboxHierarchy : public Surface<3> {
+public:
+	//counts for when this is the primary, pairs can be checked on several threads at once so they are
+	//kept as atomics and read out into this
+	struct Stats {
+		size_t n_tests;
+		size_t n_sphere_rejects;
+		size_t n_ellipsoid_rejects;
+		size_t n_coarse_rejects;
+		size_t n_exact_tests;
+	};
+
+private:
+	const MeshSurface& coarse_;
+	const MeshSurface& exact_;
+	Eigen::Vector3f center_; //of the sphere and the ellipsoid, in the owner's frame
+	float radius_;
+	Hitbox ellipsoid_; //axis aligned in the owner's frame
+	bool coarse_encloses_;
+	mutable std::atomic<size_t> n_tests_;
+	mutable std::atomic<size_t> n_sphere_rejects_;
+	mutable std::atomic<size_t> n_ellipsoid_rejects_;
+	mutable std::atomic<size_t> n_coarse_rejects_;
+	mutable std::atomic<size_t> n_exact_tests_;
+
+	//is p inside the closed mesh, by counting the faces a segment out past the sphere crosses
+	static bool inside(const MeshSurface& mesh, const Eigen::Vector3f& p, const Eigen::Vector3f& center, float radius) {
+		//off any axis so it is unlikely to run along an edge
+		const Eigen::Vector3f dir = Eigen::Vector3f(0.5773f, 0.5769f, 0.5779f).normalized();
+		Eigen::Vector3f start = p;
+		Eigen::Vector3f end = p + dir * ((p - center).norm() + 2 * radius + 1);
+		int crossings = 0;
+		float k;
+		Eigen::Vector3f normal;
+		for (int i = 0; i < 256 && mesh.firstCrossing(start, end, &k, &normal); i++) {
+			crossings++;
+			start = start + k * (end - start) + dir * 1e-5f * (radius + 1);
+		}
+		return crossings % 2 == 1;
+	}
+
+public:
+	//both meshes are in the owner's frame and have to outlive this
+	HitboxHierarchy(const MeshSurface& coarse, const MeshSurface& exact) :coarse_(coarse), exact_(exact), n_tests_(0), n_sphere_rejects_(0), n_ellipsoid_rejects_(0), n_coarse_rejects_(0), n_exact_tests_(0) {
+		Eigen::AlignedBox3f box;
+		for (const Eigen::Vector3f& v : coarse_.getVerts()) {
+			box.extend(v);
+		}
+		for (const Eigen::Vector3f& v : exact_.getVerts()) {
+			box.extend(v);
+		}
+		if (box.isEmpty()) {
+			center_ = Eigen::Vector3f::Zero();
+			radius_ = 0;
+			coarse_encloses_ = false;
+			return;
+		}
+		center_ = box.center();
+		Eigen::Vector3f half = (box.sizes() / 2).cwiseMax(1e-6f);
+		//the box's shape scaled up until every vert is inside
+		float radius_sq = 0;
+		float scale_sq = 0;
+		for (const std::vector<Eigen::Vector3f>* verts : { &coarse_.getVerts(), &exact_.getVerts() }) {
+			for (const Eigen::Vector3f& v : *verts) {
+				radius_sq = std::max(radius_sq, (v - center_).squaredNorm());
+				scale_sq = std::max(scale_sq, (v - center_).cwiseQuotient(half).squaredNorm());
+			}
+		}
+		radius_ = std::sqrt(radius_sq);
+		ellipsoid_ = Hitbox(half * std::sqrt(scale_sq));
+
+		coarse_encloses_ = !coarse_.getFaces().empty() && !coarse_.getEdges().empty() && &coarse_ != &exact_;
+		for (int i = 0; coarse_encloses_ && i < exact_.getVerts().size(); i++) {
+			coarse_encloses_ = inside(coarse_, exact_.getVerts()[i], center_, radius_);
+		}
+	}
+
+	//segments only go through the sphere and the ellipsoid before the exact mesh. a segment can cross
+	//the exact mesh while staying inside the coarse one, so the coarse mesh says nothing here
+	bool crossesSurface(Eigen::Vector<float, 3> first_state, Eigen::Vector<float, 3> second_state) const override {
+		return segmentNear(first_state, second_state) && exact_.crossesSurface(first_state, second_state);
+	}
+
+	bool firstCrossing(Eigen::Vector<float, 3> first_state, Eigen::Vector<float, 3> second_state, float* k, Eigen::Vector<float, 3>* normal) const override {
+		return segmentNear(first_state, second_state) && exact_.firstCrossing(first_state, second_state, k, normal);
+	}
+
+	//does the segment get into the sphere and then the ellipsoid, in the owner's frame
+	bool segmentNear(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) const {
+		Eigen::Vector3f dir = e2 - e1;
+		float length_sq = dir.squaredNorm();
+		float t = length_sq > 0 ? std::clamp((center_ - e1).dot(dir) / length_sq, 0.f, 1.f) : 0;
+		if ((e1 + t * dir - center_).squaredNorm() > radius_ * radius_) {
+			return false;
+		}
+		//squashed so the ellipsoid is the unit sphere
+		Eigen::Vector3f a = (e1 - center_).cwiseQuotient(ellipsoid_.getShape());
+		Eigen::Vector3f d = dir.cwiseQuotient(ellipsoid_.getShape());
+		float d_sq = d.squaredNorm();
+		t = d_sq > 0 ? std::clamp(-a.dot(d) / d_sq, 0.f, 1.f) : 0;
+		return (a + t * d).squaredNorm() <= 1;
+	}
+
+	//the part of the hierarchy before the exact meshes, for this at position and other at
+	//other_position. other may have moved by other_motion since last frame, the sphere and ellipsoid
+	//are grown to cover everywhere it could have been on the way. false if they are apart. without count
+	//the stats are left alone, for going over a pair again that was already counted
+	bool boundsOverlap(const HitboxHierarchy& other, const Eigen::Matrix4f& position, const Eigen::Matrix4f& other_position, const Eigen::Matrix4f& other_motion, bool count = true) const {
+		if (count) {
+			n_tests_.fetch_add(1, std::memory_order_relaxed);
+		}
+		//other in this one's frame, now and before its move
+		Eigen::Matrix4f relative = position.inverse() * other_position;
+		Eigen::Matrix4f last_relative = relative * other_motion.inverse();
+		Eigen::Matrix3f R = relative(seq(0, 2), seq(0, 2));
+		Eigen::Vector3f p = relative(seq(0, 2), 3);
+		//furthest any point of other moved, at most |dR| |x| + |dp| for x within its sphere
+		float moved = (R - last_relative(seq(0, 2), seq(0, 2))).norm() * (other.center_.norm() + other.radius_) + (p - last_relative(seq(0, 2), 3)).norm();
+
+		Eigen::Vector3f other_center = R * other.center_ + p;
+		float reach = radius_ + other.radius_ + moved;
+		if ((other_center - center_).squaredNorm() > reach * reach) {
+			if (count) {
+				n_sphere_rejects_.fetch_add(1, std::memory_order_relaxed);
+			}
+			return false;
+		}
+
+		//an ellipsoid scaled up by 1+moved/smallest axis holds the ellipsoid grown by moved all round
+		Eigen::Matrix4f this_frame = position;
+		this_frame.block<3, 1>(0, 3) += position.block<3, 3>(0, 0) * center_;
+		Eigen::Matrix4f other_frame = other_position;
+		other_frame.block<3, 1>(0, 3) += other_position.block<3, 3>(0, 0) * other.center_;
+		const Eigen::Vector3f& other_shape = other.ellipsoid_.getShape();
+		Hitbox swept(other_shape * (1 + moved / std::max(other_shape.minCoeff(), 1e-6f)));
+		if (!ellipsoid_.checkCollision(swept, this_frame, other_frame)) {
+			if (count) {
+				n_ellipsoid_rejects_.fetch_add(1, std::memory_order_relaxed);
+			}
+			return false;
+		}
+		return true;
+	}
+
+	//neither coarse mesh is inside the other. with their surfaces not crossing either, they are apart
+	bool coarseApart(const HitboxHierarchy& other, const Eigen::Matrix4f& position, const Eigen::Matrix4f& other_position) const {
+		Eigen::Matrix4f relative = position.inverse() * other_position;
+		Eigen::Matrix4f other_relative = other_position.inverse() * position;
+		const Eigen::Vector3f& v = other.coarse_.getVerts()[0];
+		const Eigen::Vector3f& w = coarse_.getVerts()[0];
+		return !inside(coarse_, relative.block<3, 3>(0, 0) * v + relative.block<3, 1>(0, 3), center_, radius_) &&
+			!inside(other.coarse_, other_relative.block<3, 3>(0, 0) * w + other_relative.block<3, 1>(0, 3), other.center_, other.radius_);
+	}
+
+	const MeshSurface& getCoarse() const {
+		return coarse_;
+	}
+	const MeshSurface& getExact() const {
+		return exact_;
+	}
+
+	//whether the coarse mesh gets a say, see the class comment
+	bool usesCoarse() const {
+		return coarse_encloses_;
+	}
+
+	void countCoarseReject() const {
+		n_coarse_rejects_.fetch_add(1, std::memory_order_relaxed);
+	}
+	void countExactTest() const {
+		n_exact_tests_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Stats getStats() const {
+		return { n_tests_.load(std::memory_order_relaxed), n_sphere_rejects_.load(std::memory_order_relaxed), n_ellipsoid_rejects_.load(std::memory_order_relaxed),
+			n_coarse_rejects_.load(std::memory_order_relaxed), n_exact_tests_.load(std::memory_order_relaxed) };
+	}
+	void resetStats() {
+		n_tests_ = 0;
+		n_sphere_rejects_ = 0;
+		n_ellipsoid_rejects_ = 0;
+		n_coarse_rejects_ = 0;
+		n_exact_tests_ = 0;
+	}
+
+	const Eigen::Vector3f& getCenter() const {
+		return center_;
+	}
+	float getRadius() const {
+		return radius_;
+	}
+	const Hitbox& getEllipsoid() const {
+		return ellipsoid_;
+	}
+};
+
+#endif
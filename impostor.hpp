@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef PUPPET_IMPOSTOR
+#define PUPPET_IMPOSTOR
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <cmath>
+
+#include "gl_state.hpp"
+#include "math_constants.hpp"
+
+//a stand in for something big and far away: n_views color+depth pictures of it taken with an
+//orthographic camera from evenly spaced directions around the vertical axis. the views sit side by
+//side in one color and one depth texture. the depth lets the card put every pixel back where the
+//real surface was, so it still sorts against other geometry and keeps the same silhouette
+struct Impostor {
+	static constexpr int n_views = 8;
+	static constexpr int resolution = 256; //per view
+
+	unsigned int color_tex;
+	unsigned int depth_tex;
+	Eigen::Vector3f center; //world space bounding sphere, the views are fit to it
+	float radius;
+	bool baked;
+	bool active; //being drawn in place of the real thing
+
+	Impostor(const Eigen::Vector3f& center, float radius) : center(center), radius(radius), baked(false), active(false) {
+		glGenTextures(1, &color_tex);
+		GLState::bindTexture(color_tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, n_views * resolution, resolution, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		//depth is never filtered, blending depths across a silhouette would make floating pixels
+		glGenTextures(1, &depth_tex);
+		GLState::bindTexture(depth_tex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, n_views * resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	~Impostor() {
+		GLState::deleteTextures(1, &color_tex);
+		GLState::deleteTextures(1, &depth_tex);
+	}
+
+	Impostor(const Impostor&) = delete;
+	Impostor& operator=(const Impostor&) = delete;
+
+	//unit vector from the center towards where view was taken from
+	static Eigen::Vector3f viewDir(int view) {
+		float angle = 2 * M_PI * view / n_views;
+		return Eigen::Vector3f(std::cos(angle), 0, std::sin(angle));
+	}
+
+	static Eigen::Vector3f viewRight(int view) {
+		return Eigen::Vector3f::UnitY().cross(viewDir(view));
+	}
+
+	//the view taken from closest to eye, ignoring height
+	int closestView(const Eigen::Vector3f& eye) const {
+		float angle = std::atan2(eye(2) - center(2), eye(0) - center(0));
+		int view = static_cast<int>(std::lround(angle / (2 * M_PI) * n_views));
+		return (view % n_views + n_views) % n_views;
+	}
+
+	//camera sits 2 radii out and looks back at the center
+	Eigen::Matrix4f viewCamera(int view) const {
+		Eigen::Matrix3f rotation;
+		rotation.row(0) = viewRight(view);
+		rotation.row(1) = Eigen::Vector3f::UnitY();
+		rotation.row(2) = viewDir(view);
+		Eigen::Matrix4f camera = Eigen::Matrix4f::Identity();
+		camera.block<3, 3>(0, 0) = rotation;
+		camera.block<3, 1>(0, 3) = -rotation * (center + 2 * radius * viewDir(view));
+		return camera;
+	}
+
+	//orthographic, just covering the bounding sphere. depth 0 is one radius in front of the center
+	//and depth 1 one radius behind it
+	Eigen::Matrix4f projection() const {
+		Eigen::Matrix4f projection;
+		projection << 1 / radius, 0, 0, 0,
+			0, 1 / radius, 0, 0,
+			0, 0, -1 / radius, -2,
+			0, 0, 0, 1;
+		return projection;
+	}
+};
+
+#endif
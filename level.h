@@ -12,6 +12,9 @@
 #include "ZMapper.h"
 #include "sound.hpp"
 #include "scene.hpp"
+#include "mesh_utils.hpp"
+#include "light_baker.hpp"
+#include "collision_world.hpp"
 
 #include <GLFW/glfw3.h>
 
@@ -35,6 +38,7 @@ private:
 	Surface<3>* collision_surface_;
 	Region<3>* level_region_;
 	const int level_number_;
+	Model* level_model_; //same as getModel, kept writable so lighting can be baked into it
 
 	static Level* current_level_;
 	static Level* prev_level_;
@@ -42,6 +46,8 @@ private:
 	
 	Sound theme_;
 	Scene scene_;
+	CollisionWorld collision_world_; //hitboxes of everything in the level
+	int collision_surface_id_; //collision_surface_ in collision_world_, -1 until there is one
 
 
 	//we can render the floor like an image with color corresponding to the height.
@@ -57,6 +63,17 @@ private:
 		return ret;
 	}
 
+	//the zmap goes in the collision world with a mask of 0, so it never pairs with anything but
+	//CollisionProbe can still find it. the motion constraints are what keep things out of it
+	void addCollisionSurfaceBody() {
+		if (collision_surface_id_ >= 0) {
+			collision_world_.remove(collision_surface_id_);
+		}
+		Eigen::Vector3f half = getModel()->getBoundingBox() * .55f;
+		Eigen::AlignedBox3f box(getModel()->getBoxCenter() - half, getModel()->getBoxCenter() + half);
+		collision_surface_id_ = collision_world_.add(this, *collision_surface_, box, CollisionWorld::level_layer, 0);
+	}
+
 	void enterStandby() {
 		if (load_state_ == active) {
 			deactivate();
@@ -189,10 +206,23 @@ public:
 		}
 	}
 
+	//the pairs in collision_world_ can outlive it
+	~Level() {
+		if (current_level_ == this) {
+			GameObject::setPairWorld(nullptr);
+		}
+	}
+
 	static Level* getCurrentLevel() {
 		return current_level_;
 	}
 
+	void update(GLFWwindow* window) override {
+		GameObject::update(window);
+		//everything in the level has moved, now see what ran into what
+		collision_world_.step();
+	}
+
 	static void UpdateCurrentLevel(GLFWwindow* window) {
 		current_level_->update(window);
 	}
@@ -216,6 +246,8 @@ public:
 		}
 		prev_level_ = current_level_;
 		current_level_ = new_level;
+		//pairs added by hand are checked with the rest of the level's
+		GameObject::setPairWorld(&new_level->collision_world_);
  		new_level->activate();
 		for (auto& neig : new_level->neighbors_) {
 			neig->enterStandby();
@@ -282,7 +314,9 @@ public:
 		window_(window),
 		fname_(layout_fname),
 		collision_surface_(nullptr),
-		level_number_(all_levels_.size())
+		level_number_(all_levels_.size()),
+		level_model_(model),
+		collision_surface_id_(-1)
 		//for now this uses current window size as resolution since thats what ZMapper will output as
 	{
 		all_levels_.push_back(this); //need to add remove call for destruction
@@ -292,6 +326,7 @@ public:
 
 		moveTo(model->getBoxCenter());
 		model->centerVerts();
+		generateLodsCached(*model, getName() + ".lods");
 		for (auto& neig : neighbors_) {
 			const_neighbors_.push_back(neig);
 		}
@@ -316,6 +351,7 @@ public:
 		collision_surface->createData(*this, n_steps, neighbors, static_cast<void*>(zmapper));
 		collision_surface_ = collision_surface;
 		level_region_ = collision_surface;
+		addCollisionSurfaceBody();
 	}
 	void createZmapCollisionSurface(unsigned int n_steps, ZMapper* zmapper, int x_res, int y_res) {
 		std::vector<const GameObject*> neighbors;
@@ -326,6 +362,7 @@ public:
 		collision_surface->createData(*this, n_steps, neighbors, static_cast<void*>(zmapper));
 		collision_surface_ = collision_surface;
 		level_region_ = collision_surface;
+		addCollisionSurfaceBody();
 	}
 	/*
 	const Model& getModel() const override {
@@ -335,6 +372,40 @@ public:
 		return this->texture_;
 	}*/
 
+	//bakes lights and ambient occlusion into the models of levels, traced against all of them together.
+	//each level keeps its bake in <name>.bake, if every file is there and was made with the same lights
+	//nothing is traced. call before the levels are handed to a renderer
+	static void bakeLighting(const std::vector<Level*>& levels, const std::vector<BakeLight>& lights) {
+		std::vector<std::vector<std::vector<float>>> baked;
+		for (const Level* level : levels) {
+			std::vector<std::vector<float>> lods;
+			if (!LightBaker::load(level->getName() + ".bake", lights, *level->level_model_, lods)) {
+				baked.clear();
+				break;
+			}
+			baked.push_back(std::move(lods));
+		}
+
+		if (baked.size() != levels.size()) {
+			LightBaker baker;
+			for (const Level* level : levels) {
+				baker.addMesh(*level->level_model_, level->getPosition());
+			}
+			baked = baker.bake(lights);
+			for (int i = 0; i < levels.size(); i++) {
+				if (!LightBaker::save(levels[i]->getName() + ".bake", lights, baked[i])) {
+					std::cerr << "couldnt save baked lighting for " << levels[i]->getName() << "\n";
+				}
+			}
+		}
+
+		for (int i = 0; i < levels.size(); i++) {
+			for (int lod = 0; lod < baked[i].size(); lod++) {
+				levels[i]->level_model_->setBakedLight(lod, std::move(baked[i][lod]));
+			}
+		}
+	}
+
 	const std::vector<const Level*>& getNeighbors() const {
 		return const_neighbors_;
 	}
@@ -388,6 +459,10 @@ public:
 		return scene_;
 	}
 
+	CollisionWorld& getCollisionWorld() {
+		return collision_world_;
+	}
+
 	static void resetGame(GLFWwindow* window) {
 		for (auto& level : Level::AllLevels()) {
 			//level->saveLayoutFile();
@@ -0,0 +1,334 @@
+#pragma once
+
+#ifndef PUPPET_LIGHT_BAKER
+#define PUPPET_LIGHT_BAKER
+
+#include <Eigen/Dense>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#include "Model.h"
+#include "math_constants.hpp"
+
+//a point light that never moves. same falloff as the lit shaders, color is ignored there too
+struct BakeLight {
+	Eigen::Vector3f position;
+	float brightness;
+};
+
+//traces direct light from static point lights and ambient occlusion into every vertex of a set of
+//meshes on the cpu. every added mesh occludes every other one, so rooms shadow into each other
+//through their openings. nothing in here touches gl, it runs without a window or a context.
+//the result per vertex is two floats: the diffuse term the shader would have summed over the
+//lights, and the unoccluded fraction of the hemisphere around the normal
+class LightBaker {
+public:
+	static constexpr int n_ao_rays = 64;
+	static constexpr int leaf_size = 4;
+
+private:
+	struct Mesh {
+		const Model* model;
+		Eigen::Matrix4f position;
+	};
+
+	struct Triangle {
+		Eigen::Vector3f v0;
+		Eigen::Vector3f e1;
+		Eigen::Vector3f e2;
+	};
+
+	struct Node {
+		Eigen::Vector3f low;
+		Eigen::Vector3f high;
+		int first; //first triangle for leaves, the left child otherwise. right child is always left + 1
+		int count; //0 for inner nodes
+	};
+
+	std::vector<Mesh> meshes_;
+	std::vector<Triangle> triangles_;
+	std::vector<Node> nodes_;
+	std::vector<Eigen::Vector3f> hemisphere_; //cosine weighted, around +z
+
+	float ao_distance_;
+	float offset_; //rays start this far off the surface so they dont hit it
+
+	static void bounds(const Triangle& tri, Eigen::Vector3f& low, Eigen::Vector3f& high) {
+		low = tri.v0.cwiseMin(tri.v0 + tri.e1).cwiseMin(tri.v0 + tri.e2);
+		high = tri.v0.cwiseMax(tri.v0 + tri.e1).cwiseMax(tri.v0 + tri.e2);
+	}
+
+	//median split along the longest axis of the centroids. index has to exist already
+	void build(int index, int first, int count) {
+		Eigen::Vector3f low = Eigen::Vector3f::Constant(INFINITY);
+		Eigen::Vector3f high = Eigen::Vector3f::Constant(-INFINITY);
+		Eigen::Vector3f centroid_low = low;
+		Eigen::Vector3f centroid_high = high;
+		for (int i = first; i < first + count; i++) {
+			Eigen::Vector3f tri_low, tri_high;
+			bounds(triangles_[i], tri_low, tri_high);
+			low = low.cwiseMin(tri_low);
+			high = high.cwiseMax(tri_high);
+			Eigen::Vector3f centroid = triangles_[i].v0 + (triangles_[i].e1 + triangles_[i].e2) / 3;
+			centroid_low = centroid_low.cwiseMin(centroid);
+			centroid_high = centroid_high.cwiseMax(centroid);
+		}
+		nodes_[index].low = low;
+		nodes_[index].high = high;
+
+		if (count <= leaf_size) {
+			nodes_[index].first = first;
+			nodes_[index].count = count;
+			return;
+		}
+
+		int axis;
+		(centroid_high - centroid_low).maxCoeff(&axis);
+		auto middle = triangles_.begin() + first + count / 2;
+		std::nth_element(triangles_.begin() + first, middle, triangles_.begin() + first + count, [axis](const Triangle& a, const Triangle& b) {
+			return 3 * a.v0(axis) + a.e1(axis) + a.e2(axis) < 3 * b.v0(axis) + b.e1(axis) + b.e2(axis);
+			});
+
+		//children go next to each other so only the left one needs storing
+		int left = static_cast<int>(nodes_.size());
+		nodes_.push_back(Node());
+		nodes_.push_back(Node());
+		nodes_[index].first = left;
+		nodes_[index].count = 0;
+		build(left, first, count / 2);
+		build(left + 1, first + count / 2, count - count / 2);
+	}
+
+	static bool hitsBox(const Node& node, const Eigen::Vector3f& origin, const Eigen::Vector3f& inv_dir, float max_t) {
+		Eigen::Vector3f t0 = (node.low - origin).cwiseProduct(inv_dir);
+		Eigen::Vector3f t1 = (node.high - origin).cwiseProduct(inv_dir);
+		float t_near = std::max(t0.cwiseMin(t1).maxCoeff(), 0.f);
+		float t_far = std::min(t0.cwiseMax(t1).minCoeff(), max_t);
+		return t_near <= t_far;
+	}
+
+	//moller trumbore, both sides count
+	static bool hitsTriangle(const Triangle& tri, const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float max_t) {
+		Eigen::Vector3f p = dir.cross(tri.e2);
+		float det = tri.e1.dot(p);
+		if (std::abs(det) < 1e-9f) {
+			return false;
+		}
+		float inv_det = 1 / det;
+		Eigen::Vector3f s = origin - tri.v0;
+		float u = s.dot(p) * inv_det;
+		if (u < 0 || u > 1) {
+			return false;
+		}
+		Eigen::Vector3f q = s.cross(tri.e1);
+		float v = dir.dot(q) * inv_det;
+		if (v < 0 || u + v > 1) {
+			return false;
+		}
+		float t = tri.e2.dot(q) * inv_det;
+		return t > 0 && t < max_t;
+	}
+
+	//any hit is enough, no need for the closest one
+	bool occluded(const Eigen::Vector3f& origin, const Eigen::Vector3f& dir, float max_t) const {
+		if (nodes_.empty()) {
+			return false;
+		}
+		Eigen::Vector3f inv_dir = dir.cwiseInverse();
+		int stack[64];
+		int n_stack = 0;
+		stack[n_stack++] = 0;
+		while (n_stack > 0) {
+			const Node& node = nodes_[stack[--n_stack]];
+			if (!hitsBox(node, origin, inv_dir, max_t)) {
+				continue;
+			}
+			if (node.count > 0) {
+				for (int i = node.first; i < node.first + node.count; i++) {
+					if (hitsTriangle(triangles_[i], origin, dir, max_t)) {
+						return true;
+					}
+				}
+			} else {
+				stack[n_stack++] = node.first;
+				stack[n_stack++] = node.first + 1;
+			}
+		}
+		return false;
+	}
+
+	void bakeVertex(const Eigen::Vector3f& position, const Eigen::Vector3f& normal, const std::vector<BakeLight>& lights, float* out) const {
+		Eigen::Vector3f origin = position + normal * offset_;
+
+		float diff = 0;
+		for (const BakeLight& light : lights) {
+			Eigen::Vector3f light_dir = light.position - position;
+			float distance = light_dir.norm();
+			float n_dot_l = normal.dot(light_dir / distance);
+			if (n_dot_l <= 0 || occluded(origin, (light.position - origin).normalized(), (light.position - origin).norm())) {
+				continue;
+			}
+			float strength = light.brightness * light.brightness;
+			diff += n_dot_l * strength / (strength + distance * distance);
+		}
+
+		//the same directions for every vertex, so corners that share a position and normal get the
+		//exact same value and no seams show up between faces
+		Eigen::Vector3f tangent = std::abs(normal(0)) > .9f ? Eigen::Vector3f::UnitY() : Eigen::Vector3f::UnitX();
+		tangent = tangent.cross(normal).normalized();
+		Eigen::Vector3f bitangent = normal.cross(tangent);
+		int n_open = 0;
+		for (const Eigen::Vector3f& local : hemisphere_) {
+			Eigen::Vector3f dir = local(0) * tangent + local(1) * bitangent + local(2) * normal;
+			n_open += !occluded(origin, dir, ao_distance_);
+		}
+
+		out[0] = diff;
+		out[1] = static_cast<float>(n_open) / n_ao_rays;
+	}
+
+public:
+	LightBaker(float ao_distance = 2, float offset = .01f) : ao_distance_(ao_distance), offset_(offset) {
+		const float golden_angle = M_PI * (3 - std::sqrt(5.f));
+		for (int i = 0; i < n_ao_rays; i++) {
+			float r = std::sqrt((i + .5f) / n_ao_rays);
+			float phi = i * golden_angle;
+			hemisphere_.push_back(Eigen::Vector3f(r * std::cos(phi), r * std::sin(phi), std::sqrt(1 - r * r)));
+		}
+	}
+
+	//model (and all of its lods) receives light, its full detail version also blocks it
+	void addMesh(const Model& model, const Eigen::Matrix4f& position) {
+		meshes_.push_back(Mesh{ &model, position });
+		const std::vector<float>& verts = model.getVerts();
+		for (int i = 0; i < model.flen(); i++) {
+			Eigen::Vector3f v[3];
+			for (int j = 0; j < 3; j++) {
+				int k = 3 * (3 * i + j);
+				v[j] = (position * Eigen::Vector4f(verts[k], verts[k + 1], verts[k + 2], 1)).head<3>();
+			}
+			triangles_.push_back(Triangle{ v[0], v[1] - v[0], v[2] - v[0] });
+		}
+		nodes_.clear();
+	}
+
+	//one entry per added mesh, in order, holding one vector per lod with two floats per vertex
+	std::vector<std::vector<std::vector<float>>> bake(const std::vector<BakeLight>& lights, unsigned int n_threads = std::thread::hardware_concurrency()) {
+		if (nodes_.empty() && !triangles_.empty()) {
+			nodes_.push_back(Node());
+			build(0, 0, static_cast<int>(triangles_.size()));
+		}
+
+		struct Job {
+			const Model* model;
+			const Eigen::Matrix4f* position;
+			std::vector<float>* out;
+			int first;
+			int count;
+		};
+		static constexpr int job_size = 256;
+
+		std::vector<std::vector<std::vector<float>>> baked(meshes_.size());
+		std::vector<Job> jobs;
+		for (int m = 0; m < meshes_.size(); m++) {
+			baked[m].resize(meshes_[m].model->getNLods());
+			for (int lod = 0; lod < meshes_[m].model->getNLods(); lod++) {
+				const Model& lod_model = meshes_[m].model->getLod(lod);
+				int n_verts = 3 * lod_model.flen();
+				baked[m][lod].resize(2 * n_verts);
+				for (int first = 0; first < n_verts; first += job_size) {
+					jobs.push_back(Job{ &lod_model, &meshes_[m].position, &baked[m][lod], first, std::min(job_size, n_verts - first) });
+				}
+			}
+		}
+
+		std::atomic<size_t> next_job = 0;
+		auto work = [&]() {
+			for (size_t j = next_job++; j < jobs.size(); j = next_job++) {
+				const Job& job = jobs[j];
+				const std::vector<float>& verts = job.model->getVerts();
+				const std::vector<float>& norms = job.model->getNorms();
+				for (int i = job.first; i < job.first + job.count; i++) {
+					Eigen::Vector3f position = (*job.position * Eigen::Vector4f(verts[3 * i], verts[3 * i + 1], verts[3 * i + 2], 1)).head<3>();
+					Eigen::Vector3f normal = (*job.position * Eigen::Vector4f(norms[3 * i], norms[3 * i + 1], norms[3 * i + 2], 0)).head<3>().normalized();
+					bakeVertex(position, normal, lights, job.out->data() + 2 * i);
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < std::max(n_threads, 1u); i++) {
+			threads.emplace_back(work);
+		}
+		work();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		return baked;
+	}
+
+	//the cooked form of one mesh's bake. the lights go in too so a bake made with different lights
+	//is never loaded by mistake
+	static bool save(const std::string& fname, const std::vector<BakeLight>& lights, const std::vector<std::vector<float>>& lods) {
+		std::ofstream file(fname, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		int n_lights = static_cast<int>(lights.size());
+		file.write(reinterpret_cast<const char*>(&n_lights), sizeof(int));
+		for (const BakeLight& light : lights) {
+			file.write(reinterpret_cast<const char*>(light.position.data()), 3 * sizeof(float));
+			file.write(reinterpret_cast<const char*>(&light.brightness), sizeof(float));
+		}
+		int n_lods = static_cast<int>(lods.size());
+		file.write(reinterpret_cast<const char*>(&n_lods), sizeof(int));
+		for (const std::vector<float>& lod : lods) {
+			int n = static_cast<int>(lod.size());
+			file.write(reinterpret_cast<const char*>(&n), sizeof(int));
+			file.write(reinterpret_cast<const char*>(lod.data()), n * sizeof(float));
+		}
+		return static_cast<bool>(file);
+	}
+
+	//false if there is no file, it was baked with other lights or it doesnt fit model anymore
+	static bool load(const std::string& fname, const std::vector<BakeLight>& lights, const Model& model, std::vector<std::vector<float>>& lods) {
+		std::ifstream file(fname, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+		int n_lights = 0;
+		file.read(reinterpret_cast<char*>(&n_lights), sizeof(int));
+		if (!file || n_lights != lights.size()) {
+			return false;
+		}
+		for (const BakeLight& light : lights) {
+			float stored[4];
+			file.read(reinterpret_cast<char*>(stored), 4 * sizeof(float));
+			if (!file || stored[0] != light.position(0) || stored[1] != light.position(1) || stored[2] != light.position(2) || stored[3] != light.brightness) {
+				return false;
+			}
+		}
+		int n_lods = 0;
+		file.read(reinterpret_cast<char*>(&n_lods), sizeof(int));
+		if (!file || n_lods != model.getNLods()) {
+			return false;
+		}
+		lods.assign(n_lods, std::vector<float>());
+		for (int lod = 0; lod < n_lods; lod++) {
+			int n = 0;
+			file.read(reinterpret_cast<char*>(&n), sizeof(int));
+			if (!file || n != 6 * model.getLod(lod).flen()) {
+				return false;
+			}
+			lods[lod].resize(n);
+			file.read(reinterpret_cast<char*>(lods[lod].data()), n * sizeof(float));
+		}
+		return static_cast<bool>(file);
+	}
+};
+
+#endif
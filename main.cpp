@@ -4,6 +4,8 @@
 
 #include "Default3d.h"
 #include "Dynamic3d.hpp"
+#include "Impostor3d.hpp"
+#include "Shadow3d.hpp"
 #include "level.h"
 #include "player_camera.h"
 #include "debug_camera.h"
@@ -17,6 +19,8 @@
 #include "ZMapper.h"
 #include "sound.hpp"
 #include "CollisionVisualizer.hpp"
+#include "frame_scheduler.hpp"
+#include "bench/bench.hpp"
 
 #include <GLFW/glfw3.h>
 
@@ -25,7 +29,7 @@
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 
-int main(void)
+int main(int argc, char** argv)
 {
     GLFWwindow* window;
 
@@ -57,6 +61,12 @@ int main(void)
         return -1;
     }
 
+    //--bench runs benchmarks instead of the game
+    if (runBenchmarks(argc, argv, window)) {
+        glfwTerminate();
+        return 0;
+    }
+
     //HboxGraphics hboxGraphics;
 
 
@@ -65,22 +75,30 @@ int main(void)
     DebugCamera center("debug_cam");
     DebugPlayer dbg_player;
     dbg_player.activateKeyInput(window);
+    //someone standing in the impluvium for the player to walk into
+    Humanoid bystander("bystander");
+    bystander.setPosition((Eigen::Matrix4f() << 1, 0, 0, 1.5, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1).finished());
     PlayerCamera camera(.1, 5000, 90, 1600,1200,1.0, "player1cam");
-    CollisionPair<Surface<3>, MeshSurface> tester(center.getHitbox(),center.getPosition(), dbg_player.getHitbox(),dbg_player.getPosition(),dbg_player.getdG());
-    center.addCollisionPair(&dbg_player,&tester);
 
     camera.activateKeyInput(window);
     Default3d default3d;
     default3d.setCamera(&camera);
     Eigen::Vector3f atmosphere_color = Eigen::Vector3f(0.7f, 0.7f, 0.7f);
     default3d.setAtmosphere(atmosphere_color,.2);
+    Impostor3d impostor3d(default3d);
     Dynamic3d dynamic3d;
     dynamic3d.setCamera(&camera);
+    Scene::orthogonalLight sun;
+    sun.direction_ = Eigen::Vector3f(-.3f, -1, -.2f).normalized();
+    sun.brightness = .6f;
+    default3d.setShadowLight(&sun);
+    dynamic3d.setShadowLight(&sun);
     Default2d default2d;
     HboxGraphics hbox_graphics(camera, .1, 100, 90);
     Font test_glyph("test_glyph.png");
     TextGraphics text_graphics(test_glyph);
     CollisionVisualizer collision_visualizer;
+    collision_visualizer.setCamera(&camera);
 
     DebugMenu debugMenu(window, default2d, text_graphics, collision_visualizer);
 
@@ -142,6 +160,17 @@ int main(void)
     cult_ritual.createZmapCollisionSurface(4, &zmapper);
     path_to_town.createZmapCollisionSurface(6, &zmapper);
 
+    //the player and camera can walk into any level, so they are in every level's collision world.
+    //the camera running into the player is found by the broad phase
+    for (Level* level : Level::AllLevels()) {
+        dbg_player.addHitboxTo(level->getCollisionWorld(), CollisionWorld::player_layer, CollisionWorld::camera_layer | CollisionWorld::npc_layer);
+        //the player's arms and legs against whoever they reach
+        dbg_player.addPosedHitboxTo(level->getCollisionWorld());
+        center.addHitboxTo(level->getCollisionWorld());
+    }
+    //the player walking into them goes through both hitbox hierarchies
+    bystander.addHitboxTo(cult_impluvium.getCollisionWorld());
+
     Sound bkg_music("bkg_music", "EldenRingOSTGodskinApostles.wav");
     //cult_impluvium.setTheme(bkg_music);
     Level::goToLevel(&cult_impluvium);
@@ -152,19 +181,24 @@ int main(void)
 
 
     //room1.add(camera); //shouldnt be part of the layout
-    default3d.add(cult_spiral_stairs);
-    default3d.add(cult_landing);
-    default3d.add(cult_hallway1);
-    default3d.add(cult_stairs1);
-    default3d.add(cult_impluvium);
-    default3d.add(cult_ritual);
-    default3d.add(path_to_town);
+    //the levels have no lamps of their own yet, so this only bakes ambient occlusion. it has to
+    //happen before the static batch is built, that is where the baked values get uploaded
+    std::vector<BakeLight> level_lights;
+    Level::bakeLighting({ &cult_spiral_stairs, &cult_landing, &cult_hallway1, &cult_stairs1, &cult_impluvium, &cult_ritual, &path_to_town }, level_lights);
+    //levels never move and all share rocky_texture, so they go in one static batch
+    default3d.addStatic({ &cult_spiral_stairs, &cult_landing, &cult_hallway1, &cult_stairs1, &cult_impluvium, &cult_ritual, &path_to_town });
+    //far away levels swap to impostor cards
+    for (Level* level : { &cult_spiral_stairs, &cult_landing, &cult_hallway1, &cult_stairs1, &cult_impluvium, &cult_ritual, &path_to_town }) {
+        impostor3d.add(*level);
+    }
 
     dynamic3d.add(dbg_player);
+    dynamic3d.add(bystander);
 
     //Button test_button(.5, .5, "test_button");
    
     debugMenu.activateKeyInput(window);
+    debugMenu.watchRenderer(&default3d);
     //debugMenu.setDebugTarget(&center);
 
     //Debugger dbg1(Eigen::Matrix4f::Identity(), "tester1", cult_spiral_stairs);
@@ -174,6 +208,14 @@ int main(void)
     dynamic3d.add(center);
     hbox_graphics.add(center);
 
+    //the levels are cached in the shadow map once, only the moving things are redrawn each frame
+    Shadow3d shadow3d(default3d);
+    shadow3d.add(dbg_player);
+    shadow3d.add(bystander);
+    shadow3d.add(center);
+    default3d.setShadows(shadow3d.getShadowInfo());
+    dynamic3d.setShadows(shadow3d.getShadowInfo());
+
     glfwSetWindowSize(window, 1600, 1200);
 
     //camera.setParent(&center);
@@ -223,8 +265,17 @@ int main(void)
     named_internal_objects_and levels. thus at this point every named object
     can read from/write ascociated files*/
 
+    FrameScheduler::Settings frame_settings = FrameScheduler::defaultSettings();
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--frame-log") {
+            frame_settings.log_fname = argv[i + 1];
+        }
+    }
+    FrameScheduler frame_scheduler(window, frame_settings);
+
     while (!glfwWindowShouldClose(window))
     {
+        frame_scheduler.beginFrame();
         //poll inputs
         glfwPollEvents();
 
@@ -233,25 +284,37 @@ int main(void)
         camera.update(window);
         debugMenu.update(window);
         
-        //draw everything
-        if (camera.getScreenshotFlag()) {
+        //draw everything. screenshots are taken at full resolution, otherwise the 3d passes go
+        //through the scheduler's scaled target
+        bool screenshot = camera.getScreenshotFlag();
+        if (screenshot) {
             default3d.startScreenshot(screenshot_width, screenshot_height);
+        } else {
+            frame_scheduler.beginScene();
         }
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glClearColor(atmosphere_color(0),atmosphere_color(1),atmosphere_color(2), 1.0f);
 
+        shadow3d.drawAll(); //before anything lit, they sample it
+        impostor3d.drawAll(); //before default3d, it decides what default3d skips
         default3d.drawAll();
         dynamic3d.drawAll();
         hbox_graphics.drawAll();
+        collision_visualizer.drawAll(); //the debug target's collision pairs, drawn over everything
+        if (!screenshot) {
+            frame_scheduler.endScene();
+        }
         default2d.drawAll();
         text_graphics.drawAll();
 
-        if (camera.getScreenshotFlag()) {
+        if (screenshot) {
             default3d.finishScreenshot<uint8_t, GL_UNSIGNED_BYTE>(&screenshot_buffer,"screenshot.png");
             camera.clearScreenshotFlag();
             //stbi_write_png("screenshot.png", screenshot_width, screenshot_height, screenshot_buffers, screenshot_buffer.data(), screenshot_width * screenshot_buffers);
         } 
+        GLState::endFrame();
+        frame_scheduler.endFrame();
         glfwSwapBuffers(window);
 
     }
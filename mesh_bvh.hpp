@@ -0,0 +1,576 @@
+#pragma once
+
+#ifndef PUPPET_MESH_BVH
+#define PUPPET_MESH_BVH
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <climits>
+#include <limits>
+
+#include "triangle_soa.hpp"
+
+//bounding volume hierarchy over a mesh's faces for segment queries. built once, in the mesh's own
+//frame, with the surface area heuristic over binned centroids. a moving mesh is queried by moving
+//the segments into its frame (what CollisionPair already does), never by rebuilding the tree.
+//nodes are flattened depth first, so the first child of a node is the next node and only the second
+//child's index is stored. each leaf's faces sit in their own run of whole packs in a TriangleSoA,
+//so a leaf is tested with the same simd kernel as a linear scan
+class MeshBVH {
+public:
+	typedef std::pair<Eigen::Vector3f, Eigen::Vector3f> Segment;
+
+	struct Node {
+		Eigen::Vector3f min, max;
+		int offset; //leaf: first slot, inner: index of the second child
+		int n_slots; //0 for inner nodes
+		int first_face; //lowest face index anywhere below, lets the first hit search skip subtrees
+	};
+
+private:
+	static constexpr int n_bins_ = 12;
+	static constexpr int max_leaf_ = 4 * TriangleSoA::lanes() < 8 ? 8 : 4 * TriangleSoA::lanes(); //leaves are split past this even if sah says not to
+	static constexpr float traversal_cost_ = 1.f; //relative to one triangle test
+	static constexpr int max_depth_ = 64;
+
+	std::vector<Node> nodes_;
+	TriangleSoA triangles_;
+	std::vector<int> slot_faces_; //face of each slot, -1 for padding
+
+	struct BuildFace {
+		Eigen::AlignedBox3f box;
+		Eigen::Vector3f centroid;
+		int face;
+	};
+
+	//the segment set up for slab tests against node boxes
+	struct Ray {
+		Eigen::Vector3f origin;
+		Eigen::Vector3f inv_dir;
+	};
+
+	static Ray makeRay(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) {
+		Eigen::Vector3f dir = e2 - e1;
+		return { e1, Eigen::Vector3f(1.f / dir(0), 1.f / dir(1), 1.f / dir(2)) };
+	}
+
+	//does the part of the segment between 0 and max_t go through the node's box
+	static bool overlaps(const Ray& ray, const Node& node, float max_t = 1) {
+		return overlaps(ray, node.min, node.max, max_t);
+	}
+
+	static bool overlaps(const Ray& ray, const Eigen::Vector3f& min, const Eigen::Vector3f& max, float max_t) {
+		float t_min = 0;
+		float t_max = max_t;
+		for (int axis = 0; axis < 3; axis++) {
+			float t0 = (min(axis) - ray.origin(axis)) * ray.inv_dir(axis);
+			float t1 = (max(axis) - ray.origin(axis)) * ray.inv_dir(axis);
+			if (t0 > t1) {
+				std::swap(t0, t1);
+			}
+			//nan (a flat segment on the slab's boundary) leaves the range as it was
+			t_min = t0 > t_min ? t0 : t_min;
+			t_max = t1 < t_max ? t1 : t_max;
+			if (t_min > t_max) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static float area(const Eigen::AlignedBox3f& box) {
+		if (box.isEmpty()) {
+			return 0;
+		}
+		Eigen::Vector3f d = box.sizes();
+		return 2 * (d(0) * d(1) + d(1) * d(2) + d(2) * d(0));
+	}
+
+	int makeLeaf(int node_index, std::vector<BuildFace>& faces, int begin, int end, const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& mesh_faces) {
+		Node& node = nodes_[node_index];
+		node.offset = static_cast<int>(triangles_.slots());
+		node.first_face = INT_MAX;
+		for (int i = begin; i < end; i++) {
+			const auto& [a, b, c] = mesh_faces[faces[i].face];
+			triangles_.add(verts[a], verts[b], verts[c]);
+			slot_faces_.push_back(faces[i].face);
+			node.first_face = std::min(node.first_face, faces[i].face);
+		}
+		triangles_.endPack();
+		slot_faces_.resize(triangles_.slots(), -1);
+		node.n_slots = static_cast<int>(triangles_.slots()) - node.offset;
+		return node_index;
+	}
+
+	//returns the index of the node made for faces[begin, end)
+	int build(std::vector<BuildFace>& faces, int begin, int end, int depth, const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& mesh_faces) {
+		int node_index = static_cast<int>(nodes_.size());
+		nodes_.push_back(Node{});
+
+		Eigen::AlignedBox3f box;
+		Eigen::AlignedBox3f centroid_box;
+		for (int i = begin; i < end; i++) {
+			box.extend(faces[i].box);
+			centroid_box.extend(faces[i].centroid);
+		}
+		//a little slack so a hit exactly on a face of the box cant be missed to rounding
+		Eigen::Vector3f slack = Eigen::Vector3f::Constant(1e-5f * box.sizes().maxCoeff() + 1e-7f);
+		nodes_[node_index].min = box.min() - slack;
+		nodes_[node_index].max = box.max() + slack;
+		nodes_[node_index].n_slots = 0;
+
+		int count = end - begin;
+		if (count <= TriangleSoA::lanes() || depth >= max_depth_) {
+			return makeLeaf(node_index, faces, begin, end, verts, mesh_faces);
+		}
+
+		//binned sah, cost of a split is the child areas times their face counts
+		int best_axis = -1;
+		int best_split = 0;
+		float best_cost = std::numeric_limits<float>::max();
+		Eigen::Vector3f extent = centroid_box.sizes();
+		for (int axis = 0; axis < 3; axis++) {
+			if (extent(axis) <= 0) {
+				continue;
+			}
+			Eigen::AlignedBox3f bin_boxes[n_bins_];
+			int bin_counts[n_bins_] = {};
+			float scale = n_bins_ / extent(axis);
+			for (int i = begin; i < end; i++) {
+				int bin = std::min(n_bins_ - 1, static_cast<int>((faces[i].centroid(axis) - centroid_box.min()(axis)) * scale));
+				bin_boxes[bin].extend(faces[i].box);
+				bin_counts[bin]++;
+			}
+			//sweep from the right so each split's right side is ready, then from the left
+			float right_areas[n_bins_];
+			int right_counts[n_bins_];
+			Eigen::AlignedBox3f right_box;
+			int right_count = 0;
+			for (int bin = n_bins_ - 1; bin > 0; bin--) {
+				right_box.extend(bin_boxes[bin]);
+				right_count += bin_counts[bin];
+				right_areas[bin] = area(right_box);
+				right_counts[bin] = right_count;
+			}
+			Eigen::AlignedBox3f left_box;
+			int left_count = 0;
+			for (int split = 1; split < n_bins_; split++) {
+				left_box.extend(bin_boxes[split - 1]);
+				left_count += bin_counts[split - 1];
+				if (left_count == 0 || right_counts[split] == 0) {
+					continue;
+				}
+				float cost = area(left_box) * left_count + right_areas[split] * right_counts[split];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_split = split;
+				}
+			}
+		}
+
+		float leaf_cost = static_cast<float>(count);
+		float split_cost = traversal_cost_ + best_cost / std::max(area(box), 1e-12f);
+		if (best_axis < 0 || (split_cost >= leaf_cost && count <= max_leaf_)) {
+			if (best_axis < 0 && count > max_leaf_) {
+				//every centroid in the same place, sah cant tell them apart, halve by index
+				int middle = begin + count / 2;
+				return splitAt(node_index, faces, begin, middle, end, depth, verts, mesh_faces);
+			}
+			return makeLeaf(node_index, faces, begin, end, verts, mesh_faces);
+		}
+
+		float scale = n_bins_ / extent(best_axis);
+		float axis_min = centroid_box.min()(best_axis);
+		BuildFace* middle = std::partition(faces.data() + begin, faces.data() + end, [&](const BuildFace& f) {
+			return std::min(n_bins_ - 1, static_cast<int>((f.centroid(best_axis) - axis_min) * scale)) < best_split;
+		});
+		return splitAt(node_index, faces, begin, static_cast<int>(middle - faces.data()), end, depth, verts, mesh_faces);
+	}
+
+	int splitAt(int node_index, std::vector<BuildFace>& faces, int begin, int middle, int end, int depth, const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& mesh_faces) {
+		int left = build(faces, begin, middle, depth + 1, verts, mesh_faces);
+		int right = build(faces, middle, end, depth + 1, verts, mesh_faces);
+		nodes_[node_index].offset = right;
+		nodes_[node_index].first_face = std::min(nodes_[left].first_face, nodes_[right].first_face);
+		return node_index;
+	}
+
+	//calls on_hit(face, k) for every face in the leaf the segment crosses, stops early if it returns true
+	template<class OnHit>
+	bool testLeaf(const Node& node, const TriangleSoA::Segment& segment, OnHit on_hit) const {
+		float ks[TriangleSoA::lanes()];
+		for (int first = node.offset; first < node.offset + node.n_slots; first += TriangleSoA::lanes()) {
+			int bits = triangles_.testPack(segment, first, ks);
+			for (int lane = 0; bits != 0; lane++, bits >>= 1) {
+				if ((bits & 1) && on_hit(slot_faces_[first + lane], ks[lane])) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	//packet traversal for the batch queries: segments still in play are filtered at every node, so
+	//a node is fetched once for the whole batch. the segments in play at a node are
+	//active[begin, end), the ones that make it into the node are appended after them and dropped
+	//again on the way back up. returns true if it stopped early
+	bool traverseBatch(int node_index, const std::vector<Segment>& segments, const std::vector<Ray>& rays, std::vector<int>& active, size_t begin, size_t end, std::vector<bool>* hits) const {
+		const Node& node = nodes_[node_index];
+		size_t here = active.size();
+		for (size_t i = begin; i < end; i++) {
+			int s = active[i];
+			if (!(hits != nullptr && (*hits)[s]) && overlaps(rays[s], node)) {
+				active.push_back(s);
+			}
+		}
+		size_t here_end = active.size();
+		bool stopped = false;
+		if (here == here_end) {
+			//nothing got in
+		} else if (node.n_slots > 0) {
+			for (size_t i = here; i < here_end && !stopped; i++) {
+				int s = active[i];
+				TriangleSoA::Segment segment = TriangleSoA::makeSegment(segments[s].first, segments[s].second);
+				if (testLeaf(node, segment, [](int, float) { return true; })) {
+					if (hits == nullptr) {
+						stopped = true;
+					} else {
+						(*hits)[s] = true;
+					}
+				}
+			}
+		} else {
+			stopped = traverseBatch(node_index + 1, segments, rays, active, here, here_end, hits)
+				|| traverseBatch(node.offset, segments, rays, active, here, here_end, hits);
+		}
+		active.resize(here);
+		return stopped;
+	}
+
+	//traverseBatch for the nearest hit of each segment, a segment only gets into a node if the node is
+	//nearer than the best hit it has so far
+	void traverseNearest(int node_index, const std::vector<TriangleSoA::Segment>& segments, const std::vector<Ray>& rays, std::vector<int>& active, size_t begin, size_t end, std::vector<int>* faces, std::vector<float>* ks) const {
+		const Node& node = nodes_[node_index];
+		size_t here = active.size();
+		for (size_t i = begin; i < end; i++) {
+			int s = active[i];
+			if (overlaps(rays[s], node, (*ks)[s])) {
+				active.push_back(s);
+			}
+		}
+		size_t here_end = active.size();
+		if (here == here_end) {
+			//nothing got in
+		} else if (node.n_slots > 0) {
+			for (size_t i = here; i < here_end; i++) {
+				int s = active[i];
+				int& best_face = (*faces)[s];
+				float& best_k = (*ks)[s];
+				testLeaf(node, segments[s], [&](int face, float hit_k) {
+					if (hit_k < best_k || (hit_k == best_k && (best_face < 0 || face < best_face))) {
+						best_face = face;
+						best_k = hit_k;
+					}
+					return false;
+				});
+			}
+		} else {
+			traverseNearest(node_index + 1, segments, rays, active, here, here_end, faces, ks);
+			traverseNearest(node.offset, segments, rays, active, here, here_end, faces, ks);
+		}
+		active.resize(here);
+	}
+
+	//sets up the rays and the first active list for traverseBatch
+	bool startBatch(const std::vector<Segment>& segments, std::vector<bool>* hits) const {
+		std::vector<Ray> rays;
+		std::vector<int> active;
+		rays.reserve(segments.size());
+		active.reserve(4 * segments.size());
+		for (int i = 0; i < segments.size(); i++) {
+			rays.push_back(makeRay(segments[i].first, segments[i].second));
+			active.push_back(i);
+		}
+		return traverseBatch(0, segments, rays, active, 0, active.size(), hits);
+	}
+
+public:
+	MeshBVH() {}
+
+	void build(const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& mesh_faces) {
+		clear();
+		if (mesh_faces.empty()) {
+			return;
+		}
+		std::vector<BuildFace> faces(mesh_faces.size());
+		for (int i = 0; i < mesh_faces.size(); i++) {
+			const auto& [a, b, c] = mesh_faces[i];
+			faces[i].box = Eigen::AlignedBox3f(verts[a]);
+			faces[i].box.extend(verts[b]);
+			faces[i].box.extend(verts[c]);
+			faces[i].centroid = (verts[a] + verts[b] + verts[c]) / 3;
+			faces[i].face = i;
+		}
+		nodes_.reserve(2 * mesh_faces.size() / TriangleSoA::lanes() + 1);
+		build(faces, 0, static_cast<int>(faces.size()), 0, verts, mesh_faces);
+	}
+
+	//for when the verts have moved but the faces are the same, the tree keeps its shape and only the
+	//triangles and boxes are redone, children before parents. it gets slower to search the further the
+	//mesh gets from the shape it was built in, build again if that is a long way
+	void refit(const std::vector<Eigen::Vector3f>& verts, const std::vector<std::tuple<int, int, int>>& mesh_faces) {
+		for (int node_index = static_cast<int>(nodes_.size()) - 1; node_index >= 0; node_index--) {
+			Node& node = nodes_[node_index];
+			Eigen::AlignedBox3f box;
+			if (node.n_slots > 0) {
+				for (int slot = node.offset; slot < node.offset + node.n_slots; slot++) {
+					if (slot_faces_[slot] < 0) {
+						continue;
+					}
+					const auto& [a, b, c] = mesh_faces[slot_faces_[slot]];
+					triangles_.set(slot, verts[a], verts[b], verts[c]);
+					box.extend(verts[a]);
+					box.extend(verts[b]);
+					box.extend(verts[c]);
+				}
+			} else {
+				//the left child is always the next node
+				const Node& left = nodes_[node_index + 1];
+				const Node& right = nodes_[node.offset];
+				box = Eigen::AlignedBox3f(left.min.cwiseMin(right.min), left.max.cwiseMax(right.max));
+			}
+			Eigen::Vector3f slack = Eigen::Vector3f::Constant(1e-5f * box.sizes().maxCoeff() + 1e-7f);
+			node.min = box.min() - slack;
+			node.max = box.max() + slack;
+		}
+	}
+
+	void clear() {
+		nodes_.clear();
+		triangles_.clear();
+		slot_faces_.clear();
+	}
+
+	bool isBuilt() const {
+		return !nodes_.empty();
+	}
+
+	//does the segment e1 e2 cross any face
+	bool anyHit(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) const {
+		if (nodes_.empty()) {
+			return false;
+		}
+		Ray ray = makeRay(e1, e2);
+		TriangleSoA::Segment segment = TriangleSoA::makeSegment(e1, e2);
+		int stack[max_depth_ + 1];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0) {
+			const Node& node = nodes_[stack[--stack_size]];
+			if (!overlaps(ray, node)) {
+				continue;
+			}
+			if (node.n_slots > 0) {
+				if (testLeaf(node, segment, [](int, float) { return true; })) {
+					return true;
+				}
+				continue;
+			}
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = static_cast<int>(&node - nodes_.data()) + 1;
+		}
+		return false;
+	}
+
+	//the lowest index face the segment crosses, -1 for none, with k where along the segment. the
+	//same face a linear scan in face order would stop at
+	int firstHit(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, float* k) const {
+		if (nodes_.empty()) {
+			return -1;
+		}
+		Ray ray = makeRay(e1, e2);
+		TriangleSoA::Segment segment = TriangleSoA::makeSegment(e1, e2);
+		int best_face = INT_MAX;
+		float best_k = 0;
+		int stack[max_depth_ + 1];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0) {
+			const Node& node = nodes_[stack[--stack_size]];
+			if (node.first_face >= best_face || !overlaps(ray, node)) {
+				continue;
+			}
+			if (node.n_slots > 0) {
+				testLeaf(node, segment, [&](int face, float hit_k) {
+					if (face < best_face) {
+						best_face = face;
+						best_k = hit_k;
+					}
+					return false;
+				});
+				continue;
+			}
+			//the child with the lower faces goes on top so it is searched first
+			int first_child = static_cast<int>(&node - nodes_.data()) + 1;
+			int second_child = node.offset;
+			if (nodes_[first_child].first_face > nodes_[second_child].first_face) {
+				std::swap(first_child, second_child);
+			}
+			stack[stack_size++] = second_child;
+			stack[stack_size++] = first_child;
+		}
+		if (best_face == INT_MAX) {
+			return -1;
+		}
+		if (k != nullptr) {
+			*k = best_k;
+		}
+		return best_face;
+	}
+
+	//the face the segment crosses first going from e1, -1 for none, with k where along the segment.
+	//ties go to the lower face index, same as TriangleSoA::nearestHit on the faces in order
+	int nearestHit(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, float* k) const {
+		if (nodes_.empty()) {
+			return -1;
+		}
+		Ray ray = makeRay(e1, e2);
+		TriangleSoA::Segment segment = TriangleSoA::makeSegment(e1, e2);
+		int best_face = -1;
+		float best_k = 1;
+		int stack[max_depth_ + 1];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0) {
+			const Node& node = nodes_[stack[--stack_size]];
+			//nothing past the best hit so far can beat it
+			if (!overlaps(ray, node, best_k)) {
+				continue;
+			}
+			if (node.n_slots > 0) {
+				testLeaf(node, segment, [&](int face, float hit_k) {
+					if (best_face < 0 || hit_k < best_k || (hit_k == best_k && face < best_face)) {
+						best_face = face;
+						best_k = hit_k;
+					}
+					return false;
+				});
+				continue;
+			}
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = static_cast<int>(&node - nodes_.data()) + 1;
+		}
+		if (best_face >= 0 && k != nullptr) {
+			*k = best_k;
+		}
+		return best_face;
+	}
+
+	//does any of the segments cross any face
+	bool anyHit(const std::vector<Segment>& segments) const {
+		if (nodes_.empty() || segments.empty()) {
+			return false;
+		}
+		return startBatch(segments, nullptr);
+	}
+
+	//hits[i] is whether segments[i] crosses any face
+	void hitEach(const std::vector<Segment>& segments, std::vector<bool>* hits) const {
+		hits->assign(segments.size(), false);
+		if (nodes_.empty() || segments.empty()) {
+			return;
+		}
+		startBatch(segments, hits);
+	}
+
+	//nearestHit for every segment at once, down the tree together the same way as hitEach. faces[i]
+	//is the face segments[i] crosses first, -1 for none, and ks[i] where. a face has to be nearer than
+	//what ks[i] already holds to count, so ks can carry hits on other meshes over, 1 for nothing yet
+	void nearestEach(const std::vector<Segment>& segments, std::vector<int>* faces, std::vector<float>* ks) const {
+		faces->assign(segments.size(), -1);
+		if (nodes_.empty() || segments.empty()) {
+			return;
+		}
+		std::vector<TriangleSoA::Segment> soa_segments;
+		std::vector<Ray> rays;
+		std::vector<int> active;
+		soa_segments.reserve(segments.size());
+		rays.reserve(segments.size());
+		active.reserve(4 * segments.size());
+		for (int i = 0; i < segments.size(); i++) {
+			soa_segments.push_back(TriangleSoA::makeSegment(segments[i].first, segments[i].second));
+			rays.push_back(makeRay(segments[i].first, segments[i].second));
+			active.push_back(i);
+		}
+		traverseNearest(0, soa_segments, rays, active, 0, active.size(), faces, ks);
+	}
+
+	//every face the segment crosses with k where, in no particular order
+	void allHits(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, std::vector<std::pair<int, float>>* hits) const {
+		hits->clear();
+		if (nodes_.empty()) {
+			return;
+		}
+		Ray ray = makeRay(e1, e2);
+		TriangleSoA::Segment segment = TriangleSoA::makeSegment(e1, e2);
+		int stack[max_depth_ + 1];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0) {
+			const Node& node = nodes_[stack[--stack_size]];
+			if (!overlaps(ray, node)) {
+				continue;
+			}
+			if (node.n_slots > 0) {
+				testLeaf(node, segment, [&](int face, float hit_k) {
+					hits->emplace_back(face, hit_k);
+					return false;
+				});
+				continue;
+			}
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = static_cast<int>(&node - nodes_.data()) + 1;
+		}
+	}
+
+	//for shapes swept along the segment rather than a point. visit(face, max_k) is called for every
+	//face in a leaf whose box, grown by grow on each side, the segment goes through before max_k, and
+	//returns the max_k to go on with, so a search for the nearest can shrink it as it finds hits
+	template<class Visit>
+	void sweptFaces(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, const Eigen::Vector3f& grow, Visit visit) const {
+		if (nodes_.empty()) {
+			return;
+		}
+		Ray ray = makeRay(e1, e2);
+		float max_k = 1;
+		int stack[max_depth_ + 1];
+		int stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0) {
+			const Node& node = nodes_[stack[--stack_size]];
+			if (!overlaps(ray, node.min - grow, node.max + grow, max_k)) {
+				continue;
+			}
+			if (node.n_slots > 0) {
+				for (int slot = node.offset; slot < node.offset + node.n_slots; slot++) {
+					if (slot_faces_[slot] >= 0) {
+						max_k = visit(slot_faces_[slot], max_k);
+					}
+				}
+				continue;
+			}
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = static_cast<int>(&node - nodes_.data()) + 1;
+		}
+	}
+
+	const std::vector<Node>& getNodes() const {
+		return nodes_;
+	}
+};
+
+#endif
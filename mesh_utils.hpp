@@ -1 +1,392 @@
 #pragma once
+
+#ifndef PUPPET_MESH_UTILS
+#define PUPPET_MESH_UTILS
+
+#include <Eigen/Dense>
+#include <vector>
+#include <array>
+#include <map>
+#include <queue>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+#include "Model.h"
+
+//quadric error simplification (garland & heckbert) of a models triangle soup. collapses are half
+//edge, a vertex always moves onto one of its neighbours so normals and uvs are copied over, never
+//interpolated. open borders and uv/normal seams get extra planes in the quadrics so they keep their
+//shape, and a vertex on a seam can only slide along it. simplify can be called repeatedly with
+//smaller targets, each call continues from where the last one stopped
+class MeshSimplifier {
+	//one distinct (position, normal, uv) combination. a position on a seam has several
+	struct Wedge {
+		int pos;
+		Eigen::Vector3f norm;
+		Eigen::Vector2f uv;
+	};
+
+	struct Candidate {
+		double cost;
+		int from;
+		int to;
+		int version; //of from, the candidate is stale once froms quadric changes
+
+		bool operator>(const Candidate& other) const {
+			return cost > other.cost;
+		}
+	};
+
+	static constexpr double seam_weight_ = 10.;
+	static constexpr float min_normal_dot_ = .2f; //collapses that turn a face further than this are rejected
+
+	std::vector<Eigen::Vector3f> positions_;
+	std::vector<Eigen::Matrix4d> quadrics_;
+	std::vector<double> areas_; //face area summed into each quadric, turns the error into a squared distance
+	std::vector<std::vector<int>> pos_faces_; //can still hold dead faces
+	std::vector<int> versions_;
+	std::vector<bool> pos_alive_;
+	std::vector<Wedge> wedges_;
+	std::vector<std::array<int, 3>> faces_; //wedge indices
+	std::vector<bool> face_alive_;
+	size_t n_alive_faces_;
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue_;
+
+	int facePos(int face, int corner) const {
+		return wedges_[faces_[face][corner]].pos;
+	}
+
+	int findCorner(int face, int pos) const {
+		for (int c = 0; c < 3; c++) {
+			if (facePos(face, c) == pos) {
+				return c;
+			}
+		}
+		return -1;
+	}
+
+	Eigen::Vector3f faceNormal(int face) const {
+		const Eigen::Vector3f& a = positions_[facePos(face, 0)];
+		return (positions_[facePos(face, 1)] - a).cross(positions_[facePos(face, 2)] - a);
+	}
+
+	static Eigen::Matrix4d planeQuadric(const Eigen::Vector3f& normal, const Eigen::Vector3f& point, double weight) {
+		Eigen::Vector4d plane;
+		plane << normal.cast<double>(), -normal.dot(point);
+		return weight * plane * plane.transpose();
+	}
+
+	//roughly the squared distance to from's original planes
+	double cost(int from, int to) const {
+		Eigen::Vector4d v;
+		v << positions_[to].cast<double>(), 1;
+		return v.dot(quadrics_[from] * v) / std::max(areas_[from], 1e-12);
+	}
+
+	void push(int from, int to) {
+		queue_.push(Candidate{ cost(from, to), from, to, versions_[from] });
+	}
+
+	//works out which wedge at to each wedge at from turns into. every wedge that survives the
+	//collapse needs a partner along the collapsed edge, otherwise from is on a seam that doesnt run
+	//along this edge and moving it would tear the uvs
+	bool checkCollapse(int from, int to, std::map<int, int>& wedge_map) const {
+		bool shared_edge = false;
+		for (int f : pos_faces_[from]) {
+			if (!face_alive_[f]) {
+				continue;
+			}
+			int c_to = findCorner(f, to);
+			if (c_to < 0) {
+				continue;
+			}
+			shared_edge = true;
+			int w_from = faces_[f][findCorner(f, from)];
+			int w_to = faces_[f][c_to];
+			auto it = wedge_map.find(w_from);
+			if (it != wedge_map.end() && it->second != w_to) {
+				return false;
+			}
+			wedge_map[w_from] = w_to;
+		}
+		if (!shared_edge) {
+			return false;
+		}
+
+		for (int f : pos_faces_[from]) {
+			if (!face_alive_[f] || findCorner(f, to) >= 0) {
+				continue;
+			}
+			int c_from = findCorner(f, from);
+			if (!wedge_map.contains(faces_[f][c_from])) {
+				return false;
+			}
+			Eigen::Vector3f old_normal = faceNormal(f);
+			std::array<Eigen::Vector3f, 3> p = { positions_[facePos(f, 0)], positions_[facePos(f, 1)], positions_[facePos(f, 2)] };
+			p[c_from] = positions_[to];
+			Eigen::Vector3f new_normal = (p[1] - p[0]).cross(p[2] - p[0]);
+			if (new_normal.squaredNorm() < 1e-12f || old_normal.normalized().dot(new_normal.normalized()) < min_normal_dot_) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void collapse(int from, int to, const std::map<int, int>& wedge_map) {
+		for (int f : pos_faces_[from]) {
+			if (!face_alive_[f]) {
+				continue;
+			}
+			if (findCorner(f, to) >= 0) {
+				face_alive_[f] = false;
+				n_alive_faces_--;
+				continue;
+			}
+			int c_from = findCorner(f, from);
+			faces_[f][c_from] = wedge_map.at(faces_[f][c_from]);
+			pos_faces_[to].push_back(f);
+		}
+		pos_alive_[from] = false;
+		pos_faces_[from].clear();
+		quadrics_[to] += quadrics_[from];
+		areas_[to] += areas_[from];
+		versions_[to]++;
+
+		std::erase_if(pos_faces_[to], [this](int f) {return !face_alive_[f]; });
+		for (int f : pos_faces_[to]) {
+			for (int c = 0; c < 3; c++) {
+				int other = facePos(f, c);
+				if (other != to) {
+					push(to, other);
+					push(other, to);
+				}
+			}
+		}
+	}
+
+public:
+	MeshSimplifier(const Model& model) : n_alive_faces_(0) {
+		const std::vector<float>& verts = model.getVerts();
+		const std::vector<float>& norms = model.getNorms();
+		const std::vector<float>& tex_coords = model.getTexCoords();
+
+		//weld the soup back together, by position for the topology and by all attributes for wedges
+		std::map<std::array<float, 3>, int> pos_ids;
+		std::map<std::array<float, 8>, int> wedge_ids;
+		faces_.resize(model.flen());
+		for (int i = 0; i < 3 * model.flen(); i++) {
+			std::array<float, 3> p = { verts[3 * i], verts[3 * i + 1], verts[3 * i + 2] };
+			auto pos_it = pos_ids.try_emplace(p, static_cast<int>(positions_.size())).first;
+			if (pos_it->second == positions_.size()) {
+				positions_.push_back(Eigen::Vector3f(p[0], p[1], p[2]));
+			}
+			std::array<float, 8> w = { p[0], p[1], p[2], norms[3 * i], norms[3 * i + 1], norms[3 * i + 2], tex_coords[2 * i], tex_coords[2 * i + 1] };
+			auto wedge_it = wedge_ids.try_emplace(w, static_cast<int>(wedges_.size())).first;
+			if (wedge_it->second == wedges_.size()) {
+				wedges_.push_back(Wedge{ pos_it->second, Eigen::Vector3f(w[3], w[4], w[5]), Eigen::Vector2f(w[6], w[7]) });
+			}
+			faces_[i / 3][i % 3] = wedge_it->second;
+		}
+
+		quadrics_.assign(positions_.size(), Eigen::Matrix4d::Zero());
+		areas_.assign(positions_.size(), 0.);
+		pos_faces_.resize(positions_.size());
+		versions_.assign(positions_.size(), 0);
+		pos_alive_.assign(positions_.size(), true);
+		face_alive_.assign(faces_.size(), false);
+
+		//pos edge (low, high) -> (face, wedge at low, wedge at high) for every face using it
+		std::map<std::pair<int, int>, std::vector<std::array<int, 3>>> edges;
+		for (int f = 0; f < faces_.size(); f++) {
+			Eigen::Vector3f normal = faceNormal(f);
+			float area2 = normal.norm();
+			if (facePos(f, 0) == facePos(f, 1) || facePos(f, 1) == facePos(f, 2) || facePos(f, 0) == facePos(f, 2) || area2 == 0) {
+				continue; //degenerate, just drop it
+			}
+			face_alive_[f] = true;
+			n_alive_faces_++;
+			normal /= area2;
+			for (int c = 0; c < 3; c++) {
+				int p = facePos(f, c);
+				quadrics_[p] += planeQuadric(normal, positions_[p], .5 * area2);
+				areas_[p] += .5 * area2;
+				pos_faces_[p].push_back(f);
+
+				int q = facePos(f, (c + 1) % 3);
+				int w_p = faces_[f][c];
+				int w_q = faces_[f][(c + 1) % 3];
+				if (p < q) {
+					edges[{p, q}].push_back({ f, w_p, w_q });
+				} else {
+					edges[{q, p}].push_back({ f, w_q, w_p });
+				}
+			}
+		}
+
+		//a border has one face, a seam has two that disagree on the wedges. either way pin it with a
+		//plane through the edge, perpendicular to the face
+		for (const auto& [ends, users] : edges) {
+			bool seam = users.size() != 2 || users[0][1] != users[1][1] || users[0][2] != users[1][2];
+			if (!seam) {
+				continue;
+			}
+			const Eigen::Vector3f& a = positions_[ends.first];
+			const Eigen::Vector3f& b = positions_[ends.second];
+			for (const auto& user : users) {
+				Eigen::Vector3f normal = (b - a).cross(faceNormal(user[0])).normalized();
+				Eigen::Matrix4d q = planeQuadric(normal, a, seam_weight_ * (b - a).squaredNorm());
+				quadrics_[ends.first] += q;
+				quadrics_[ends.second] += q;
+			}
+		}
+
+		for (const auto& [ends, users] : edges) {
+			push(ends.first, ends.second);
+			push(ends.second, ends.first);
+		}
+	}
+
+	//collapses the cheapest edges until there are at most target_faces left, or the next collapse
+	//would move the surface further than max_error. returns the face count reached
+	size_t simplify(size_t target_faces, float max_error) {
+		std::map<int, int> wedge_map;
+		while (n_alive_faces_ > target_faces && !queue_.empty()) {
+			Candidate candidate = queue_.top();
+			if (candidate.cost > max_error * max_error) {
+				break;
+			}
+			queue_.pop();
+			if (!pos_alive_[candidate.from] || !pos_alive_[candidate.to] || candidate.version != versions_[candidate.from]) {
+				continue;
+			}
+			wedge_map.clear();
+			if (checkCollapse(candidate.from, candidate.to, wedge_map)) {
+				collapse(candidate.from, candidate.to, wedge_map);
+			}
+		}
+		return n_alive_faces_;
+	}
+
+	size_t getNFaces() const {
+		return n_alive_faces_;
+	}
+
+	//the current state as a new model in gl layout
+	std::unique_ptr<Model> makeModel() const {
+		std::vector<float> verts, norms, tex_coords;
+		verts.reserve(9 * n_alive_faces_);
+		norms.reserve(9 * n_alive_faces_);
+		tex_coords.reserve(6 * n_alive_faces_);
+		for (int f = 0; f < faces_.size(); f++) {
+			if (!face_alive_[f]) {
+				continue;
+			}
+			for (int w : faces_[f]) {
+				const Wedge& wedge = wedges_[w];
+				const Eigen::Vector3f& p = positions_[wedge.pos];
+				verts.insert(verts.end(), { p(0), p(1), p(2) });
+				norms.insert(norms.end(), { wedge.norm(0), wedge.norm(1), wedge.norm(2) });
+				tex_coords.insert(tex_coords.end(), { wedge.uv(0), wedge.uv(1) });
+			}
+		}
+		return std::make_unique<Model>(verts, norms, tex_coords);
+	}
+};
+
+//gives the model up to n_lods coarser versions, each with about ratio times the triangles of the
+//one before. the first may move the surface by max_error of the bounding box diagonal, each level
+//after doubles that. stops early once a level barely shrinks
+inline void generateLods(Model& model, int n_lods = 3, float ratio = .5f, float max_error = .01f) {
+	MeshSimplifier simplifier(model);
+	size_t n_faces = simplifier.getNFaces();
+	float error = max_error * model.getBoundingBox().norm();
+	for (int i = 0; i < n_lods; i++, error *= 2) {
+		size_t reached = simplifier.simplify(static_cast<size_t>(n_faces * ratio), error);
+		if (reached == 0 || reached > .9f * n_faces) {
+			break;
+		}
+		model.addLod(simplifier.makeModel());
+		n_faces = reached;
+	}
+}
+
+//fnv-1a of the model's gl data and the settings, what a cached lod chain was generated from
+inline uint64_t lodKey(const Model& model, int n_lods, float ratio, float max_error) {
+	uint64_t key = 14695981039346656037ull;
+	auto mix = [&key](const void* data, size_t n_bytes) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < n_bytes; i++) {
+			key = (key ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	mix(model.getVerts().data(), model.getVerts().size() * sizeof(float));
+	mix(model.getNorms().data(), model.getNorms().size() * sizeof(float));
+	mix(model.getTexCoords().data(), model.getTexCoords().size() * sizeof(float));
+	mix(&n_lods, sizeof(int));
+	mix(&ratio, sizeof(float));
+	mix(&max_error, sizeof(float));
+	return key;
+}
+
+//generateLods, kept in fname so the simplifier only runs once per model. the file is read back if it
+//was made from the same data with the same settings, otherwise the lods are generated again and it is
+//written over. a model that already has lods is left alone
+inline void generateLodsCached(Model& model, const std::string& fname, int n_lods = 3, float ratio = .5f, float max_error = .01f) {
+	if (model.getNLods() > 1) {
+		return;
+	}
+	uint64_t key = lodKey(model, n_lods, ratio, max_error);
+	{
+		std::ifstream file(fname, std::ios::binary);
+		uint64_t stored_key = 0;
+		int n_stored = 0;
+		file.read(reinterpret_cast<char*>(&stored_key), sizeof(uint64_t));
+		file.read(reinterpret_cast<char*>(&n_stored), sizeof(int));
+		if (file && stored_key == key && n_stored >= 0 && n_stored <= n_lods) {
+			std::vector<std::unique_ptr<Model>> lods;
+			for (int lod = 0; lod < n_stored; lod++) {
+				int n_faces = 0;
+				file.read(reinterpret_cast<char*>(&n_faces), sizeof(int));
+				if (!file || n_faces <= 0 || static_cast<size_t>(n_faces) > model.flen()) {
+					break;
+				}
+				std::vector<float> verts(9 * static_cast<size_t>(n_faces)), norms(9 * static_cast<size_t>(n_faces)), tex_coords(6 * static_cast<size_t>(n_faces));
+				file.read(reinterpret_cast<char*>(verts.data()), verts.size() * sizeof(float));
+				file.read(reinterpret_cast<char*>(norms.data()), norms.size() * sizeof(float));
+				file.read(reinterpret_cast<char*>(tex_coords.data()), tex_coords.size() * sizeof(float));
+				if (!file) {
+					break;
+				}
+				lods.push_back(std::make_unique<Model>(verts, norms, tex_coords));
+			}
+			if (lods.size() == static_cast<size_t>(n_stored)) {
+				for (auto& lod : lods) {
+					model.addLod(std::move(lod));
+				}
+				return;
+			}
+		}
+	}
+
+	generateLods(model, n_lods, ratio, max_error);
+	std::ofstream file(fname, std::ios::binary);
+	int n_generated = model.getNLods() - 1;
+	file.write(reinterpret_cast<const char*>(&key), sizeof(uint64_t));
+	file.write(reinterpret_cast<const char*>(&n_generated), sizeof(int));
+	for (int lod = 1; lod < model.getNLods(); lod++) {
+		const Model& generated = model.getLod(lod);
+		int n_faces = static_cast<int>(generated.flen());
+		file.write(reinterpret_cast<const char*>(&n_faces), sizeof(int));
+		file.write(reinterpret_cast<const char*>(generated.getVerts().data()), generated.getVerts().size() * sizeof(float));
+		file.write(reinterpret_cast<const char*>(generated.getNorms().data()), generated.getNorms().size() * sizeof(float));
+		file.write(reinterpret_cast<const char*>(generated.getTexCoords().data()), generated.getTexCoords().size() * sizeof(float));
+	}
+	if (!file) {
+		std::cerr << "couldnt save lods to " << fname << "\n";
+	}
+}
+
+#endif
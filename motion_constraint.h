@@ -9,6 +9,7 @@
 #include <unordered_set>
 
 #include "surface.hpp"
+#include "collision.hpp"
 
 using Eigen::seq;
 
@@ -17,6 +18,13 @@ class BoundaryConstraint{
 	const Surface<3>* boundary_;
 	const Eigen::Matrix4f* boundary_position_;
 
+	//the last move swept, translate asks about the same move more than once
+	mutable bool has_swept_;
+	mutable Eigen::Matrix4f swept_from_;
+	mutable Eigen::Matrix4f swept_to_;
+	mutable Eigen::Matrix4f swept_boundary_position_;
+	mutable TimeOfImpact swept_toi_;
+
 protected:
 
 	virtual bool invalidPosition(Eigen::Matrix4f position) const {
@@ -24,69 +32,110 @@ protected:
 	};
 
 public:
+	//the move is swept, not just its end, so a big step cant jump over something thin
 	bool breaksConstraint(Eigen::Matrix4f old_tform, Eigen::Matrix4f new_tform) const { 
 		if (boundary_ == nullptr) return false;
-		return invalidPosition(new_tform) || 
-			boundary_->crossesSurface(old_tform(seq(0, 2), 3)-(*boundary_position_)(seq(0,2),3),
-										new_tform(seq(0, 2), 3)-(*boundary_position_)(seq(0,2),3));
+		return invalidPosition(new_tform) || sweep(old_tform, new_tform).hit;
 	}
 
-	Eigen::Vector3f limitTranslate(Eigen::Matrix4f position, Eigen::Vector3f delta_pos, int n_iters = 5) const {
-		//Eigen::Vector3f delta_pos = first_guess - position;
-		//returns farthest possible delta_pos
-		float delta_norm = delta_pos.norm();
-		float len_ratio = 1.;
-		Eigen::Vector3f longest_vec = Eigen::Vector3f::Zero();
-		for (int i = 0; i < n_iters; i++) {
-			Eigen::Matrix4f new_tform = position;
-			new_tform(seq(0, 2), 3) += longest_vec + len_ratio * delta_pos;
-			if (breaksConstraint(position, new_tform)) {
+	//earliest point in the move from old_tform to new_tform that breaks the constraint, with where and
+	//the normal to slide along. the base constraint only has the path of the origin to go on
+	virtual TimeOfImpact timeOfImpact(Eigen::Matrix4f old_tform, Eigen::Matrix4f new_tform) const {
+		TimeOfImpact toi{ false, 1, Eigen::Vector3f::Zero(), Eigen::Vector3f::Zero() };
+		if (boundary_ == nullptr) {
+			return toi;
+		}
+		Eigen::Vector3f start = old_tform(seq(0, 2), 3) - (*boundary_position_)(seq(0, 2), 3);
+		Eigen::Vector3f end = new_tform(seq(0, 2), 3) - (*boundary_position_)(seq(0, 2), 3);
+		float k;
+		Eigen::Vector3f normal;
+		if (boundary_->firstCrossing(start, end, &k, &normal)) {
+			toi = { true, k, old_tform(seq(0, 2), 3) + k * (end - start), normal };
+		}
+		return toi;
+	}
 
+	//timeOfImpact, unless it is the same move as last time
+	const TimeOfImpact& sweep(const Eigen::Matrix4f& old_tform, const Eigen::Matrix4f& new_tform) const {
+		if (!has_swept_ || old_tform != swept_from_ || new_tform != swept_to_ || (boundary_position_ != nullptr && *boundary_position_ != swept_boundary_position_)) {
+			swept_toi_ = timeOfImpact(old_tform, new_tform);
+			swept_from_ = old_tform;
+			swept_to_ = new_tform;
+			if (boundary_position_ != nullptr) {
+				swept_boundary_position_ = *boundary_position_;
 			}
-			else {
-				if (len_ratio == 1.) {
-					return delta_pos;
-				}
-				longest_vec += delta_pos * len_ratio;
-			}
-			len_ratio /= 2;
+			has_swept_ = true;
 		}
-		return longest_vec;
+		return swept_toi_;
 	}
 
+	//how far short of a hit a move stops, so the next move doesnt start out touching
+	static constexpr float contact_skin = 1e-3f;
 
-	Eigen::Vector3f bestTranslate(Eigen::Matrix4f current, Eigen::Vector3f delta_pos, Eigen::Vector3f normal, Eigen::Vector3f binormal, int n_iters=5) const {
-			//Eigen::Matrix3f delta_pos = target(seq(0, 2), 3) - current(seq(0, 2), 3);
+	//farthest along delta_pos it can go
+	Eigen::Vector3f limitTranslate(Eigen::Matrix4f position, Eigen::Vector3f delta_pos) const {
+		Eigen::Matrix4f new_tform = position;
+		new_tform(seq(0, 2), 3) += delta_pos;
+		const TimeOfImpact& toi = sweep(position, new_tform);
+		if (!toi.hit) {
+			return delta_pos;
+		}
 		float delta_norm = delta_pos.norm();
-		Eigen::Vector3f fwd = limitTranslate(current, delta_pos, n_iters);
-		float fwd_ratio = fwd.norm() / delta_pos.norm();
-		if (fwd_ratio == 1.) {
-			return fwd;
+		return delta_pos * std::max(0.f, toi.t - contact_skin / std::max(delta_norm, 1e-12f));
+	}
+
+	//goes as far as it can along delta_pos, then the rest of the move with the part into whatever it
+	//hit taken off, so it slides along it. up to n_slides hits, one sweep each
+	Eigen::Vector3f slideTranslate(Eigen::Matrix4f position, Eigen::Vector3f delta_pos, int n_slides = 3) const {
+		Eigen::Vector3f moved = Eigen::Vector3f::Zero();
+		Eigen::Vector3f remaining = delta_pos;
+		for (int i = 0; i < n_slides && remaining.squaredNorm() > contact_skin * contact_skin; i++) {
+			Eigen::Matrix4f from = position;
+			from(seq(0, 2), 3) += moved;
+			Eigen::Matrix4f to = from;
+			to(seq(0, 2), 3) += remaining;
+			const TimeOfImpact& toi = sweep(from, to);
+			if (!toi.hit) {
+				return moved + remaining;
+			}
+			float safe_t = std::max(0.f, toi.t - contact_skin / remaining.norm());
+			moved += safe_t * remaining;
+			remaining *= 1 - safe_t;
+			remaining -= remaining.dot(toi.normal) * toi.normal;
+		}
+		return moved;
+	}
+
+	//slides along what was hit. if that gets nowhere, like against a surface that cant tell which way
+	//it faces, the rest of the move is tried along normal and binormal both ways and it goes towards
+	//whichever sides are free
+	Eigen::Vector3f bestTranslate(Eigen::Matrix4f current, Eigen::Vector3f delta_pos, Eigen::Vector3f normal, Eigen::Vector3f binormal, int n_slides = 3) const {
+		Eigen::Vector3f slid = slideTranslate(current, delta_pos, n_slides);
+		if (slid.squaredNorm() > contact_skin * contact_skin) {
+			return slid;
+		}
+		float rest = delta_pos.norm();
+		Eigen::Vector3f bounce_vec = Eigen::Vector3f::Zero();
+		for (const Eigen::Vector3f& dir : { normal, Eigen::Vector3f(-normal), binormal, Eigen::Vector3f(-binormal) }) {
+			bounce_vec += limitTranslate(current, rest * dir);
 		}
-		Eigen::Matrix4f next = current;
-		next(seq(0,2),3) += fwd;
-		Eigen::Vector3f pos_norm = limitTranslate(next, (1 - fwd_ratio) * delta_norm * normal, n_iters);
-		Eigen::Vector3f neg_norm = limitTranslate(next, -(1 - fwd_ratio) * delta_norm * normal, n_iters);
-		Eigen::Vector3f pos_binorm = limitTranslate(next, (1 - fwd_ratio) * delta_norm * binormal, n_iters);
-		Eigen::Vector3f neg_binorm = limitTranslate(next, -(1 - fwd_ratio) * delta_norm * binormal, n_iters);
-		Eigen::Vector3f bounce_vec = fwd + (pos_norm + neg_norm) + (pos_binorm + neg_binorm);
-		return limitTranslate(current, bounce_vec,n_iters);
-		//Eigen::Matrix4f new_pos = current;
-		//new_pos(seq(0, 2), 3) += bounce_vec;
-		//return bounce_vec + limitTranslate(new_pos,delta_pos, n_iters);
+		return limitTranslate(current, bounce_vec);
 	}
 
-	BoundaryConstraint() : boundary_(nullptr),boundary_position_(nullptr) {}
+	BoundaryConstraint() : boundary_(nullptr),boundary_position_(nullptr),has_swept_(false) {}
 
 	BoundaryConstraint(const Surface<3>* boundary, const Eigen::Matrix4f* boundary_position) :
 		boundary_(boundary),
-		boundary_position_(boundary_position){}
+		boundary_position_(boundary_position),
+		has_swept_(false){}
 
 	void setBoundary(const Surface<3>* boundary) {
 		boundary_ = boundary;
+		has_swept_ = false;
 	}
 	void setBoundaryPosition(const Eigen::Matrix4f* boundary_position) {
 		boundary_position_ = boundary_position;
+		has_swept_ = false;
 	}
 
 	const Surface<3>* getBoundary() const {
@@ -21,6 +21,19 @@ protected:
 	}
 
 public:
+	//the hitbox swept from old to new, on top of the origin's path
+	TimeOfImpact timeOfImpact(Eigen::Matrix4f old_tform, Eigen::Matrix4f new_tform) const override {
+		TimeOfImpact toi = BoundaryConstraint::timeOfImpact(old_tform, new_tform);
+		if constexpr (std::derived_from<secondary_type, MeshSurface>) {
+			if (getBoundary() != nullptr && secondary_hitbox_ != nullptr) {
+				TimeOfImpact swept = sweepCollision(*getBoundary(), *secondary_hitbox_, *getBoundaryPosition(), old_tform, new_tform);
+				if (swept.hit && (!toi.hit || swept.t < toi.t)) {
+					toi = swept;
+				}
+			}
+		}
+		return toi;
+	}
 
 	NoCollideConstraint(const secondary_type* secondary_hitbox) :
 		secondary_hitbox_(secondary_hitbox) {
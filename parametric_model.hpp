@@ -2,12 +2,87 @@
 #ifndef PUPPET_PARAMETRIC_MODEL
 #define PUPPET_PARAMETRIC_MODEL
 
+#include <vector>
+#include <string>
+#include <Eigen/Geometry>
+
 #include "Model.h"
 
-class ParametricModel :public Model {
+//a model bent by a vector of parameters. parameter i turns hinge i: everything hanging off it rotates
+//by that angle about the hinge's axis through its pivot (both in the rest pose). a hinge can sit on
+//a parent hinge, so a chain of them moves like a limb. each vertex hangs off at most one hinge.
+//only the angles change from frame to frame, the hinges and which vertex hangs off which never do,
+//so a renderer can keep all of that on the gpu and upload just the parameters
+class ParametricModel : public Model {
+public:
+	static constexpr int max_parameters = 32; //the sizes of the arrays in Parametric3d's shader
+
+	struct Hinge {
+		Eigen::Vector3f axis; //unit length
+		Eigen::Vector3f pivot;
+		int parent; //-1 for none, otherwise always an earlier hinge
+	};
+
+private:
+	std::vector<Hinge> hinges_;
+	std::vector<int> vert_hinges_; //one per vertex, -1 for vertices that never move
+
+public:
+	ParametricModel(std::string fname, bool force_shade_hard = true) :
+		ParametricModel(fname, Model::default_path, force_shade_hard) {}
+
+	ParametricModel(std::string fname, std::string path, bool force_shade_hard = true) :
+		Model(fname, path, force_shade_hard),
+		vert_hinges_(vlen(), -1) {}
+
+	//returns the index of the parameter that drives the new hinge
+	int addHinge(const Eigen::Vector3f& axis, const Eigen::Vector3f& pivot, int parent = -1) {
+		if (hinges_.size() >= max_parameters || parent >= static_cast<int>(hinges_.size())) {
+			std::cerr << "can't add hinge to parametric model\n";
+			return -1;
+		}
+		hinges_.push_back(Hinge{ axis.normalized(), pivot, parent });
+		return static_cast<int>(hinges_.size()) - 1;
+	}
+
+	void attach(const std::vector<int>& verts, int hinge) {
+		for (int vert : verts) {
+			vert_hinges_[vert] = hinge;
+		}
+	}
+
+	//attaches every vertex whose rest position inside(position) is true for
+	template<class Predicate>
+	void attachWhere(Predicate inside, int hinge) {
+		for (int i = 0; i < vlen(); i++) {
+			if (inside(getVert(i))) {
+				vert_hinges_[i] = hinge;
+			}
+		}
+	}
+
+	const std::vector<Hinge>& getHinges() const {
+		return hinges_;
+	}
 
+	const std::vector<int>& getVertHinges() const {
+		return vert_hinges_;
+	}
 
+	int getNParameters() const {
+		return static_cast<int>(hinges_.size());
+	}
 
+	//what the vertex shader does, for anything on the cpu that needs the bent shape. direction
+	//skips the pivots, for normals
+	Eigen::Vector3f deform(const Eigen::Vector3f& rest, int hinge, const float* parameters, bool direction = false) const {
+		Eigen::Vector3f out = rest;
+		for (int h = hinge; h >= 0; h = hinges_[h].parent) {
+			Eigen::Matrix3f rotation = Eigen::AngleAxisf(parameters[h], hinges_[h].axis).toRotationMatrix();
+			out = direction ? Eigen::Vector3f(rotation * out) : Eigen::Vector3f(hinges_[h].pivot + rotation * (out - hinges_[h].pivot));
+		}
+		return out;
+	}
 };
 
 
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef PUPPET_SHADOW_MAP
+#define PUPPET_SHADOW_MAP
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+
+#include "gl_state.hpp"
+
+//what a lit renderer needs to sample the shadow of the scenes shadow_light. filled in by Shadow3d
+struct ShadowInfo {
+	static constexpr int texture_unit = 2; //0 is the object texture, 1 is used by impostors
+
+	unsigned int depth_tex;
+	Eigen::Matrix4f light_space; //world to light clip space
+	Eigen::Vector3f direction; //the way the light travels
+	float strength;
+	bool valid; //false until a map has been rendered, or while the scene has no shadow light
+
+	ShadowInfo() : depth_tex(0), light_space(Eigen::Matrix4f::Identity()), direction(0, -1, 0), strength(0), valid(false) {}
+
+	//the shaders skip the directional term entirely when the strength is 0
+	static void setUniforms(unsigned int program, const ShadowInfo* shadows) {
+		if (shadows == nullptr || !shadows->valid) {
+			glUniform1f(glGetUniformLocation(program, "shadow_light_strength"), 0);
+			return;
+		}
+		GLState::activeTexture(texture_unit);
+		GLState::bindTexture(shadows->depth_tex);
+		GLState::activeTexture(0);
+		glUniformMatrix4fv(glGetUniformLocation(program, "light_space"), 1, GL_FALSE, shadows->light_space.data());
+		glUniform3fv(glGetUniformLocation(program, "shadow_light_direction"), 1, shadows->direction.data());
+		glUniform1f(glGetUniformLocation(program, "shadow_light_strength"), shadows->strength);
+	}
+};
+
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+
+#ifndef PUPPET_SKINNED_MESH_SURFACE
+#define PUPPET_SKINNED_MESH_SURFACE
+
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#include "surface.hpp"
+#include "dynamic_model.hpp"
+
+//a MeshSurface that follows a DynamicModel's pose. every vert is stuck to one vertex group, the group
+//of the model's nearest vert when it is bound, and moves with that group's transform the same way
+//DynamicModel::updateData moves the model. update moves the verts and refits the bvh rather than
+//building it again, so it is linear in the size of the mesh.
+//each group also gets a capsule around its verts, a cheap stand in for the mesh in the broad phase
+class SkinnedMeshSurface : public MeshSurface {
+public:
+	//from a to b with a radius
+	struct Capsule {
+		Eigen::Vector3f a;
+		Eigen::Vector3f b;
+		float radius;
+	};
+
+private:
+	struct Bone {
+		const VertexGroup* group;
+		Capsule rest; //in the group's frame
+	};
+
+	std::vector<Bone> bones_;
+	std::vector<int> vert_bones_; //-1 for a vert whose group has no transform, it stays where it was loaded
+	std::vector<Eigen::Vector3f> local_verts_; //in its group's frame
+	std::vector<Eigen::Vector3f> posed_verts_;
+	std::vector<Eigen::Matrix4f> bone_tforms_;
+	std::vector<Capsule> capsules_; //in the mesh's frame, from the last update
+	Eigen::AlignedBox3f bounds_;
+	const Eigen::Matrix4f* root_tform_;
+	size_t pose_; //goes up every update
+	bool all_bound_;
+
+	//the smallest capsule along the direction the verts are most spread out in that holds them all
+	static Capsule fitCapsule(const std::vector<Eigen::Vector3f>& verts) {
+		Eigen::Vector3f center = Eigen::Vector3f::Zero();
+		for (const Eigen::Vector3f& v : verts) {
+			center += v;
+		}
+		center /= static_cast<float>(verts.size());
+		Eigen::Matrix3f covariance = Eigen::Matrix3f::Zero();
+		for (const Eigen::Vector3f& v : verts) {
+			covariance += (v - center) * (v - center).transpose();
+		}
+		//eigenvalues come out smallest first
+		Eigen::Vector3f axis = Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f>(covariance).eigenvectors().col(2);
+		float t_min = std::numeric_limits<float>::max();
+		float t_max = -std::numeric_limits<float>::max();
+		for (const Eigen::Vector3f& v : verts) {
+			float t = (v - center).dot(axis);
+			t_min = std::min(t_min, t);
+			t_max = std::max(t_max, t);
+		}
+		Capsule capsule{ center + t_min * axis, center + t_max * axis, 0 };
+		for (const Eigen::Vector3f& v : verts) {
+			float t = std::clamp((v - center).dot(axis), t_min, t_max);
+			capsule.radius = std::max(capsule.radius, (v - center - t * axis).norm());
+		}
+		return capsule;
+	}
+
+public:
+	SkinnedMeshSurface(std::string fname) : MeshSurface(fname), root_tform_(nullptr), pose_(0), all_bound_(false) {}
+
+	SkinnedMeshSurface(std::string fname, std::string path) : MeshSurface(fname, path), root_tform_(nullptr), pose_(0), all_bound_(false) {}
+
+	//sticks each vert to a group of model. call it while model's verts are still as loaded and its
+	//groups' transforms are in the pose the obj was made in, the same time as DynamicModel::offsetVerts
+	//and before it. root_tform is the model's root transform, nullptr for none
+	void bind(const DynamicModel& model, const Eigen::Matrix4f* root_tform) {
+		root_tform_ = root_tform;
+		bones_.clear();
+
+		//every vert of the model with its group, faces all in one group went to a static model. counted
+		//off the vert data, vlen isnt kept for models made vert by vert
+		std::vector<std::pair<Eigen::Vector3f, const VertexGroup*>> model_verts;
+		for (int i = 0; i < model.getVerts().size() / 3; i++) {
+			model_verts.emplace_back(model.getVert(i), model.getGroup(i));
+		}
+		for (const auto& [group, static_model] : model.getStaticModels()) {
+			for (int i = 0; i < static_model->getVerts().size() / 3; i++) {
+				model_verts.emplace_back(static_model->getVert(i), group);
+			}
+		}
+
+		std::unordered_map<const VertexGroup*, int> bone_index;
+		std::vector<std::vector<Eigen::Vector3f>> bone_verts;
+		const std::vector<Eigen::Vector3f>& verts = getVerts();
+		vert_bones_.assign(verts.size(), -1);
+		local_verts_ = verts;
+		all_bound_ = !model_verts.empty();
+		for (int i = 0; i < verts.size(); i++) {
+			//only done once, a plain search is fine
+			const VertexGroup* group = nullptr;
+			float best = std::numeric_limits<float>::max();
+			for (const auto& [position, model_group] : model_verts) {
+				float distance = (position - verts[i]).squaredNorm();
+				if (distance < best) {
+					best = distance;
+					group = model_group;
+				}
+			}
+			if (group == nullptr || group->getTform() == nullptr) {
+				all_bound_ = false;
+				continue;
+			}
+			auto [it, inserted] = bone_index.emplace(group, static_cast<int>(bones_.size()));
+			if (inserted) {
+				bones_.push_back(Bone{ group, {} });
+				bone_verts.emplace_back();
+			}
+			vert_bones_[i] = it->second;
+			Eigen::Matrix4f to_local = group->getTform()->inverse();
+			local_verts_[i] = to_local.block<3, 3>(0, 0) * verts[i] + to_local.block<3, 1>(0, 3);
+			bone_verts[it->second].push_back(local_verts_[i]);
+		}
+		for (int bone = 0; bone < bones_.size(); bone++) {
+			bones_[bone].rest = fitCapsule(bone_verts[bone]);
+		}
+		bone_tforms_.resize(bones_.size());
+		capsules_.resize(bones_.size());
+		update();
+	}
+
+	//moves the verts to the pose the groups' transforms are in now
+	void update() {
+		if (local_verts_.empty()) {
+			return; //not bound yet
+		}
+		for (int bone = 0; bone < bones_.size(); bone++) {
+			const Eigen::Matrix4f& tform = *bones_[bone].group->getTform();
+			bone_tforms_[bone] = root_tform_ == nullptr ? tform : root_tform_->inverse() * tform;
+			const Capsule& rest = bones_[bone].rest;
+			const Eigen::Matrix4f& T = bone_tforms_[bone];
+			capsules_[bone] = { T.block<3, 3>(0, 0) * rest.a + T.block<3, 1>(0, 3), T.block<3, 3>(0, 0) * rest.b + T.block<3, 1>(0, 3), rest.radius };
+		}
+		posed_verts_.resize(local_verts_.size());
+		bounds_.setEmpty();
+		for (int i = 0; i < local_verts_.size(); i++) {
+			if (vert_bones_[i] < 0) {
+				posed_verts_[i] = local_verts_[i];
+			} else {
+				const Eigen::Matrix4f& T = bone_tforms_[vert_bones_[i]];
+				posed_verts_[i] = T.block<3, 3>(0, 0) * local_verts_[i] + T.block<3, 1>(0, 3);
+			}
+			bounds_.extend(posed_verts_[i]);
+		}
+		moveVerts(posed_verts_);
+		pose_++;
+	}
+
+	//one per group with verts stuck to it, as of the last update
+	const std::vector<Capsule>& getCapsules() const {
+		return capsules_;
+	}
+
+	//whether the capsules hold every vert, they dont if a vert is stuck to a group with no transform
+	bool capsulesCoverMesh() const {
+		return all_bound_;
+	}
+
+	//box around the verts as of the last update
+	const Eigen::AlignedBox3f& getBounds() const {
+		return bounds_;
+	}
+
+	size_t getPose() const {
+		return pose_;
+	}
+};
+
+#endif
@@ -0,0 +1,225 @@
+#pragma once
+
+#ifndef PUPPET_STATIC_BATCH
+#define PUPPET_STATIC_BATCH
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+
+#include "GameObject.h"
+#include "gl_state.hpp"
+#include "draw_order.hpp"
+#include "texture_streamer.hpp"
+
+//merges objects that never move and share a texture into one set of buffers. verts are baked into
+//world space at build time so the whole batch draws with an identity model matrix. each object
+//keeps its own range (chunk) so chunks can still be culled and ordered, the visible ones go out in
+//a single glMultiDrawArrays. every lod of a model is baked in too, a chunk picks its range per
+//frame. if one of the objects does move, build a new batch
+class StaticBatch {
+public:
+	struct Range {
+		int first; //first vertex in the batch buffers
+		int count;
+	};
+
+	struct Chunk {
+		const GameObject* obj;
+		std::vector<Range> lods;
+		mutable int lod;
+		Eigen::Vector3f center; //world space bounding sphere
+		float radius;
+		float texels_across; //see TextureStreamer::texelsAcross
+	};
+
+	struct DrawStats {
+		size_t n_chunks;
+		size_t n_triangles;
+		size_t n_triangles_full; //what the same chunks would have cost at lod 0
+		float texels_per_screen; //most texels across the screen height any drawn chunk needs, for mip streaming
+	};
+
+private:
+	unsigned int VAO_;
+	unsigned int VBO_[4];
+	int tex_id_;
+	bool baked_; //every chunk has baked light, in the fourth buffer
+	std::vector<Chunk> chunks_;
+
+	//rebuilt every draw, kept around so drawing doesnt allocate
+	mutable std::vector<std::pair<float, int>> visible_;
+	mutable std::vector<int> firsts_;
+	mutable std::vector<int> counts_;
+
+public:
+	StaticBatch(const std::vector<const GameObject*>& objs, int tex_id) : tex_id_(tex_id), baked_(true) {
+		std::vector<float> verts, norms, tex_coords, baked_light;
+		int n_verts = 0;
+		for (const GameObject* obj : objs) {
+			const Model& model = *(obj->getModel());
+			const Eigen::Matrix4f position = obj->getPosition();
+			std::vector<Range> lods;
+
+			for (int lod = 0; lod < model.getNLods(); lod++) {
+				const Model& lod_model = model.getLod(lod);
+				int count = 3 * lod_model.flen();
+				for (int i = 0; i < count; i++) {
+					Eigen::Vector4f v = position * Eigen::Vector4f(lod_model.getVerts()[3 * i], lod_model.getVerts()[3 * i + 1], lod_model.getVerts()[3 * i + 2], 1);
+					//same as the shader, normals go through the model matrix with w = 0
+					Eigen::Vector4f n = position * Eigen::Vector4f(lod_model.getNorms()[3 * i], lod_model.getNorms()[3 * i + 1], lod_model.getNorms()[3 * i + 2], 0);
+					verts.insert(verts.end(), { v(0), v(1), v(2) });
+					norms.insert(norms.end(), { n(0), n(1), n(2) });
+				}
+				tex_coords.insert(tex_coords.end(), lod_model.getTexCoords().begin(), lod_model.getTexCoords().begin() + 2 * count);
+				const std::vector<float>& lod_light = model.getBakedLight(lod);
+				baked_ = baked_ && lod_light.size() == 2 * count;
+				if (baked_) {
+					baked_light.insert(baked_light.end(), lod_light.begin(), lod_light.end());
+				}
+				lods.push_back(Range{ n_verts, count });
+				n_verts += count;
+			}
+
+			float center_depth, radius;
+			DrawOrder<GameObject, int>::boundsDepth(Eigen::Matrix4f::Identity(), position, model, center_depth, radius);
+			Eigen::Vector3f center = (position * model.getBoxCenter().homogeneous()).head<3>();
+			chunks_.push_back(Chunk{ obj, lods, 0, center, radius, TextureStreamer::texelsAcross(model, *(obj->getTexture())) });
+		}
+
+		glGenVertexArrays(1, &VAO_);
+		glGenBuffers(4, VBO_);
+		GLState::bindVertexArray(VAO_);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_[0]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * verts.size(), verts.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_[1]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * norms.size(), norms.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(1);
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_[2]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * tex_coords.size(), tex_coords.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(2);
+
+		//all or nothing, a batch is drawn with one shader path
+		if (baked_) {
+			GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_[3]);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(float) * baked_light.size(), baked_light.data(), GL_STATIC_DRAW);
+			glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+			glEnableVertexAttribArray(3);
+		}
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+	}
+
+	~StaticBatch() {
+		GLState::deleteBuffers(4, VBO_);
+		GLState::deleteVertexArrays(1, &VAO_);
+	}
+
+	StaticBatch(const StaticBatch&) = delete;
+	StaticBatch& operator=(const StaticBatch&) = delete;
+
+	//culls chunks against the frustum, picks a lod for the rest, orders them front to back and draws
+	//them in one call. chunks whose object is in skip are left out. assumes the program and the
+	//model matrix (identity) are already set
+	DrawStats draw(const Eigen::Matrix4f& camera, const Eigen::Matrix4f& perspective, const std::unordered_set<const GameObject*>& skip) const {
+		DrawStats stats = { 0, 0, 0, 0 };
+		const Eigen::Matrix4f view_proj = perspective * camera;
+		visible_.clear();
+		for (int i = 0; i < chunks_.size(); i++) {
+			const Chunk& chunk = chunks_[i];
+			if (chunk.obj->isHidden() || skip.contains(chunk.obj) || !sphereInFrustum(view_proj, chunk.center, chunk.radius)) {
+				continue;
+			}
+			float center_depth = -(camera * chunk.center.homogeneous())(2);
+			float screen_size = LodSelector::screenSize(perspective, center_depth, chunk.radius);
+			chunk.lod = LodSelector::select(screen_size, chunk.lod, static_cast<int>(chunk.lods.size()));
+			stats.texels_per_screen = std::max(stats.texels_per_screen, chunk.texels_across / std::max(screen_size, 1e-6f));
+			visible_.push_back({ center_depth - chunk.radius, i });
+		}
+		if (visible_.empty()) {
+			return stats;
+		}
+		std::sort(visible_.begin(), visible_.end());
+
+		firsts_.clear();
+		counts_.clear();
+		for (const auto& depth_index : visible_) {
+			const Chunk& chunk = chunks_[depth_index.second];
+			firsts_.push_back(chunk.lods[chunk.lod].first);
+			counts_.push_back(chunk.lods[chunk.lod].count);
+			stats.n_triangles += chunk.lods[chunk.lod].count / 3;
+			stats.n_triangles_full += chunk.lods[0].count / 3;
+		}
+		stats.n_chunks = visible_.size();
+
+		GLState::bindTexture(tex_id_);
+		GLState::bindVertexArray(VAO_);
+		glMultiDrawArrays(GL_TRIANGLES, firsts_.data(), counts_.data(), static_cast<int>(firsts_.size()));
+		return stats;
+	}
+
+	int getTexID() const {
+		return tex_id_;
+	}
+
+	//whether to draw with the baked lighting instead of the scene lights
+	bool isBaked() const {
+		return baked_;
+	}
+
+	const std::vector<Chunk>& getChunks() const {
+		return chunks_;
+	}
+
+	bool contains(const GameObject& obj) const {
+		for (const Chunk& chunk : chunks_) {
+			if (chunk.obj == &obj) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//every visible chunk at full detail in one call, no culling or sorting. for depth only passes
+	//that cover more than the camera sees, like shadow maps
+	void drawDepth() const {
+		firsts_.clear();
+		counts_.clear();
+		for (const Chunk& chunk : chunks_) {
+			if (!chunk.obj->isHidden()) {
+				firsts_.push_back(chunk.lods[0].first);
+				counts_.push_back(chunk.lods[0].count);
+			}
+		}
+		if (firsts_.empty()) {
+			return;
+		}
+		GLState::bindVertexArray(VAO_);
+		glMultiDrawArrays(GL_TRIANGLES, firsts_.data(), counts_.data(), static_cast<int>(firsts_.size()));
+	}
+
+	//draws one object at full detail on its own, for things like impostor baking
+	void drawChunk(const GameObject& obj) const {
+		for (const Chunk& chunk : chunks_) {
+			if (chunk.obj == &obj) {
+				GLState::bindTexture(tex_id_);
+				GLState::bindVertexArray(VAO_);
+				glDrawArrays(GL_TRIANGLES, chunk.lods[0].first, chunk.lods[0].count);
+				return;
+			}
+		}
+	}
+
+};
+
+#endif
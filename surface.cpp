@@ -1,36 +1,271 @@
 #include<unordered_set>
+#include<unordered_map>
+#include<filesystem>
+#include<cstring>
+#include<algorithm>
 
 #include "Model.h"
 #include "surface.hpp"
 
 MeshSurface::MeshSurface(std::string fname) : MeshSurface(fname, Model::default_path) {}
 
-MeshSurface::MeshSurface(std::string fname, std::string path){
+MeshSurface::MeshSurface(std::string fname, std::string path) : hull_reach_(0) {
+	std::string cooked_fname = std::filesystem::path(path + fname).replace_extension(".cmesh").string();
+	{
+		CollisionMeshFile cooked(cooked_fname);
+		if (cooked.isCurrent(path + fname)) {
+			if (loadCooked(cooked.getData())) {
+				buildBVH();
+				return;
+			}
+			std::cerr << "cooked collision mesh " << cooked_fname << " is corrupt, cooking it again\n";
+		}
+	}
+
 	Model model(fname, path, false);
 	for (int i = 0; i < model.vlen(); i++) {
 		verts_.emplace_back(model.getVerts()[3 * i], model.getVerts()[3 * i + 1], model.getVerts()[3 * i + 2]);
 	}
 	if (model.getLines().size() > 0) {
+		std::unordered_set<std::pair<int, int>, edgeHasher> edges;
 		for (int i = 0; i < model.getLines().size() / 2; i++) {
 			std::pair<int, int>e(model.getLines()[2 * i], model.getLines()[2 * i + 1]);
-			edges_.push_back(e);
+			if (e.first > e.second) {
+				std::swap(e.first, e.second);
+			}
+			if (!edges.contains(e)) {
+				edges.emplace(e);
+				edges_.push_back(e);
+			}
 		}
+		edge_faces_.assign(edges_.size(), { -1, -1 });
 	}
 	else {
-		std::unordered_set<std::pair<int, int>, edgeHasher> edges;
 		for (int i = 0; i < model.flen(); i++) {
-			for (int first = 0; first < 3; first++) {
-				for (int second = 0; second < 3; second++) {
-					if (first == second) continue;
-					std::pair<int, int>e(model.getFaces()[3 * i + first], model.getFaces()[3 * i + second]);
-					if (!edges.contains(e)) {
-						edges.emplace(e);
-						edges_.push_back(e);
-					}
-				}
+			faces_.emplace_back(model.getFaces()[3 * i], model.getFaces()[3 * i + 1], model.getFaces()[3 * i + 2]);
+		}
+	}
+	weldVerts();
+	//faces go in through addFace again now they point at the welded verts
+	std::vector<std::tuple<int, int, int>> faces;
+	faces.swap(faces_);
+	for (const auto& [a, b, c] : faces) {
+		addFace(a, b, c);
+	}
+	if (!faces_.empty()) {
+		buildTopology();
+	}
+	buildBVH();
+	buildHulls();
+
+	if (!saveCooked(cooked_fname, path + fname)) {
+		std::cerr << "couldnt cook collision mesh " << cooked_fname << "\n";
+	}
+}
+
+void MeshSurface::weldVerts() {
+	struct PositionHasher {
+		size_t operator()(const Eigen::Vector3f& v) const {
+			uint32_t bits[3];
+			std::memcpy(bits, v.data(), sizeof(bits));
+			return std::hash<uint64_t>{}((static_cast<uint64_t>(bits[0]) << 32 | bits[1]) ^ (static_cast<uint64_t>(bits[2]) * 0x9e3779b97f4a7c15ull));
+		}
+	};
+	std::unordered_map<Eigen::Vector3f, int, PositionHasher> kept;
+	std::vector<int> remap(verts_.size());
+	std::vector<Eigen::Vector3f> welded;
+	for (int i = 0; i < verts_.size(); i++) {
+		auto [it, inserted] = kept.emplace(verts_[i], static_cast<int>(welded.size()));
+		if (inserted) {
+			welded.push_back(verts_[i]);
+		}
+		remap[i] = it->second;
+	}
+	if (welded.size() == verts_.size()) {
+		return;
+	}
+	verts_.swap(welded);
+	for (auto& [a, b, c] : faces_) {
+		a = remap[a];
+		b = remap[b];
+		c = remap[c];
+	}
+	std::unordered_set<std::pair<int, int>, edgeHasher> edges;
+	std::vector<std::pair<int, int>> welded_edges;
+	for (auto [a, b] : edges_) {
+		std::pair<int, int> e(std::min(remap[a], remap[b]), std::max(remap[a], remap[b]));
+		if (e.first != e.second && !edges.contains(e)) {
+			edges.emplace(e);
+			welded_edges.push_back(e);
+		}
+	}
+	edges_.swap(welded_edges);
+	edge_faces_.assign(edges_.size(), { -1, -1 });
+}
+
+void MeshSurface::buildTopology() {
+	edges_.clear();
+	edge_faces_.clear();
+	std::unordered_map<uint64_t, int> edge_index;
+	for (int f = 0; f < faces_.size(); f++) {
+		const auto& [a, b, c] = faces_[f];
+		for (auto [first, second] : { std::pair<int, int>(a, b), std::pair<int, int>(b, c), std::pair<int, int>(c, a) }) {
+			if (first == second) {
+				continue;
+			}
+			if (first > second) {
+				std::swap(first, second);
+			}
+			uint64_t key = static_cast<uint64_t>(first) << 32 | static_cast<uint32_t>(second);
+			auto [it, inserted] = edge_index.emplace(key, static_cast<int>(edges_.size()));
+			if (inserted) {
+				edges_.emplace_back(first, second);
+				edge_faces_.emplace_back(f, -1);
+			} else if (edge_faces_[it->second].second == -1 && edge_faces_[it->second].first != f) {
+				//past two faces the edge isnt manifold, the first two are kept
+				edge_faces_[it->second].second = f;
 			}
-			faces_.push_back(std::tuple<int, int, int>{model.getFaces()[3 * i], model.getFaces()[3 * i + 1], model.getFaces()[3 * i + 2]});
 		}
 	}
+}
+
+void MeshSurface::setHulls(std::vector<ConvexHull> hulls) {
+	hulls_ = std::move(hulls);
+	hull_reach_ = 0;
+	for (const ConvexHull& hull : hulls_) {
+		for (const Eigen::Vector3f& v : hull.getVerts()) {
+			hull_reach_ = std::max(hull_reach_, v.norm());
+		}
+	}
+}
 
-}
\ No newline at end of file
+void MeshSurface::buildHulls() {
+	//a few holes, like where a head was left open at the neck, are taken as covered by the hull of
+	//their rim. anything more open, like a room, has no inside to hold
+	int n_open = 0;
+	for (const auto& [first, second] : edge_faces_) {
+		n_open += second < 0;
+	}
+	if (faces_.empty() || edge_faces_.size() != edges_.size() || n_open > edges_.size() / 50) {
+		setHulls({});
+		return;
+	}
+	Eigen::AlignedBox3f box;
+	for (const Eigen::Vector3f& v : verts_) {
+		box.extend(v);
+	}
+	//a piece can be this much bigger than the mesh it holds
+	setHulls(ConvexHull::decompose(verts_, faces_, .02f * box.diagonal().norm(), 16));
+}
+
+//every index in data points into its array and every hull's runs are in order inside theirs. the
+//file's size already matches its counts, this is for what is in the arrays
+static bool cookedInRange(const CollisionMeshData& data) {
+	auto index = [](int i, int n) { return i >= 0 && i < n; };
+	for (int i = 0; i < data.n_edges; i++) {
+		if (!index(data.edge_a[i], data.n_verts) || !index(data.edge_b[i], data.n_verts) ||
+			!index(data.edge_face_0[i] + 1, data.n_faces + 1) || !index(data.edge_face_1[i] + 1, data.n_faces + 1)) {
+			return false;
+		}
+	}
+	for (int i = 0; i < data.n_faces; i++) {
+		if (!index(data.face_a[i], data.n_verts) || !index(data.face_b[i], data.n_verts) || !index(data.face_c[i], data.n_verts)) {
+			return false;
+		}
+	}
+	for (int h = 0, v = 0, f = 0; h < data.n_hulls; h++) {
+		int verts_end = data.hull_verts_end[h];
+		int faces_end = data.hull_faces_end[h];
+		if (verts_end < v || verts_end > data.n_hull_verts || faces_end < f || faces_end > data.n_hull_faces) {
+			return false;
+		}
+		for (; f < faces_end; f++) {
+			int n_piece_verts = verts_end - v;
+			if (!index(data.hull_face_a[f], n_piece_verts) || !index(data.hull_face_b[f], n_piece_verts) || !index(data.hull_face_c[f], n_piece_verts)) {
+				return false;
+			}
+		}
+		v = verts_end;
+	}
+	return true;
+}
+
+bool MeshSurface::loadCooked(const CollisionMeshData& data) {
+	if (!cookedInRange(data)) {
+		return false;
+	}
+	verts_.reserve(data.n_verts);
+	for (int i = 0; i < data.n_verts; i++) {
+		verts_.emplace_back(data.vert_x[i], data.vert_y[i], data.vert_z[i]);
+	}
+	edges_.reserve(data.n_edges);
+	edge_faces_.reserve(data.n_edges);
+	for (int i = 0; i < data.n_edges; i++) {
+		edges_.emplace_back(data.edge_a[i], data.edge_b[i]);
+		edge_faces_.emplace_back(data.edge_face_0[i], data.edge_face_1[i]);
+	}
+	faces_.reserve(data.n_faces);
+	face_norms_.reserve(data.n_faces);
+	face_offsets_.reserve(data.n_faces);
+	for (int i = 0; i < data.n_faces; i++) {
+		faces_.emplace_back(data.face_a[i], data.face_b[i], data.face_c[i]);
+		triangles_.add(verts_[data.face_a[i]], verts_[data.face_b[i]], verts_[data.face_c[i]]);
+		face_norms_.emplace_back(data.plane_x[i], data.plane_y[i], data.plane_z[i]);
+		face_offsets_.push_back(data.plane_d[i]);
+	}
+	std::vector<ConvexHull> hulls;
+	for (int h = 0, v = 0, f = 0; h < data.n_hulls; h++) {
+		std::vector<Eigen::Vector3f> hull_verts;
+		for (; v < data.hull_verts_end[h]; v++) {
+			hull_verts.emplace_back(data.hull_x[v], data.hull_y[v], data.hull_z[v]);
+		}
+		std::vector<std::tuple<int, int, int>> hull_faces;
+		for (; f < data.hull_faces_end[h]; f++) {
+			hull_faces.emplace_back(data.hull_face_a[f], data.hull_face_b[f], data.hull_face_c[f]);
+		}
+		hulls.emplace_back(std::move(hull_verts), std::move(hull_faces));
+	}
+	setHulls(std::move(hulls));
+	return true;
+}
+
+bool MeshSurface::saveCooked(const std::string& fname, const std::string& source_fname) const {
+	std::vector<float> vert_x, vert_y, vert_z;
+	for (const Eigen::Vector3f& v : verts_) {
+		vert_x.push_back(v(0)); vert_y.push_back(v(1)); vert_z.push_back(v(2));
+	}
+	std::vector<int> edge_a, edge_b, edge_face_0, edge_face_1;
+	for (int i = 0; i < edges_.size(); i++) {
+		edge_a.push_back(edges_[i].first); edge_b.push_back(edges_[i].second);
+		edge_face_0.push_back(edge_faces_[i].first); edge_face_1.push_back(edge_faces_[i].second);
+	}
+	std::vector<int> face_a, face_b, face_c;
+	std::vector<float> plane_x, plane_y, plane_z;
+	for (int i = 0; i < faces_.size(); i++) {
+		face_a.push_back(std::get<0>(faces_[i])); face_b.push_back(std::get<1>(faces_[i])); face_c.push_back(std::get<2>(faces_[i]));
+		plane_x.push_back(face_norms_[i](0)); plane_y.push_back(face_norms_[i](1)); plane_z.push_back(face_norms_[i](2));
+	}
+	std::vector<int> hull_verts_end, hull_faces_end;
+	std::vector<float> hull_x, hull_y, hull_z;
+	std::vector<int> hull_face_a, hull_face_b, hull_face_c;
+	for (const ConvexHull& hull : hulls_) {
+		for (const Eigen::Vector3f& v : hull.getVerts()) {
+			hull_x.push_back(v(0)); hull_y.push_back(v(1)); hull_z.push_back(v(2));
+		}
+		for (const auto& [a, b, c] : hull.getFaces()) {
+			hull_face_a.push_back(a); hull_face_b.push_back(b); hull_face_c.push_back(c);
+		}
+		hull_verts_end.push_back(static_cast<int>(hull_x.size()));
+		hull_faces_end.push_back(static_cast<int>(hull_face_a.size()));
+	}
+	CollisionMeshData data{ static_cast<int>(verts_.size()), static_cast<int>(edges_.size()), static_cast<int>(faces_.size()),
+		vert_x.data(), vert_y.data(), vert_z.data(),
+		edge_a.data(), edge_b.data(), edge_face_0.data(), edge_face_1.data(),
+		face_a.data(), face_b.data(), face_c.data(),
+		plane_x.data(), plane_y.data(), plane_z.data(), face_offsets_.data(),
+		static_cast<int>(hulls_.size()), static_cast<int>(hull_x.size()), static_cast<int>(hull_face_a.size()),
+		hull_verts_end.data(), hull_faces_end.data(),
+		hull_x.data(), hull_y.data(), hull_z.data(),
+		hull_face_a.data(), hull_face_b.data(), hull_face_c.data() };
+	return CollisionMeshFile::write(fname, source_fname, data);
+}
@@ -5,6 +5,13 @@
 #include <Eigen/dense>
 #include <iostream>
 #include <tuple>
+#include <vector>
+#include <algorithm>
+
+#include "triangle_soa.hpp"
+#include "mesh_bvh.hpp"
+#include "collision_mesh.hpp"
+#include "convex_hull.hpp"
 
 using Eigen::seq;
 //boundaryConstraint -> cant cross specified boundary, motion is adjusted to stay within bounds
@@ -14,6 +21,29 @@ template<int n_dims>
 class Surface {
 public:
 	virtual bool crossesSurface(Eigen::Vector<float, n_dims> first_state, Eigen::Vector<float, n_dims> second_state) const = 0;
+
+	//where going from first_state to second_state first crosses, as k along the segment, and the
+	//normal of the surface there facing back against the direction of travel.
+	//without anything more to go on than crossesSurface this narrows k down by halving, k is then the
+	//last point found not to cross and the normal is straight back along the segment
+	virtual bool firstCrossing(Eigen::Vector<float, n_dims> first_state, Eigen::Vector<float, n_dims> second_state, float* k, Eigen::Vector<float, n_dims>* normal) const {
+		if (!crossesSurface(first_state, second_state)) {
+			return false;
+		}
+		float free_k = 0;
+		float crossed_k = 1;
+		for (int i = 0; i < 8; i++) {
+			float mid_k = (free_k + crossed_k) / 2;
+			if (crossesSurface(first_state, first_state + mid_k * (second_state - first_state))) {
+				crossed_k = mid_k;
+			} else {
+				free_k = mid_k;
+			}
+		}
+		*k = free_k;
+		*normal = -(second_state - first_state).normalized();
+		return true;
+	}
 };
 
 
@@ -34,6 +64,21 @@ class MeshSurface : public Surface<3> {
 	std::vector<std::pair<int, int>> edges_;
 	std::vector<std::tuple<int, int, int>> faces_;
 	std::vector<Eigen::Vector3f> face_norms_;
+	std::vector<float> face_offsets_; //face_norms_[i].p = face_offsets_[i] on face i
+	std::vector<std::pair<int, int>> edge_faces_; //faces either side of each edge, -1 for none. empty until buildTopology
+	TriangleSoA triangles_; //faces_ again, laid out for crossesSurface
+	MeshBVH bvh_; //over faces_, crossesSurface goes through it once it is built
+	std::vector<ConvexHull> hulls_; //convex pieces holding the inside of the mesh, empty if it isnt closed
+	float hull_reach_; //furthest any vert of hulls_ is from the origin
+
+	void setHulls(std::vector<ConvexHull> hulls);
+	//merges verts at exactly the same position, the faces and edges are pointed at the one kept
+	void weldVerts();
+	//edges_ from the faces, each undirected edge once, and edge_faces_ to go with them
+	void buildTopology();
+	//false without loading anything if an index or hull range in data points outside its array
+	bool loadCooked(const CollisionMeshData& data);
+	bool saveCooked(const std::string& fname, const std::string& source_fname) const;
 
 	struct edgeHasher {
 		size_t operator()(const std::pair<int, int>& p) const {
@@ -123,24 +168,122 @@ public:
 
 	//this (primary surface) is the "shield" and other(secondary surface) is the "sword"
 	//i.e. if secondary is a single edge then it will work but not vice versa
+	//same hits as calling crossesTriangle on every face. goes through the bvh if it is built, otherwise
+	//tests every face a pack at a time
 	bool crossesSurface(Eigen::Vector<float, 3> first_state, Eigen::Vector<float, 3> second_state) const override {
-		for (const std::tuple<int, int, int>& f : faces_) {
-			if (crossesTriangle(first_state, second_state, verts_[std::get<0>(f)], verts_[std::get<1>(f)], verts_[std::get<2>(f)])) {
-				return true;
-			}
-		} 
-		return false;
+		if (bvh_.isBuilt()) {
+			return bvh_.anyHit(first_state, second_state);
+		}
+		return triangles_.firstHit(first_state, second_state) >= 0;
 	}
 
+	//loc is where along the segment it crosses the first face it crosses, in face order
 	bool crossesSurface(Eigen::Vector<float, 3> first_state, Eigen::Vector<float, 3> second_state, float* loc) const {
-		for (const std::tuple<int, int, int>& f : faces_) {
-			if (crossesTriangle(first_state, second_state, verts_[std::get<0>(f)], verts_[std::get<1>(f)], verts_[std::get<2>(f)],loc)) {
+		if (bvh_.isBuilt()) {
+			return bvh_.firstHit(first_state, second_state, loc) >= 0;
+		}
+		return triangles_.firstHit(first_state, second_state, loc) >= 0;
+	}
+
+	//the face crossed first going from first_state, exactly, not by halving
+	bool firstCrossing(Eigen::Vector<float, 3> first_state, Eigen::Vector<float, 3> second_state, float* k, Eigen::Vector<float, 3>* normal) const override {
+		int face = bvh_.isBuilt() ? bvh_.nearestHit(first_state, second_state, k) : triangles_.nearestHit(first_state, second_state, k);
+		if (face < 0) {
+			return false;
+		}
+		const auto& [a, b, c] = faces_[face];
+		Eigen::Vector3f n = (verts_[b] - verts_[a]).cross(verts_[c] - verts_[a]).normalized();
+		*normal = n.dot(second_state - first_state) > 0 ? -n : n;
+		return true;
+	}
+
+	//every face the segment crosses with k where along it, nearest first
+	void allCrossings(Eigen::Vector<float, 3> first_state, Eigen::Vector<float, 3> second_state, std::vector<std::pair<int, float>>* hits) const {
+		if (bvh_.isBuilt()) {
+			bvh_.allHits(first_state, second_state, hits);
+		} else {
+			hits->clear();
+			TriangleSoA::Segment segment = TriangleSoA::makeSegment(first_state, second_state);
+			float ks[TriangleSoA::lanes()];
+			for (size_t first = 0; first < triangles_.slots(); first += TriangleSoA::lanes()) {
+				int bits = triangles_.testPack(segment, first, ks);
+				for (int lane = 0; bits != 0; lane++, bits >>= 1) {
+					if (bits & 1) {
+						hits->emplace_back(static_cast<int>(first) + lane, ks[lane]);
+					}
+				}
+			}
+		}
+		std::sort(hits->begin(), hits->end(), [](const std::pair<int, float>& a, const std::pair<int, float>& b) {
+			return a.second < b.second || (a.second == b.second && a.first < b.first);
+		});
+	}
+
+	//does any of the segments cross, the whole batch goes down the bvh together
+	bool crossesSurface(const std::vector<MeshBVH::Segment>& segments) const {
+		if (bvh_.isBuilt()) {
+			return bvh_.anyHit(segments);
+		}
+		for (const auto& [first_state, second_state] : segments) {
+			if (triangles_.firstHit(first_state, second_state) >= 0) {
 				return true;
 			}
 		}
 		return false;
 	}
 
+	//hits[i] is whether segments[i] crosses
+	void crossesSurface(const std::vector<MeshBVH::Segment>& segments, std::vector<bool>* hits) const {
+		if (bvh_.isBuilt()) {
+			bvh_.hitEach(segments, hits);
+			return;
+		}
+		hits->resize(segments.size());
+		for (int i = 0; i < segments.size(); i++) {
+			(*hits)[i] = triangles_.firstHit(segments[i].first, segments[i].second) >= 0;
+		}
+	}
+
+	//the verts moved to verts, which has one for every vert in the same order. faces, edges and the
+	//topology stay as they are, the face planes follow and the bvh is refit rather than built again
+	void moveVerts(const std::vector<Eigen::Vector3f>& verts) {
+		verts_ = verts;
+		for (int i = 0; i < faces_.size(); i++) {
+			const auto& [a, b, c] = faces_[i];
+			Eigen::Vector3f n = (verts_[b] - verts_[a]).cross(verts_[c] - verts_[a]).normalized();
+			face_norms_[i] = n;
+			face_offsets_[i] = n.dot(verts_[a]);
+			triangles_.set(i, verts_[a], verts_[b], verts_[c]);
+		}
+		if (bvh_.isBuilt()) {
+			bvh_.refit(verts_, faces_);
+		}
+		//cut up for another shape, worked out again only at cook time
+		hulls_.clear();
+	}
+
+	//builds the bvh over the faces so far. the obj constructor does this, meshes made face by face
+	//should call it once they are done
+	void buildBVH() {
+		bvh_.build(verts_, faces_);
+	}
+
+	const MeshBVH& getBVH() const {
+		return bvh_;
+	}
+
+	//cuts a closed mesh into convex pieces for GJK, a convex mesh is one piece. an open mesh gets none,
+	//it has no inside to hold, small holes aside. the obj constructor does this when it cooks, it is
+	//too slow to do as the game runs
+	void buildHulls();
+
+	const std::vector<ConvexHull>& getHulls() const {
+		return hulls_;
+	}
+	float getHullReach() const {
+		return hull_reach_;
+	}
+
 	const std::vector<Eigen::Vector3f>& getVerts() const {
 		return verts_;
 	}
@@ -161,14 +304,35 @@ public:
 	const std::vector<std::tuple<int, int, int>>& getFaces() const {
 		return faces_;
 	}
+	//the face's verts have to be added first. drops the bvh and the convex pieces until buildBVH and
+	//buildHulls are called again
 	void addFace(int first_ind, int second_ind, int third_ind) {
 		faces_.emplace_back(first_ind, second_ind, third_ind);
+		triangles_.add(verts_[first_ind], verts_[second_ind], verts_[third_ind]);
+		Eigen::Vector3f n = (verts_[second_ind] - verts_[first_ind]).cross(verts_[third_ind] - verts_[first_ind]).normalized();
+		face_norms_.push_back(n);
+		face_offsets_.push_back(n.dot(verts_[first_ind]));
+		bvh_.clear();
+		hulls_.clear();
+	}
+
+	//unit normals, along (b-a)x(c-a) for face a b c
+	const std::vector<Eigen::Vector3f>& getFaceNorms() const {
+		return face_norms_;
+	}
+	const std::vector<float>& getFaceOffsets() const {
+		return face_offsets_;
+	}
+	const std::vector<std::pair<int, int>>& getEdgeFaces() const {
+		return edge_faces_;
 	}
 
+	//loads <name>.cmesh next to the obj if it is there and up to date, otherwise reads the obj, welds
+	//and builds the topology and the convex pieces and cooks it into <name>.cmesh for next time
 	explicit MeshSurface(std::string fname);
 	MeshSurface(std::string fname, std::string path);
 
-	MeshSurface(){}
+	MeshSurface() : hull_reach_(0) {}
 
 };
 
@@ -4,6 +4,9 @@
 #define PUPPET_GRAPHICSTEXT
 
 #include <string>
+#include <array>
+#include <algorithm>
+#include <vector>
 
 #include "text.hpp"
 #include "Graphics.hpp"
@@ -34,16 +37,16 @@ class Font {
 	Texture glyph;
 	int tex_id_;
 	float unscaled_line_height_;
-	std::unordered_map<char, char_info> char_info_bank;
-	//should be const, but initialization is awkward so left non-const for now
+	std::array<char_info, 256> char_info_bank_;
+	//flat table indexed by the unsigned char value, glyph lookups happen per character per frame
 
 public:
 	int getTexID() const {
 		return tex_id_;
 	}
 
-	char_info getCharInfo(const char& c) const {
-		return char_info_bank.at(c);
+	const char_info& getCharInfo(const char& c) const {
+		return char_info_bank_[static_cast<unsigned char>(c)];
 	}
 
 	float getUnscaledLineHeight() const {
@@ -53,11 +56,11 @@ public:
 
 	Font(std::string glyph_fname, std::string path):glyph(glyph_fname, path),unscaled_line_height_(1.f/15.f) {
 		for (int i = 0; i < 256; i++) {
-			char_info_bank[static_cast<char>(i)] = char_info(static_cast<char>(i));
+			char_info_bank_[i] = char_info(static_cast<char>(i));
 		}
 		unsigned int tex_id;
 		glGenTextures(1, &(tex_id));
-		glBindTexture(GL_TEXTURE_2D, tex_id);
+		GLState::bindTexture(tex_id);
 		//this->tex_id = static_cast<int>(tex_id);
 		tex_id_ = static_cast<int>(tex_id);
 
@@ -79,104 +82,174 @@ public:
 
 };
 
-class TextGraphics : public Graphics<Textbox, unsigned int, unsigned int, size_t> {
-								//textbox, VAO, tex_id, n_elems
-	std::unordered_map<std::string, const Font*> named_fonts_;
-	Font& default_font_;
-	unsigned int position_location_;
-
-
-
-	Cache makeDataCache(const Textbox& obj) const override {
-		const Font* font;
-		if (named_fonts_.contains(obj.font)) {
-			font = named_fonts_.at(obj.font);
-		}
-		else {
-			font = &default_font_;
-		}
+//a textbox's quads as of the last time they were built, along with what they were built from
+struct TextQuads {
+	std::string text;
+	float font_size;
+	float box_width;
+	Eigen::Matrix4f position;
+	std::vector<float> verts;
+	size_t n_glyphs;
+	bool valid;
 
-		//super lazy code...
-		const Model* model_ = makeTextboxModel(obj,*font);
-		const Model& model = *model_;
+	TextQuads() : font_size(0), box_width(0), position(Eigen::Matrix4f::Zero()), n_glyphs(0), valid(false) {}
 
-		// = model.flen();
-		unsigned int VAO;
-		glGenVertexArrays(1, &(VAO));
-		unsigned int VBO[2];
-		glGenBuffers(2, VBO);
-		unsigned int EBO;
-		glGenBuffers(1, &EBO);
+	bool isStale(const Textbox& textbox, const Eigen::Matrix4f& new_position) const {
+		return !valid || textbox.font_size != font_size || textbox.box_width != box_width || new_position != position || textbox.text != text;
+	}
 
-		glBindVertexArray(VAO);
+	void rebuild(const Textbox& textbox, const Font& font, const Eigen::Matrix4f& new_position);
+};
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.vlen() * 3, model.getVerts().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
+//each textbox keeps its own quads, already transformed, and only rebuilds them when its text, size
+//or position changed since the last frame. all textboxes are drawn through one vertex buffer with one
+//draw per font, which is only rewritten on frames where some textbox was rebuilt, shown or hidden.
+//a ui that isnt changing costs a string and matrix compare per textbox and a draw per font
+class TextGraphics : public Graphics<Textbox, const Font*, TextQuads*> {
+								//textbox, font, its quads
+	static constexpr size_t floats_per_vert_ = 5; //x,y,z,u,v
+	static constexpr size_t verts_per_glyph_ = 6;
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * model.getTexCoords().size(), model.getTexCoords().data(), GL_STATIC_DRAW);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
+	struct GlyphBatch {
+		const Font* font;
+		std::vector<float> verts; //kept between frames, only rewritten when something is dirty
+		size_t first_vert;
+	};
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * model.flen() * 3, model.getFaces().data(), GL_STATIC_DRAW);
+	std::unordered_map<std::string, const Font*> named_fonts_;
+	Font& default_font_;
+	unsigned int VAO_;
+	unsigned int VBO_;
+	mutable size_t vbo_capacity_; //in floats
+	mutable std::vector<GlyphBatch> batches_; //only a handful of fonts so a linear search is fine
+	mutable std::vector<std::pair<const Font*, const TextQuads*>> drawn_; //in draw order, to tell when the set of visible textboxes changed
+	mutable size_t n_drawn_;
+	mutable bool dirty_;
+	mutable size_t n_draw_calls_;
+	mutable size_t n_glyphs_;
+	mutable size_t n_rebuilt_;
+	mutable bool uploaded_;
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
 
-		/*GLenum error = glGetError();
-		if (error != GL_NO_ERROR) {
-			printf("Error during VAO creation: 0x%x\n", error);
-		}*/
 
-		//texture code:
-		unsigned int glyph_tex_id = font->getTexID();
-		int n_elems = model.flen();
-		delete model_;
-		return Cache{ VAO, glyph_tex_id,  n_elems};
+	Cache makeDataCache(const Textbox& obj) const override {
+		const Font* font = &default_font_;
+		if (named_fonts_.contains(obj.font)) {
+			font = named_fonts_.at(obj.font);
+		}
+		return Cache{ font, new TextQuads() };
 	};
 
 	void deleteDataCache(Cache cache) const override {
-
+		delete std::get<1>(cache);
+		dirty_ = true;
 	};
 
 
-	constexpr unsigned int& getVAO(Cache cache) const {
+	constexpr const Font* getFont(Cache cache) const {
 		return std::get<0>(cache);
 	}
 
-	constexpr unsigned int& getTexID(Cache cache) const {
-		return std::get<1>(cache);
-	}
-
-	constexpr size_t& getNElems(Cache cache) const {
-		return std::get<2>(cache);
+	GlyphBatch& getBatch(const Font* font) const {
+		for (GlyphBatch& batch : batches_) {
+			if (batch.font == font) {
+				return batch;
+			}
+		}
+		batches_.push_back(GlyphBatch{ font, {}, 0 });
+		return batches_.back();
 	}
 
 	void drawObj(const Textbox& obj, Cache cache) const override {
-		glBindTexture(GL_TEXTURE_2D, getTexID(cache));
-		glBindVertexArray(getVAO(cache));
-
 		Eigen::Matrix4f position_centered = obj.getPosition();
 		position_centered(0, 3) -= obj.box_width / 2;
 		position_centered(1, 3) += obj.box_height / 2;
-		glUniformMatrix4fv(position_location_, 1, GL_FALSE, position_centered.data());
 
-		glDrawElements(GL_TRIANGLES, 3 * getNElems(cache), GL_UNSIGNED_INT, 0);
+		const Font* font = getFont(cache);
+		TextQuads& quads = *std::get<1>(cache);
+		if (quads.isStale(obj, position_centered)) {
+			quads.rebuild(obj, *font, position_centered);
+			n_rebuilt_++;
+			dirty_ = true;
+		}
+
+		if (n_drawn_ == drawn_.size()) {
+			drawn_.push_back({ font, &quads });
+			dirty_ = true;
+		} else if (drawn_[n_drawn_].second != &quads) {
+			drawn_[n_drawn_] = { font, &quads };
+			dirty_ = true;
+		}
+		n_drawn_++;
 	}
 
 
 	void beginDraw() const override {
-		glDisable(GL_DEPTH_TEST);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-		//default3d specific code
+		GLState::disable(GL_DEPTH_TEST);
+		GLState::polygonMode(GL_FILL);
+		n_drawn_ = 0;
+		n_draw_calls_ = 0;
+		n_rebuilt_ = 0;
+		uploaded_ = false;
 	}
 
 	void endDraw() const override {
-		//default3d specific code
+		if (n_drawn_ != drawn_.size()) {
+			drawn_.resize(n_drawn_);
+			dirty_ = true;
+		}
+		if (dirty_) {
+			rewriteBuffer();
+			dirty_ = false;
+		}
+
+		GLState::bindVertexArray(VAO_);
+		for (const GlyphBatch& batch : batches_) {
+			if (batch.verts.empty()) {
+				continue;
+			}
+			GLState::bindTexture(batch.font->getTexID());
+			glDrawArrays(GL_TRIANGLES, batch.first_vert, batch.verts.size() / floats_per_vert_);
+			n_draw_calls_++;
+		}
+	}
+
+	//gathers the quads of everything drawn this frame into the per font batches and uploads them
+	void rewriteBuffer() const {
+		for (GlyphBatch& batch : batches_) {
+			batch.verts.clear();
+		}
+		n_glyphs_ = 0;
+		for (const auto& [font, quads] : drawn_) {
+			std::vector<float>& verts = getBatch(font).verts;
+			verts.insert(verts.end(), quads->verts.begin(), quads->verts.end());
+			n_glyphs_ += quads->n_glyphs;
+		}
+
+		size_t total_floats = 0;
+		for (GlyphBatch& batch : batches_) {
+			batch.first_vert = total_floats / floats_per_vert_;
+			total_floats += batch.verts.size();
+		}
+		if (total_floats == 0) {
+			return;
+		}
+
+		GLState::bindVertexArray(VAO_);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_);
+		vbo_capacity_ = std::max<size_t>(vbo_capacity_, 1);
+		while (vbo_capacity_ < total_floats) {
+			vbo_capacity_ *= 2;
+		}
+		//orphan the old storage so the driver doesnt stall on last frames draw
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vbo_capacity_, NULL, GL_DYNAMIC_DRAW);
+		for (const GlyphBatch& batch : batches_) {
+			if (!batch.verts.empty()) {
+				glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * batch.first_vert * floats_per_vert_, sizeof(float) * batch.verts.size(), batch.verts.data());
+			}
+		}
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		uploaded_ = true;
 	}
 
 public:
@@ -184,27 +257,71 @@ public:
 		named_fonts_[name] = &font;
 	}
 	
-	TextGraphics(Font& default_font):
+	TextGraphics(Font& default_font, size_t initial_glyph_capacity = 1024):
 		default_font_(default_font),
-		position_location_(glGetUniformLocation(gl_id, "position_matrix")){
+		vbo_capacity_(initial_glyph_capacity * verts_per_glyph_ * floats_per_vert_),
+		n_drawn_(0),
+		dirty_(true),
+		n_draw_calls_(0),
+		n_glyphs_(0),
+		n_rebuilt_(0),
+		uploaded_(false){
+		glGenVertexArrays(1, &VAO_);
+		glGenBuffers(1, &VBO_);
+
+		GLState::bindVertexArray(VAO_);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, VBO_);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vbo_capacity_, NULL, GL_DYNAMIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, floats_per_vert_ * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, floats_per_vert_ * sizeof(float), (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::bindVertexArray(0);
+	}
+
+	~TextGraphics() {
+		GLState::deleteBuffers(1, &VBO_);
+		GLState::deleteVertexArrays(1, &VAO_);
+	}
+
+	//stats from the last drawAll
+	size_t getNDrawCalls() const {
+		return n_draw_calls_;
 	}
 
-	//renamed from get to make since it is allocating memory
-//nodiscard since memory needs to be deleted later. this should be a smart pointer eventually
-	[[nodiscard]] static Model* makeTextboxModel(const Textbox& textbox, const Font& font) {
+	size_t getNGlyphs() const {
+		return n_glyphs_;
+	}
+
+	//textboxes whose quads were rebuilt
+	size_t getNRebuilt() const {
+		return n_rebuilt_;
+	}
+
+	//false on frames where nothing changed and last frame's buffer was drawn as is
+	bool wasUploaded() const {
+		return uploaded_;
+	}
+
+	//appends two triangles per character, already transformed by position, to out. returns the number of glyphs written
+	static size_t writeTextboxQuads(const Textbox& textbox, const Font& font, const Eigen::Matrix4f& position, std::vector<float>& out) {
 		float line_length = 0;
 		int line_num = 0;
-		Model* textbox_model = new Model(std::vector<float>{},
-			std::vector<float>{},
-			std::vector<float>{},
-			std::vector<unsigned int>{},
-			std::vector<unsigned int>{},
-			std::vector<unsigned int>{});
+
+		auto write_vert = [&](float x, float y, float u, float v) {
+			Eigen::Vector4f p = position * Eigen::Vector4f(x, y, 0, 1);
+			out.push_back(p(0));
+			out.push_back(p(1));
+			out.push_back(p(2));
+			out.push_back(u);
+			out.push_back(v);
+		};
 
 		const size_t& strlen = textbox.text.size();
 		for (size_t i = 0; i < strlen; i++) {
 			char c = textbox.text[i];
-			char_info char_info_ = font.getCharInfo(c);
+			const char_info& char_info_ = font.getCharInfo(c);
 			float char_end = line_length + char_info_.unscaled_width * textbox.font_size;
 			if (char_end > textbox.box_width || c == '\n') {
 				char_end = char_info_.unscaled_width * textbox.font_size;
@@ -212,28 +329,36 @@ public:
 				line_length = 0;
 			}
 			float line_top = -line_num * font.getUnscaledLineHeight() * textbox.font_size;
-			int vert_index_offset = textbox_model->getVerts().size() / 3;
-			//add verts model
-			textbox_model->addVert(Eigen::Vector3f(line_length, line_top, 0));
-			textbox_model->addVert(Eigen::Vector3f(line_length, line_top - textbox.font_size * char_info_.unscaled_height, 0));
-			textbox_model->addVert(Eigen::Vector3f(char_end, line_top, 0));
-			textbox_model->addVert(Eigen::Vector3f(char_end, line_top - textbox.font_size * char_info_.unscaled_height, 0));//bottom right
-			//add tex coords to model
-			textbox_model->addTexCoord(char_info_.glyph_left, 1-(char_info_.glyph_top));
-			textbox_model->addTexCoord(char_info_.glyph_left, 1-(char_info_.glyph_top + char_info_.unscaled_height));
-			textbox_model->addTexCoord(char_info_.glyph_left + char_info_.unscaled_width, 1- char_info_.glyph_top);
-			textbox_model->addTexCoord(char_info_.glyph_left + char_info_.unscaled_width, 1-(char_info_.glyph_top + char_info_.unscaled_height));
-			//add face to model
-			textbox_model->addFace(vert_index_offset, vert_index_offset + 1, vert_index_offset + 2);
-			textbox_model->addFace(vert_index_offset + 1, vert_index_offset + 2, vert_index_offset + 3);
+			float line_bottom = line_top - textbox.font_size * char_info_.unscaled_height;
+			float tex_left = char_info_.glyph_left;
+			float tex_right = char_info_.glyph_left + char_info_.unscaled_width;
+			float tex_top = 1 - char_info_.glyph_top;
+			float tex_bottom = 1 - (char_info_.glyph_top + char_info_.unscaled_height);
+			//same winding as the old indexed quads: (tl, bl, tr), (bl, tr, br)
+			write_vert(line_length, line_top, tex_left, tex_top);
+			write_vert(line_length, line_bottom, tex_left, tex_bottom);
+			write_vert(char_end, line_top, tex_right, tex_top);
+			write_vert(line_length, line_bottom, tex_left, tex_bottom);
+			write_vert(char_end, line_top, tex_right, tex_top);
+			write_vert(char_end, line_bottom, tex_right, tex_bottom);
 			line_length = char_end;
 		}
-		return textbox_model;
+		return strlen;
 	}
 
 
 };
 
+inline void TextQuads::rebuild(const Textbox& textbox, const Font& font, const Eigen::Matrix4f& new_position) {
+	text = textbox.text;
+	font_size = textbox.font_size;
+	box_width = textbox.box_width;
+	position = new_position;
+	verts.clear();
+	n_glyphs = TextGraphics::writeTextboxQuads(textbox, font, position, verts);
+	valid = true;
+}
+
 const char* TextGraphics::vertex_code = "\n"
 "#version 330 core\n"
 "layout (location = 0) in vec3 pos;\n"
@@ -242,13 +367,13 @@ const char* TextGraphics::vertex_code = "\n"
 
 //"uniform float line_height;\n"
 //"uniform float numeric_char_width;\n"
-"uniform mat4 position_matrix;\n"
+//positions are already transformed on the cpu when the batch is written
 
 "out vec2 texCoord;\n"
 
 "void main()\n"
 "{\n"
-"   gl_Position = position_matrix * vec4(pos.x, pos.y, 0, 1.0);\n"
+"   gl_Position = vec4(pos, 1.0);\n"
 //"	if(vt_offset > 1) {vt.y += line_height;vt.x = numeric_char_width*(vt_offset-2);}\n"
 //"	else if (vt_offset == 1) {vt += numeric_char_width;}\n"
 "	texCoord = vt;\n"
@@ -0,0 +1,158 @@
+#pragma once
+
+#ifndef PUPPET_TEXTURE_ATLAS
+#define PUPPET_TEXTURE_ATLAS
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "Texture.h"
+#include "gl_state.hpp"
+
+//packs small textures (ui buttons, borders, solid colors) into one gl texture so everything
+//sampling from it can go in the same draw call. packing is simple shelf packing. a removed texture
+//leaves its slot to the next texture that fits in it, so swapping between textures of the same size,
+//like recoloring a SolidTexture, doesnt use up the atlas.
+//the atlas is clamped at the edges, a texture that has to repeat needs its own gl texture
+class TextureAtlas {
+public:
+	struct Region {
+		int x, y, width, height;
+
+		Region() :x(-1), y(-1), width(0), height(0) {}
+		Region(int x, int y, int width, int height) :x(x), y(y), width(width), height(height) {}
+
+		bool isValid() const {
+			return x >= 0;
+		}
+	};
+
+private:
+	static constexpr int padding_ = 1;
+
+	unsigned int tex_id_;
+	const int width_, height_;
+	int shelf_x_, shelf_y_, shelf_height_;
+	struct Entry {
+		Region region; //what the texture covers
+		Region slot; //what it was given, can be bigger when it went into a freed slot
+	};
+
+	std::unordered_map<const Texture*, Entry> regions_;
+	std::vector<Region> free_; //slots of removed textures
+
+	Region allocate(int w, int h) {
+		if (w + 2 * padding_ > width_ || h + 2 * padding_ > height_) {
+			return Region();
+		}
+		//the smallest free slot it fits in
+		auto best = free_.end();
+		for (auto it = free_.begin(); it != free_.end(); it++) {
+			if (it->width >= w && it->height >= h && (best == free_.end() || it->width * it->height < best->width * best->height)) {
+				best = it;
+			}
+		}
+		if (best != free_.end()) {
+			Region region = *best;
+			free_.erase(best);
+			return region;
+		}
+		if (shelf_x_ + w + 2 * padding_ > width_) {
+			//next shelf
+			shelf_y_ += shelf_height_;
+			shelf_x_ = 0;
+			shelf_height_ = 0;
+		}
+		if (shelf_y_ + h + 2 * padding_ > height_) {
+			return Region();
+		}
+		Region region(shelf_x_ + padding_, shelf_y_ + padding_, w, h);
+		shelf_x_ += w + 2 * padding_;
+		shelf_height_ = std::max(shelf_height_, h + 2 * padding_);
+		return region;
+	}
+
+public:
+	TextureAtlas(int width, int height) :width_(width), height_(height), shelf_x_(0), shelf_y_(0), shelf_height_(0) {
+		glGenTextures(1, &tex_id_);
+		GLState::bindTexture(tex_id_);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);//no mips, they would bleed between entries
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		GLState::bindTexture(0);
+	}
+
+	TextureAtlas() :TextureAtlas(1024, 1024) {}
+
+	~TextureAtlas() {
+		GLState::deleteTextures(1, &tex_id_);
+	}
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	int getTexID() const {
+		return static_cast<int>(tex_id_);
+	}
+
+	//returns an invalid region if the texture doesnt fit, caller should fall back to its own texture
+	Region insert(const Texture& tex) {
+		if (regions_.contains(&tex)) {
+			return regions_.at(&tex).region;
+		}
+		Region slot = allocate(tex.width, tex.height);
+		if (!slot.isValid()) {
+			return slot;
+		}
+		Region region(slot.x, slot.y, tex.width, tex.height);
+
+		std::vector<uint8_t> data = tex.getData();
+		std::vector<uint8_t> rgba(tex.width * tex.height * 4, 255);
+		for (size_t i = 0; i < static_cast<size_t>(tex.width * tex.height); i++) {
+			for (size_t c = 0; c < tex.n_channels && c < 4; c++) {
+				rgba[4 * i + c] = data[tex.n_channels * i + c];
+			}
+		}
+
+		GLState::bindTexture(tex_id_);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		GLState::bindTexture(0);
+
+		regions_[&tex] = Entry{ region, slot };
+		return region;
+	}
+
+	//frees tex's slot, a texture inserted later at the same address gets uploaded again. tex is only
+	//looked up, it can already be deleted
+	void remove(const Texture* tex) {
+		auto found = regions_.find(tex);
+		if (found == regions_.end()) {
+			return;
+		}
+		free_.push_back(found->second.slot);
+		regions_.erase(found);
+	}
+
+	//(left, bottom, width, height) in uv space, a uv of (u,v) on the original texture maps to
+	//(left + u*width, bottom + v*height)
+	Eigen::Vector4f getUVRect(const Region& region) const {
+		return Eigen::Vector4f(
+			static_cast<float>(region.x) / width_,
+			static_cast<float>(region.y) / height_,
+			static_cast<float>(region.width) / width_,
+			static_cast<float>(region.height) / height_);
+	}
+
+	size_t size() const {
+		return regions_.size();
+	}
+
+};
+
+#endif
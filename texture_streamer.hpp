@@ -0,0 +1,235 @@
+#pragma once
+
+#ifndef PUPPET_TEXTURE_STREAMER
+#define PUPPET_TEXTURE_STREAMER
+
+#include <glad/glad.h>
+#include <Eigen/Dense>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+#include "Texture.h"
+#include "Model.h"
+#include "gl_state.hpp"
+
+//keeps only the mips of each texture that are actually needed in vram. every frame the renderer
+//requests the finest mip each texture is seen at, update() then uploads or evicts the finest levels
+//to get as close to that as the budget allows. the full mip chain stays on the cpu, a texture's gl
+//object only ever holds levels resident..coarsest and sampling is clamped to them with
+//GL_TEXTURE_BASE_LEVEL, so a texture that isnt streamed in yet just looks blurrier
+class TextureStreamer {
+public:
+	struct Stats {
+		size_t n_textures;
+		size_t resident_bytes;
+		size_t requested_bytes; //what the requests of the last frame would take with no budget
+		size_t budget_bytes;
+		size_t n_uploads; //levels, last update
+		size_t n_evictions;
+	};
+
+private:
+	static constexpr int initial_size_ = 64; //levels this size and smaller are uploaded right away
+
+	struct Streamed {
+		unsigned int format;
+		int n_channels;
+		std::vector<std::vector<uint8_t>> mips; //cpu copy of every level, 0 is full resolution
+		std::vector<std::pair<int, int>> sizes;
+		int resident; //finest level in vram
+		int requested; //finest level asked for since the last update, -1 if none
+	};
+
+	std::unordered_map<unsigned int, Streamed> textures_;
+	size_t budget_;
+	int max_uploads_per_update_; //spreads the upload cost over frames
+	Stats stats_;
+
+	size_t levelBytes(const Streamed& streamed, int level) const {
+		return static_cast<size_t>(streamed.sizes[level].first) * streamed.sizes[level].second * streamed.n_channels;
+	}
+
+	//bytes of level and everything coarser
+	size_t tailBytes(const Streamed& streamed, int level) const {
+		size_t bytes = 0;
+		for (int i = level; i < static_cast<int>(streamed.mips.size()); i++) {
+			bytes += levelBytes(streamed, i);
+		}
+		return bytes;
+	}
+
+	//2x2 box filter, odd edges reuse the last row or column
+	static std::vector<uint8_t> downsample(const std::vector<uint8_t>& src, int width, int height, int n_channels, int new_width, int new_height) {
+		std::vector<uint8_t> dst(static_cast<size_t>(new_width) * new_height * n_channels);
+		for (int y = 0; y < new_height; y++) {
+			int y0 = std::min(2 * y, height - 1);
+			int y1 = std::min(2 * y + 1, height - 1);
+			for (int x = 0; x < new_width; x++) {
+				int x0 = std::min(2 * x, width - 1);
+				int x1 = std::min(2 * x + 1, width - 1);
+				for (int c = 0; c < n_channels; c++) {
+					int sum = src[(y0 * width + x0) * n_channels + c] + src[(y0 * width + x1) * n_channels + c]
+						+ src[(y1 * width + x0) * n_channels + c] + src[(y1 * width + x1) * n_channels + c];
+					dst[(y * new_width + x) * n_channels + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+		return dst;
+	}
+
+	void upload(unsigned int tex_id, const Streamed& streamed, int level) const {
+		glTexImage2D(GL_TEXTURE_2D, level, streamed.format, streamed.sizes[level].first, streamed.sizes[level].second, 0, streamed.format, GL_UNSIGNED_BYTE, streamed.mips[level].data());
+	}
+
+public:
+	TextureStreamer(size_t budget = 256 << 20, int max_uploads_per_update = 4) :
+		budget_(budget),
+		max_uploads_per_update_(max_uploads_per_update),
+		stats_{ 0, 0, 0, budget, 0, 0 } {
+	}
+
+	//how many texels of tex lie across the model's bounding sphere, from the uv area per unit of
+	//surface area. dividing by the pixels the sphere covers on screen gives texels per pixel
+	static float texelsAcross(const Model& model, const Texture& tex) {
+		const std::vector<float>& verts = model.getVerts();
+		const std::vector<float>& tex_coords = model.getTexCoords();
+		double area = 0;
+		double uv_area = 0;
+		for (size_t i = 0; i < model.flen(); i++) {
+			Eigen::Vector3f v0(verts[9 * i], verts[9 * i + 1], verts[9 * i + 2]);
+			Eigen::Vector3f v1(verts[9 * i + 3], verts[9 * i + 4], verts[9 * i + 5]);
+			Eigen::Vector3f v2(verts[9 * i + 6], verts[9 * i + 7], verts[9 * i + 8]);
+			area += .5 * (v1 - v0).cross(v2 - v0).norm();
+			Eigen::Vector2f t0(tex_coords[6 * i], tex_coords[6 * i + 1]);
+			Eigen::Vector2f t1(tex_coords[6 * i + 2], tex_coords[6 * i + 3]);
+			Eigen::Vector2f t2(tex_coords[6 * i + 4], tex_coords[6 * i + 5]);
+			Eigen::Vector2f a = t1 - t0;
+			Eigen::Vector2f b = t2 - t0;
+			uv_area += .5 * std::abs(a(0) * b(1) - a(1) * b(0));
+		}
+		if (area <= 0) {
+			return 0;
+		}
+		float texels_per_unit = static_cast<float>(std::sqrt(uv_area * tex.width * tex.height / area));
+		return texels_per_unit * model.getBoundingBox().norm();
+	}
+
+	//creates the gl texture with only the small levels in it
+	unsigned int add(const Texture& tex) {
+		Streamed streamed;
+		streamed.n_channels = tex.n_channels;
+		streamed.format = tex.n_channels == 4 ? GL_RGBA : GL_RGB;
+		streamed.mips.push_back(tex.getData());
+		streamed.sizes.push_back({ static_cast<int>(tex.width), static_cast<int>(tex.height) });
+		while (streamed.sizes.back().first > 1 || streamed.sizes.back().second > 1) {
+			auto [width, height] = streamed.sizes.back();
+			int new_width = std::max(width / 2, 1);
+			int new_height = std::max(height / 2, 1);
+			streamed.mips.push_back(downsample(streamed.mips.back(), width, height, streamed.n_channels, new_width, new_height));
+			streamed.sizes.push_back({ new_width, new_height });
+		}
+		int n_levels = static_cast<int>(streamed.mips.size());
+		streamed.resident = n_levels - 1;
+		while (streamed.resident > 0 && std::max(streamed.sizes[streamed.resident - 1].first, streamed.sizes[streamed.resident - 1].second) <= initial_size_) {
+			streamed.resident--;
+		}
+		streamed.requested = -1;
+
+		unsigned int tex_id;
+		glGenTextures(1, &tex_id);
+		GLState::bindTexture(tex_id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, streamed.resident);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, n_levels - 1);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (int level = streamed.resident; level < n_levels; level++) {
+			upload(tex_id, streamed, level);
+		}
+
+		stats_.resident_bytes += tailBytes(streamed, streamed.resident);
+		stats_.n_textures++;
+		textures_[tex_id] = std::move(streamed);
+		return tex_id;
+	}
+
+	//mip is the level the texture is seen at, fractional levels round towards finer
+	void request(unsigned int tex_id, float mip) {
+		auto it = textures_.find(tex_id);
+		if (it == textures_.end()) {
+			return;
+		}
+		Streamed& streamed = it->second;
+		int level = std::clamp(static_cast<int>(std::floor(mip)), 0, static_cast<int>(streamed.mips.size()) - 1);
+		streamed.requested = streamed.requested < 0 ? level : std::min(streamed.requested, level);
+	}
+
+	//call once a frame after everything has made its requests
+	void update() {
+		//what everything wants. textures nobody asked for fall back to their smallest level
+		std::vector<std::pair<unsigned int, int>> targets;
+		size_t total = 0;
+		stats_.requested_bytes = 0;
+		for (auto& [tex_id, streamed] : textures_) {
+			int target = streamed.requested < 0 ? static_cast<int>(streamed.mips.size()) - 1 : streamed.requested;
+			targets.push_back({ tex_id, target });
+			total += tailBytes(streamed, target);
+			stats_.requested_bytes += streamed.requested < 0 ? 0 : tailBytes(streamed, target);
+			streamed.requested = -1;
+		}
+
+		//over budget, drop the largest finest level of anything until it fits
+		while (total > budget_) {
+			int largest = -1;
+			size_t largest_bytes = 0;
+			for (int i = 0; i < static_cast<int>(targets.size()); i++) {
+				const Streamed& streamed = textures_.at(targets[i].first);
+				if (targets[i].second < static_cast<int>(streamed.mips.size()) - 1 && levelBytes(streamed, targets[i].second) > largest_bytes) {
+					largest = i;
+					largest_bytes = levelBytes(streamed, targets[i].second);
+				}
+			}
+			if (largest < 0) {
+				break;
+			}
+			total -= largest_bytes;
+			targets[largest].second++;
+		}
+
+		//evicting is cheap and frees room right away, uploads go one level per texture per update
+		stats_.n_uploads = 0;
+		stats_.n_evictions = 0;
+		for (const auto& [tex_id, target] : targets) {
+			Streamed& streamed = textures_.at(tex_id);
+			if (target == streamed.resident) {
+				continue;
+			}
+			GLState::bindTexture(tex_id);
+			if (target > streamed.resident) {
+				for (int level = streamed.resident; level < target; level++) {
+					glTexImage2D(GL_TEXTURE_2D, level, streamed.format, 0, 0, 0, streamed.format, GL_UNSIGNED_BYTE, NULL);
+					stats_.resident_bytes -= levelBytes(streamed, level);
+					stats_.n_evictions++;
+				}
+				streamed.resident = target;
+			} else if (stats_.n_uploads < static_cast<size_t>(max_uploads_per_update_)) {
+				glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+				streamed.resident--;
+				upload(tex_id, streamed, streamed.resident);
+				stats_.resident_bytes += levelBytes(streamed, streamed.resident);
+				stats_.n_uploads++;
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, streamed.resident);
+		}
+	}
+
+	const Stats& getStats() const {
+		return stats_;
+	}
+};
+
+#endif
@@ -0,0 +1,259 @@
+#pragma once
+
+#ifndef PUPPET_TRIANGLE_SOA
+#define PUPPET_TRIANGLE_SOA
+
+#include <Eigen/Dense>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PUPPET_TRIANGLE_SOA_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PUPPET_TRIANGLE_SOA_SSE
+#endif
+
+//triangles stored as structure of arrays so a segment can be tested against a pack of them at once:
+//8 with avx, 4 with sse and one at a time otherwise. the release configs build with /arch:AVX2, debug
+//ones get sse. each triangle keeps its first corner, its two edges from that corner and their cross
+//product, so a test is möller-trumbore with no setup.
+//the arrays are padded to a whole pack with degenerate triangles that never hit.
+//solves the same system as MeshSurface::crossesTriangle, e1 + k*(e2-e1) = t1 + a*(t2-t1) + b*(t3-t1),
+//and hits on the same conditions, 0<=k<=1, a>=0, b>=0, a+b<=1, nonzero determinant
+class TriangleSoA {
+#if defined(PUPPET_TRIANGLE_SOA_AVX)
+	static constexpr int lanes_ = 8;
+#elif defined(PUPPET_TRIANGLE_SOA_SSE)
+	static constexpr int lanes_ = 4;
+#else
+	static constexpr int lanes_ = 1;
+#endif
+
+	//corner, edge a = t2-t1, edge b = t3-t1, normal n = a x b
+	std::vector<float> x_, y_, z_;
+	std::vector<float> ax_, ay_, az_;
+	std::vector<float> bx_, by_, bz_;
+	std::vector<float> nx_, ny_, nz_;
+	size_t n_triangles_; //slots in use, not counting the padding after the last triangle
+
+public:
+
+	//the kernel is written once over a pack type, a pack being lanes_ floats with the arithmetic and
+	//compares needed. compares give masks, bits(mask) has bit i set if lane i passed
+#if defined(PUPPET_TRIANGLE_SOA_AVX)
+	struct Pack {
+		__m256 v;
+		static Pack load(const float* p) { return { _mm256_loadu_ps(p) }; }
+		static Pack broadcast(float f) { return { _mm256_set1_ps(f) }; }
+		Pack operator+(Pack o) const { return { _mm256_add_ps(v, o.v) }; }
+		Pack operator-(Pack o) const { return { _mm256_sub_ps(v, o.v) }; }
+		Pack operator*(Pack o) const { return { _mm256_mul_ps(v, o.v) }; }
+		Pack operator/(Pack o) const { return { _mm256_div_ps(v, o.v) }; }
+		Pack operator>=(Pack o) const { return { _mm256_cmp_ps(v, o.v, _CMP_GE_OQ) }; }
+		Pack operator<=(Pack o) const { return { _mm256_cmp_ps(v, o.v, _CMP_LE_OQ) }; }
+		Pack operator!=(Pack o) const { return { _mm256_cmp_ps(v, o.v, _CMP_NEQ_OQ) }; }
+		Pack operator&(Pack o) const { return { _mm256_and_ps(v, o.v) }; }
+		int bits() const { return _mm256_movemask_ps(v); }
+		void store(float* p) const { _mm256_storeu_ps(p, v); }
+	};
+#elif defined(PUPPET_TRIANGLE_SOA_SSE)
+	struct Pack {
+		__m128 v;
+		static Pack load(const float* p) { return { _mm_loadu_ps(p) }; }
+		static Pack broadcast(float f) { return { _mm_set1_ps(f) }; }
+		Pack operator+(Pack o) const { return { _mm_add_ps(v, o.v) }; }
+		Pack operator-(Pack o) const { return { _mm_sub_ps(v, o.v) }; }
+		Pack operator*(Pack o) const { return { _mm_mul_ps(v, o.v) }; }
+		Pack operator/(Pack o) const { return { _mm_div_ps(v, o.v) }; }
+		Pack operator>=(Pack o) const { return { _mm_cmpge_ps(v, o.v) }; }
+		Pack operator<=(Pack o) const { return { _mm_cmple_ps(v, o.v) }; }
+		Pack operator!=(Pack o) const { return { _mm_cmpneq_ps(v, o.v) }; }
+		Pack operator&(Pack o) const { return { _mm_and_ps(v, o.v) }; }
+		int bits() const { return _mm_movemask_ps(v); }
+		void store(float* p) const { _mm_storeu_ps(p, v); }
+	};
+#else
+	struct Pack {
+		float v;
+		bool mask = false;
+		static Pack load(const float* p) { return { *p }; }
+		static Pack broadcast(float f) { return { f }; }
+		Pack operator+(Pack o) const { return { v + o.v }; }
+		Pack operator-(Pack o) const { return { v - o.v }; }
+		Pack operator*(Pack o) const { return { v * o.v }; }
+		Pack operator/(Pack o) const { return { v / o.v }; }
+		Pack operator>=(Pack o) const { return { 0, v >= o.v }; }
+		Pack operator<=(Pack o) const { return { 0, v <= o.v }; }
+		Pack operator!=(Pack o) const { return { 0, v != o.v }; }
+		Pack operator&(Pack o) const { return { 0, mask && o.mask }; }
+		int bits() const { return mask ? 1 : 0; }
+		void store(float* p) const { *p = v; }
+	};
+#endif
+
+	//a segment broadcast across a pack, made once and tested against any number of packs
+	struct Segment {
+		Pack ex, ey, ez; //first end
+		Pack dx, dy, dz; //second end - first end
+	};
+
+	static Segment makeSegment(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2) {
+		Eigen::Vector3f d = e2 - e1;
+		return { Pack::broadcast(e1(0)), Pack::broadcast(e1(1)), Pack::broadcast(e1(2)),
+			Pack::broadcast(d(0)), Pack::broadcast(d(1)), Pack::broadcast(d(2)) };
+	}
+
+	//bit i of the result is set if the segment hits triangle first+i, k of each lane goes to k_out.
+	//first has to be a multiple of lanes()
+	int testPack(const Segment& s, size_t first, float* k_out) const {
+		const Pack zero = Pack::broadcast(0);
+		const Pack one = Pack::broadcast(1);
+
+		//t = e1 - corner
+		Pack tx = s.ex - Pack::load(&x_[first]);
+		Pack ty = s.ey - Pack::load(&y_[first]);
+		Pack tz = s.ez - Pack::load(&z_[first]);
+
+		//det = a.(d x b) = -d.n, k = t.n/det
+		Pack nx = Pack::load(&nx_[first]);
+		Pack ny = Pack::load(&ny_[first]);
+		Pack nz = Pack::load(&nz_[first]);
+		Pack det = zero - (s.dx * nx + s.dy * ny + s.dz * nz);
+		Pack k = (tx * nx + ty * ny + tz * nz) / det;
+		Pack hit = (det != zero) & (k >= zero) & (k <= one);
+		//most triangles are nowhere near the segment's line, skip the rest of the test for them
+		if (hit.bits() == 0) {
+			return 0;
+		}
+
+		Pack ax = Pack::load(&ax_[first]);
+		Pack ay = Pack::load(&ay_[first]);
+		Pack az = Pack::load(&az_[first]);
+		Pack bx = Pack::load(&bx_[first]);
+		Pack by = Pack::load(&by_[first]);
+		Pack bz = Pack::load(&bz_[first]);
+
+		//u = t.(d x b)/det
+		Pack px = s.dy * bz - s.dz * by;
+		Pack py = s.dz * bx - s.dx * bz;
+		Pack pz = s.dx * by - s.dy * bx;
+		Pack u = (tx * px + ty * py + tz * pz) / det;
+		//v = d.(t x a)/det
+		Pack qx = ty * az - tz * ay;
+		Pack qy = tz * ax - tx * az;
+		Pack qz = tx * ay - ty * ax;
+		Pack v = (s.dx * qx + s.dy * qy + s.dz * qz) / det;
+
+		hit = hit & (u >= zero) & (v >= zero) & (u + v <= one);
+		k.store(k_out);
+		return hit.bits();
+	}
+
+private:
+	void pad() {
+		while (x_.size() % lanes_ != 0) {
+			for (std::vector<float>* arr : { &x_, &y_, &z_, &ax_, &ay_, &az_, &bx_, &by_, &bz_, &nx_, &ny_, &nz_ }) {
+				arr->push_back(0);
+			}
+		}
+	}
+
+public:
+	TriangleSoA() : n_triangles_(0) {}
+
+	//appends after the last triangle, reusing the padding of the last pack if there is any
+	void add(const Eigen::Vector3f& t1, const Eigen::Vector3f& t2, const Eigen::Vector3f& t3) {
+		x_.resize(n_triangles_); y_.resize(n_triangles_); z_.resize(n_triangles_);
+		ax_.resize(n_triangles_); ay_.resize(n_triangles_); az_.resize(n_triangles_);
+		bx_.resize(n_triangles_); by_.resize(n_triangles_); bz_.resize(n_triangles_);
+		nx_.resize(n_triangles_); ny_.resize(n_triangles_); nz_.resize(n_triangles_);
+
+		Eigen::Vector3f a = t2 - t1;
+		Eigen::Vector3f b = t3 - t1;
+		Eigen::Vector3f n = a.cross(b);
+		x_.push_back(t1(0)); y_.push_back(t1(1)); z_.push_back(t1(2));
+		ax_.push_back(a(0)); ay_.push_back(a(1)); az_.push_back(a(2));
+		bx_.push_back(b(0)); by_.push_back(b(1)); bz_.push_back(b(2));
+		nx_.push_back(n(0)); ny_.push_back(n(1)); nz_.push_back(n(2));
+		n_triangles_++;
+		pad();
+	}
+
+	//puts a different triangle in a slot that already has one
+	void set(size_t slot, const Eigen::Vector3f& t1, const Eigen::Vector3f& t2, const Eigen::Vector3f& t3) {
+		Eigen::Vector3f a = t2 - t1;
+		Eigen::Vector3f b = t3 - t1;
+		Eigen::Vector3f n = a.cross(b);
+		x_[slot] = t1(0); y_[slot] = t1(1); z_[slot] = t1(2);
+		ax_[slot] = a(0); ay_[slot] = a(1); az_[slot] = a(2);
+		bx_[slot] = b(0); by_[slot] = b(1); bz_[slot] = b(2);
+		nx_[slot] = n(0); ny_[slot] = n(1); nz_[slot] = n(2);
+	}
+
+	//makes the next add start a new pack, so a run of triangles can be tested on its own
+	void endPack() {
+		n_triangles_ = x_.size();
+	}
+
+	//in slots, padding included. a multiple of lanes()
+	size_t slots() const {
+		return x_.size();
+	}
+
+	void clear() {
+		for (std::vector<float>* arr : { &x_, &y_, &z_, &ax_, &ay_, &az_, &bx_, &by_, &bz_, &nx_, &ny_, &nz_ }) {
+			arr->clear();
+		}
+		n_triangles_ = 0;
+	}
+
+	static constexpr int lanes() {
+		return lanes_;
+	}
+
+	//slot of the first triangle, in the order they were added, the segment e1 e2 crosses, -1 for
+	//none. without endPack slots are just the order triangles were added in. k, if not null, gets where along the segment it crosses that one
+	int firstHit(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, float* k = nullptr) const {
+		Segment s = makeSegment(e1, e2);
+		float ks[lanes_];
+		for (size_t first = 0; first < x_.size(); first += lanes_) {
+			int bits = testPack(s, first, ks);
+			if (bits != 0) {
+				int lane = 0;
+				while (!(bits & (1 << lane))) {
+					lane++;
+				}
+				if (k != nullptr) {
+					*k = ks[lane];
+				}
+				return static_cast<int>(first) + lane;
+			}
+		}
+		return -1;
+	}
+
+	//slot of the triangle the segment e1 e2 crosses first going from e1, -1 for none. ties go to the
+	//lower slot
+	int nearestHit(const Eigen::Vector3f& e1, const Eigen::Vector3f& e2, float* k = nullptr) const {
+		Segment s = makeSegment(e1, e2);
+		float ks[lanes_];
+		int best = -1;
+		float best_k = 0;
+		for (size_t first = 0; first < x_.size(); first += lanes_) {
+			int bits = testPack(s, first, ks);
+			for (int lane = 0; bits != 0; lane++, bits >>= 1) {
+				if ((bits & 1) && (best < 0 || ks[lane] < best_k)) {
+					best = static_cast<int>(first) + lane;
+					best_k = ks[lane];
+				}
+			}
+		}
+		if (best >= 0 && k != nullptr) {
+			*k = best_k;
+		}
+		return best;
+	}
+};
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef PUPPET_UI_BINDING
+#define PUPPET_UI_BINDING
+
+#include <Eigen/Dense>
+#include <string>
+#include <cmath>
+
+//how far apart two values are as far as the display is concerned
+inline float displayDistance(float a, float b) {
+	return std::abs(a - b);
+}
+
+template<class Derived>
+float displayDistance(const Eigen::MatrixBase<Derived>& a, const Eigen::MatrixBase<Derived>& b) {
+	return (a - b).cwiseAbs().maxCoeff();
+}
+
+//text made from a value. update() is meant to be called every frame with the current value, the
+//text is only re-made when the value moved by at least the display step since it was last made, so
+//a value that isnt changing costs one compare instead of a format
+template<class Value>
+class TextBinding {
+	Value shown_;
+	float step_;
+	bool valid_;
+	std::string text_;
+
+public:
+	TextBinding(float step) : shown_(), step_(step), valid_(false) {}
+
+	//format takes the value and returns the text. returns true if the text was re-made
+	template<class Format>
+	bool update(const Value& value, Format format) {
+		if (valid_ && displayDistance(value, shown_) < step_) {
+			return false;
+		}
+		shown_ = value;
+		text_ = format(value);
+		valid_ = true;
+		return true;
+	}
+
+	//forces the next update to re-make the text, for when the format depends on more than the value
+	void invalidate() {
+		valid_ = false;
+	}
+
+	const std::string& getText() const {
+		return text_;
+	}
+};
+
+#endif
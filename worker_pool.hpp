@@ -0,0 +1,114 @@
+#pragma once
+
+#ifndef PUPPET_WORKER_POOL
+#define PUPPET_WORKER_POOL
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+//threads that stay around between frames waiting for work, so a per frame stage doesnt pay for
+//starting threads every time. the thread calling parallelFor works too, it returns once every job
+//is done
+class WorkerPool {
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable done_;
+
+	const std::function<void(size_t)>* job_;
+	size_t n_jobs_;
+	std::atomic<size_t> next_job_;
+	int n_working_; //threads that havent finished the current batch
+	uint64_t batch_; //bumped for every parallelFor so a thread never runs one twice
+	bool stopping_;
+
+	void runJobs() {
+		for (size_t i = next_job_++; i < n_jobs_; i = next_job_++) {
+			(*job_)(i);
+		}
+	}
+
+	void work() {
+		uint64_t last_batch = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				start_.wait(lock, [&]() { return stopping_ || batch_ != last_batch; });
+				if (stopping_) {
+					return;
+				}
+				last_batch = batch_;
+			}
+			runJobs();
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				n_working_--;
+			}
+			done_.notify_one();
+		}
+	}
+
+public:
+	//n_threads counts the caller, so 1 runs everything on the caller
+	explicit WorkerPool(unsigned int n_threads = std::thread::hardware_concurrency()) :job_(nullptr), n_jobs_(0), next_job_(0), n_working_(0), batch_(0), stopping_(false) {
+		for (unsigned int i = 1; i < std::max(n_threads, 1u); i++) {
+			threads_.emplace_back(&WorkerPool::work, this);
+		}
+	}
+
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		start_.notify_all();
+		for (std::thread& thread : threads_) {
+			thread.join();
+		}
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	//job(i) for every i below n_jobs, in no particular order and on any thread
+	void parallelFor(size_t n_jobs, const std::function<void(size_t)>& job) {
+		if (threads_.empty() || n_jobs < 2) {
+			for (size_t i = 0; i < n_jobs; i++) {
+				job(i);
+			}
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job_ = &job;
+			n_jobs_ = n_jobs;
+			next_job_ = 0;
+			n_working_ = static_cast<int>(threads_.size());
+			batch_++;
+		}
+		start_.notify_all();
+		runJobs();
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_.wait(lock, [&]() { return n_working_ == 0; });
+		job_ = nullptr;
+	}
+
+	//threads including the caller
+	size_t size() const {
+		return threads_.size() + 1;
+	}
+
+	//one pool for everything that doesnt need its own
+	static WorkerPool& shared() {
+		static WorkerPool pool;
+		return pool;
+	}
+};
+
+#endif
@@ -90,6 +90,50 @@ protected:
 		return false;
 	}
 
+	//a move only crosses the zmap going off the level or through a floor or ceiling. where is found by
+	//halving like any surface, the normal by probing a cell on from there. if going on up or down
+	//crosses it hit a floor or ceiling and the normal is the slope of it there, otherwise it hit the
+	//edge of the level and the normal is along the ground, away from whichever sides are blocked
+	bool firstCrossing(Eigen::Vector3f first_state, Eigen::Vector3f second_state, float* k, Eigen::Vector3f* normal) const override {
+		if (!Region<3>::firstCrossing(first_state, second_state, k, normal)) {
+			return false;
+		}
+		Eigen::Vector3f move = second_state - first_state;
+		Eigen::Vector3f free = first_state + *k * move;
+		float cell = std::max(map_width_ / x_resolution_, map_height_ / y_resolution_);
+		Eigen::Vector3f facing = Eigen::Vector3f::Zero();
+
+		Eigen::Vector3f probe = free;
+		probe(1) += std::copysign(cell, move(1));
+		if (move(1) != 0 && crossesSurface(free, probe)) {
+			//heights a cell either side, looked for up to a cell past free so a slope rising away is found
+			float reach = move(1) < 0 ? cell : -cell;
+			auto height = [&](const Eigen::Vector3f& at) {
+				std::pair<zdata, zdata> z = getZdata(at, reach);
+				return move(1) < 0 ? z.first.z : z.second.z;
+			};
+			float dx = height(free + cell * Eigen::Vector3f::UnitX()) - height(free - cell * Eigen::Vector3f::UnitX());
+			float dz = height(free + cell * Eigen::Vector3f::UnitZ()) - height(free - cell * Eigen::Vector3f::UnitZ());
+			Eigen::Vector3f up = Eigen::Vector3f::UnitY();
+			if (std::isfinite(dx) && std::isfinite(dz)) {
+				up = Eigen::Vector3f(-dx / (2 * cell), 1, -dz / (2 * cell)).normalized();
+			}
+			facing = move(1) < 0 ? up : Eigen::Vector3f(-up);
+		} else {
+			for (int axis : { 0, 2 }) {
+				probe = free;
+				probe(axis) += std::copysign(cell, move(axis));
+				if (move(axis) != 0 && crossesSurface(free, probe)) {
+					facing(axis) = -std::copysign(1.f, move(axis));
+				}
+			}
+		}
+		if (facing.squaredNorm() > 0) {
+			*normal = facing.normalized();
+		}
+		return true;
+	}
+
 public:
 	Zmap(int y_resolution, int x_resolution, float map_height, float map_width, float xy_padding) :
 		x_resolution_(x_resolution),